@@ -40,12 +40,15 @@ public class BetterPA : ModuleRules
 				"SlateCore",
 				"UnrealEd",
 				"PhysicsCore",
+				"Chaos",
 				"AnimationCore",
 				"ToolMenus",
 				"ContentBrowser",
 				"AssetTools",
+				"AssetRegistry",
 				"InputCore",
-				"GraphEditor"
+				"GraphEditor",
+				"DesktopPlatform"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
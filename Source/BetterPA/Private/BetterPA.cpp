@@ -1,5 +1,9 @@
 #include "BetterPA.h"
 #include "BetterPAGenerator.h"
+#include "BetterPAShapePriors.h"
+#include "BetterPABodyClassifier.h"
+#include "BetterPAConstraintBuilder.h"
+#include "BetterPAInterchange.h"
 #include "ContentBrowserModule.h"
 #include "IContentBrowserSingleton.h"
 #include "Engine/SkeletalMesh.h"
@@ -8,8 +12,23 @@
 #include "Factories/PhysicsAssetFactory.h"
 #include "SBetterPABonePicker.h"
 #include "SBetterPAConstraintGraph.h"
+#include "SBetterPAFitReport.h"
+#include "SBetterPAPreviewViewport.h"
+#include "BetterPAFitAnalysis.h"
+#include "BetterPAAudit.h"
+#include "SBetterPAAuditReport.h"
 #include "Widgets/SWindow.h"
 #include "Framework/Application/SlateApplication.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "Widgets/Notifications/SNotificationList.h"
+#include "Widgets/Input/SCheckBox.h"
+#include "Widgets/Text/STextBlock.h"
+#include "Animation/AnimSequence.h"
+#include "UObject/StrongObjectPtr.h"
+#include "DesktopPlatformModule.h"
+#include "IDesktopPlatform.h"
+#include "Misc/Paths.h"
+#include "Algo/Count.h"
 
 #define LOCTEXT_NAMESPACE "FBetterPAModule"
 
@@ -23,12 +42,17 @@ void FBetterPAModule::StartupModule()
 	
 	MenuExtenderDelegates.Add(FContentBrowserMenuExtender_SelectedAssets::CreateRaw(this, &FBetterPAModule::OnExtendContentBrowserAssetSelectionMenu));
 	MenuExtenderDelegates.Add(FContentBrowserMenuExtender_SelectedAssets::CreateRaw(this, &FBetterPAModule::OnExtendContentBrowserPhysicsAssetSelectionMenu));
+
+	ContentBrowserModule.GetAllPathViewContextMenuExtenders().Add(FContentBrowserMenuExtender_SelectedPaths::CreateRaw(this, &FBetterPAModule::OnExtendContentBrowserPathSelectionMenu));
+
+	AutoRegenerator.Register();
 }
 
 void FBetterPAModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	AutoRegenerator.Unregister();
 }
 
 TSharedRef<FExtender> FBetterPAModule::OnExtendContentBrowserAssetSelectionMenu(const TArray<FAssetData>& SelectedAssets)
@@ -83,6 +107,27 @@ void FBetterPAModule::AddPhysicsAssetMenuEntry(FMenuBuilder& MenuBuilder, FAsset
 		FSlateIcon(),
 		FUIAction(FExecuteAction::CreateRaw(this, &FBetterPAModule::OnOpenConstraintGraph, SelectedAsset))
 	);
+
+	MenuBuilder.AddMenuEntry(
+		LOCTEXT("AnalyzeFitQuality", "Analyze Fit Quality"),
+		LOCTEXT("AnalyzeFitQualityTooltip", "Measures how well each body covers the skinned vertices of its bones."),
+		FSlateIcon(),
+		FUIAction(FExecuteAction::CreateRaw(this, &FBetterPAModule::OnAnalyzeFitQuality, SelectedAsset))
+	);
+
+	MenuBuilder.AddMenuEntry(
+		LOCTEXT("ExportInterchange", "Export Physics Interchange"),
+		LOCTEXT("ExportInterchangeTooltip", "Writes the bodies and constraints to a binary interchange file and a text dump in Saved/BetterPA/Interchange."),
+		FSlateIcon(),
+		FUIAction(FExecuteAction::CreateRaw(this, &FBetterPAModule::OnExportInterchange, SelectedAsset))
+	);
+
+	MenuBuilder.AddMenuEntry(
+		LOCTEXT("ImportInterchange", "Import Physics Interchange"),
+		LOCTEXT("ImportInterchangeTooltip", "Replaces the bodies and constraints with the ones in an interchange file, matched to the preview mesh's bones by name."),
+		FSlateIcon(),
+		FUIAction(FExecuteAction::CreateRaw(this, &FBetterPAModule::OnImportInterchange, SelectedAsset))
+	);
 }
 
 void FBetterPAModule::OnGenerateBetterPA(FAssetData SelectedAsset)
@@ -95,61 +140,345 @@ void FBetterPAModule::OnGenerateBetterPA(FAssetData SelectedAsset)
 
 	TSharedPtr<SWindow> PickerWindow;
 	TSharedPtr<SBetterPABonePicker> BonePicker;
+	TSharedPtr<SBetterPAPreviewViewport> PreviewViewport;
+	TSharedRef<FBetterPAGenerationSettings> Settings = MakeShared<FBetterPAGenerationSettings>();
+	Settings->ShapePriors = FBetterPAShapePriors::LoadDefault();
+	// Keeps the pose animations loaded while the window and its background previews use them
+	TSharedRef<TArray<TStrongObjectPtr<UAnimSequence>>> PoseAnimations = MakeShared<TArray<TStrongObjectPtr<UAnimSequence>>>();
 
 	PickerWindow = SNew(SWindow)
 		.Title(LOCTEXT("SelectBones", "Select Bones for Physics Asset"))
-		.ClientSize(FVector2D(400, 600))
+		.ClientSize(FVector2D(1000, 650))
 		.SupportsMinimize(false)
 		.SupportsMaximize(false);
 
-	BonePicker = SNew(SBetterPABonePicker)
+	PreviewViewport = SNew(SBetterPAPreviewViewport)
 		.SkeletalMesh(SkeletalMesh);
 
+	BonePicker = SNew(SBetterPABonePicker)
+		.SkeletalMesh(SkeletalMesh)
+		.OnBonesToggled_Lambda([PreviewViewport, Settings](const TArray<FName>& ToggledBones, const TSet<FName>& SelectedBones)
+		{
+			PreviewViewport->RequestUpdate(SelectedBones, ToggledBones, *Settings, false);
+		});
+
 	PickerWindow->SetContent(
-		SNew(SVerticalBox)
-		+ SVerticalBox::Slot()
-		.FillHeight(1.0f)
-		[
-			BonePicker.ToSharedRef()
-		]
-		+ SVerticalBox::Slot()
-		.AutoHeight()
-		.HAlign(HAlign_Right)
-		.Padding(10)
+		SNew(SHorizontalBox)
+		+ SHorizontalBox::Slot()
+		.FillWidth(0.4f)
 		[
-			SNew(SHorizontalBox)
-			+ SHorizontalBox::Slot()
-			.AutoWidth()
+			SNew(SVerticalBox)
+			+ SVerticalBox::Slot()
+			.FillHeight(1.0f)
+			[
+				BonePicker.ToSharedRef()
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 10, 10, 0)
+			[
+				SNew(SCheckBox)
+				.IsChecked_Lambda([Settings]() { return Settings->bOptimizeFit ? ECheckBoxState::Checked : ECheckBoxState::Unchecked; })
+				.OnCheckStateChanged_Lambda([Settings, BonePicker, PreviewViewport](ECheckBoxState NewState)
+				{
+					Settings->bOptimizeFit = (NewState == ECheckBoxState::Checked);
+					PreviewViewport->RequestUpdate(BonePicker->GetSelectedBones(), TArray<FName>(), *Settings, true);
+				})
+				.ToolTipText(LOCTEXT("OptimizeFitTooltip", "Refine each capsule against the skinned vertices of its bones."))
+				[
+					SNew(STextBlock).Text(LOCTEXT("OptimizeFit", "Optimize Fit to Mesh"))
+				]
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
+			[
+				SNew(SCheckBox)
+				.IsEnabled(Settings->ShapePriors.IsValid())
+				.IsChecked_Lambda([Settings]() { return Settings->bUseShapePriors ? ECheckBoxState::Checked : ECheckBoxState::Unchecked; })
+				.OnCheckStateChanged_Lambda([Settings, BonePicker, PreviewViewport](ECheckBoxState NewState)
+				{
+					Settings->bUseShapePriors = (NewState == ECheckBoxState::Checked);
+					PreviewViewport->RequestUpdate(BonePicker->GetSelectedBones(), TArray<FName>(), *Settings, true);
+				})
+				.ToolTipText(Settings->ShapePriors.IsValid()
+					? FText::Format(LOCTEXT("UseShapePriorsTooltip", "Start capsules and limits from proportions learned from {0} physics assets in the project."), Settings->ShapePriors->Sources.Num())
+					: LOCTEXT("NoShapePriorsTooltip", "No shape priors yet. Right-click a content folder and choose Learn Shape Priors."))
+				[
+					SNew(STextBlock).Text(LOCTEXT("UseShapePriors", "Use Learned Shape Priors"))
+				]
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
+			[
+				SNew(SHorizontalBox)
+				.IsEnabled_Lambda([Settings]() { return Settings->bOptimizeFit; })
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				[
+					SNew(SButton)
+					.Text(LOCTEXT("UseSelectedAnimations", "Fit Selected Animations"))
+					.ToolTipText(LOCTEXT("UseSelectedAnimationsTooltip", "Also fit to frames sampled from the animation sequences selected in the Content Browser. Select none to fit the reference pose only."))
+					.OnClicked_Lambda([SkeletalMesh, Settings, PoseAnimations, BonePicker, PreviewViewport]()
+					{
+						TArray<FAssetData> SelectedAssets;
+						FModuleManager::LoadModuleChecked<FContentBrowserModule>("ContentBrowser").Get().GetSelectedAssets(SelectedAssets);
+
+						PoseAnimations->Reset();
+						Settings->PoseAnimations.Reset();
+						for (const FAssetData& AssetData : SelectedAssets)
+						{
+							UAnimSequence* Animation = Cast<UAnimSequence>(AssetData.GetAsset());
+							if (Animation && Animation->GetSkeleton() == SkeletalMesh->GetSkeleton())
+							{
+								PoseAnimations->Emplace(Animation);
+								Settings->PoseAnimations.Add(Animation);
+							}
+						}
+
+						PreviewViewport->RequestUpdate(BonePicker->GetSelectedBones(), TArray<FName>(), *Settings, true);
+						return FReply::Handled();
+					})
+				]
+				+ SHorizontalBox::Slot()
+				.VAlign(VAlign_Center)
+				.Padding(8, 0, 0, 0)
+				[
+					SNew(STextBlock)
+					.Text_Lambda([Settings]()
+					{
+						return Settings->PoseAnimations.Num() > 0
+							? FText::Format(LOCTEXT("PoseAnimationCount", "{0} animations, {1} frames each"), Settings->PoseAnimations.Num(), Settings->PoseSamplesPerAnimation)
+							: LOCTEXT("ReferencePoseOnly", "Reference pose only");
+					})
+				]
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
+			[
+				SNew(SCheckBox)
+				.IsChecked_Lambda([Settings]() { return Settings->bChainMode ? ECheckBoxState::Checked : ECheckBoxState::Unchecked; })
+				.OnCheckStateChanged_Lambda([Settings, BonePicker, PreviewViewport](ECheckBoxState NewState)
+				{
+					Settings->bChainMode = (NewState == ECheckBoxState::Checked);
+					PreviewViewport->RequestUpdate(BonePicker->GetSelectedBones(), TArray<FName>(), *Settings, true);
+				})
+				.ToolTipText(LOCTEXT("ChainModeTooltip", "Hair, tails and straps get a body on every few bones only, limits that loosen towards the tip and no collision inside the chain."))
+				[
+					SNew(STextBlock).Text(LOCTEXT("ChainMode", "Optimize Bone Chains"))
+				]
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
+			[
+				SNew(SCheckBox)
+				.IsChecked_Lambda([Settings]() { return Settings->bSweepJointLimits ? ECheckBoxState::Checked : ECheckBoxState::Unchecked; })
+				.OnCheckStateChanged_Lambda([Settings, BonePicker, PreviewViewport](ECheckBoxState NewState)
+				{
+					Settings->bSweepJointLimits = (NewState == ECheckBoxState::Checked);
+					PreviewViewport->RequestUpdate(BonePicker->GetSelectedBones(), TArray<FName>(), *Settings, true);
+				})
+				.ToolTipText(LOCTEXT("SweepJointLimitsTooltip", "Swing and twist each body about its joint and limit it where it starts passing into its parent or a neighbouring limb, instead of using fixed 45 degree limits."))
+				[
+					SNew(STextBlock).Text(LOCTEXT("SweepJointLimits", "Limits From Geometry"))
+				]
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
+			[
+				SNew(SCheckBox)
+				.IsChecked_Lambda([Settings]() { return Settings->ConstraintProfiles.Num() > 0 ? ECheckBoxState::Checked : ECheckBoxState::Unchecked; })
+				.OnCheckStateChanged_Lambda([Settings, BonePicker, PreviewViewport](ECheckBoxState NewState)
+				{
+					Settings->ConstraintProfiles = NewState == ECheckBoxState::Checked ? BetterPA::GetRagdollProfilePresets() : TArray<FBetterPAConstraintProfileRule>();
+					PreviewViewport->RequestUpdate(BonePicker->GetSelectedBones(), TArray<FName>(), *Settings, true);
+				})
+				.ToolTipText(LOCTEXT("RagdollProfilesTooltip", "Write LimpDeath, Stumble and HitReaction constraint profiles into the asset, so game code can switch behaviours with SetConstraintProfile instead of swapping physics assets."))
+				[
+					SNew(STextBlock).Text(LOCTEXT("RagdollProfiles", "Add Ragdoll Profiles"))
+				]
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
+			[
+				SNew(SCheckBox)
+				.IsChecked_Lambda([Settings]() { return Settings->bClassifyBodies ? ECheckBoxState::Checked : ECheckBoxState::Unchecked; })
+				.OnCheckStateChanged_Lambda([Settings, BonePicker, PreviewViewport](ECheckBoxState NewState)
+				{
+					Settings->bClassifyBodies = (NewState == ECheckBoxState::Checked);
+					PreviewViewport->RequestUpdate(BonePicker->GetSelectedBones(), TArray<FName>(), *Settings, true);
+				})
+				.ToolTipText(LOCTEXT("ClassifyBodiesTooltip", "Make helper, small, deep and chain bodies kinematic or query-only, so partial ragdolls simulate and collide fewer bodies."))
+				[
+					SNew(STextBlock).Text(LOCTEXT("ClassifyBodies", "Classify Bodies"))
+				]
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
+			[
+				SNew(STextBlock)
+				.Text_Lambda([Settings, PreviewViewport]()
+				{
+					TSharedPtr<const FBetterPAGenerationResult> Result = PreviewViewport->GetUpToDateResult();
+					if (!Result.IsValid() || !Settings->bClassifyBodies)
+					{
+						return FText::GetEmpty();
+					}
+
+					const FBetterPABodyClassSummary Summary = FBetterPABodyClassifier::Summarize(*Result);
+					return FText::Format(LOCTEXT("ClassSummary", "Simulated bodies: {0} of {1}, contact shapes: {2} of {3}, query shapes: {4} of {3}"),
+						Summary.NumSimulated, Summary.NumBodies, Summary.NumContactShapes, Summary.NumShapes, Summary.NumQueryShapes);
+				})
+				.ToolTipText_Lambda([PreviewViewport]()
+				{
+					TSharedPtr<const FBetterPAGenerationResult> Result = PreviewViewport->GetUpToDateResult();
+					if (!Result.IsValid())
+					{
+						return FText::GetEmpty();
+					}
+
+					const FBetterPABodyClassSummary Summary = FBetterPABodyClassifier::Summarize(*Result);
+					FString Report;
+					for (int32 ClassIndex = 0; ClassIndex < (int32)EBetterPABodyClass::Num; ++ClassIndex)
+					{
+						Report += FString::Printf(TEXT("%s: %d bodies\n"), FBetterPABodyClassifier::GetClassName((EBetterPABodyClass)ClassIndex), Summary.NumPerClass[ClassIndex]);
+					}
+					return FText::FromString(Report.TrimEnd());
+				})
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
 			[
-				SNew(SButton)
-				.Text(LOCTEXT("Generate", "Generate"))
-				.OnClicked_Lambda([this, SelectedAsset, SkeletalMesh, BonePicker, PickerWindow]()
+				SNew(SCheckBox)
+				.IsChecked_Lambda([Settings]() { return Settings->bComputeMass ? ECheckBoxState::Checked : ECheckBoxState::Unchecked; })
+				.OnCheckStateChanged_Lambda([Settings, BonePicker, PreviewViewport](ECheckBoxState NewState)
 				{
-					TSet<FName> SelectedBones = BonePicker->GetSelectedBones();
-					GeneratePhysicsAsset(SelectedAsset, SkeletalMesh, SelectedBones);
-					PickerWindow->RequestDestroyWindow();
-					return FReply::Handled();
+					Settings->bComputeMass = (NewState == ECheckBoxState::Checked);
+					PreviewViewport->RequestUpdate(BonePicker->GetSelectedBones(), TArray<FName>(), *Settings, true);
 				})
+				.ToolTipText(LOCTEXT("ComputeMassTooltip", "Override each body's mass with its shape volume times a per-bone density, and scale its damping and sleep threshold with that mass, instead of the engine's material defaults."))
+				[
+					SNew(STextBlock).Text(LOCTEXT("ComputeMass", "Compute Mass From Volume"))
+				]
 			]
-			+ SHorizontalBox::Slot()
-			.AutoWidth()
-			.Padding(10, 0, 0, 0)
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
 			[
-				SNew(SButton)
-				.Text(LOCTEXT("Cancel", "Cancel"))
-				.OnClicked_Lambda([PickerWindow]()
+				SNew(SCheckBox)
+				.IsChecked_Lambda([Settings]() { return Settings->bResolvePenetration ? ECheckBoxState::Checked : ECheckBoxState::Unchecked; })
+				.OnCheckStateChanged_Lambda([Settings, BonePicker, PreviewViewport](ECheckBoxState NewState)
 				{
-					PickerWindow->RequestDestroyWindow();
-					return FReply::Handled();
+					Settings->bResolvePenetration = (NewState == ECheckBoxState::Checked);
+					PreviewViewport->RequestUpdate(BonePicker->GetSelectedBones(), TArray<FName>(), *Settings, true);
+				})
+				.ToolTipText(LOCTEXT("ResolvePenetrationTooltip", "Shrink or shorten capsules and spheres that start out overlapping a body they collide with, so the ragdoll does not pop apart when it starts simulating."))
+				[
+					SNew(STextBlock).Text(LOCTEXT("ResolvePenetration", "Resolve Initial Penetration"))
+				]
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
+			[
+				SNew(STextBlock)
+				.Text_Lambda([Settings, PreviewViewport]()
+				{
+					TSharedPtr<const FBetterPAGenerationResult> Result = PreviewViewport->GetUpToDateResult();
+					return Result.IsValid() && Settings->bResolvePenetration
+						? FText::Format(LOCTEXT("PenetrationFixCount", "Initial penetrations: {0} bodies adjusted, {1} still overlapping"), Result->PenetrationFixes.Num(),
+							Algo::CountIf(Result->PenetrationFixes, [](const FBetterPAPenetrationFix& Fix) { return Fix.ResidualDepth > 0.0f; }))
+						: FText::GetEmpty();
+				})
+				.ToolTipText_Lambda([PreviewViewport]()
+				{
+					TSharedPtr<const FBetterPAGenerationResult> Result = PreviewViewport->GetUpToDateResult();
+					if (!Result.IsValid())
+					{
+						return FText::GetEmpty();
+					}
+
+					FString Report;
+					for (const FBetterPAPenetrationFix& Fix : Result->PenetrationFixes)
+					{
+						Report += FString::Printf(TEXT("%s: %.2f cm into %s, radius %+.2f, length %+.2f"),
+							*Result->Bodies[Fix.Body].BoneName.ToString(),
+							Fix.Depth,
+							Result->Bodies.IsValidIndex(Fix.OtherBody) ? *Result->Bodies[Fix.OtherBody].BoneName.ToString() : TEXT("?"),
+							Fix.RadiusChange,
+							Fix.LengthChange);
+						Report += Fix.ResidualDepth > 0.0f ? FString::Printf(TEXT(", %.2f cm left\n"), Fix.ResidualDepth) : FString(TEXT("\n"));
+					}
+					return FText::FromString(Report.TrimEnd());
 				})
 			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(10, 4, 10, 0)
+			[
+				SNew(STextBlock)
+				.Text_Lambda([Settings, PreviewViewport]()
+				{
+					return PreviewViewport->IsRefining()
+						? FText::Format(LOCTEXT("RefiningPreview", "Coarse preview from LOD {0}, refining against LOD {1}..."), PreviewViewport->GetCoarseLODIndex(), Settings->LODIndex)
+						: FText::GetEmpty();
+				})
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.HAlign(HAlign_Right)
+			.Padding(10)
+			[
+				SNew(SHorizontalBox)
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				[
+					SNew(SButton)
+					.Text(LOCTEXT("Generate", "Generate"))
+					.OnClicked_Lambda([this, SelectedAsset, SkeletalMesh, BonePicker, PreviewViewport, PickerWindow, Settings]()
+					{
+						// Reuse the previewed result when it matches the current selection, nothing was written before this point
+						TSharedPtr<const FBetterPAGenerationResult> PreviewResult = PreviewViewport->GetUpToDateResult();
+						TSet<FName> SelectedBones = BonePicker->GetSelectedBones();
+						GeneratePhysicsAsset(SelectedAsset, SkeletalMesh, SelectedBones, *Settings, PreviewResult.Get());
+						PickerWindow->RequestDestroyWindow();
+						return FReply::Handled();
+					})
+				]
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				.Padding(10, 0, 0, 0)
+				[
+					SNew(SButton)
+					.Text(LOCTEXT("Cancel", "Cancel"))
+					.OnClicked_Lambda([PickerWindow]()
+					{
+						PickerWindow->RequestDestroyWindow();
+						return FReply::Handled();
+					})
+				]
+			]
+		]
+		+ SHorizontalBox::Slot()
+		.FillWidth(0.6f)
+		[
+			PreviewViewport.ToSharedRef()
 		]
 	);
 
+	PreviewViewport->RequestUpdate(BonePicker->GetSelectedBones(), TArray<FName>(), *Settings, true);
+
 	FSlateApplication::Get().AddWindow(PickerWindow.ToSharedRef());
 }
 
-void FBetterPAModule::GeneratePhysicsAsset(FAssetData SelectedAsset, USkeletalMesh* SkeletalMesh, const TSet<FName>& SelectedBones)
+void FBetterPAModule::GeneratePhysicsAsset(FAssetData SelectedAsset, USkeletalMesh* SkeletalMesh, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings, const FBetterPAGenerationResult* PreviewResult)
 {
 	FString PackageName = SelectedAsset.PackageName.ToString() + "_PhysicsAsset";
 	FString AssetName = SelectedAsset.AssetName.ToString() + "_PhysicsAsset";
@@ -169,7 +498,16 @@ void FBetterPAModule::GeneratePhysicsAsset(FAssetData SelectedAsset, USkeletalMe
 			PhysicsAsset->PreviewSkeletalMesh = SkeletalMesh;
 		}
 		
-		FBetterPAGenerator::GeneratePhysicsAsset(SkeletalMesh, PhysicsAsset, SelectedBones);
+		if (PreviewResult)
+		{
+			FBetterPAGenerator::ApplyResultTransacted(PhysicsAsset, *PreviewResult, LOCTEXT("GeneratePhysicsAssetTransaction", "Generate Physics Asset"));
+		}
+		else
+		{
+			FBetterPAGenerator::GeneratePhysicsAsset(SkeletalMesh, PhysicsAsset, SelectedBones, Settings);
+		}
+
+		AutoRegenerator.RecordGeneration(SkeletalMesh, PhysicsAsset, SelectedBones, Settings);
 	}
 }
 
@@ -193,6 +531,193 @@ void FBetterPAModule::OnOpenConstraintGraph(FAssetData SelectedAsset)
 	FSlateApplication::Get().AddWindow(GraphWindow.ToSharedRef());
 }
 
+void FBetterPAModule::OnAnalyzeFitQuality(FAssetData SelectedAsset)
+{
+	UPhysicsAsset* PhysicsAsset = Cast<UPhysicsAsset>(SelectedAsset.GetAsset());
+	USkeletalMesh* SkeletalMesh = PhysicsAsset ? PhysicsAsset->PreviewSkeletalMesh.LoadSynchronous() : nullptr;
+	if (!SkeletalMesh)
+	{
+		return;
+	}
+
+	TArray<FBetterPABodyFitStats> Stats;
+	if (!FBetterPAFitAnalysis::Analyze(SkeletalMesh, PhysicsAsset, FBetterPAFitAnalysisSettings(), Stats))
+	{
+		return;
+	}
+
+	const FString ReportPath = FBetterPAFitAnalysis::SaveReport(PhysicsAsset, Stats);
+
+	TSharedPtr<SWindow> ReportWindow = SNew(SWindow)
+		.Title(LOCTEXT("FitReport", "Fit Quality Report"))
+		.ClientSize(FVector2D(800, 600));
+
+	ReportWindow->SetContent(
+		SNew(SBetterPAFitReport)
+		.Stats(Stats)
+		.ReportPath(ReportPath)
+	);
+
+	FSlateApplication::Get().AddWindow(ReportWindow.ToSharedRef());
+}
+
+void FBetterPAModule::OnExportInterchange(FAssetData SelectedAsset)
+{
+	UPhysicsAsset* PhysicsAsset = Cast<UPhysicsAsset>(SelectedAsset.GetAsset());
+	if (!PhysicsAsset)
+	{
+		return;
+	}
+
+	FBetterPAGenerationResult Result;
+	FBetterPAInterchange::ResultFromAsset(PhysicsAsset, Result);
+
+	// Settings travel with the result when the editor generated the asset, so the receiving side can regenerate it the same way
+	const FBetterPAGenerationRecord* Record = AutoRegenerator.FindRecord(PhysicsAsset);
+
+	const FString FilePath = FPaths::ProjectSavedDir() / TEXT("BetterPA") / TEXT("Interchange") / PhysicsAsset->GetName() + TEXT(".bpax");
+	const bool bSaved = FBetterPAInterchange::SaveToFile(FilePath, Result, Record ? &Record->Settings : nullptr);
+
+	FNotificationInfo Info(bSaved
+		? FText::Format(LOCTEXT("InterchangeExported", "Exported {0} bodies and {1} constraints to {2}"), Result.Bodies.Num(), Result.Constraints.Num(), FText::FromString(FilePath))
+		: FText::Format(LOCTEXT("InterchangeExportFailed", "Could not write {0}"), FText::FromString(FilePath)));
+	Info.ExpireDuration = 5.0f;
+	FSlateNotificationManager::Get().AddNotification(Info);
+}
+
+void FBetterPAModule::OnImportInterchange(FAssetData SelectedAsset)
+{
+	UPhysicsAsset* PhysicsAsset = Cast<UPhysicsAsset>(SelectedAsset.GetAsset());
+	USkeletalMesh* SkeletalMesh = PhysicsAsset ? PhysicsAsset->PreviewSkeletalMesh.LoadSynchronous() : nullptr;
+	IDesktopPlatform* DesktopPlatform = FDesktopPlatformModule::Get();
+	if (!SkeletalMesh || !DesktopPlatform)
+	{
+		return;
+	}
+
+	TArray<FString> Files;
+	if (!DesktopPlatform->OpenFileDialog(
+		FSlateApplication::Get().FindBestParentWindowHandleForDialogs(nullptr),
+		LOCTEXT("ImportInterchangeDialog", "Import Physics Interchange").ToString(),
+		FPaths::ProjectSavedDir() / TEXT("BetterPA") / TEXT("Interchange"),
+		TEXT(""),
+		TEXT("BetterPA Interchange (*.bpax)|*.bpax"),
+		EFileDialogFlags::None,
+		Files) || Files.Num() == 0)
+	{
+		return;
+	}
+
+	FBetterPAGenerationResult Result;
+	TOptional<FBetterPAGenerationSettings> Settings;
+	FString Error;
+	if (!FBetterPAInterchange::LoadFromFile(Files[0], SkeletalMesh->GetRefSkeleton(), Result, &Settings, Error))
+	{
+		FNotificationInfo Info(FText::Format(LOCTEXT("InterchangeImportFailed", "Could not import {0}: {1}"), FText::FromString(Files[0]), FText::FromString(Error)));
+		Info.ExpireDuration = 5.0f;
+		FSlateNotificationManager::Get().AddNotification(Info);
+		return;
+	}
+
+	const FBetterPAApplyStats Stats = FBetterPAGenerator::ApplyResultTransacted(PhysicsAsset, Result, LOCTEXT("ImportInterchangeTransaction", "Import Physics Interchange"));
+
+	// With the settings that produced it, the imported result is kept up to date with the mesh like a generated one
+	if (Settings.IsSet())
+	{
+		TSet<FName> SelectedBones;
+		for (const FBetterPABodyResult& Body : Result.Bodies)
+		{
+			SelectedBones.Add(Body.BoneName);
+		}
+		AutoRegenerator.RecordGeneration(SkeletalMesh, PhysicsAsset, SelectedBones, Settings.GetValue());
+	}
+
+	FNotificationInfo Info(FText::Format(LOCTEXT("InterchangeImported", "Imported {0} bodies: {1} added, {2} changed, {3} removed"), Result.Bodies.Num(), Stats.NumAdded, Stats.NumChanged, Stats.NumRemoved));
+	Info.ExpireDuration = 5.0f;
+	FSlateNotificationManager::Get().AddNotification(Info);
+}
+
+TSharedRef<FExtender> FBetterPAModule::OnExtendContentBrowserPathSelectionMenu(const TArray<FString>& SelectedPaths)
+{
+	TSharedRef<FExtender> Extender = MakeShared<FExtender>();
+
+	if (SelectedPaths.Num() > 0)
+	{
+		Extender->AddMenuExtension(
+			"PathContextBulkOperations",
+			EExtensionHook::After,
+			nullptr,
+			FMenuExtensionDelegate::CreateRaw(this, &FBetterPAModule::AddPathMenuEntry, SelectedPaths)
+		);
+	}
+
+	return Extender;
+}
+
+void FBetterPAModule::AddPathMenuEntry(FMenuBuilder& MenuBuilder, TArray<FString> SelectedPaths)
+{
+	MenuBuilder.AddMenuEntry(
+		LOCTEXT("AuditPhysicsAssets", "Audit Physics Assets"),
+		LOCTEXT("AuditPhysicsAssetsTooltip", "Checks every physics asset in the selected folders for broken shapes, bones and constraints."),
+		FSlateIcon(),
+		FUIAction(FExecuteAction::CreateRaw(this, &FBetterPAModule::OnAuditPhysicsAssets, SelectedPaths))
+	);
+
+	MenuBuilder.AddMenuEntry(
+		LOCTEXT("LearnShapePriors", "Learn Shape Priors"),
+		LOCTEXT("LearnShapePriorsTooltip", "Learns per-bone capsule proportions and limits from the physics assets in the selected folders. Only assets changed since the last run are read."),
+		FSlateIcon(),
+		FUIAction(FExecuteAction::CreateRaw(this, &FBetterPAModule::OnLearnShapePriors, SelectedPaths))
+	);
+}
+
+void FBetterPAModule::OnAuditPhysicsAssets(TArray<FString> SelectedPaths)
+{
+	FBetterPAAuditSettings Settings;
+	for (const FString& Path : SelectedPaths)
+	{
+		Settings.PackagePaths.Add(FName(*Path));
+	}
+
+	TArray<FBetterPAAuditFinding> Findings;
+	FBetterPAAudit::RunAudit(Settings, Findings);
+	const FString ReportPath = FBetterPAAudit::SaveReport(Findings);
+
+	TSharedPtr<SWindow> ReportWindow = SNew(SWindow)
+		.Title(LOCTEXT("AuditReport", "Physics Asset Audit"))
+		.ClientSize(FVector2D(1000, 600));
+
+	ReportWindow->SetContent(
+		SNew(SBetterPAAuditReport)
+		.Findings(Findings)
+		.ReportPath(ReportPath)
+	);
+
+	FSlateApplication::Get().AddWindow(ReportWindow.ToSharedRef());
+}
+
+void FBetterPAModule::OnLearnShapePriors(TArray<FString> SelectedPaths)
+{
+	FBetterPAShapePriorSettings Settings;
+	for (const FString& Path : SelectedPaths)
+	{
+		Settings.PackagePaths.Add(FName(*Path));
+	}
+
+	const FString TablePath = FBetterPAShapePriorTable::GetDefaultPath();
+	FBetterPAShapePriorTable Table;
+	Table.Load(TablePath);
+
+	const int32 NumRead = FBetterPAShapePriors::Update(Table, Settings);
+	const bool bSaved = Table.Save(TablePath);
+
+	FNotificationInfo Info(bSaved
+		? FText::Format(LOCTEXT("ShapePriorsUpdated", "Shape priors: {0} assets read, {1} bone patterns from {2} assets"), NumRead, Table.Patterns.Num(), Table.Sources.Num())
+		: LOCTEXT("ShapePriorsSaveFailed", "Could not save the shape prior table"));
+	Info.ExpireDuration = 5.0f;
+	FSlateNotificationManager::Get().AddNotification(Info);
+}
+
 #undef LOCTEXT_NAMESPACE
 	
 IMPLEMENT_MODULE(FBetterPAModule, BetterPA)
\ No newline at end of file
@@ -0,0 +1,470 @@
+#include "BetterPAAudit.h"
+#include "BetterPAAutoRegen.h"
+#include "BetterPAConstraintBuilder.h"
+#include "BetterPAGenerator.h"
+#include "BetterPAInterchange.h"
+#include "BetterPAShapePriors.h"
+#include "Engine/SkeletalMesh.h"
+#include "PhysicsAssetUtils.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Async/ParallelFor.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopedSlowTask.h"
+#include "ScopedTransaction.h"
+#include "UObject/StrongObjectPtr.h"
+#include "UObject/UObjectGlobals.h"
+
+#define LOCTEXT_NAMESPACE "BetterPAAudit"
+
+namespace
+{
+	void AddFinding(TArray<FBetterPAAuditFinding>& OutFindings, const UPhysicsAsset* PhysicsAsset, EBetterPAAuditIssue Issue, FName BoneName, FName OtherBoneName, FString Detail)
+	{
+		FBetterPAAuditFinding& Finding = OutFindings.AddDefaulted_GetRef();
+		Finding.AssetPath = FSoftObjectPath(PhysicsAsset);
+		Finding.Issue = Issue;
+		Finding.BoneName = BoneName;
+		Finding.OtherBoneName = OtherBoneName;
+		Finding.Detail = MoveTemp(Detail);
+	}
+
+	void FinishStructuralEdit(UPhysicsAsset* PhysicsAsset)
+	{
+		PhysicsAsset->UpdateBodySetupIndexMap();
+		PhysicsAsset->UpdateBoundsBodiesArray();
+		PhysicsAsset->MarkPackageDirty();
+	}
+
+	// Refits the shapes of one body the way the asset was generated, everything else on the asset is left as it is
+	bool RefitBody(UPhysicsAsset* PhysicsAsset, FName BoneName)
+	{
+		USkeletalMesh* SkeletalMesh = PhysicsAsset->PreviewSkeletalMesh.LoadSynchronous();
+		const int32 BodyIndex = PhysicsAsset->FindBodyIndex(BoneName);
+		if (!SkeletalMesh || BodyIndex == INDEX_NONE || SkeletalMesh->GetRefSkeleton().FindBoneIndex(BoneName) == INDEX_NONE)
+		{
+			return false;
+		}
+
+		// Settings the editor recorded when it generated the asset, defaults for assets it did not generate
+		FBetterPAGenerationSettings Settings;
+		FBetterPAGenerationRecordTable Records;
+		if (Records.Load(FBetterPAGenerationRecordTable::GetDefaultPath()))
+		{
+			if (const FBetterPAGenerationRecord* Record = Records.FindByPhysicsAsset(FSoftObjectPath(PhysicsAsset)))
+			{
+				Settings = Record->Settings;
+			}
+		}
+		if (Settings.bUseShapePriors)
+		{
+			Settings.ShapePriors = FBetterPAShapePriors::LoadDefault();
+		}
+
+		TSet<FName> SelectedBones;
+		for (const USkeletalBodySetup* BodySetup : PhysicsAsset->SkeletalBodySetups)
+		{
+			if (BodySetup && SkeletalMesh->GetRefSkeleton().FindBoneIndex(BodySetup->BoneName) != INDEX_NONE)
+			{
+				SelectedBones.Add(BodySetup->BoneName);
+			}
+		}
+
+		FBetterPAGenerationResult Previous;
+		FBetterPAInterchange::ResultFromAsset(PhysicsAsset, Previous);
+
+		FBetterPAGenerationResult Result;
+		if (!FBetterPAGenerator::GenerateIncremental(SkeletalMesh, SelectedBones, Settings, { BoneName }, Previous, Result))
+		{
+			return false;
+		}
+
+		const FBetterPABodyResult* Body = Result.Bodies.FindByPredicate([BoneName](const FBetterPABodyResult& Candidate) { return Candidate.BoneName == BoneName; });
+		if (!Body)
+		{
+			return false;
+		}
+
+		// Only the geometry is replaced, mass, physics type and collision settings stay as they were tuned
+		USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[BodyIndex];
+		BodySetup->Modify();
+		BodySetup->AggGeom = Body->AggGeom;
+		BodySetup->InvalidatePhysicsData();
+		BodySetup->CreatePhysicsMeshes();
+		PhysicsAsset->MarkPackageDirty();
+		return true;
+	}
+
+	// Constrains the body to the body of its nearest ancestor bone, or to the root body when no ancestor has one
+	bool ConnectBody(UPhysicsAsset* PhysicsAsset, FName BoneName, FName RootBoneName)
+	{
+		const USkeletalMesh* SkeletalMesh = PhysicsAsset->PreviewSkeletalMesh.LoadSynchronous();
+		if (!SkeletalMesh || PhysicsAsset->FindBodyIndex(BoneName) == INDEX_NONE)
+		{
+			return false;
+		}
+
+		const FReferenceSkeleton& RefSkeleton = SkeletalMesh->GetRefSkeleton();
+		FName ParentBoneName = RootBoneName;
+		for (int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName); BoneIndex != INDEX_NONE; )
+		{
+			BoneIndex = RefSkeleton.GetParentIndex(BoneIndex);
+			if (BoneIndex != INDEX_NONE && PhysicsAsset->FindBodyIndex(RefSkeleton.GetBoneName(BoneIndex)) != INDEX_NONE)
+			{
+				ParentBoneName = RefSkeleton.GetBoneName(BoneIndex);
+				break;
+			}
+		}
+
+		if (ParentBoneName == BoneName || PhysicsAsset->FindBodyIndex(ParentBoneName) == INDEX_NONE)
+		{
+			return false;
+		}
+
+		FBetterPAConstraintContext Context;
+		Context.Init(PhysicsAsset);
+		PhysicsAsset->ConstraintSetup.Add(FBetterPAConstraintBuilder::CreateConstraint(PhysicsAsset, BoneName, ParentBoneName, FBetterPAConstraintSettings(), Context));
+		FinishStructuralEdit(PhysicsAsset);
+		return true;
+	}
+}
+
+const TCHAR* FBetterPAAudit::GetIssueName(EBetterPAAuditIssue Issue)
+{
+	switch (Issue)
+	{
+	case EBetterPAAuditIssue::DegenerateShape: return TEXT("Degenerate Shape");
+	case EBetterPAAuditIssue::ConstraintMissingBone: return TEXT("Constraint Missing Bone");
+	case EBetterPAAuditIssue::BodyMissingBone: return TEXT("Body Missing Bone");
+	case EBetterPAAuditIssue::UnreachableBody: return TEXT("Unreachable Body");
+	case EBetterPAAuditIssue::DuplicateConstraint: return TEXT("Duplicate Constraint");
+	case EBetterPAAuditIssue::MissingPreviewMesh: return TEXT("Missing Preview Mesh");
+	default: return TEXT("Unknown");
+	}
+}
+
+bool FBetterPAAudit::IsFixable(EBetterPAAuditIssue Issue)
+{
+	return Issue != EBetterPAAuditIssue::MissingPreviewMesh;
+}
+
+void FBetterPAAudit::AuditAsset(const UPhysicsAsset* PhysicsAsset, const FBetterPAAuditSettings& Settings, TArray<FBetterPAAuditFinding>& OutFindings)
+{
+	if (!PhysicsAsset)
+	{
+		return;
+	}
+
+	const USkeletalMesh* SkeletalMesh = PhysicsAsset->PreviewSkeletalMesh.Get();
+	const FReferenceSkeleton* RefSkeleton = SkeletalMesh ? &SkeletalMesh->GetRefSkeleton() : nullptr;
+	if (!RefSkeleton)
+	{
+		AddFinding(OutFindings, PhysicsAsset, EBetterPAAuditIssue::MissingPreviewMesh, NAME_None, NAME_None, TEXT("Bone checks skipped"));
+	}
+
+	const int32 NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+	TMap<FName, int32> BodyOfBone;
+	BodyOfBone.Reserve(NumBodies);
+
+	// Root body is the one closest to the skeleton root, or the first body without a skeleton
+	int32 RootBody = INDEX_NONE;
+	int32 RootBoneIndex = MAX_int32;
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[BodyIndex];
+		if (!BodySetup)
+		{
+			continue;
+		}
+
+		BodyOfBone.Add(BodySetup->BoneName, BodyIndex);
+
+		const FKAggregateGeom& AggGeom = BodySetup->AggGeom;
+		for (const FKSphylElem& Elem : AggGeom.SphylElems)
+		{
+			if (Elem.Radius < Settings.MinShapeSize)
+			{
+				AddFinding(OutFindings, PhysicsAsset, EBetterPAAuditIssue::DegenerateShape, BodySetup->BoneName, NAME_None, FString::Printf(TEXT("Capsule radius %.3f"), Elem.Radius));
+			}
+		}
+		for (const FKSphereElem& Elem : AggGeom.SphereElems)
+		{
+			if (Elem.Radius < Settings.MinShapeSize)
+			{
+				AddFinding(OutFindings, PhysicsAsset, EBetterPAAuditIssue::DegenerateShape, BodySetup->BoneName, NAME_None, FString::Printf(TEXT("Sphere radius %.3f"), Elem.Radius));
+			}
+		}
+		for (const FKBoxElem& Elem : AggGeom.BoxElems)
+		{
+			if (FMath::Min3(Elem.X, Elem.Y, Elem.Z) < Settings.MinShapeSize)
+			{
+				AddFinding(OutFindings, PhysicsAsset, EBetterPAAuditIssue::DegenerateShape, BodySetup->BoneName, NAME_None, FString::Printf(TEXT("Box extent %.3f"), FMath::Min3(Elem.X, Elem.Y, Elem.Z)));
+			}
+		}
+
+		const int32 BoneIndex = RefSkeleton ? RefSkeleton->FindBoneIndex(BodySetup->BoneName) : BodyIndex;
+		if (BoneIndex == INDEX_NONE)
+		{
+			AddFinding(OutFindings, PhysicsAsset, EBetterPAAuditIssue::BodyMissingBone, BodySetup->BoneName, NAME_None, TEXT("Bone not in skeleton"));
+		}
+		else if (BoneIndex < RootBoneIndex)
+		{
+			RootBoneIndex = BoneIndex;
+			RootBody = BodyIndex;
+		}
+	}
+
+	// Constraint adjacency between bodies, plus duplicate and dangling checks
+	TArray<TArray<int32>> Neighbours;
+	Neighbours.SetNum(NumBodies);
+	TSet<FBetterPABonePair> SeenPairs;
+	SeenPairs.Reserve(PhysicsAsset->ConstraintSetup.Num());
+
+	for (const UPhysicsConstraintTemplate* Constraint : PhysicsAsset->ConstraintSetup)
+	{
+		if (!Constraint)
+		{
+			continue;
+		}
+
+		const FName Bone1 = Constraint->DefaultInstance.ConstraintBone1;
+		const FName Bone2 = Constraint->DefaultInstance.ConstraintBone2;
+
+		bool bAlreadySeen = false;
+		SeenPairs.Add(FBetterPABonePair(Bone1, Bone2), &bAlreadySeen);
+		if (bAlreadySeen)
+		{
+			AddFinding(OutFindings, PhysicsAsset, EBetterPAAuditIssue::DuplicateConstraint, Bone1, Bone2, TEXT("Bones already constrained"));
+			continue;
+		}
+
+		const int32* Body1 = BodyOfBone.Find(Bone1);
+		const int32* Body2 = BodyOfBone.Find(Bone2);
+		const bool bBone1InSkeleton = !RefSkeleton || RefSkeleton->FindBoneIndex(Bone1) != INDEX_NONE;
+		const bool bBone2InSkeleton = !RefSkeleton || RefSkeleton->FindBoneIndex(Bone2) != INDEX_NONE;
+		if (!Body1 || !Body2 || !bBone1InSkeleton || !bBone2InSkeleton)
+		{
+			const bool bFirstMissing = !Body1 || !bBone1InSkeleton;
+			AddFinding(OutFindings, PhysicsAsset, EBetterPAAuditIssue::ConstraintMissingBone, Bone1, Bone2,
+				FString::Printf(TEXT("%s has no %s"), *(bFirstMissing ? Bone1 : Bone2).ToString(), (bFirstMissing ? Body1 : Body2) ? TEXT("bone") : TEXT("body")));
+			continue;
+		}
+
+		Neighbours[*Body1].Add(*Body2);
+		Neighbours[*Body2].Add(*Body1);
+	}
+
+	if (RootBody == INDEX_NONE || NumBodies < 2)
+	{
+		return;
+	}
+
+	TBitArray<> Reached(false, NumBodies);
+	TArray<int32> Queue;
+	Queue.Reserve(NumBodies);
+	Queue.Add(RootBody);
+	Reached[RootBody] = true;
+	for (int32 QueueIndex = 0; QueueIndex < Queue.Num(); ++QueueIndex)
+	{
+		for (int32 Neighbour : Neighbours[Queue[QueueIndex]])
+		{
+			if (!Reached[Neighbour])
+			{
+				Reached[Neighbour] = true;
+				Queue.Add(Neighbour);
+			}
+		}
+	}
+
+	const FName RootBone = PhysicsAsset->SkeletalBodySetups[RootBody]->BoneName;
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[BodyIndex];
+		if (BodySetup && !Reached[BodyIndex])
+		{
+			AddFinding(OutFindings, PhysicsAsset, EBetterPAAuditIssue::UnreachableBody, BodySetup->BoneName, RootBone, TEXT("No constraint path to the root body"));
+		}
+	}
+}
+
+void FBetterPAAudit::RunAudit(const FBetterPAAuditSettings& Settings, TArray<FBetterPAAuditFinding>& OutFindings)
+{
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.ClassPaths.Add(UPhysicsAsset::StaticClass()->GetClassPathName());
+	Filter.bRecursivePaths = true;
+	Filter.PackagePaths = Settings.PackagePaths;
+	if (Filter.PackagePaths.Num() == 0)
+	{
+		Filter.PackagePaths.Add(TEXT("/Game"));
+	}
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+
+	// Stable order so reports diff cleanly between runs
+	Assets.Sort([](const FAssetData& A, const FAssetData& B) { return A.PackageName.LexicalLess(B.PackageName); });
+
+	const int32 BatchSize = FMath::Max(1, Settings.BatchSize);
+	FScopedSlowTask SlowTask((float)Assets.Num(), LOCTEXT("AuditingPhysicsAssets", "Auditing physics assets..."));
+	SlowTask.MakeDialog(true);
+
+	for (int32 BatchStart = 0; BatchStart < Assets.Num(); BatchStart += BatchSize)
+	{
+		if (SlowTask.ShouldCancel())
+		{
+			break;
+		}
+
+		const int32 BatchEnd = FMath::Min(BatchStart + BatchSize, Assets.Num());
+		SlowTask.EnterProgressFrame((float)(BatchEnd - BatchStart));
+
+		// Queue the whole batch on the async loader, then the preview meshes it references
+		for (int32 AssetIndex = BatchStart; AssetIndex < BatchEnd; ++AssetIndex)
+		{
+			LoadPackageAsync(Assets[AssetIndex].PackageName.ToString());
+		}
+		FlushAsyncLoading();
+
+		TArray<TStrongObjectPtr<UPhysicsAsset>> Batch;
+		Batch.Reserve(BatchEnd - BatchStart);
+		for (int32 AssetIndex = BatchStart; AssetIndex < BatchEnd; ++AssetIndex)
+		{
+			if (UPhysicsAsset* PhysicsAsset = Cast<UPhysicsAsset>(Assets[AssetIndex].FastGetAsset(false)))
+			{
+				Batch.Emplace(PhysicsAsset);
+				if (!PhysicsAsset->PreviewSkeletalMesh.IsNull() && !PhysicsAsset->PreviewSkeletalMesh.IsValid())
+				{
+					LoadPackageAsync(PhysicsAsset->PreviewSkeletalMesh.ToSoftObjectPath().GetLongPackageName());
+				}
+			}
+		}
+		FlushAsyncLoading();
+
+		TArray<TArray<FBetterPAAuditFinding>> BatchFindings;
+		BatchFindings.SetNum(Batch.Num());
+		ParallelFor(Batch.Num(), [&](int32 Index)
+		{
+			AuditAsset(Batch[Index].Get(), Settings, BatchFindings[Index]);
+		});
+
+		for (TArray<FBetterPAAuditFinding>& Findings : BatchFindings)
+		{
+			OutFindings.Append(MoveTemp(Findings));
+		}
+
+		// Let go of the batch so memory stays bounded by the batch size
+		Batch.Reset();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+}
+
+bool FBetterPAAudit::FixFinding(FBetterPAAuditFinding& Finding)
+{
+	UPhysicsAsset* PhysicsAsset = Cast<UPhysicsAsset>(Finding.AssetPath.TryLoad());
+	if (!PhysicsAsset || Finding.bFixed || !IsFixable(Finding.Issue))
+	{
+		return false;
+	}
+
+	const FScopedTransaction Transaction(FText::Format(LOCTEXT("FixAuditFinding", "Fix {0}"), FText::FromString(GetIssueName(Finding.Issue))));
+	PhysicsAsset->Modify();
+
+	switch (Finding.Issue)
+	{
+	case EBetterPAAuditIssue::DuplicateConstraint:
+	{
+		// Keep the first constraint between the bones
+		const FBetterPABonePair Pair(Finding.BoneName, Finding.OtherBoneName);
+		bool bKept = false;
+		PhysicsAsset->ConstraintSetup.RemoveAll([&Pair, &bKept](const UPhysicsConstraintTemplate* Constraint)
+		{
+			if (!Constraint || !(FBetterPABonePair(Constraint->DefaultInstance.ConstraintBone1, Constraint->DefaultInstance.ConstraintBone2) == Pair))
+			{
+				return false;
+			}
+			const bool bRemove = bKept;
+			bKept = true;
+			return bRemove;
+		});
+		FinishStructuralEdit(PhysicsAsset);
+		break;
+	}
+	case EBetterPAAuditIssue::ConstraintMissingBone:
+	{
+		const FBetterPABonePair Pair(Finding.BoneName, Finding.OtherBoneName);
+		PhysicsAsset->ConstraintSetup.RemoveAll([&Pair](const UPhysicsConstraintTemplate* Constraint)
+		{
+			return Constraint && FBetterPABonePair(Constraint->DefaultInstance.ConstraintBone1, Constraint->DefaultInstance.ConstraintBone2) == Pair;
+		});
+		FinishStructuralEdit(PhysicsAsset);
+		break;
+	}
+	case EBetterPAAuditIssue::BodyMissingBone:
+	{
+		// DestroyBody drops the body's constraints and re-indexes the collision disable table past it
+		for (int32 BodyIndex = PhysicsAsset->SkeletalBodySetups.Num() - 1; BodyIndex >= 0; --BodyIndex)
+		{
+			const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[BodyIndex];
+			if (BodySetup && BodySetup->BoneName == Finding.BoneName)
+			{
+				FPhysicsAssetUtils::DestroyBody(PhysicsAsset, BodyIndex);
+			}
+		}
+		FinishStructuralEdit(PhysicsAsset);
+		break;
+	}
+	case EBetterPAAuditIssue::DegenerateShape:
+		if (!RefitBody(PhysicsAsset, Finding.BoneName))
+		{
+			return false;
+		}
+		break;
+	case EBetterPAAuditIssue::UnreachableBody:
+		if (!ConnectBody(PhysicsAsset, Finding.BoneName, Finding.OtherBoneName))
+		{
+			return false;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	Finding.bFixed = true;
+	return true;
+}
+
+FString FBetterPAAudit::ToCSV(const TArray<FBetterPAAuditFinding>& Findings)
+{
+	FString Result = TEXT("Asset,Issue,Bone,OtherBone,Detail,Fixed\n");
+	for (const FBetterPAAuditFinding& Finding : Findings)
+	{
+		Result += FString::Printf(TEXT("%s,%s,%s,%s,\"%s\",%s\n"),
+			*Finding.AssetPath.ToString(), GetIssueName(Finding.Issue),
+			*Finding.BoneName.ToString(), *Finding.OtherBoneName.ToString(),
+			*Finding.Detail.Replace(TEXT("\""), TEXT("\"\"")),
+			Finding.bFixed ? TEXT("1") : TEXT("0"));
+	}
+	return Result;
+}
+
+FString FBetterPAAudit::SaveReport(const TArray<FBetterPAAuditFinding>& Findings)
+{
+	const FString FileName = FString::Printf(TEXT("PhysicsAssetAudit_%s.csv"), *FDateTime::Now().ToString());
+	const FString FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("BetterPA"), TEXT("Audit"), FileName);
+
+	if (!FFileHelper::SaveStringToFile(ToCSV(Findings), *FilePath))
+	{
+		return FString();
+	}
+	return FilePath;
+}
+
+#undef LOCTEXT_NAMESPACE
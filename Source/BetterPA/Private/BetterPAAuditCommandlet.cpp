@@ -0,0 +1,69 @@
+#include "BetterPAAuditCommandlet.h"
+#include "BetterPAAudit.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "FileHelpers.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBetterPAAudit, Log, All);
+
+UBetterPAAuditCommandlet::UBetterPAAuditCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UBetterPAAuditCommandlet::Main(const FString& Params)
+{
+	FBetterPAAuditSettings Settings;
+
+	FString Paths;
+	if (FParse::Value(*Params, TEXT("Paths="), Paths, false))
+	{
+		TArray<FString> PathList;
+		Paths.ParseIntoArray(PathList, TEXT("+"));
+		for (const FString& Path : PathList)
+		{
+			Settings.PackagePaths.Add(FName(*Path));
+		}
+	}
+	FParse::Value(*Params, TEXT("BatchSize="), Settings.BatchSize);
+	const bool bFix = FParse::Param(*Params, TEXT("Fix"));
+
+	TArray<FBetterPAAuditFinding> Findings;
+	FBetterPAAudit::RunAudit(Settings, Findings);
+
+	if (bFix)
+	{
+		// Findings are grouped by asset, so each package is saved once after its fixes
+		for (int32 Index = 0; Index < Findings.Num();)
+		{
+			const FSoftObjectPath AssetPath = Findings[Index].AssetPath;
+			for (; Index < Findings.Num() && Findings[Index].AssetPath == AssetPath; ++Index)
+			{
+				FBetterPAAudit::FixFinding(Findings[Index]);
+			}
+
+			if (UPhysicsAsset* PhysicsAsset = Cast<UPhysicsAsset>(AssetPath.ResolveObject()))
+			{
+				if (PhysicsAsset->GetPackage()->IsDirty())
+				{
+					UEditorLoadingAndSavingUtils::SavePackages({ PhysicsAsset->GetPackage() }, true);
+				}
+			}
+		}
+	}
+
+	int32 NumFixed = 0;
+	for (const FBetterPAAuditFinding& Finding : Findings)
+	{
+		NumFixed += Finding.bFixed ? 1 : 0;
+		UE_LOG(LogBetterPAAudit, Display, TEXT("%s: %s %s %s %s"), *Finding.AssetPath.ToString(), FBetterPAAudit::GetIssueName(Finding.Issue),
+			*Finding.BoneName.ToString(), *Finding.OtherBoneName.ToString(), *Finding.Detail);
+	}
+
+	const FString ReportPath = FBetterPAAudit::SaveReport(Findings);
+	UE_LOG(LogBetterPAAudit, Display, TEXT("%d findings, %d fixed. Report: %s"), Findings.Num(), NumFixed, *ReportPath);
+
+	return 0;
+}
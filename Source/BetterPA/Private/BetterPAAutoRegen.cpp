@@ -0,0 +1,600 @@
+#include "BetterPAAutoRegen.h"
+#include "BetterPAInterchange.h"
+#include "BetterPAShapePriors.h"
+#include "Engine/SkeletalMesh.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "ReferenceSkeleton.h"
+#include "Editor.h"
+#include "Subsystems/ImportSubsystem.h"
+#include "Async/Async.h"
+#include "UObject/Package.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "Widgets/Notifications/SNotificationList.h"
+#include "Hash/xxhash.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+#define LOCTEXT_NAMESPACE "BetterPAAutoRegen"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBetterPAAutoRegen, Log, All);
+
+namespace
+{
+	// Bump when the record layout changes, older tables are dropped rather than misread
+	constexpr int32 GenerationRecordVersion = 1;
+
+	// Selected bones whose body an incremental pass keeps: not dirty, not below a dirty bone and not the nearest selected ancestor of one
+	TSet<FName> GatherUntouchedBones(const FReferenceSkeleton& RefSkeleton, const TArray<FName>& SelectedBones, const TSet<FName>& DirtyBones)
+	{
+		const int32 NumBones = RefSkeleton.GetNum();
+		TSet<FName> Selected(SelectedBones);
+
+		// Parents precede their children in the reference skeleton
+		TBitArray<> Affected(false, NumBones);
+		for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+		{
+			const int32 ParentIndex = RefSkeleton.GetParentIndex(BoneIndex);
+			if (DirtyBones.Contains(RefSkeleton.GetBoneName(BoneIndex)) || (ParentIndex != INDEX_NONE && Affected[ParentIndex]))
+			{
+				Affected[BoneIndex] = true;
+			}
+		}
+
+		for (const FName& DirtyBone : DirtyBones)
+		{
+			int32 AncestorIndex = RefSkeleton.FindBoneIndex(DirtyBone);
+			AncestorIndex = AncestorIndex != INDEX_NONE ? RefSkeleton.GetParentIndex(AncestorIndex) : INDEX_NONE;
+			while (AncestorIndex != INDEX_NONE && !Selected.Contains(RefSkeleton.GetBoneName(AncestorIndex)))
+			{
+				AncestorIndex = RefSkeleton.GetParentIndex(AncestorIndex);
+			}
+			if (AncestorIndex != INDEX_NONE)
+			{
+				Affected[AncestorIndex] = true;
+			}
+		}
+
+		TSet<FName> UntouchedBones;
+		for (const FName& BoneName : SelectedBones)
+		{
+			const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
+			if (BoneIndex != INDEX_NONE && !Affected[BoneIndex])
+			{
+				UntouchedBones.Add(BoneName);
+			}
+		}
+		return UntouchedBones;
+	}
+
+	// Takes bodies, constraints and disabled pairs between untouched bones from the asset as it is now, so hand edits to them survive the apply
+	void KeepUntouchedFromAsset(const UPhysicsAsset* PhysicsAsset, const TSet<FName>& UntouchedBones, FBetterPAGenerationResult& InOutResult)
+	{
+		FBetterPAGenerationResult Current;
+		FBetterPAInterchange::ResultFromAsset(PhysicsAsset, Current);
+
+		TMap<FName, int32> ResultBodies;
+		for (int32 BodyIndex = 0; BodyIndex < InOutResult.Bodies.Num(); ++BodyIndex)
+		{
+			ResultBodies.Add(InOutResult.Bodies[BodyIndex].BoneName, BodyIndex);
+		}
+
+		// Asset body index to result body index, INDEX_NONE unless the body is untouched and in both
+		TArray<int32> CurrentToResult;
+		CurrentToResult.Init(INDEX_NONE, Current.Bodies.Num());
+		for (int32 BodyIndex = 0; BodyIndex < Current.Bodies.Num(); ++BodyIndex)
+		{
+			const FBetterPABodyResult& CurrentBody = Current.Bodies[BodyIndex];
+			const int32* ResultIndex = ResultBodies.Find(CurrentBody.BoneName);
+			if (!ResultIndex || !UntouchedBones.Contains(CurrentBody.BoneName))
+			{
+				continue;
+			}
+
+			CurrentToResult[BodyIndex] = *ResultIndex;
+
+			// Skeleton placement comes from the generator, everything the asset stores from the asset
+			FBetterPABodyResult& Body = InOutResult.Bodies[*ResultIndex];
+			Body.AggGeom = CurrentBody.AggGeom;
+			Body.Mass = CurrentBody.Mass;
+			Body.LinearDamping = CurrentBody.LinearDamping;
+			Body.AngularDamping = CurrentBody.AngularDamping;
+			Body.SleepThresholdMultiplier = CurrentBody.SleepThresholdMultiplier;
+			Body.PhysicsType = CurrentBody.PhysicsType;
+			Body.CollisionEnabled = CurrentBody.CollisionEnabled;
+		}
+
+		auto IsUntouched = [&InOutResult, &UntouchedBones](int32 BodyIndex)
+		{
+			return UntouchedBones.Contains(InOutResult.Bodies[BodyIndex].BoneName);
+		};
+
+		// Joints between two untouched bodies are the asset's, including ones added or deleted by hand
+		InOutResult.Constraints.RemoveAll([&IsUntouched](const FBetterPAConstraintResult& Constraint)
+		{
+			return IsUntouched(Constraint.ChildBody) && IsUntouched(Constraint.ParentBody);
+		});
+		for (const FBetterPAConstraintResult& CurrentConstraint : Current.Constraints)
+		{
+			const int32 ChildBody = CurrentToResult[CurrentConstraint.ChildBody];
+			const int32 ParentBody = CurrentToResult[CurrentConstraint.ParentBody];
+			if (ChildBody != INDEX_NONE && ParentBody != INDEX_NONE)
+			{
+				FBetterPAConstraintResult& Constraint = InOutResult.Constraints.Add_GetRef(CurrentConstraint);
+				Constraint.ChildBody = ChildBody;
+				Constraint.ParentBody = ParentBody;
+				for (const FBetterPAConstraintProfile& Profile : Constraint.Profiles)
+				{
+					InOutResult.ConstraintProfileNames.AddUnique(Profile.Name);
+				}
+			}
+		}
+
+		InOutResult.DisabledCollisions.RemoveAll([&IsUntouched](const TPair<int32, int32>& Pair)
+		{
+			return IsUntouched(Pair.Key) && IsUntouched(Pair.Value);
+		});
+		for (const TPair<int32, int32>& Pair : Current.DisabledCollisions)
+		{
+			const int32 BodyA = CurrentToResult[Pair.Key];
+			const int32 BodyB = CurrentToResult[Pair.Value];
+			if (BodyA != INDEX_NONE && BodyB != INDEX_NONE)
+			{
+				InOutResult.DisabledCollisions.Emplace(BodyA, BodyB);
+			}
+		}
+	}
+}
+
+FArchive& operator<<(FArchive& Ar, FBetterPAGenerationRecord& Record)
+{
+	Ar << Record.PhysicsAsset;
+	FBetterPAGenerationSettings::StaticStruct()->SerializeItem(Ar, &Record.Settings, nullptr);
+	Ar << Record.SelectedBones;
+	Ar << Record.BoneHashes;
+	return Ar;
+}
+
+void FBetterPAGenerationRecordTable::Serialize(FArchive& Ar)
+{
+	int32 Version = GenerationRecordVersion;
+	Ar << Version;
+	if (Ar.IsLoading() && Version != GenerationRecordVersion)
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << Records;
+}
+
+bool FBetterPAGenerationRecordTable::Save(const FString& FilePath) const
+{
+	// Settings hold object references and names, which plain memory archives cannot write
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	FObjectAndNameAsStringProxyArchive Archive(Writer, false);
+	const_cast<FBetterPAGenerationRecordTable*>(this)->Serialize(Archive);
+	return FFileHelper::SaveArrayToFile(Data, *FilePath);
+}
+
+bool FBetterPAGenerationRecordTable::Load(const FString& FilePath)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *FilePath, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	FObjectAndNameAsStringProxyArchive Archive(Reader, false);
+	Serialize(Archive);
+	if (Archive.IsError())
+	{
+		Records.Reset();
+		return false;
+	}
+	return true;
+}
+
+const FBetterPAGenerationRecord* FBetterPAGenerationRecordTable::FindByPhysicsAsset(const FSoftObjectPath& PhysicsAsset) const
+{
+	for (const TPair<FString, FBetterPAGenerationRecord>& Entry : Records)
+	{
+		if (Entry.Value.PhysicsAsset == PhysicsAsset)
+		{
+			return &Entry.Value;
+		}
+	}
+	return nullptr;
+}
+
+FString FBetterPAGenerationRecordTable::GetDefaultPath()
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("BetterPA"), TEXT("GenerationRecords.bin"));
+}
+
+void FBetterPAAutoRegenerator::Register()
+{
+	// The import subsystem only exists once the editor is up
+	if (GEditor)
+	{
+		OnPostEngineInit();
+	}
+	else
+	{
+		PostEngineInitHandle = FCoreDelegates::OnPostEngineInit.AddRaw(this, &FBetterPAAutoRegenerator::OnPostEngineInit);
+	}
+}
+
+void FBetterPAAutoRegenerator::Unregister()
+{
+	FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(PropertyChangedHandle);
+	if (GEditor)
+	{
+		if (UImportSubsystem* ImportSubsystem = GEditor->GetEditorSubsystem<UImportSubsystem>())
+		{
+			ImportSubsystem->OnAssetReimport.Remove(ReimportHandle);
+		}
+	}
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+
+	// Workers read the snapshots and settings held here, let them stop before the entries go
+	for (TPair<FString, FRegeneration>& Running : InFlight)
+	{
+		*Running.Value.Cancelled = true;
+	}
+	for (TPair<FString, FRegeneration>& Running : InFlight)
+	{
+		Running.Value.Task.Wait();
+	}
+
+	// Finished tasks check the module is still there before touching this object
+	QueuedMeshes.Reset();
+	InFlight.Reset();
+}
+
+void FBetterPAAutoRegenerator::OnPostEngineInit()
+{
+	if (!GEditor)
+	{
+		return;
+	}
+
+	if (UImportSubsystem* ImportSubsystem = GEditor->GetEditorSubsystem<UImportSubsystem>())
+	{
+		ReimportHandle = ImportSubsystem->OnAssetReimport.AddRaw(this, &FBetterPAAutoRegenerator::OnAssetReimport);
+	}
+	PropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddRaw(this, &FBetterPAAutoRegenerator::OnObjectPropertyChanged);
+}
+
+void FBetterPAAutoRegenerator::LoadTable()
+{
+	if (!bTableLoaded)
+	{
+		Table.Load(FBetterPAGenerationRecordTable::GetDefaultPath());
+		bTableLoaded = true;
+	}
+}
+
+const FBetterPAGenerationRecord* FBetterPAAutoRegenerator::FindRecord(const UPhysicsAsset* PhysicsAsset)
+{
+	if (!PhysicsAsset)
+	{
+		return nullptr;
+	}
+
+	LoadTable();
+	return Table.FindByPhysicsAsset(FSoftObjectPath(PhysicsAsset));
+}
+
+void FBetterPAAutoRegenerator::RecordGeneration(const USkeletalMesh* SkeletalMesh, const UPhysicsAsset* PhysicsAsset, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings)
+{
+	if (!SkeletalMesh || !PhysicsAsset)
+	{
+		return;
+	}
+
+	LoadTable();
+
+	FBetterPAGenerationRecord& Record = Table.Records.FindOrAdd(SkeletalMesh->GetPathName());
+	Record.PhysicsAsset = FSoftObjectPath(PhysicsAsset);
+	Record.Settings = Settings;
+	Record.Settings.ShapePriors.Reset();
+	Record.SelectedBones = SelectedBones.Array();
+	Record.SelectedBones.Sort(FNameLexicalLess());
+	HashSourceData(SkeletalMesh, Settings.LODIndex, Record.BoneHashes);
+
+	Table.Save(FBetterPAGenerationRecordTable::GetDefaultPath());
+}
+
+void FBetterPAAutoRegenerator::HashSourceData(const USkeletalMesh* SkeletalMesh, int32 LODIndex, TMap<FName, uint64>& OutBoneHashes)
+{
+	OutBoneHashes.Reset();
+	if (!SkeletalMesh)
+	{
+		return;
+	}
+
+	const FReferenceSkeleton& RefSkeleton = SkeletalMesh->GetRefSkeleton();
+	const int32 NumBones = RefSkeleton.GetNum();
+
+	TArray<FXxHash64Builder> Builders;
+	Builders.SetNum(NumBones);
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		// Names as text, FName indices differ between editor sessions
+		const FString BoneName = RefSkeleton.GetBoneName(BoneIndex).ToString();
+		const int32 ParentIndex = RefSkeleton.GetParentIndex(BoneIndex);
+		const FString ParentName = ParentIndex != INDEX_NONE ? RefSkeleton.GetBoneName(ParentIndex).ToString() : FString();
+		const FTransform3f Pose(RefSkeleton.GetRefBonePose()[BoneIndex]);
+		const FQuat4f Rotation = Pose.GetRotation();
+		const FVector3f Translation = Pose.GetTranslation();
+		const FVector3f Scale = Pose.GetScale3D();
+
+		FXxHash64Builder& Builder = Builders[BoneIndex];
+		Builder.Update(*BoneName, BoneName.Len() * sizeof(TCHAR));
+		Builder.Update(*ParentName, ParentName.Len() * sizeof(TCHAR));
+		Builder.Update(&Rotation, sizeof(Rotation));
+		Builder.Update(&Translation, sizeof(Translation));
+		Builder.Update(&Scale, sizeof(Scale));
+	}
+
+	// Each vertex goes into the hash of every bone it is weighted to, so a weight paint change only dirties the bones it touched
+	const FSkeletalMeshModel* ImportedModel = SkeletalMesh->GetImportedModel();
+	if (ImportedModel && ImportedModel->LODModels.IsValidIndex(LODIndex))
+	{
+		for (const FSkelMeshSection& Section : ImportedModel->LODModels[LODIndex].Sections)
+		{
+			for (const FSoftSkinVertex& Vertex : Section.SoftVertices)
+			{
+				for (int32 InfluenceIndex = 0; InfluenceIndex < MAX_TOTAL_INFLUENCES; ++InfluenceIndex)
+				{
+					const auto Weight = Vertex.InfluenceWeights[InfluenceIndex];
+					if (Weight == 0 || !Section.BoneMap.IsValidIndex(Vertex.InfluenceBones[InfluenceIndex]))
+					{
+						continue;
+					}
+
+					const int32 BoneIndex = Section.BoneMap[Vertex.InfluenceBones[InfluenceIndex]];
+					if (Builders.IsValidIndex(BoneIndex))
+					{
+						Builders[BoneIndex].Update(&Vertex.Position, sizeof(Vertex.Position));
+						Builders[BoneIndex].Update(&Weight, sizeof(Weight));
+					}
+				}
+			}
+		}
+	}
+
+	OutBoneHashes.Reserve(NumBones);
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		OutBoneHashes.Add(RefSkeleton.GetBoneName(BoneIndex), Builders[BoneIndex].Finalize().Hash);
+	}
+}
+
+void FBetterPAAutoRegenerator::OnAssetReimport(UObject* Object)
+{
+	QueueCheck(Object);
+}
+
+void FBetterPAAutoRegenerator::OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+{
+	// Interactive edits fire on every drag step, wait for the value to be committed
+	if (PropertyChangedEvent.ChangeType != EPropertyChangeType::Interactive)
+	{
+		QueueCheck(Object);
+	}
+}
+
+void FBetterPAAutoRegenerator::QueueCheck(UObject* Object)
+{
+	const USkeletalMesh* SkeletalMesh = Cast<USkeletalMesh>(Object);
+	if (!SkeletalMesh)
+	{
+		return;
+	}
+
+	LoadTable();
+
+	const FString MeshPath = SkeletalMesh->GetPathName();
+	if (!Table.Records.Contains(MeshPath))
+	{
+		return;
+	}
+
+	// A reimport fires post-edit events as well, one check per mesh on the next tick covers all of them
+	QueuedMeshes.Add(MeshPath);
+	if (!TickerHandle.IsValid())
+	{
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FBetterPAAutoRegenerator::ProcessQueuedChecks));
+	}
+}
+
+bool FBetterPAAutoRegenerator::ProcessQueuedChecks(float DeltaTime)
+{
+	TickerHandle.Reset();
+
+	TSet<FString> Meshes = MoveTemp(QueuedMeshes);
+	QueuedMeshes.Reset();
+	for (const FString& MeshPath : Meshes)
+	{
+		if (FRegeneration* Running = InFlight.Find(MeshPath))
+		{
+			Running->bRequeue = true;
+			continue;
+		}
+
+		const FBetterPAGenerationRecord* Record = Table.Records.Find(MeshPath);
+		USkeletalMesh* SkeletalMesh = FindObject<USkeletalMesh>(nullptr, *MeshPath);
+		if (!Record || !SkeletalMesh)
+		{
+			continue;
+		}
+
+		TMap<FName, uint64> BoneHashes;
+		HashSourceData(SkeletalMesh, Record->Settings.LODIndex, BoneHashes);
+		if (BoneHashes.OrderIndependentCompareEqual(Record->BoneHashes))
+		{
+			UE_LOG(LogBetterPAAutoRegen, Verbose, TEXT("%s changed, but not its skeleton or skinning"), *MeshPath);
+			continue;
+		}
+
+		StartRegeneration(SkeletalMesh, *Record, MoveTemp(BoneHashes));
+	}
+
+	return false;
+}
+
+void FBetterPAAutoRegenerator::StartRegeneration(USkeletalMesh* SkeletalMesh, const FBetterPAGenerationRecord& Record, TMap<FName, uint64>&& BoneHashes)
+{
+	UPhysicsAsset* PhysicsAsset = Cast<UPhysicsAsset>(Record.PhysicsAsset.TryLoad());
+	if (!PhysicsAsset)
+	{
+		UE_LOG(LogBetterPAAutoRegen, Warning, TEXT("%s was generated for %s but no longer exists, forgetting it"), *Record.PhysicsAsset.ToString(), *SkeletalMesh->GetPathName());
+		Table.Records.Remove(SkeletalMesh->GetPathName());
+		Table.Save(FBetterPAGenerationRecordTable::GetDefaultPath());
+		return;
+	}
+
+	// Bones whose own data changed; an added or removed bone shifts the hierarchy, so everything is refitted then
+	TSet<FName> DirtyBones;
+	bool bFullRebuild = BoneHashes.Num() != Record.BoneHashes.Num();
+	for (const TPair<FName, uint64>& BoneHash : BoneHashes)
+	{
+		const uint64* PreviousHash = Record.BoneHashes.Find(BoneHash.Key);
+		if (!PreviousHash)
+		{
+			bFullRebuild = true;
+			break;
+		}
+		if (*PreviousHash != BoneHash.Value)
+		{
+			DirtyBones.Add(BoneHash.Key);
+		}
+	}
+
+	FBetterPAGenerationSettings Settings = Record.Settings;
+	if (Settings.bUseShapePriors)
+	{
+		Settings.ShapePriors = FBetterPAShapePriors::LoadDefault();
+	}
+	TSet<FName> SelectedBones(Record.SelectedBones);
+
+	// Reimports and property edits rewrite the mesh on the game thread, the worker reads a private copy instead
+	USkeletalMesh* Snapshot = DuplicateObject<USkeletalMesh>(SkeletalMesh, GetTransientPackage());
+	Snapshot->SetFlags(RF_Transient);
+
+	// Untouched bodies keep the shapes the asset has; the record holds the settings it was generated with, so they match
+	// what a fresh pass would give unless they were edited, and those edits are what KeepUntouchedFromAsset preserves
+	TSharedPtr<FBetterPAGenerationResult> Previous = MakeShared<FBetterPAGenerationResult>();
+	TSet<FName> UntouchedBones;
+	if (!bFullRebuild)
+	{
+		FBetterPAInterchange::ResultFromAsset(PhysicsAsset, *Previous);
+		UntouchedBones = GatherUntouchedBones(Snapshot->GetRefSkeleton(), Record.SelectedBones, DirtyBones);
+	}
+
+	const FString MeshPath = SkeletalMesh->GetPathName();
+	FRegeneration& Regeneration = InFlight.Add(MeshPath);
+	Regeneration.SkeletalMesh.Reset(SkeletalMesh);
+	Regeneration.PhysicsAsset.Reset(PhysicsAsset);
+	Regeneration.BoneHashes = MoveTemp(BoneHashes);
+	Regeneration.Snapshot.Reset(Snapshot);
+	Regeneration.UntouchedBones = MoveTemp(UntouchedBones);
+	Regeneration.Cancelled = MakeShared<FThreadSafeBool>(false);
+
+	UE_LOG(LogBetterPAAutoRegen, Log, TEXT("%s changed, regenerating %s (%s)"), *MeshPath, *PhysicsAsset->GetName(),
+		bFullRebuild ? TEXT("skeleton changed") : *FString::Printf(TEXT("%d bones changed"), DirtyBones.Num()));
+
+	const USkeletalMesh* Mesh = Snapshot;
+	TSharedPtr<FThreadSafeBool> Cancelled = Regeneration.Cancelled;
+	Regeneration.Task = Async(EAsyncExecution::ThreadPool, [this, Mesh, MeshPath, SelectedBones = MoveTemp(SelectedBones), DirtyBones = MoveTemp(DirtyBones), Settings, Previous, bFullRebuild, Cancelled]()
+	{
+		TSharedPtr<FBetterPAGenerationResult> Result = MakeShared<FBetterPAGenerationResult>();
+		if (bFullRebuild)
+		{
+			FBetterPAGenerator::Generate(Mesh, SelectedBones, Settings, *Result, Cancelled.Get());
+		}
+		else
+		{
+			FBetterPAGenerator::GenerateIncremental(Mesh, SelectedBones, Settings, DirtyBones, *Previous, *Result, Cancelled.Get());
+		}
+
+		if (*Cancelled)
+		{
+			return;
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [this, MeshPath, Result]()
+		{
+			// The module may have shut down while the task ran
+			if (FModuleManager::Get().IsModuleLoaded(TEXT("BetterPA")))
+			{
+				OnRegenerationFinished(MeshPath, Result);
+			}
+		});
+	});
+}
+
+void FBetterPAAutoRegenerator::OnRegenerationFinished(const FString& MeshPath, TSharedPtr<const FBetterPAGenerationResult> Result)
+{
+	FRegeneration* Running = InFlight.Find(MeshPath);
+	if (!Running)
+	{
+		return;
+	}
+	FRegeneration Regeneration = MoveTemp(*Running);
+	InFlight.Remove(MeshPath);
+
+	UPhysicsAsset* PhysicsAsset = Regeneration.PhysicsAsset.Get();
+	if (Result->Bodies.Num() > 0)
+	{
+		// Read at apply time, so edits made while the worker ran are kept as well
+		FBetterPAGenerationResult Merged = *Result;
+		if (Regeneration.UntouchedBones.Num() > 0)
+		{
+			KeepUntouchedFromAsset(PhysicsAsset, Regeneration.UntouchedBones, Merged);
+		}
+
+		const FBetterPAApplyStats Stats = FBetterPAGenerator::ApplyResultTransacted(PhysicsAsset, Merged, LOCTEXT("RegeneratePhysicsAssetTransaction", "Regenerate Physics Asset"));
+		RegeneratedAssets.Add(FString::Printf(TEXT("%s: %d added, %d changed, %d removed"), *PhysicsAsset->GetName(), Stats.NumAdded, Stats.NumChanged, Stats.NumRemoved));
+
+		if (FBetterPAGenerationRecord* Record = Table.Records.Find(MeshPath))
+		{
+			Record->BoneHashes = MoveTemp(Regeneration.BoneHashes);
+			Table.Save(FBetterPAGenerationRecordTable::GetDefaultPath());
+		}
+	}
+	else
+	{
+		UE_LOG(LogBetterPAAutoRegen, Warning, TEXT("Regenerating %s gave no bodies, the asset was left as it is"), *PhysicsAsset->GetName());
+	}
+
+	if (Regeneration.bRequeue)
+	{
+		QueueCheck(Regeneration.SkeletalMesh.Get());
+	}
+
+	// One notification for everything a batch of reimports regenerated
+	if (InFlight.Num() == 0 && QueuedMeshes.Num() == 0 && RegeneratedAssets.Num() > 0)
+	{
+		FNotificationInfo Info(FText::Format(LOCTEXT("PhysicsAssetsRegenerated", "Regenerated physics assets after their meshes changed:\n{0}"),
+			FText::FromString(FString::Join(RegeneratedAssets, TEXT("\n")))));
+		Info.ExpireDuration = 8.0f;
+		FSlateNotificationManager::Get().AddNotification(Info);
+		RegeneratedAssets.Reset();
+	}
+}
+
+#undef LOCTEXT_NAMESPACE
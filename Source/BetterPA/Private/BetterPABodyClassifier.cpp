@@ -0,0 +1,93 @@
+#include "BetterPABodyClassifier.h"
+#include "BetterPAGenerator.h"
+
+const TCHAR* FBetterPABodyClassifier::GetClassName(EBetterPABodyClass Class)
+{
+	switch (Class)
+	{
+	case EBetterPABodyClass::Full: return TEXT("Full");
+	case EBetterPABodyClass::LowInfluence: return TEXT("LowInfluence");
+	case EBetterPABodyClass::Small: return TEXT("Small");
+	case EBetterPABodyClass::Deep: return TEXT("Deep");
+	case EBetterPABodyClass::Chain: return TEXT("Chain");
+	default: return TEXT("Unknown");
+	}
+}
+
+void FBetterPABodyClassifier::Classify(FBetterPAGenerationResult& Result, const TBitArray<>& ChainBodies, const TArray<float>& Influence, const FBetterPAGenerationSettings& Settings)
+{
+	const int32 NumBodies = Result.Bodies.Num();
+
+	// Parents precede their children, so one pass sees every parent's depth first
+	TArray<int32> Depths;
+	Depths.SetNumUninitialized(NumBodies);
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		FBetterPABodyResult& Body = Result.Bodies[BodyIndex];
+		Depths[BodyIndex] = Body.ParentBody != INDEX_NONE ? Depths[Body.ParentBody] + 1 : 0;
+
+		// Root bodies anchor the ragdoll and stay fully simulated
+		EBetterPABodyClass Class = EBetterPABodyClass::Full;
+		if (Body.ParentBody != INDEX_NONE)
+		{
+			if (Settings.MinInfluence > 0.0f && Influence.IsValidIndex(BodyIndex) && Influence[BodyIndex] < Settings.MinInfluence)
+			{
+				Class = EBetterPABodyClass::LowInfluence;
+			}
+			else if (Body.AggGeom.GetVolume(FVector::OneVector) < Settings.SmallBodyVolume)
+			{
+				Class = EBetterPABodyClass::Small;
+			}
+			else if (Settings.MaxSimulatedDepth > 0 && Depths[BodyIndex] > Settings.MaxSimulatedDepth)
+			{
+				Class = EBetterPABodyClass::Deep;
+			}
+			else if (ChainBodies.IsValidIndex(BodyIndex) && ChainBodies[BodyIndex])
+			{
+				Class = EBetterPABodyClass::Chain;
+			}
+		}
+
+		FBetterPABodyClassResponse Response;
+		switch (Class)
+		{
+		case EBetterPABodyClass::LowInfluence: Response = Settings.LowInfluenceResponse; break;
+		case EBetterPABodyClass::Small: Response = Settings.SmallBodyResponse; break;
+		case EBetterPABodyClass::Deep: Response = Settings.DeepBodyResponse; break;
+		case EBetterPABodyClass::Chain: Response = Settings.ChainBodyResponse; break;
+		default: break;
+		}
+
+		Body.Class = Class;
+		Body.PhysicsType = Response.PhysicsType;
+		Body.CollisionEnabled = Response.CollisionEnabled;
+	}
+}
+
+FBetterPABodyClassSummary FBetterPABodyClassifier::Summarize(const FBetterPAGenerationResult& Result)
+{
+	FBetterPABodyClassSummary Summary;
+	for (const FBetterPABodyResult& Body : Result.Bodies)
+	{
+		const int32 NumShapes = Body.AggGeom.GetElementCount();
+
+		++Summary.NumBodies;
+		++Summary.NumPerClass[(int32)Body.Class];
+		Summary.NumShapes += NumShapes;
+
+		if (Body.PhysicsType != PhysType_Kinematic)
+		{
+			++Summary.NumSimulated;
+		}
+		if (CollisionEnabledHasPhysics(Body.CollisionEnabled))
+		{
+			Summary.NumContactShapes += NumShapes;
+		}
+		if (CollisionEnabledHasQuery(Body.CollisionEnabled))
+		{
+			Summary.NumQueryShapes += NumShapes;
+		}
+	}
+	return Summary;
+}
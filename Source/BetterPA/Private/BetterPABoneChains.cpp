@@ -0,0 +1,69 @@
+#include "BetterPABoneChains.h"
+#include "ReferenceSkeleton.h"
+
+void BetterPA::FindBoneChains(const FReferenceSkeleton& RefSkeleton, int32 MinBones, TArray<FBetterPABoneChain>& OutChains)
+{
+	OutChains.Reset();
+
+	const TArray<FMeshBoneInfo>& BoneInfo = RefSkeleton.GetRefBoneInfo();
+	const TArray<FTransform>& BonePose = RefSkeleton.GetRefBonePose();
+	const int32 NumBones = BoneInfo.Num();
+
+	// Child count and the only child of single-child bones
+	TArray<int32> NumChildren;
+	TArray<int32> OnlyChild;
+	NumChildren.Init(0, NumBones);
+	OnlyChild.Init(INDEX_NONE, NumBones);
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		const int32 ParentIndex = BoneInfo[BoneIndex].ParentIndex;
+		if (ParentIndex != INDEX_NONE)
+		{
+			++NumChildren[ParentIndex];
+			OnlyChild[ParentIndex] = BoneIndex;
+		}
+	}
+
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		// Chains hang off a branching bone, single-child parents belong to the run above
+		const int32 ParentIndex = BoneInfo[BoneIndex].ParentIndex;
+		if (ParentIndex == INDEX_NONE || NumChildren[ParentIndex] == 1)
+		{
+			continue;
+		}
+
+		int32 BoneCount = 1;
+		int32 TipIndex = BoneIndex;
+		while (NumChildren[TipIndex] == 1)
+		{
+			TipIndex = OnlyChild[TipIndex];
+			++BoneCount;
+		}
+
+		if (NumChildren[TipIndex] != 0 || BoneCount < MinBones)
+		{
+			continue;
+		}
+
+		FBetterPABoneChain& Chain = OutChains.AddDefaulted_GetRef();
+		Chain.Bones.Reserve(BoneCount);
+		Chain.Distances.Reserve(BoneCount);
+
+		float Distance = 0.0f;
+		for (int32 ChainBone = BoneIndex; ; ChainBone = OnlyChild[ChainBone])
+		{
+			if (Chain.Bones.Num() > 0)
+			{
+				Distance += BonePose[ChainBone].GetTranslation().Size();
+			}
+			Chain.Bones.Add(ChainBone);
+			Chain.Distances.Add(Distance);
+
+			if (ChainBone == TipIndex)
+			{
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,431 @@
+#include "BetterPAConstraintBuilder.h"
+#include "BetterPAGenerator.h"
+#include "BetterPAFrameKernel.h"
+#include "Engine/SkeletalMesh.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "AnimationRuntime.h"
+
+namespace
+{
+	FConstraintProfileProperties MakeProfileProperties(const FConstraintProfileProperties& Default, const FBetterPAConstraintProfile& Profile)
+	{
+		FConstraintProfileProperties Properties = Default;
+
+		// Free and locked axes stay that way, only limited ones take the profile's limits
+		Properties.ConeLimit.Swing1LimitDegrees = Default.ConeLimit.Swing1Motion == EAngularConstraintMotion::ACM_Limited ? Profile.Swing1Limit : Default.ConeLimit.Swing1LimitDegrees;
+		Properties.ConeLimit.Swing2LimitDegrees = Default.ConeLimit.Swing2Motion == EAngularConstraintMotion::ACM_Limited ? Profile.Swing2Limit : Default.ConeLimit.Swing2LimitDegrees;
+		Properties.TwistLimit.TwistLimitDegrees = Default.TwistLimit.TwistMotion == EAngularConstraintMotion::ACM_Limited ? Profile.TwistLimit : Default.TwistLimit.TwistLimitDegrees;
+
+		const bool bSoftLimits = Profile.LimitStiffness > 0.0f;
+		Properties.ConeLimit.bSoftConstraint = bSoftLimits;
+		Properties.ConeLimit.Stiffness = Profile.LimitStiffness;
+		Properties.ConeLimit.Damping = Profile.LimitDamping;
+		Properties.TwistLimit.bSoftConstraint = bSoftLimits;
+		Properties.TwistLimit.Stiffness = Profile.LimitStiffness;
+		Properties.TwistLimit.Damping = Profile.LimitDamping;
+
+		// Orientation target stays at the reference pose
+		FConstraintDrive& SlerpDrive = Properties.AngularDrive.SlerpDrive;
+		Properties.AngularDrive.AngularDriveMode = EAngularDriveMode::SLERP;
+		SlerpDrive.bEnablePositionDrive = Profile.DriveStiffness > 0.0f;
+		SlerpDrive.bEnableVelocityDrive = Profile.DriveStiffness > 0.0f && Profile.DriveDamping > 0.0f;
+		SlerpDrive.Stiffness = Profile.DriveStiffness;
+		SlerpDrive.Damping = Profile.DriveDamping;
+
+		return Properties;
+	}
+
+	int32 FindProfileHandle(const TArray<FPhysicsConstraintProfileHandle>& Handles, FName ProfileName)
+	{
+		return Handles.IndexOfByPredicate([ProfileName](const FPhysicsConstraintProfileHandle& Handle) { return Handle.ProfileName == ProfileName; });
+	}
+
+	void GetProfilesFromDefault(const FConstraintInstance& Instance, TConstArrayView<FBetterPAConstraintProfileRule> Rules, TArray<FBetterPAConstraintProfile>& OutProfiles)
+	{
+		OutProfiles.Reset(Rules.Num());
+		for (const FBetterPAConstraintProfileRule& Rule : Rules)
+		{
+			if (!Rule.Name.IsNone())
+			{
+				OutProfiles.Add(BetterPA::MakeConstraintProfile(Rule, Instance.GetAngularSwing1Limit(), Instance.GetAngularSwing2Limit(), Instance.GetAngularTwistLimit()));
+			}
+		}
+	}
+
+	void GetRuleNames(TConstArrayView<FBetterPAConstraintProfileRule> Rules, TArray<FName>& OutNames)
+	{
+		for (const FBetterPAConstraintProfileRule& Rule : Rules)
+		{
+			if (!Rule.Name.IsNone())
+			{
+				OutNames.AddUnique(Rule.Name);
+			}
+		}
+	}
+}
+
+TArray<FBetterPAConstraintProfileRule> BetterPA::GetRagdollProfilePresets()
+{
+	TArray<FBetterPAConstraintProfileRule> Presets;
+
+	// Loose, soft limits and no drive, the body folds under its own weight
+	FBetterPAConstraintProfileRule& LimpDeath = Presets.AddDefaulted_GetRef();
+	LimpDeath.Name = TEXT("LimpDeath");
+	LimpDeath.LimitScale = 1.25f;
+	LimpDeath.LimitStiffness = 50.0f;
+	LimpDeath.LimitDamping = 5.0f;
+
+	// Generated limits and a weak drive, limbs flail but drift back towards the pose
+	FBetterPAConstraintProfileRule& Stumble = Presets.AddDefaulted_GetRef();
+	Stumble.Name = TEXT("Stumble");
+	Stumble.DriveStiffness = 500.0f;
+	Stumble.DriveDampingRatio = 1.0f;
+
+	// Tighter limits and a strong, slightly underdamped drive so hits snap back
+	FBetterPAConstraintProfileRule& HitReaction = Presets.AddDefaulted_GetRef();
+	HitReaction.Name = TEXT("HitReaction");
+	HitReaction.LimitScale = 0.8f;
+	HitReaction.DriveStiffness = 2000.0f;
+	HitReaction.DriveDampingRatio = 0.7f;
+
+	return Presets;
+}
+
+FBetterPAConstraintProfile BetterPA::MakeConstraintProfile(const FBetterPAConstraintProfileRule& Rule, float Swing1Limit, float Swing2Limit, float TwistLimit)
+{
+	FBetterPAConstraintProfile Profile;
+	Profile.Name = Rule.Name;
+
+	const float LimitScale = FMath::Max(Rule.LimitScale, 0.0f);
+	Profile.Swing1Limit = FMath::Min(Swing1Limit * LimitScale, 180.0f);
+	Profile.Swing2Limit = FMath::Min(Swing2Limit * LimitScale, 180.0f);
+	Profile.TwistLimit = FMath::Min(TwistLimit * LimitScale, 180.0f);
+
+	Profile.LimitStiffness = FMath::Max(Rule.LimitStiffness, 0.0f);
+	Profile.LimitDamping = FMath::Max(Rule.LimitDamping, 0.0f);
+
+	// Drives default to acceleration mode, where critical damping is 2 * sqrt(k) whatever the body's mass
+	Profile.DriveStiffness = FMath::Max(Rule.DriveStiffness, 0.0f);
+	Profile.DriveDamping = 2.0f * FMath::Sqrt(Profile.DriveStiffness) * FMath::Max(Rule.DriveDampingRatio, 0.0f);
+
+	return Profile;
+}
+
+void BetterPA::WriteConstraintProfiles(UPhysicsConstraintTemplate& Constraint, TConstArrayView<FBetterPAConstraintProfile> Profiles)
+{
+	for (const FBetterPAConstraintProfile& Profile : Profiles)
+	{
+		int32 HandleIndex = FindProfileHandle(Constraint.ProfileHandles, Profile.Name);
+		if (HandleIndex == INDEX_NONE)
+		{
+			HandleIndex = Constraint.ProfileHandles.AddDefaulted();
+			Constraint.ProfileHandles[HandleIndex].ProfileName = Profile.Name;
+		}
+		Constraint.ProfileHandles[HandleIndex].ProfileProperties = MakeProfileProperties(Constraint.DefaultInstance.ProfileInstance, Profile);
+	}
+}
+
+bool BetterPA::ConstraintProfilesMatch(const UPhysicsConstraintTemplate& Constraint, TConstArrayView<FBetterPAConstraintProfile> Profiles)
+{
+	for (const FBetterPAConstraintProfile& Profile : Profiles)
+	{
+		const int32 HandleIndex = FindProfileHandle(Constraint.ProfileHandles, Profile.Name);
+		if (HandleIndex == INDEX_NONE)
+		{
+			return false;
+		}
+
+		const FConstraintProfileProperties Expected = MakeProfileProperties(Constraint.DefaultInstance.ProfileInstance, Profile);
+		if (!FConstraintProfileProperties::StaticStruct()->CompareScriptStruct(&Constraint.ProfileHandles[HandleIndex].ProfileProperties, &Expected, PPF_None))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void BetterPA::AddConstraintProfileNames(UPhysicsAsset* PhysicsAsset, TConstArrayView<FName> Names)
+{
+	if (!PhysicsAsset || Names.Num() == 0)
+	{
+		return;
+	}
+
+	// Private on UPhysicsAsset, the editor's details panel edits it through reflection as well
+	const FArrayProperty* Property = FindFProperty<FArrayProperty>(UPhysicsAsset::StaticClass(), TEXT("ConstraintProfiles"));
+	if (!Property)
+	{
+		return;
+	}
+
+	TArray<FName>& ProfileNames = *Property->ContainerPtrToValuePtr<TArray<FName>>(PhysicsAsset);
+	for (FName Name : Names)
+	{
+		ProfileNames.AddUnique(Name);
+	}
+}
+
+void FBetterPAConstraintContext::Init(const UPhysicsAsset* PhysicsAsset)
+{
+	ComponentSpaceTransforms.Reset();
+	ParentIndices.Reset();
+	BoneIndices.Reset();
+
+	USkeletalMesh* SkelMesh = PhysicsAsset ? PhysicsAsset->PreviewSkeletalMesh.Get() : nullptr;
+	if (!SkelMesh)
+	{
+		return;
+	}
+
+	const FReferenceSkeleton& RefSkeleton = SkelMesh->GetRefSkeleton();
+	FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, RefSkeleton.GetRefBonePose(), ComponentSpaceTransforms);
+
+	const TArray<FMeshBoneInfo>& BoneInfo = RefSkeleton.GetRefBoneInfo();
+	ParentIndices.Reserve(BoneInfo.Num());
+	BoneIndices.Reserve(BoneInfo.Num());
+	for (int32 BoneIndex = 0; BoneIndex < BoneInfo.Num(); ++BoneIndex)
+	{
+		ParentIndices.Add(BoneInfo[BoneIndex].ParentIndex);
+		BoneIndices.Add(BoneInfo[BoneIndex].Name, BoneIndex);
+	}
+}
+
+int32 FBetterPAConstraintContext::FindBone(FName BoneName) const
+{
+	const int32* BoneIndex = BoneIndices.Find(BoneName);
+	return BoneIndex ? *BoneIndex : INDEX_NONE;
+}
+
+void FBetterPAConstraintContext::GetParentAndChild(FName Bone1, FName Bone2, FName& OutParent, FName& OutChild) const
+{
+	OutParent = Bone2;
+	OutChild = Bone1;
+
+	const int32 BoneIndex1 = FindBone(Bone1);
+	const int32 BoneIndex2 = FindBone(Bone2);
+	if (BoneIndex1 == INDEX_NONE || BoneIndex2 == INDEX_NONE)
+	{
+		return;
+	}
+
+	// Bone1 is the parent if it is an ancestor of Bone2
+	for (int32 Ancestor = ParentIndices[BoneIndex2]; Ancestor != INDEX_NONE; Ancestor = ParentIndices[Ancestor])
+	{
+		if (Ancestor == BoneIndex1)
+		{
+			OutParent = Bone1;
+			OutChild = Bone2;
+			return;
+		}
+	}
+}
+
+int32 FBetterPAConstraintBuilder::FindConstraint(const UPhysicsAsset* PhysicsAsset, FName BoneA, FName BoneB)
+{
+	if (!PhysicsAsset)
+	{
+		return INDEX_NONE;
+	}
+
+	for (int32 ConstraintIndex = 0; ConstraintIndex < PhysicsAsset->ConstraintSetup.Num(); ++ConstraintIndex)
+	{
+		const UPhysicsConstraintTemplate* ExistingConstraint = PhysicsAsset->ConstraintSetup[ConstraintIndex];
+		if (ExistingConstraint &&
+			((ExistingConstraint->DefaultInstance.ConstraintBone1 == BoneA && ExistingConstraint->DefaultInstance.ConstraintBone2 == BoneB) ||
+			 (ExistingConstraint->DefaultInstance.ConstraintBone1 == BoneB && ExistingConstraint->DefaultInstance.ConstraintBone2 == BoneA)))
+		{
+			return ConstraintIndex;
+		}
+	}
+	return INDEX_NONE;
+}
+
+UPhysicsConstraintTemplate* FBetterPAConstraintBuilder::CreateConstraint(UPhysicsAsset* PhysicsAsset, FName Bone1Name, FName Bone2Name, const FBetterPAConstraintSettings& Settings, const FBetterPAConstraintContext& Context)
+{
+	TArray<UPhysicsConstraintTemplate*> Constraints;
+	const TPair<FName, FName> Link(Bone1Name, Bone2Name);
+	CreateConstraints(PhysicsAsset, MakeArrayView(&Link, 1), Settings, Context, Constraints);
+	return Constraints[0];
+}
+
+void FBetterPAConstraintBuilder::CreateConstraints(UPhysicsAsset* PhysicsAsset, TConstArrayView<TPair<FName, FName>> Links, const FBetterPAConstraintSettings& Settings, const FBetterPAConstraintContext& Context, TArray<UPhysicsConstraintTemplate*>& OutConstraints)
+{
+	// Center of the body's first capsule in component space, the bone location for other bodies and the origin without a body
+	auto GetBodyCenter = [PhysicsAsset](FName BoneName, const FTransform& BoneTransform)
+	{
+		const int32 BodyIndex = PhysicsAsset->FindBodyIndex(BoneName);
+		if (BodyIndex == INDEX_NONE)
+		{
+			return FVector::ZeroVector;
+		}
+
+		const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[BodyIndex];
+		return BodySetup && BodySetup->AggGeom.SphylElems.Num() > 0 ? BoneTransform.TransformPosition(BodySetup->AggGeom.SphylElems[0].Center) : BoneTransform.GetLocation();
+	};
+
+	// Every link's frames go through one batch; links with a missing bone keep identity frames
+	TBitArray<> TransformsValid(false, Links.Num());
+	TArray<float> CenterDistances;
+	CenterDistances.SetNumZeroed(Links.Num());
+
+	FBetterPAJointFrameBatch JointFrames;
+	JointFrames.SetNum(Links.Num());
+	for (int32 LinkIndex = 0; LinkIndex < Links.Num(); ++LinkIndex)
+	{
+		const int32 BoneIndex1 = Context.FindBone(Links[LinkIndex].Key);
+		const int32 BoneIndex2 = Context.FindBone(Links[LinkIndex].Value);
+		if (BoneIndex1 == INDEX_NONE || BoneIndex2 == INDEX_NONE)
+		{
+			JointFrames.Set(LinkIndex, FTransform::Identity, FTransform::Identity, FVector::ZeroVector, FQuat::Identity);
+			continue;
+		}
+
+		const FTransform& T1 = Context.ComponentSpaceTransforms[BoneIndex1];
+		const FTransform& T2 = Context.ComponentSpaceTransforms[BoneIndex2];
+		TransformsValid[LinkIndex] = true;
+
+		if (Settings.Mode == EConstraintGenerationMode::Mesh)
+		{
+			// Constraint at the midpoint of the capsule centers, in Body1's orientation
+			const FVector Body1Center = GetBodyCenter(Links[LinkIndex].Key, T1);
+			const FVector Body2Center = GetBodyCenter(Links[LinkIndex].Value, T2);
+			CenterDistances[LinkIndex] = FVector::Dist(Body1Center, Body2Center);
+			JointFrames.Set(LinkIndex, T1, T2, (Body1Center + Body2Center) * 0.5f, T1.GetRotation());
+		}
+		else
+		{
+			// Constraint at Body2 (Target) location, in Body2's orientation
+			JointFrames.Set(LinkIndex, T1, T2, T2.GetLocation(), T2.GetRotation());
+		}
+	}
+	JointFrames.Compute();
+
+	OutConstraints.Reset(Links.Num());
+	for (int32 LinkIndex = 0; LinkIndex < Links.Num(); ++LinkIndex)
+	{
+		const FName Bone1Name = Links[LinkIndex].Key;
+		const FName Bone2Name = Links[LinkIndex].Value;
+		const bool bTransformsValid = TransformsValid[LinkIndex];
+
+		// Create Constraint between Bone1 (source) and Bone2 (target)
+		const FName ConstraintName = BetterPA::MakeStableObjectName(PhysicsAsset, FString::Printf(TEXT("Constraint_%s_%s"), *Bone1Name.ToString(), *Bone2Name.ToString()));
+		UPhysicsConstraintTemplate* NewConstraint = NewObject<UPhysicsConstraintTemplate>(PhysicsAsset, ConstraintName, RF_Transactional);
+		FConstraintInstance& Instance = NewConstraint->DefaultInstance;
+
+		Instance.ConstraintBone1 = Bone1Name;
+		Instance.ConstraintBone2 = Bone2Name;
+		Instance.ProfileInstance.bDisableCollision = true;
+
+		FVector Pos;
+		FVector PriAxis;
+		FVector SecAxis;
+
+		if (Settings.Mode == EConstraintGenerationMode::Standard)
+		{
+			// Standard Mode: Locked Linear, Limited Angular (45 deg)
+			Instance.SetAngularSwing1Limit(EAngularConstraintMotion::ACM_Limited, 45.0f);
+			Instance.SetAngularSwing2Limit(EAngularConstraintMotion::ACM_Limited, 45.0f);
+			Instance.SetAngularTwistLimit(EAngularConstraintMotion::ACM_Limited, 45.0f);
+
+			Instance.SetLinearXLimit(ELinearConstraintMotion::LCM_Locked, 0.0f);
+			Instance.SetLinearYLimit(ELinearConstraintMotion::LCM_Locked, 0.0f);
+			Instance.SetLinearZLimit(ELinearConstraintMotion::LCM_Locked, 0.0f);
+
+			if (bTransformsValid)
+			{
+				// Pos1 and orientation relative to Body1/Parent (aligned with Child)
+				JointFrames.GetFrame1(LinkIndex, Pos, PriAxis, SecAxis);
+				Instance.Pos1 = Pos;
+				Instance.PriAxis1 = PriAxis;
+				Instance.SecAxis1 = SecAxis;
+
+				// Pos2 and orientation relative to Body2/Child (Identity)
+				Instance.Pos2 = FVector::ZeroVector;
+				Instance.PriAxis2 = FVector(1,0,0);
+				Instance.SecAxis2 = FVector(0,1,0);
+			}
+		}
+		else if (Settings.Mode == EConstraintGenerationMode::Mesh)
+		{
+			// Mesh Mode: Free Angular, Limited Linear
+			Instance.SetAngularSwing1Limit(EAngularConstraintMotion::ACM_Free, 0.0f);
+			Instance.SetAngularSwing2Limit(EAngularConstraintMotion::ACM_Free, 0.0f);
+			Instance.SetAngularTwistLimit(EAngularConstraintMotion::ACM_Free, 0.0f);
+
+			float LinearLimit = 0.0f;
+			if (bTransformsValid)
+			{
+				// Distance between CENTERS of capsules
+				LinearLimit = Settings.bScaleByDistance ? CenterDistances[LinkIndex] * Settings.ScalingFactor : 10.0f;
+			}
+
+			Instance.SetLinearXLimit(ELinearConstraintMotion::LCM_Limited, LinearLimit);
+			Instance.SetLinearYLimit(ELinearConstraintMotion::LCM_Limited, LinearLimit);
+			Instance.SetLinearZLimit(ELinearConstraintMotion::LCM_Limited, LinearLimit);
+
+			if (bTransformsValid)
+			{
+				// Frame aligned with Body1, so its axes relative to Body1 are the identity
+				JointFrames.GetFrame1(LinkIndex, Pos, PriAxis, SecAxis);
+				Instance.Pos1 = Pos;
+				Instance.PriAxis1 = FVector(1,0,0);
+				Instance.SecAxis1 = FVector(0,1,0);
+
+				// Relative to Body2, matching Body1's frame at that point
+				JointFrames.GetFrame2(LinkIndex, Pos, PriAxis, SecAxis);
+				Instance.Pos2 = Pos;
+				Instance.PriAxis2 = PriAxis;
+				Instance.SecAxis2 = SecAxis;
+			}
+		}
+
+		if (Settings.Profiles.Num() > 0)
+		{
+			TArray<FBetterPAConstraintProfile> Profiles;
+			GetProfilesFromDefault(Instance, Settings.Profiles, Profiles);
+			BetterPA::WriteConstraintProfiles(*NewConstraint, Profiles);
+		}
+
+		OutConstraints.Add(NewConstraint);
+	}
+
+	if (Settings.Profiles.Num() > 0 && Links.Num() > 0)
+	{
+		TArray<FName> ProfileNames;
+		GetRuleNames(Settings.Profiles, ProfileNames);
+		BetterPA::AddConstraintProfileNames(PhysicsAsset, ProfileNames);
+	}
+}
+
+int32 FBetterPAConstraintBuilder::WriteProfiles(UPhysicsAsset* PhysicsAsset, TConstArrayView<FBetterPAConstraintProfileRule> Rules)
+{
+	if (!PhysicsAsset)
+	{
+		return 0;
+	}
+
+	int32 NumChanged = 0;
+	TArray<FBetterPAConstraintProfile> Profiles;
+	for (UPhysicsConstraintTemplate* Constraint : PhysicsAsset->ConstraintSetup)
+	{
+		if (!Constraint)
+		{
+			continue;
+		}
+
+		GetProfilesFromDefault(Constraint->DefaultInstance, Rules, Profiles);
+		if (!BetterPA::ConstraintProfilesMatch(*Constraint, Profiles))
+		{
+			Constraint->Modify();
+			BetterPA::WriteConstraintProfiles(*Constraint, Profiles);
+			++NumChanged;
+		}
+	}
+
+	TArray<FName> ProfileNames;
+	GetRuleNames(Rules, ProfileNames);
+	BetterPA::AddConstraintProfileNames(PhysicsAsset, ProfileNames);
+	return NumChanged;
+}
@@ -0,0 +1,836 @@
+#include "BetterPAConstraintEdGraph.h"
+#include "BetterPAConstraintGraphNode.h"
+#include "BetterPAGenerator.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "ScopedTransaction.h"
+
+#define LOCTEXT_NAMESPACE "BetterPAConstraintEdGraph"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBetterPAConstraintGraph, Log, All);
+
+namespace
+{
+	TPair<const UEdGraphNode*, const UEdGraphNode*> MakeNodePair(const UEdGraphNode* A, const UEdGraphNode* B)
+	{
+		return A < B ? TPair<const UEdGraphNode*, const UEdGraphNode*>(A, B) : TPair<const UEdGraphNode*, const UEdGraphNode*>(B, A);
+	}
+}
+
+void UBetterPAConstraintEdGraph::Initialize(UPhysicsAsset* InPhysicsAsset)
+{
+	PhysicsAsset = InPhysicsAsset;
+	Context.Init(InPhysicsAsset);
+	RebuildIndex();
+}
+
+void UBetterPAConstraintEdGraph::AddNode(UEdGraphNode* NodeToAdd, bool bUserAction, bool bSelectNewNode)
+{
+	Super::AddNode(NodeToAdd, bUserAction, bSelectNewNode);
+
+	if (UBetterPAConstraintGraphNode* BodyNode = Cast<UBetterPAConstraintGraphNode>(NodeToAdd))
+	{
+		NodesByBone.Add(BodyNode->BoneName, BodyNode);
+		for (FName Bone : BodyNode->CollapsedBones)
+		{
+			NodesByBone.Add(Bone, BodyNode);
+		}
+	}
+}
+
+bool UBetterPAConstraintEdGraph::RemoveNode(UEdGraphNode* NodeToRemove, bool bBreakAllLinks)
+{
+	// Links are broken on the pins directly, not through the schema, so note them while the pins still have them
+	TArray<TPair<const UEdGraphNode*, const UEdGraphNode*>> BrokenNodeLinks;
+	if (NodeToRemove && bBreakAllLinks)
+	{
+		for (const UEdGraphPin* Pin : NodeToRemove->Pins)
+		{
+			for (const UEdGraphPin* LinkedPin : Pin->LinkedTo)
+			{
+				const UEdGraphNode* OtherNode = LinkedPin->GetOwningNode();
+				BrokenNodeLinks.Emplace(Pin->Direction == EGPD_Output ? NodeToRemove : OtherNode, Pin->Direction == EGPD_Output ? OtherNode : NodeToRemove);
+			}
+		}
+	}
+
+	const bool bRemoved = Super::RemoveNode(NodeToRemove, bBreakAllLinks);
+	if (bRemoved)
+	{
+		// The node knows the bones it was indexed under, so only those entries are looked at
+		if (const UBetterPAConstraintGraphNode* BodyNode = Cast<UBetterPAConstraintGraphNode>(NodeToRemove))
+		{
+			for (FName Bone : BodyNode->CollapsedBones)
+			{
+				if (NodesByBone.FindRef(Bone) == BodyNode)
+				{
+					NodesByBone.Remove(Bone);
+				}
+			}
+			if (NodesByBone.FindRef(BodyNode->BoneName) == BodyNode)
+			{
+				NodesByBone.Remove(BodyNode->BoneName);
+			}
+		}
+		for (const TPair<const UEdGraphNode*, const UEdGraphNode*>& Link : BrokenNodeLinks)
+		{
+			RemoveLinkFromIndex(Link.Key, Link.Value);
+		}
+		NumParentLinks.Remove(NodeToRemove);
+		Adjacency.Remove(NodeToRemove);
+	}
+	return bRemoved;
+}
+
+void UBetterPAConstraintEdGraph::RebuildIndex()
+{
+	RebuildNodeIndex();
+	RebuildLinkIndex();
+
+	KnownConstraints.Reset();
+	ConstraintsByPair.Reset();
+	BrokenLinks.Reset();
+
+	if (UPhysicsAsset* Asset = PhysicsAsset.Get())
+	{
+		for (UPhysicsConstraintTemplate* Constraint : Asset->ConstraintSetup)
+		{
+			if (Constraint)
+			{
+				IndexConstraint(Constraint, FBetterPABonePair(Constraint->DefaultInstance.ConstraintBone1, Constraint->DefaultInstance.ConstraintBone2));
+			}
+		}
+	}
+	SnapshotConstraintSetup();
+}
+
+void UBetterPAConstraintEdGraph::SnapshotConstraintSetup()
+{
+	SetupSnapshot.Reset();
+	if (const UPhysicsAsset* Asset = PhysicsAsset.Get())
+	{
+		SetupSnapshot.Reserve(Asset->ConstraintSetup.Num());
+		for (UPhysicsConstraintTemplate* Constraint : Asset->ConstraintSetup)
+		{
+			SetupSnapshot.Add(Constraint);
+		}
+	}
+}
+
+void UBetterPAConstraintEdGraph::RebuildLinkIndex()
+{
+	LinkedNodes.Reset();
+	NumParentLinks.Reset();
+	NodeIds.Reset();
+	ComponentParents.Reset();
+	Adjacency.Reset();
+
+	for (UEdGraphNode* Node : Nodes)
+	{
+		UEdGraphPin* OutPin = Node ? Node->FindPin(TEXT("Out")) : nullptr;
+		if (OutPin)
+		{
+			for (UEdGraphPin* LinkedPin : OutPin->LinkedTo)
+			{
+				AddLinkToIndex(Node, LinkedPin->GetOwningNode());
+			}
+		}
+	}
+}
+
+void UBetterPAConstraintEdGraph::RemoveAllNodes()
+{
+	Modify();
+
+	// Both ends of every link are going, so the pins are cleared outright instead of unlinking one side at a time
+	for (UEdGraphNode* Node : Nodes)
+	{
+		if (Node)
+		{
+			for (UEdGraphPin* Pin : Node->Pins)
+			{
+				Pin->LinkedTo.Reset();
+			}
+		}
+	}
+	Nodes.Reset();
+
+	RebuildNodeIndex();
+	RebuildLinkIndex();
+}
+
+int32 UBetterPAConstraintEdGraph::GetNodeId(const UEdGraphNode* Node)
+{
+	if (const int32* NodeId = NodeIds.Find(Node))
+	{
+		return *NodeId;
+	}
+
+	const int32 NodeId = ComponentParents.Add(ComponentParents.Num());
+	NodeIds.Add(Node, NodeId);
+	return NodeId;
+}
+
+int32 UBetterPAConstraintEdGraph::FindComponent(int32 NodeId) const
+{
+	// Path halving keeps the trees flat
+	while (ComponentParents[NodeId] != NodeId)
+	{
+		ComponentParents[NodeId] = ComponentParents[ComponentParents[NodeId]];
+		NodeId = ComponentParents[NodeId];
+	}
+	return NodeId;
+}
+
+void UBetterPAConstraintEdGraph::AddLinkToIndex(const UEdGraphNode* Source, const UEdGraphNode* Target)
+{
+	bool bAlreadyLinked = false;
+	LinkedNodes.Add(MakeNodePair(Source, Target), &bAlreadyLinked);
+	if (bAlreadyLinked)
+	{
+		return;
+	}
+
+	++NumParentLinks.FindOrAdd(Target);
+	Adjacency.FindOrAdd(Source).Add(Target);
+	Adjacency.FindOrAdd(Target).Add(Source);
+
+	const int32 SourceId = GetNodeId(Source);
+	const int32 TargetId = GetNodeId(Target);
+	ComponentParents[FindComponent(SourceId)] = FindComponent(TargetId);
+}
+
+void UBetterPAConstraintEdGraph::RemoveLinkFromIndex(const UEdGraphNode* Source, const UEdGraphNode* Target)
+{
+	if (LinkedNodes.Remove(MakeNodePair(Source, Target)) == 0)
+	{
+		return;
+	}
+
+	if (int32* NumParents = NumParentLinks.Find(Target))
+	{
+		*NumParents = FMath::Max(0, *NumParents - 1);
+	}
+	if (auto* SourceLinks = Adjacency.Find(Source))
+	{
+		SourceLinks->RemoveSingleSwap(Target);
+	}
+	if (auto* TargetLinks = Adjacency.Find(Target))
+	{
+		TargetLinks->RemoveSingleSwap(Source);
+	}
+
+	SplitComponent(Source, Target);
+}
+
+void UBetterPAConstraintEdGraph::SplitComponent(const UEdGraphNode* Source, const UEdGraphNode* Target)
+{
+	if (Source == Target)
+	{
+		return;
+	}
+
+	// Flood both ends a node at a time. Meeting means the link was not a bridge and the component stands as it is,
+	// otherwise the side that runs out first is the smaller one, so the cost is bounded by the part that is cut off.
+	const UEdGraphNode* Starts[2] = { Source, Target };
+	TSet<const UEdGraphNode*> Reached[2];
+	TArray<const UEdGraphNode*> Stacks[2];
+	for (int32 Side = 0; Side < 2; ++Side)
+	{
+		Reached[Side].Add(Starts[Side]);
+		Stacks[Side].Add(Starts[Side]);
+	}
+
+	int32 Side = 0;
+	while (Stacks[Side].Num() > 0)
+	{
+		const UEdGraphNode* Node = Stacks[Side].Pop();
+		if (const auto* Neighbours = Adjacency.Find(Node))
+		{
+			for (const UEdGraphNode* Neighbour : *Neighbours)
+			{
+				if (Reached[1 - Side].Contains(Neighbour))
+				{
+					return;
+				}
+
+				bool bAlreadyReached = false;
+				Reached[Side].Add(Neighbour, &bAlreadyReached);
+				if (!bAlreadyReached)
+				{
+					Stacks[Side].Add(Neighbour);
+				}
+			}
+		}
+		Side = 1 - Side;
+	}
+
+	// The cut off side gets fresh ids under a new root, so the other side's ids stay valid wherever the old root was.
+	// The old ids are left in place until the next RebuildLinkIndex.
+	const int32 NewRoot = ComponentParents.Num();
+	for (const UEdGraphNode* Node : Reached[Side])
+	{
+		NodeIds.Add(Node, ComponentParents.Add(NewRoot));
+	}
+}
+
+bool UBetterPAConstraintEdGraph::AreNodesLinked(const UEdGraphNode* A, const UEdGraphNode* B) const
+{
+	return LinkedNodes.Contains(MakeNodePair(A, B));
+}
+
+int32 UBetterPAConstraintEdGraph::GetNumParentLinks(const UEdGraphNode* Node) const
+{
+	return NumParentLinks.FindRef(Node);
+}
+
+bool UBetterPAConstraintEdGraph::AreNodesConnected(const UEdGraphNode* A, const UEdGraphNode* B) const
+{
+	const int32* IdA = NodeIds.Find(A);
+	const int32* IdB = NodeIds.Find(B);
+	return IdA && IdB && FindComponent(*IdA) == FindComponent(*IdB);
+}
+
+void UBetterPAConstraintEdGraph::RebuildNodeIndex()
+{
+	NodesByBone.Reset();
+	for (UEdGraphNode* Node : Nodes)
+	{
+		if (UBetterPAConstraintGraphNode* BodyNode = Cast<UBetterPAConstraintGraphNode>(Node))
+		{
+			NodesByBone.Add(BodyNode->BoneName, BodyNode);
+			for (FName Bone : BodyNode->CollapsedBones)
+			{
+				NodesByBone.Add(Bone, BodyNode);
+			}
+		}
+	}
+}
+
+UBetterPAConstraintGraphNode* UBetterPAConstraintEdGraph::FindNode(FName BoneName) const
+{
+	const TWeakObjectPtr<UBetterPAConstraintGraphNode>* Node = NodesByBone.Find(BoneName);
+	return Node ? Node->Get() : nullptr;
+}
+
+void UBetterPAConstraintEdGraph::IndexConstraint(UPhysicsConstraintTemplate* Constraint, const FBetterPABonePair& Pair)
+{
+	KnownConstraints.Add(Constraint, Pair);
+	ConstraintsByPair.Add(Pair, Constraint);
+}
+
+void UBetterPAConstraintEdGraph::UnindexConstraint(const TWeakObjectPtr<UPhysicsConstraintTemplate>& Constraint)
+{
+	FBetterPABonePair Pair;
+	if (KnownConstraints.RemoveAndCopyValue(Constraint, Pair))
+	{
+		// Duplicate constraints share a pair, only drop the lookup if it points at this one
+		const TWeakObjectPtr<UPhysicsConstraintTemplate>* Existing = ConstraintsByPair.Find(Pair);
+		if (Existing && (*Existing == Constraint || !Existing->IsValid()))
+		{
+			ConstraintsByPair.Remove(Pair);
+		}
+	}
+}
+
+bool UBetterPAConstraintEdGraph::GetLinkBones(UEdGraphPin* A, UEdGraphPin* B, FName& OutBone1, FName& OutBone2) const
+{
+	UEdGraphPin* OutputPin = A->Direction == EGPD_Output ? A : B;
+	UEdGraphPin* InputPin = A->Direction == EGPD_Output ? B : A;
+
+	const UBetterPAConstraintGraphNode* SourceNode = Cast<UBetterPAConstraintGraphNode>(OutputPin->GetOwningNode());
+	const UBetterPAConstraintGraphNode* TargetNode = Cast<UBetterPAConstraintGraphNode>(InputPin->GetOwningNode());
+	if (!SourceNode || !TargetNode || SourceNode == TargetNode)
+	{
+		return false;
+	}
+
+	// Collapsed chains link out of their tail and into their head
+	OutBone1 = SourceNode->GetOutputBoneName();
+	OutBone2 = TargetNode->GetInputBoneName();
+	return true;
+}
+
+void UBetterPAConstraintEdGraph::OnLinkAdded(UEdGraphPin* A, UEdGraphPin* B)
+{
+	UEdGraphPin* OutputPin = A->Direction == EGPD_Output ? A : B;
+	UEdGraphPin* InputPin = A->Direction == EGPD_Output ? B : A;
+	AddLinkToIndex(OutputPin->GetOwningNode(), InputPin->GetOwningNode());
+
+	// Relinking before an apply keeps the constraint
+	const UBetterPAConstraintGraphNode* SourceNode = Cast<UBetterPAConstraintGraphNode>(OutputPin->GetOwningNode());
+	const UBetterPAConstraintGraphNode* TargetNode = Cast<UBetterPAConstraintGraphNode>(InputPin->GetOwningNode());
+	if (SourceNode && TargetNode)
+	{
+		BrokenLinks.Remove(FBetterPABonePair(SourceNode->BoneName, TargetNode->BoneName));
+	}
+
+	UPhysicsAsset* Asset = PhysicsAsset.Get();
+	FName Bone1Name;
+	FName Bone2Name;
+	if (bSuppressSync || !bLiveSync || !Asset || !GetLinkBones(A, B, Bone1Name, Bone2Name))
+	{
+		return;
+	}
+
+	const FBetterPABonePair Pair(Bone1Name, Bone2Name);
+	if (ConstraintsByPair.Contains(Pair))
+	{
+		return;
+	}
+
+	const FScopedTransaction Transaction(LOCTEXT("AddConstraint", "Add Constraint"));
+	TGuardValue<bool> ApplyingGuard(bApplyingToAsset, true);
+
+	Asset->Modify();
+	UPhysicsConstraintTemplate* NewConstraint = FBetterPAConstraintBuilder::CreateConstraint(Asset, Bone1Name, Bone2Name, ConstraintSettings, Context);
+	Asset->ConstraintSetup.Add(NewConstraint);
+	SetupSnapshot.Add(NewConstraint);
+	IndexConstraint(NewConstraint, Pair);
+	Asset->MarkPackageDirty();
+}
+
+void UBetterPAConstraintEdGraph::OnLinkRemoved(UEdGraphPin* A, UEdGraphPin* B)
+{
+	UEdGraphPin* OutputPin = A->Direction == EGPD_Output ? A : B;
+	UEdGraphPin* InputPin = A->Direction == EGPD_Output ? B : A;
+	RemoveLinkFromIndex(OutputPin->GetOwningNode(), InputPin->GetOwningNode());
+
+	UPhysicsAsset* Asset = PhysicsAsset.Get();
+	FName Bone1Name;
+	FName Bone2Name;
+	if (bSuppressSync || !Asset || !GetLinkBones(A, B, Bone1Name, Bone2Name))
+	{
+		return;
+	}
+
+	if (!bLiveSync)
+	{
+		// Remembered for the next apply, which leaves every other constraint between graph nodes alone
+		const UBetterPAConstraintGraphNode* SourceNode = CastChecked<UBetterPAConstraintGraphNode>(OutputPin->GetOwningNode());
+		const UBetterPAConstraintGraphNode* TargetNode = CastChecked<UBetterPAConstraintGraphNode>(InputPin->GetOwningNode());
+		BrokenLinks.Add(FBetterPABonePair(SourceNode->BoneName, TargetNode->BoneName));
+		return;
+	}
+
+	TWeakObjectPtr<UPhysicsConstraintTemplate> Constraint = ConstraintsByPair.FindRef(FBetterPABonePair(Bone1Name, Bone2Name));
+	if (!Constraint.IsValid())
+	{
+		return;
+	}
+
+	const FScopedTransaction Transaction(LOCTEXT("RemoveConstraint", "Remove Constraint"));
+	TGuardValue<bool> ApplyingGuard(bApplyingToAsset, true);
+
+	Asset->Modify();
+	Asset->ConstraintSetup.RemoveSingle(Constraint.Get());
+	SetupSnapshot.RemoveSingle(Constraint);
+	UnindexConstraint(Constraint);
+	Asset->MarkPackageDirty();
+}
+
+void UBetterPAConstraintEdGraph::ApplyToAsset()
+{
+	UPhysicsAsset* Asset = PhysicsAsset.Get();
+	if (!Asset)
+	{
+		return;
+	}
+
+	// Linked node pairs keyed by the head bones of the nodes, with the bones the constraint would join
+	TMap<FBetterPABonePair, TPair<FName, FName>> GraphLinks;
+	for (UEdGraphNode* Node : Nodes)
+	{
+		UEdGraphPin* OutPin = Node ? Node->FindPin(TEXT("Out")) : nullptr;
+		if (!OutPin)
+		{
+			continue;
+		}
+
+		for (UEdGraphPin* LinkedPin : OutPin->LinkedTo)
+		{
+			FName Bone1Name;
+			FName Bone2Name;
+			if (GetLinkBones(OutPin, LinkedPin, Bone1Name, Bone2Name))
+			{
+				const FBetterPABonePair NodePair(CastChecked<UBetterPAConstraintGraphNode>(Node)->BoneName, CastChecked<UBetterPAConstraintGraphNode>(LinkedPin->GetOwningNode())->BoneName);
+				GraphLinks.Add(NodePair, TPair<FName, FName>(Bone1Name, Bone2Name));
+			}
+		}
+	}
+
+	const FText Description = LOCTEXT("ApplyConstraintGraph", "Apply Constraint Graph");
+	int32 NumAdded = 0;
+	int32 NumRemoved = 0;
+	{
+		const FScopedTransaction Transaction(Description);
+		TGuardValue<bool> ApplyingGuard(bApplyingToAsset, true);
+		Asset->Modify();
+
+		// Constraints of links the user broke, constraints the graph never showed as links are left alone
+		TSet<FBetterPABonePair> CoveredNodePairs;
+		TArray<UPhysicsConstraintTemplate*> Removed;
+		for (const TPair<TWeakObjectPtr<UPhysicsConstraintTemplate>, FBetterPABonePair>& Known : KnownConstraints)
+		{
+			const UBetterPAConstraintGraphNode* NodeA = FindNode(Known.Value.First);
+			const UBetterPAConstraintGraphNode* NodeB = FindNode(Known.Value.Second);
+			if (!NodeA || !NodeB || NodeA == NodeB || !Known.Key.IsValid())
+			{
+				continue;
+			}
+
+			const FBetterPABonePair NodePair(NodeA->BoneName, NodeB->BoneName);
+			if (GraphLinks.Contains(NodePair))
+			{
+				CoveredNodePairs.Add(NodePair);
+			}
+			else if (BrokenLinks.Contains(NodePair))
+			{
+				Removed.Add(Known.Key.Get());
+			}
+		}
+		BrokenLinks.Reset();
+
+		for (UPhysicsConstraintTemplate* Constraint : Removed)
+		{
+			Asset->ConstraintSetup.RemoveSingle(Constraint);
+			UnindexConstraint(Constraint);
+		}
+		NumRemoved = Removed.Num();
+
+		TArray<TPair<FName, FName>> NewLinks;
+		for (const TPair<FBetterPABonePair, TPair<FName, FName>>& Link : GraphLinks)
+		{
+			if (!CoveredNodePairs.Contains(Link.Key))
+			{
+				NewLinks.Add(Link.Value);
+			}
+		}
+
+		TArray<UPhysicsConstraintTemplate*> NewConstraints;
+		FBetterPAConstraintBuilder::CreateConstraints(Asset, NewLinks, ConstraintSettings, Context, NewConstraints);
+		for (int32 LinkIndex = 0; LinkIndex < NewLinks.Num(); ++LinkIndex)
+		{
+			Asset->ConstraintSetup.Add(NewConstraints[LinkIndex]);
+			IndexConstraint(NewConstraints[LinkIndex], FBetterPABonePair(NewLinks[LinkIndex].Key, NewLinks[LinkIndex].Value));
+		}
+		NumAdded = NewLinks.Num();
+
+		Asset->UpdateBodySetupIndexMap();
+		Asset->UpdateBoundsBodiesArray();
+		Asset->MarkPackageDirty();
+	}
+	SnapshotConstraintSetup();
+
+	UE_LOG(LogBetterPAConstraintGraph, Log, TEXT("%s on %s: %d constraints added, %d removed, %llu bytes of undo memory"),
+		*Description.ToString(), *Asset->GetName(), NumAdded, NumRemoved, (uint64)BetterPA::GetLastTransactionSize(Description));
+}
+
+int32 UBetterPAConstraintEdGraph::ApplyProfilesToAsset()
+{
+	UPhysicsAsset* Asset = PhysicsAsset.Get();
+	if (!Asset || ConstraintSettings.Profiles.Num() == 0)
+	{
+		return 0;
+	}
+
+	const FText Description = LOCTEXT("ApplyConstraintProfiles", "Write Constraint Profiles");
+	int32 NumChanged = 0;
+	{
+		const FScopedTransaction Transaction(Description);
+		TGuardValue<bool> ApplyingGuard(bApplyingToAsset, true);
+		Asset->Modify();
+
+		NumChanged = FBetterPAConstraintBuilder::WriteProfiles(Asset, ConstraintSettings.Profiles);
+		Asset->MarkPackageDirty();
+	}
+
+	UE_LOG(LogBetterPAConstraintGraph, Log, TEXT("%s on %s: %d constraints changed, %llu bytes of undo memory"),
+		*Description.ToString(), *Asset->GetName(), NumChanged, (uint64)BetterPA::GetLastTransactionSize(Description));
+	return NumChanged;
+}
+
+bool UBetterPAConstraintEdGraph::LinkFromAsset(TConstArrayView<UBetterPAConstraintGraphNode*> AddedNodes)
+{
+	TSet<FName> AddedBones;
+	for (const UBetterPAConstraintGraphNode* Node : AddedNodes)
+	{
+		if (Node)
+		{
+			AddedBones.Add(Node->BoneName);
+			AddedBones.Append(Node->CollapsedBones);
+		}
+	}
+
+	// Links are made on the pins, the asset already has these constraints
+	bool bGraphChanged = false;
+	for (const TPair<FBetterPABonePair, TWeakObjectPtr<UPhysicsConstraintTemplate>>& Constrained : ConstraintsByPair)
+	{
+		if (Constrained.Value.IsValid() && (AddedBones.Contains(Constrained.Key.First) || AddedBones.Contains(Constrained.Key.Second)))
+		{
+			bGraphChanged |= SetNodesLinked(Constrained.Key, true);
+		}
+	}
+	return bGraphChanged;
+}
+
+bool UBetterPAConstraintEdGraph::SetNodesLinked(const FBetterPABonePair& Pair, bool bLinked)
+{
+	FName ParentBone;
+	FName ChildBone;
+	Context.GetParentAndChild(Pair.First, Pair.Second, ParentBone, ChildBone);
+
+	UBetterPAConstraintGraphNode* ParentNode = FindNode(ParentBone);
+	UBetterPAConstraintGraphNode* ChildNode = FindNode(ChildBone);
+	if (!ParentNode || !ChildNode || ParentNode == ChildNode)
+	{
+		return false;
+	}
+
+	UEdGraphPin* ParentOut = ParentNode->FindPin(TEXT("Out"));
+	UEdGraphPin* ParentIn = ParentNode->FindPin(TEXT("In"));
+	UEdGraphPin* ChildOut = ChildNode->FindPin(TEXT("Out"));
+	UEdGraphPin* ChildIn = ChildNode->FindPin(TEXT("In"));
+	if (!ParentOut || !ParentIn || !ChildOut || !ChildIn)
+	{
+		return false;
+	}
+
+	// A link drawn against the hierarchy still stands for the same constraint
+	const bool bForward = ParentOut->LinkedTo.Contains(ChildIn);
+	const bool bReverse = ChildOut->LinkedTo.Contains(ParentIn);
+
+	if (bLinked)
+	{
+		if (bForward || bReverse)
+		{
+			return false;
+		}
+		ParentOut->MakeLinkTo(ChildIn);
+		AddLinkToIndex(ParentNode, ChildNode);
+		return true;
+	}
+
+	if (bForward)
+	{
+		ParentOut->BreakLinkTo(ChildIn);
+		RemoveLinkFromIndex(ParentNode, ChildNode);
+	}
+	if (bReverse)
+	{
+		ChildOut->BreakLinkTo(ParentIn);
+		RemoveLinkFromIndex(ChildNode, ParentNode);
+	}
+	return bForward || bReverse;
+}
+
+void UBetterPAConstraintEdGraph::SyncFromAsset()
+{
+	UPhysicsAsset* Asset = PhysicsAsset.Get();
+	if (!Asset)
+	{
+		return;
+	}
+
+	TGuardValue<bool> SuppressGuard(bSuppressSync, true);
+	bool bGraphChanged = false;
+
+	TSet<UPhysicsConstraintTemplate*> Seen;
+	Seen.Reserve(Asset->ConstraintSetup.Num());
+
+	for (UPhysicsConstraintTemplate* Constraint : Asset->ConstraintSetup)
+	{
+		if (!Constraint)
+		{
+			continue;
+		}
+
+		Seen.Add(Constraint);
+		const FBetterPABonePair Pair(Constraint->DefaultInstance.ConstraintBone1, Constraint->DefaultInstance.ConstraintBone2);
+
+		if (const FBetterPABonePair* KnownPair = KnownConstraints.Find(Constraint))
+		{
+			if (*KnownPair == Pair)
+			{
+				continue;
+			}
+
+			// Retargeted to other bones
+			const FBetterPABonePair OldPair = *KnownPair;
+			UnindexConstraint(Constraint);
+			if (!ConstraintsByPair.Contains(OldPair))
+			{
+				bGraphChanged |= SetNodesLinked(OldPair, false);
+			}
+		}
+
+		IndexConstraint(Constraint, Pair);
+		bGraphChanged |= SetNodesLinked(Pair, true);
+	}
+
+	TArray<TWeakObjectPtr<UPhysicsConstraintTemplate>> Removed;
+	for (const TPair<TWeakObjectPtr<UPhysicsConstraintTemplate>, FBetterPABonePair>& Known : KnownConstraints)
+	{
+		if (!Seen.Contains(Known.Key.Get()))
+		{
+			Removed.Add(Known.Key);
+		}
+	}
+
+	for (const TWeakObjectPtr<UPhysicsConstraintTemplate>& Constraint : Removed)
+	{
+		const FBetterPABonePair Pair = KnownConstraints.FindChecked(Constraint);
+		UnindexConstraint(Constraint);
+
+		// Keep the link if another constraint still joins the same bones
+		if (!ConstraintsByPair.Contains(Pair))
+		{
+			bGraphChanged |= SetNodesLinked(Pair, false);
+		}
+	}
+	SnapshotConstraintSetup();
+
+	if (bGraphChanged)
+	{
+		NotifyGraphChanged();
+	}
+}
+
+void UBetterPAConstraintEdGraph::SyncConstraintSetup()
+{
+	UPhysicsAsset* Asset = PhysicsAsset.Get();
+	if (!Asset)
+	{
+		return;
+	}
+
+	// Edits add or remove constraints in one place, skip the ends the two lists still share
+	const TArray<TObjectPtr<UPhysicsConstraintTemplate>>& Setup = Asset->ConstraintSetup;
+	const int32 NumSetup = Setup.Num();
+	const int32 NumSnapshot = SetupSnapshot.Num();
+
+	int32 Prefix = 0;
+	while (Prefix < NumSetup && Prefix < NumSnapshot && SetupSnapshot[Prefix] == Setup[Prefix].Get())
+	{
+		++Prefix;
+	}
+
+	int32 Suffix = 0;
+	while (Suffix < NumSetup - Prefix && Suffix < NumSnapshot - Prefix && SetupSnapshot[NumSnapshot - 1 - Suffix] == Setup[NumSetup - 1 - Suffix].Get())
+	{
+		++Suffix;
+	}
+
+	const int32 NumChanged = NumSetup - Prefix - Suffix;
+	const int32 NumReplaced = NumSnapshot - Prefix - Suffix;
+	if (NumChanged == 0 && NumReplaced == 0)
+	{
+		return;
+	}
+
+	TGuardValue<bool> SuppressGuard(bSuppressSync, true);
+	bool bGraphChanged = false;
+
+	TSet<UPhysicsConstraintTemplate*> Changed;
+	for (int32 Index = Prefix; Index < Prefix + NumChanged; ++Index)
+	{
+		if (Setup[Index])
+		{
+			Changed.Add(Setup[Index].Get());
+		}
+	}
+
+	// Dropped from the list
+	for (int32 Index = Prefix; Index < Prefix + NumReplaced; ++Index)
+	{
+		const TWeakObjectPtr<UPhysicsConstraintTemplate> Constraint = SetupSnapshot[Index];
+		const FBetterPABonePair* KnownPair = KnownConstraints.Find(Constraint);
+		if (!KnownPair || Changed.Contains(Constraint.Get()))
+		{
+			continue;
+		}
+
+		const FBetterPABonePair OldPair = *KnownPair;
+		UnindexConstraint(Constraint);
+		if (!ConstraintsByPair.Contains(OldPair))
+		{
+			bGraphChanged |= SetNodesLinked(OldPair, false);
+		}
+	}
+
+	// Added to the list, or moved within it
+	for (int32 Index = Prefix; Index < Prefix + NumChanged; ++Index)
+	{
+		UPhysicsConstraintTemplate* Constraint = Setup[Index];
+		if (!Constraint)
+		{
+			continue;
+		}
+
+		const FBetterPABonePair Pair(Constraint->DefaultInstance.ConstraintBone1, Constraint->DefaultInstance.ConstraintBone2);
+		if (const FBetterPABonePair* KnownPair = KnownConstraints.Find(Constraint))
+		{
+			if (*KnownPair == Pair)
+			{
+				continue;
+			}
+
+			const FBetterPABonePair OldPair = *KnownPair;
+			UnindexConstraint(Constraint);
+			if (!ConstraintsByPair.Contains(OldPair))
+			{
+				bGraphChanged |= SetNodesLinked(OldPair, false);
+			}
+		}
+
+		IndexConstraint(Constraint, Pair);
+		bGraphChanged |= SetNodesLinked(Pair, true);
+	}
+
+	SetupSnapshot.RemoveAt(Prefix, NumReplaced);
+	SetupSnapshot.InsertDefaulted(Prefix, NumChanged);
+	for (int32 Index = Prefix; Index < Prefix + NumChanged; ++Index)
+	{
+		SetupSnapshot[Index] = Setup[Index].Get();
+	}
+
+	if (bGraphChanged)
+	{
+		NotifyGraphChanged();
+	}
+}
+
+void UBetterPAConstraintEdGraph::SyncConstraint(UPhysicsConstraintTemplate* Constraint)
+{
+	const FBetterPABonePair* KnownPair = Constraint ? KnownConstraints.Find(Constraint) : nullptr;
+	if (!KnownPair)
+	{
+		return;
+	}
+
+	const FBetterPABonePair Pair(Constraint->DefaultInstance.ConstraintBone1, Constraint->DefaultInstance.ConstraintBone2);
+	if (*KnownPair == Pair)
+	{
+		return;
+	}
+
+	TGuardValue<bool> SuppressGuard(bSuppressSync, true);
+
+	const FBetterPABonePair OldPair = *KnownPair;
+	UnindexConstraint(Constraint);
+	IndexConstraint(Constraint, Pair);
+
+	bool bGraphChanged = false;
+	if (!ConstraintsByPair.Contains(OldPair))
+	{
+		bGraphChanged |= SetNodesLinked(OldPair, false);
+	}
+	bGraphChanged |= SetNodesLinked(Pair, true);
+
+	if (bGraphChanged)
+	{
+		NotifyGraphChanged();
+	}
+}
+
+#undef LOCTEXT_NAMESPACE
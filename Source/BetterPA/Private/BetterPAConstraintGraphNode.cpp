@@ -2,12 +2,16 @@
 
 FText UBetterPAConstraintGraphNode::GetNodeTitle(ENodeTitleType::Type TitleType) const
 {
+	if (IsCollapsedChain())
+	{
+		return FText::FromString(FString::Printf(TEXT("%s ... %s (%d)"), *CollapsedBones[0].ToString(), *CollapsedBones.Last().ToString(), CollapsedBones.Num()));
+	}
 	return FText::FromName(BoneName);
 }
 
 FLinearColor UBetterPAConstraintGraphNode::GetNodeTitleColor() const
 {
-	return FLinearColor(0.2f, 0.8f, 0.2f);
+	return IsCollapsedChain() ? FLinearColor(0.2f, 0.5f, 0.8f) : FLinearColor(0.2f, 0.8f, 0.2f);
 }
 
 void UBetterPAConstraintGraphNode::AllocateDefaultPins()
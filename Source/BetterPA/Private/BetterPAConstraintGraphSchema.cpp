@@ -1,5 +1,6 @@
 #include "BetterPAConstraintGraphSchema.h"
 #include "BetterPAConstraintGraphNode.h"
+#include "BetterPAConstraintEdGraph.h"
 
 void UBetterPAConstraintGraphSchema::GetGraphContextActions(FGraphContextMenuBuilder& ContextMenuBuilder) const
 {
@@ -20,6 +21,40 @@ const FPinConnectionResponse UBetterPAConstraintGraphSchema::CanCreateConnection
 		return FPinConnectionResponse(CONNECT_RESPONSE_DISALLOW, TEXT("Directions must be opposite"));
 	}
 
+	const UEdGraphPin* OutputPin = A->Direction == EGPD_Output ? A : B;
+	const UEdGraphPin* InputPin = A->Direction == EGPD_Output ? B : A;
+	const UEdGraphNode* SourceNode = OutputPin->GetOwningNode();
+	const UEdGraphNode* TargetNode = InputPin->GetOwningNode();
+
+	// Everything below is answered by the graph's link index, no scan over the links
+	const UBetterPAConstraintEdGraph* Graph = Cast<UBetterPAConstraintEdGraph>(SourceNode->GetGraph());
+	if (!Graph)
+	{
+		return FPinConnectionResponse(CONNECT_RESPONSE_MAKE, TEXT("Create Constraint"));
+	}
+
+	if (Graph->AreNodesLinked(SourceNode, TargetNode))
+	{
+		return FPinConnectionResponse(CONNECT_RESPONSE_DISALLOW, TEXT("These bodies are already linked"));
+	}
+
+	const UBetterPAConstraintGraphNode* SourceBody = Cast<UBetterPAConstraintGraphNode>(SourceNode);
+	const UBetterPAConstraintGraphNode* TargetBody = Cast<UBetterPAConstraintGraphNode>(TargetNode);
+	if (SourceBody && TargetBody && Graph->IsConstrainedInAsset(SourceBody->GetOutputBoneName(), TargetBody->GetInputBoneName()))
+	{
+		return FPinConnectionResponse(CONNECT_RESPONSE_MAKE, TEXT("Link existing constraint"));
+	}
+
+	if (Graph->AreNodesConnected(SourceNode, TargetNode))
+	{
+		return FPinConnectionResponse(CONNECT_RESPONSE_MAKE, TEXT("Create Constraint (closes a loop)"));
+	}
+
+	if (Graph->GetNumParentLinks(TargetNode) > 0)
+	{
+		return FPinConnectionResponse(CONNECT_RESPONSE_MAKE, TEXT("Create Constraint (target already has a parent)"));
+	}
+
 	return FPinConnectionResponse(CONNECT_RESPONSE_MAKE, TEXT("Create Constraint"));
 }
 
@@ -29,8 +64,37 @@ bool UBetterPAConstraintGraphSchema::TryCreateConnection(UEdGraphPin* A, UEdGrap
 	
 	if (bModified)
 	{
-		// Logic to actually create the constraint in the Physics Asset will go here or be triggered by an event
+		if (UBetterPAConstraintEdGraph* Graph = Cast<UBetterPAConstraintEdGraph>(A->GetOwningNode()->GetGraph()))
+		{
+			Graph->OnLinkAdded(A, B);
+		}
 	}
 
 	return bModified;
 }
+
+void UBetterPAConstraintGraphSchema::BreakPinLinks(UEdGraphPin& TargetPin, bool bSendsNodeNotifcation) const
+{
+	// The links are gone once the base class returns
+	const TArray<UEdGraphPin*> LinkedPins = TargetPin.LinkedTo;
+
+	UEdGraphSchema::BreakPinLinks(TargetPin, bSendsNodeNotifcation);
+
+	if (UBetterPAConstraintEdGraph* Graph = Cast<UBetterPAConstraintEdGraph>(TargetPin.GetOwningNode()->GetGraph()))
+	{
+		for (UEdGraphPin* LinkedPin : LinkedPins)
+		{
+			Graph->OnLinkRemoved(&TargetPin, LinkedPin);
+		}
+	}
+}
+
+void UBetterPAConstraintGraphSchema::BreakSinglePinLink(UEdGraphPin* SourcePin, UEdGraphPin* TargetPin) const
+{
+	UEdGraphSchema::BreakSinglePinLink(SourcePin, TargetPin);
+
+	if (UBetterPAConstraintEdGraph* Graph = Cast<UBetterPAConstraintEdGraph>(SourcePin->GetOwningNode()->GetGraph()))
+	{
+		Graph->OnLinkRemoved(SourcePin, TargetPin);
+	}
+}
@@ -0,0 +1,282 @@
+#include "BetterPAConvexDecomposition.h"
+#include "BetterPAMeshData.h"
+#include "BetterPAParallel.h"
+#include "PhysicsEngine/ConvexElem.h"
+#include "Hash/xxhash.h"
+#include "Misc/ScopeLock.h"
+#include "Containers/LruCache.h"
+
+namespace
+{
+	// Directions the concavity of a part is measured along, dense enough that convex parts measure close to zero
+	constexpr int32 NumMeasureDirections = 64;
+
+	// Cached decompositions, the least recently used one makes room once full
+	constexpr int32 MaxCacheEntries = 1024;
+
+	FCriticalSection CacheLock;
+	TLruCache<uint64, TArray<FKConvexElem>> Cache(MaxCacheEntries);
+
+	// Evenly spread unit directions on a Fibonacci sphere
+	void MakeDirections(int32 Count, TArray<FVector3f>& OutDirections)
+	{
+		OutDirections.SetNumUninitialized(Count);
+		const float GoldenAngle = PI * (3.0f - FMath::Sqrt(5.0f));
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const float Z = 1.0f - (2.0f * Index + 1.0f) / Count;
+			const float Ring = FMath::Sqrt(FMath::Max(1.0f - Z * Z, 0.0f));
+			const float Angle = GoldenAngle * Index;
+			OutDirections[Index] = FVector3f(FMath::Cos(Angle) * Ring, FMath::Sin(Angle) * Ring, Z);
+		}
+	}
+
+	struct FPart
+	{
+		TArray<int32> Points;
+		// Deepest point inside the part's hull, relative to the part's size
+		float Concavity = 0.0f;
+	};
+
+	float MeasureConcavity(const TArray<FVector3f>& Points, const TArray<int32>& PartPoints, const TArray<FVector3f>& Directions)
+	{
+		const int32 NumDirections = Directions.Num();
+		TArray<float, TInlineAllocator<NumMeasureDirections>> Support;
+		Support.Init(-MAX_flt, NumDirections);
+
+		FBox3f Bounds(ForceInit);
+		for (int32 PointIndex : PartPoints)
+		{
+			const FVector3f& Point = Points[PointIndex];
+			Bounds += Point;
+			for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+			{
+				Support[Direction] = FMath::Max(Support[Direction], Directions[Direction] | Point);
+			}
+		}
+
+		const float Size = Bounds.GetSize().Size();
+		if (Size <= UE_KINDA_SMALL_NUMBER)
+		{
+			return 0.0f;
+		}
+
+		// Mesh vertices of a convex part all lie on its hull, anything deeper marks a concavity
+		float MaxDepth = 0.0f;
+		for (int32 PointIndex : PartPoints)
+		{
+			const FVector3f& Point = Points[PointIndex];
+			float Depth = MAX_flt;
+			for (int32 Direction = 0; Direction < NumDirections && Depth > MaxDepth; ++Direction)
+			{
+				Depth = FMath::Min(Depth, Support[Direction] - (Directions[Direction] | Point));
+			}
+			MaxDepth = FMath::Max(MaxDepth, Depth);
+		}
+
+		return MaxDepth / Size;
+	}
+
+	// Splits the part in two halves across its principal axis, returns false if either half would be too small
+	bool SplitPart(const TArray<FVector3f>& Points, const FPart& Part, int32 MinPoints, TArray<int32>& OutFirst, TArray<int32>& OutSecond)
+	{
+		FVector3f Mean = FVector3f::ZeroVector;
+		for (int32 PointIndex : Part.Points)
+		{
+			Mean += Points[PointIndex];
+		}
+		Mean /= (float)Part.Points.Num();
+
+		float Cov[3][3] = {};
+		for (int32 PointIndex : Part.Points)
+		{
+			const FVector3f D = Points[PointIndex] - Mean;
+			Cov[0][0] += D.X * D.X; Cov[0][1] += D.X * D.Y; Cov[0][2] += D.X * D.Z;
+			Cov[1][1] += D.Y * D.Y; Cov[1][2] += D.Y * D.Z; Cov[2][2] += D.Z * D.Z;
+		}
+		Cov[1][0] = Cov[0][1];
+		Cov[2][0] = Cov[0][2];
+		Cov[2][1] = Cov[1][2];
+
+		// Power iteration, the largest eigenvector is all that is needed
+		FVector3f Axis(1.0f, 1.0f, 1.0f);
+		for (int32 Iteration = 0; Iteration < 16; ++Iteration)
+		{
+			const FVector3f Next(
+				Cov[0][0] * Axis.X + Cov[0][1] * Axis.Y + Cov[0][2] * Axis.Z,
+				Cov[1][0] * Axis.X + Cov[1][1] * Axis.Y + Cov[1][2] * Axis.Z,
+				Cov[2][0] * Axis.X + Cov[2][1] * Axis.Y + Cov[2][2] * Axis.Z);
+			if (!Next.Normalize())
+			{
+				break;
+			}
+			Axis = Next;
+		}
+
+		const float Split = Axis | Mean;
+		for (int32 PointIndex : Part.Points)
+		{
+			((Axis | Points[PointIndex]) < Split ? OutFirst : OutSecond).Add(PointIndex);
+		}
+
+		return OutFirst.Num() >= MinPoints && OutSecond.Num() >= MinPoints;
+	}
+
+	uint64 HashInput(const FBetterPAPointBucket& Points, const FBetterPAConvexSettings& Settings)
+	{
+		FXxHash64Builder Builder;
+		Builder.Update(Points.X.GetData(), Points.X.Num() * sizeof(float));
+		Builder.Update(Points.Y.GetData(), Points.Y.Num() * sizeof(float));
+		Builder.Update(Points.Z.GetData(), Points.Z.Num() * sizeof(float));
+		Builder.Update(&Settings.MaxHulls, sizeof(Settings.MaxHulls));
+		Builder.Update(&Settings.MaxHullVertices, sizeof(Settings.MaxHullVertices));
+		Builder.Update(&Settings.MaxConcavity, sizeof(Settings.MaxConcavity));
+		Builder.Update(&Settings.MinHullPoints, sizeof(Settings.MinHullPoints));
+		Builder.Update(&Settings.MaxPoints, sizeof(Settings.MaxPoints));
+		return Builder.Finalize().Hash;
+	}
+}
+
+void FBetterPAConvexDecomposition::Decompose(const FBetterPAPointBucket& Points, const FBetterPAConvexSettings& Settings, TArray<FKConvexElem>& OutHulls)
+{
+	OutHulls.Reset();
+
+	const int32 NumSource = Points.Num();
+	const int32 MinPoints = FMath::Max(Settings.MinHullPoints, 4);
+	if (NumSource < MinPoints)
+	{
+		return;
+	}
+
+	// Even stride keeps the thinned set spread over the whole surface
+	const int32 Stride = FMath::DivideAndRoundUp(NumSource, FMath::Max(Settings.MaxPoints, MinPoints));
+	TArray<FVector3f> Thinned;
+	Thinned.Reserve(NumSource / Stride + 1);
+	for (int32 Index = 0; Index < NumSource; Index += Stride)
+	{
+		Thinned.Add(Points.Get(Index));
+	}
+
+	TArray<FVector3f> MeasureDirections;
+	TArray<FVector3f> HullDirections;
+	MakeDirections(NumMeasureDirections, MeasureDirections);
+	MakeDirections(FMath::Max(Settings.MaxHullVertices, 4), HullDirections);
+
+	TArray<FPart> Parts;
+	FPart& Whole = Parts.AddDefaulted_GetRef();
+	Whole.Points.Reserve(Thinned.Num());
+	for (int32 Index = 0; Index < Thinned.Num(); ++Index)
+	{
+		Whole.Points.Add(Index);
+	}
+	Whole.Concavity = MeasureConcavity(Thinned, Whole.Points, MeasureDirections);
+
+	const int32 MaxHulls = FMath::Max(Settings.MaxHulls, 1);
+	while (Parts.Num() < MaxHulls)
+	{
+		int32 Worst = INDEX_NONE;
+		for (int32 PartIndex = 0; PartIndex < Parts.Num(); ++PartIndex)
+		{
+			if (Parts[PartIndex].Concavity > Settings.MaxConcavity && (Worst == INDEX_NONE || Parts[PartIndex].Concavity > Parts[Worst].Concavity))
+			{
+				Worst = PartIndex;
+			}
+		}
+
+		if (Worst == INDEX_NONE)
+		{
+			break;
+		}
+
+		FPart First;
+		FPart Second;
+		if (!SplitPart(Thinned, Parts[Worst], MinPoints, First.Points, Second.Points))
+		{
+			// Too small to split, accept it as it is
+			Parts[Worst].Concavity = 0.0f;
+			continue;
+		}
+
+		First.Concavity = MeasureConcavity(Thinned, First.Points, MeasureDirections);
+		Second.Concavity = MeasureConcavity(Thinned, Second.Points, MeasureDirections);
+		Parts[Worst] = MoveTemp(First);
+		Parts.Add(MoveTemp(Second));
+	}
+
+	// Support points are hull vertices, so each hull stays within the vertex budget
+	for (const FPart& Part : Parts)
+	{
+		TArray<int32, TInlineAllocator<64>> SupportPoints;
+		for (const FVector3f& Direction : HullDirections)
+		{
+			int32 Best = Part.Points[0];
+			float BestDot = -MAX_flt;
+			for (int32 PointIndex : Part.Points)
+			{
+				const float Dot = Direction | Thinned[PointIndex];
+				if (Dot > BestDot)
+				{
+					BestDot = Dot;
+					Best = PointIndex;
+				}
+			}
+			SupportPoints.AddUnique(Best);
+		}
+
+		if (SupportPoints.Num() < 4)
+		{
+			continue;
+		}
+
+		FKConvexElem& Hull = OutHulls.AddDefaulted_GetRef();
+		Hull.VertexData.Reserve(SupportPoints.Num());
+		for (int32 PointIndex : SupportPoints)
+		{
+			Hull.VertexData.Add(FVector(Thinned[PointIndex]));
+		}
+		Hull.UpdateElemBox();
+	}
+}
+
+void FBetterPAConvexDecomposition::DecomposeBodies(const FBetterPAVertexBuckets& Buckets, const TBitArray<>& BodyMask, const FBetterPAConvexSettings& Settings, TArray<TArray<FKConvexElem>>& OutHulls)
+{
+	const int32 NumBodies = Buckets.Buckets.Num();
+	OutHulls.Reset();
+	OutHulls.SetNum(NumBodies);
+
+	TArray<int32> Bodies;
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies && BodyIndex < BodyMask.Num(); ++BodyIndex)
+	{
+		if (BodyMask[BodyIndex])
+		{
+			Bodies.Add(BodyIndex);
+		}
+	}
+
+	BetterPA::ParallelFor(Bodies.Num(), [&](int32 Index)
+	{
+		const int32 BodyIndex = Bodies[Index];
+		const FBetterPAPointBucket& Points = Buckets.Buckets[BodyIndex];
+		const uint64 Key = HashInput(Points, Settings);
+
+		{
+			FScopeLock Lock(&CacheLock);
+			if (const TArray<FKConvexElem>* Cached = Cache.FindAndTouch(Key))
+			{
+				OutHulls[BodyIndex] = *Cached;
+				return;
+			}
+		}
+
+		Decompose(Points, Settings, OutHulls[BodyIndex]);
+
+		FScopeLock Lock(&CacheLock);
+		Cache.Add(Key, OutHulls[BodyIndex]);
+	});
+}
+
+void FBetterPAConvexDecomposition::ClearCache()
+{
+	FScopeLock Lock(&CacheLock);
+	Cache.Empty(MaxCacheEntries);
+}
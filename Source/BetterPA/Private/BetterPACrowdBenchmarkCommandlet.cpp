@@ -0,0 +1,314 @@
+#include "BetterPACrowdBenchmarkCommandlet.h"
+#include "Animation/SkeletalMeshActor.h"
+#include "Components/BoxComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/World.h"
+#include "Engine/CollisionProfile.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "PBDRigidsSolver.h"
+#include "Chaos/PBDRigidsEvolutionGBF.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBetterPACrowdBenchmark, Log, All);
+
+namespace
+{
+	// Half size of the floor the crowd drops onto, large enough for the widest grid the spacing allows
+	constexpr float FloorExtent = 100000.0f;
+
+	struct FCrowdStats
+	{
+		FString AssetName;
+		int32 NumActors = 0;
+		int32 NumBodies = 0;
+		int32 NumShapes = 0;
+		int32 NumConstraints = 0;
+
+		// Per measured frame, warmup excluded
+		double AvgFrameMs = 0.0;
+		double AvgPhysicsMs = 0.0;
+		double P95PhysicsMs = 0.0;
+		double MaxPhysicsMs = 0.0;
+
+		// Collision constraints in the solver after each physics tick, summed over the frame
+		double AvgContacts = 0.0;
+		int32 MaxContacts = 0;
+
+		// Bodies still simulating after the last frame, the crowd has settled when this drops
+		int32 NumAwakeBodies = 0;
+
+		// Physics allocations the crowd added, meshes and assets were loaded before the baseline. Negative without -llm
+		int64 MemoryBytes = -1;
+	};
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	// Chaos tags its particles, geometry and acceleration structures separately from the rest of physics
+	constexpr ELLMTag PhysicsMemoryTags[] = { ELLMTag::Physics, ELLMTag::Chaos, ELLMTag::ChaosGeometry, ELLMTag::ChaosAcceleration, ELLMTag::ChaosParticles, ELLMTag::ChaosConvex };
+#endif
+
+	// Bytes currently allocated under the physics tags, negative when the tracker is not running
+	int64 GetPhysicsMemory()
+	{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		if (FLowLevelMemTracker::IsEnabled())
+		{
+			int64 Bytes = 0;
+			for (const ELLMTag Tag : PhysicsMemoryTags)
+			{
+				Bytes += FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default, Tag);
+			}
+			return Bytes;
+		}
+#endif
+		return -1;
+	}
+
+	FString FormatMemoryKB(int64 Bytes, int32 NumActors = 1)
+	{
+		return Bytes >= 0 ? FString::Printf(TEXT("%.1f"), Bytes / 1024.0 / NumActors) : FString(TEXT("n/a"));
+	}
+
+	int32 CountShapes(const UPhysicsAsset& PhysicsAsset)
+	{
+		int32 NumShapes = 0;
+		for (const USkeletalBodySetup* BodySetup : PhysicsAsset.SkeletalBodySetups)
+		{
+			if (BodySetup)
+			{
+				NumShapes += BodySetup->AggGeom.GetElementCount();
+			}
+		}
+		return NumShapes;
+	}
+
+	double GetPercentile(TArray<double> Values, float Percentile)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.0;
+		}
+		Values.Sort();
+		return Values[FMath::Clamp(FMath::CeilToInt32(Values.Num() * Percentile) - 1, 0, Values.Num() - 1)];
+	}
+
+	// One row per metric and one column per asset, so variants of a mesh read side by side
+	FString ToCSV(const TArray<FCrowdStats>& AllStats)
+	{
+		FString Result = TEXT("Metric");
+		for (const FCrowdStats& Stats : AllStats)
+		{
+			Result += TEXT(",") + Stats.AssetName;
+		}
+		Result += TEXT("\n");
+
+		auto AddRow = [&](const TCHAR* Metric, TFunctionRef<FString(const FCrowdStats&)> GetValue)
+		{
+			Result += Metric;
+			for (const FCrowdStats& Stats : AllStats)
+			{
+				Result += TEXT(",") + GetValue(Stats);
+			}
+			Result += TEXT("\n");
+		};
+
+		AddRow(TEXT("Actors"), [](const FCrowdStats& Stats) { return FString::FromInt(Stats.NumActors); });
+		AddRow(TEXT("Bodies"), [](const FCrowdStats& Stats) { return FString::FromInt(Stats.NumBodies); });
+		AddRow(TEXT("Shapes"), [](const FCrowdStats& Stats) { return FString::FromInt(Stats.NumShapes); });
+		AddRow(TEXT("Constraints"), [](const FCrowdStats& Stats) { return FString::FromInt(Stats.NumConstraints); });
+		AddRow(TEXT("Frame ms (avg)"), [](const FCrowdStats& Stats) { return FString::Printf(TEXT("%.3f"), Stats.AvgFrameMs); });
+		AddRow(TEXT("Physics ms (avg)"), [](const FCrowdStats& Stats) { return FString::Printf(TEXT("%.3f"), Stats.AvgPhysicsMs); });
+		AddRow(TEXT("Physics ms (p95)"), [](const FCrowdStats& Stats) { return FString::Printf(TEXT("%.3f"), Stats.P95PhysicsMs); });
+		AddRow(TEXT("Physics ms (max)"), [](const FCrowdStats& Stats) { return FString::Printf(TEXT("%.3f"), Stats.MaxPhysicsMs); });
+		AddRow(TEXT("Solver contacts per frame (avg)"), [](const FCrowdStats& Stats) { return FString::Printf(TEXT("%.1f"), Stats.AvgContacts); });
+		AddRow(TEXT("Solver contacts per frame (max)"), [](const FCrowdStats& Stats) { return FString::FromInt(Stats.MaxContacts); });
+		AddRow(TEXT("Awake bodies at end"), [](const FCrowdStats& Stats) { return FString::FromInt(Stats.NumAwakeBodies); });
+		AddRow(TEXT("Physics memory KB"), [](const FCrowdStats& Stats) { return FormatMemoryKB(Stats.MemoryBytes); });
+		AddRow(TEXT("Physics memory KB per actor"), [](const FCrowdStats& Stats) { return FormatMemoryKB(Stats.MemoryBytes, FMath::Max(Stats.NumActors, 1)); });
+		return Result;
+	}
+}
+
+UBetterPACrowdBenchmarkCommandlet::UBetterPACrowdBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UBetterPACrowdBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString Assets;
+	int32 Count = 100;
+	int32 Frames = 300;
+	int32 WarmupFrames = 30;
+	float DeltaTime = 1.0f / 60.0f;
+	float Spacing = 150.0f;
+	FParse::Value(*Params, TEXT("Assets="), Assets, false);
+	FParse::Value(*Params, TEXT("Count="), Count);
+	FParse::Value(*Params, TEXT("Frames="), Frames);
+	FParse::Value(*Params, TEXT("WarmupFrames="), WarmupFrames);
+	FParse::Value(*Params, TEXT("DeltaTime="), DeltaTime);
+	FParse::Value(*Params, TEXT("Spacing="), Spacing);
+	Count = FMath::Max(Count, 1);
+	Frames = FMath::Max(Frames, 1);
+	WarmupFrames = FMath::Max(WarmupFrames, 0);
+	DeltaTime = FMath::Max(DeltaTime, UE_KINDA_SMALL_NUMBER);
+
+	TArray<FString> AssetPaths;
+	Assets.ParseIntoArray(AssetPaths, TEXT("+"));
+	if (AssetPaths.Num() == 0)
+	{
+		UE_LOG(LogBetterPACrowdBenchmark, Error, TEXT("No physics assets given, pass -Assets=/Game/A.A+/Game/B.B"));
+		return 1;
+	}
+	if (GetPhysicsMemory() < 0)
+	{
+		UE_LOG(LogBetterPACrowdBenchmark, Warning, TEXT("The low level memory tracker is off, physics memory is not reported. Run with -llm to get it."));
+	}
+
+	TArray<FCrowdStats> AllStats;
+	for (const FString& AssetPath : AssetPaths)
+	{
+		UPhysicsAsset* PhysicsAsset = LoadObject<UPhysicsAsset>(nullptr, *AssetPath);
+		USkeletalMesh* SkeletalMesh = PhysicsAsset ? PhysicsAsset->GetPreviewMesh() : nullptr;
+		if (!SkeletalMesh)
+		{
+			UE_LOG(LogBetterPACrowdBenchmark, Error, TEXT("%s: %s"), *AssetPath, PhysicsAsset ? TEXT("no preview mesh") : TEXT("not a physics asset"));
+			return 1;
+		}
+
+		// A fresh world per asset, so no variant inherits the previous one's broadphase or pools
+		UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("BetterPACrowdBenchmark"));
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+
+		AActor* Floor = World->SpawnActor<AActor>();
+		UBoxComponent* FloorBox = NewObject<UBoxComponent>(Floor);
+		FloorBox->SetBoxExtent(FVector(FloorExtent, FloorExtent, 10.0f));
+		FloorBox->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+		Floor->SetRootComponent(FloorBox);
+		FloorBox->RegisterComponent();
+		FloorBox->SetWorldLocation(FVector(0.0f, 0.0f, -10.0f));
+
+		const int64 BaselineMemory = GetPhysicsMemory();
+
+		FCrowdStats& Stats = AllStats.AddDefaulted_GetRef();
+		Stats.AssetName = PhysicsAsset->GetName();
+
+		const int32 GridSide = FMath::CeilToInt32(FMath::Sqrt((float)Count));
+		TArray<USkeletalMeshComponent*> Components;
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const FVector Location((Index % GridSide) * Spacing, (Index / GridSide) * Spacing, 0.0f);
+			ASkeletalMeshActor* Actor = World->SpawnActor<ASkeletalMeshActor>(Location, FRotator::ZeroRotator);
+			if (!Actor)
+			{
+				continue;
+			}
+
+			USkeletalMeshComponent* Component = Actor->GetSkeletalMeshComponent();
+			Component->SetSkeletalMesh(SkeletalMesh);
+			Component->SetPhysicsAsset(PhysicsAsset);
+			Component->SetCollisionProfileName(TEXT("Ragdoll"));
+			Component->SetSimulatePhysics(true);
+			Component->WakeAllRigidBodies();
+			Components.Add(Component);
+
+			Stats.NumBodies += Component->Bodies.Num();
+			Stats.NumConstraints += Component->Constraints.Num();
+		}
+		Stats.NumActors = Components.Num();
+		Stats.NumShapes = CountShapes(*PhysicsAsset) * Components.Num();
+
+		// Time from the start to the end of each physics frame, summed over substeps
+		double PhysicsStartTime = 0.0;
+		double FramePhysicsSeconds = 0.0;
+		int32 NumFrameContacts = 0;
+		FPhysScene* PhysScene = World->GetPhysicsScene();
+		const FDelegateHandle PreTickHandle = PhysScene->OnPhysScenePreTick.AddLambda([&PhysicsStartTime](auto*, float)
+		{
+			PhysicsStartTime = FPlatformTime::Seconds();
+		});
+		// The step has finished here and its collision constraints are still in the evolution, the next step rebuilds them
+		const FDelegateHandle PostTickHandle = PhysScene->OnPhysScenePostTick.AddLambda([&PhysicsStartTime, &FramePhysicsSeconds, &NumFrameContacts, PhysScene](auto*)
+		{
+			FramePhysicsSeconds += FPlatformTime::Seconds() - PhysicsStartTime;
+			if (Chaos::FPBDRigidsSolver* Solver = PhysScene->GetSolver())
+			{
+				NumFrameContacts += Solver->GetEvolution()->GetCollisionConstraints().NumConstraints();
+			}
+		});
+
+		TArray<double> PhysicsMs;
+		PhysicsMs.Reserve(Frames);
+		double TotalFrameSeconds = 0.0;
+		int64 TotalContacts = 0;
+		for (int32 Frame = 0; Frame < WarmupFrames + Frames; ++Frame)
+		{
+			NumFrameContacts = 0;
+			FramePhysicsSeconds = 0.0;
+			const double FrameStartTime = FPlatformTime::Seconds();
+			World->Tick(LEVELTICK_All, DeltaTime);
+			const double FrameSeconds = FPlatformTime::Seconds() - FrameStartTime;
+
+			if (Frame < WarmupFrames)
+			{
+				continue;
+			}
+			TotalFrameSeconds += FrameSeconds;
+			PhysicsMs.Add(FramePhysicsSeconds * 1000.0);
+			TotalContacts += NumFrameContacts;
+			Stats.MaxContacts = FMath::Max(Stats.MaxContacts, NumFrameContacts);
+		}
+
+		PhysScene->OnPhysScenePreTick.Remove(PreTickHandle);
+		PhysScene->OnPhysScenePostTick.Remove(PostTickHandle);
+
+		if (BaselineMemory >= 0)
+		{
+			Stats.MemoryBytes = GetPhysicsMemory() - BaselineMemory;
+		}
+		Stats.AvgFrameMs = TotalFrameSeconds * 1000.0 / Frames;
+		Stats.AvgContacts = (double)TotalContacts / Frames;
+		Stats.MaxPhysicsMs = PhysicsMs.Num() > 0 ? FMath::Max(PhysicsMs) : 0.0;
+		Stats.P95PhysicsMs = GetPercentile(PhysicsMs, 0.95f);
+		for (const double Ms : PhysicsMs)
+		{
+			Stats.AvgPhysicsMs += Ms / Frames;
+		}
+		for (const USkeletalMeshComponent* Component : Components)
+		{
+			for (const FBodyInstance* Body : Component->Bodies)
+			{
+				Stats.NumAwakeBodies += (Body && Body->IsInstanceAwake()) ? 1 : 0;
+			}
+		}
+
+		UE_LOG(LogBetterPACrowdBenchmark, Display, TEXT("%s: %d actors, %d bodies, %d constraints, physics %.3f ms avg, %.3f ms p95, %.1f contacts per frame, %s KB of physics memory"),
+			*Stats.AssetName, Stats.NumActors, Stats.NumBodies, Stats.NumConstraints, Stats.AvgPhysicsMs, Stats.P95PhysicsMs, Stats.AvgContacts, *FormatMemoryKB(Stats.MemoryBytes));
+
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	const FString Report = ToCSV(AllStats);
+	UE_LOG(LogBetterPACrowdBenchmark, Display, TEXT("%d ragdolls, %d frames of %.4f s\n%s"), Count, Frames, DeltaTime, *Report);
+
+	const FString FileName = FString::Printf(TEXT("CrowdBenchmark_%s.csv"), *FDateTime::Now().ToString());
+	const FString FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("BetterPA"), TEXT("Benchmarks"), FileName);
+	if (FFileHelper::SaveStringToFile(Report, *FilePath))
+	{
+		UE_LOG(LogBetterPACrowdBenchmark, Display, TEXT("Report: %s"), *FilePath);
+	}
+	return 0;
+}
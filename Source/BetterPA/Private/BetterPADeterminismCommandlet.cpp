@@ -0,0 +1,160 @@
+#include "BetterPADeterminismCommandlet.h"
+#include "BetterPAConvexDecomposition.h"
+#include "BetterPAGenerator.h"
+#include "BetterPAParallel.h"
+#include "Animation/AnimSequence.h"
+#include "Engine/SkeletalMesh.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "ReferenceSkeleton.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBetterPADeterminism, Log, All);
+
+namespace
+{
+	// Object references are written as paths, so runs into assets with the same path compare byte for byte
+	void SerializeAsset(UPhysicsAsset* PhysicsAsset, TArray<uint8>& OutBytes)
+	{
+		FMemoryWriter Writer(OutBytes);
+		FObjectAndNameAsStringProxyArchive Archive(Writer, false);
+
+		PhysicsAsset->Serialize(Archive);
+		for (USkeletalBodySetup* BodySetup : PhysicsAsset->SkeletalBodySetups)
+		{
+			FString Name = BodySetup->GetName();
+			Archive << Name;
+			BodySetup->Serialize(Archive);
+		}
+		for (UPhysicsConstraintTemplate* Constraint : PhysicsAsset->ConstraintSetup)
+		{
+			FString Name = Constraint->GetName();
+			Archive << Name;
+			Constraint->Serialize(Archive);
+		}
+	}
+}
+
+UBetterPADeterminismCommandlet::UBetterPADeterminismCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UBetterPADeterminismCommandlet::Main(const FString& Params)
+{
+	FString MeshPath;
+	if (!FParse::Value(*Params, TEXT("Mesh="), MeshPath, false))
+	{
+		UE_LOG(LogBetterPADeterminism, Error, TEXT("Missing -Mesh=/Game/Path/Mesh"));
+		return 1;
+	}
+
+	USkeletalMesh* SkeletalMesh = LoadObject<USkeletalMesh>(nullptr, *MeshPath);
+	if (!SkeletalMesh)
+	{
+		UE_LOG(LogBetterPADeterminism, Error, TEXT("Could not load %s"), *MeshPath);
+		return 1;
+	}
+
+	TArray<int32> ThreadCounts = { 1, 4, 0 };
+	FString Threads;
+	if (FParse::Value(*Params, TEXT("Threads="), Threads, false))
+	{
+		TArray<FString> ThreadList;
+		Threads.ParseIntoArray(ThreadList, TEXT("+"));
+		ThreadCounts.Reset();
+		for (const FString& Count : ThreadList)
+		{
+			ThreadCounts.Add(FCString::Atoi(*Count));
+		}
+	}
+
+	FBetterPAGenerationSettings Settings;
+	Settings.bOptimizeFit = FParse::Param(*Params, TEXT("Optimize"));
+	Settings.bChainMode = FParse::Param(*Params, TEXT("Chains"));
+	Settings.bSweepJointLimits = FParse::Param(*Params, TEXT("SweepLimits"));
+
+	FString ConvexBones;
+	if (FParse::Value(*Params, TEXT("ConvexBones="), ConvexBones, false))
+	{
+		TArray<FString> BoneList;
+		ConvexBones.ParseIntoArray(BoneList, TEXT("+"));
+		for (const FString& BoneName : BoneList)
+		{
+			Settings.ConvexBones.Add(FName(*BoneName));
+		}
+	}
+
+	FString PoseAnimations;
+	if (FParse::Value(*Params, TEXT("PoseAnimations="), PoseAnimations, false))
+	{
+		TArray<FString> AnimationList;
+		PoseAnimations.ParseIntoArray(AnimationList, TEXT("+"));
+		for (const FString& AnimationPath : AnimationList)
+		{
+			UAnimSequence* Animation = LoadObject<UAnimSequence>(nullptr, *AnimationPath);
+			if (!Animation)
+			{
+				UE_LOG(LogBetterPADeterminism, Error, TEXT("Could not load %s"), *AnimationPath);
+				return 1;
+			}
+			Settings.PoseAnimations.Add(Animation);
+		}
+	}
+
+	TSet<FName> SelectedBones;
+	for (const FMeshBoneInfo& Bone : SkeletalMesh->GetRefSkeleton().GetRefBoneInfo())
+	{
+		SelectedBones.Add(Bone.Name);
+	}
+
+	const FName AssetName(TEXT("BetterPADeterminismCheck"));
+	TArray<uint8> FirstBytes;
+	int32 NumMismatches = 0;
+
+	for (int32 RunIndex = 0; RunIndex < ThreadCounts.Num(); ++RunIndex)
+	{
+		// Every run writes into an asset at the same path, the previous one is moved aside first
+		if (UObject* Previous = StaticFindObjectFast(nullptr, GetTransientPackage(), AssetName))
+		{
+			Previous->Rename(nullptr, GetTransientPackage(), REN_DontCreateRedirectors | REN_NonTransactional);
+		}
+		UPhysicsAsset* PhysicsAsset = NewObject<UPhysicsAsset>(GetTransientPackage(), AssetName);
+
+		// Cached hulls would hide differences in the decomposition itself
+		FBetterPAConvexDecomposition::ClearCache();
+
+		{
+			BetterPA::FScopedMaxWorkers MaxWorkers(ThreadCounts[RunIndex]);
+			FBetterPAGenerator::GeneratePhysicsAsset(SkeletalMesh, PhysicsAsset, SelectedBones, Settings);
+		}
+
+		TArray<uint8> Bytes;
+		SerializeAsset(PhysicsAsset, Bytes);
+
+		if (RunIndex == 0)
+		{
+			FirstBytes = MoveTemp(Bytes);
+			UE_LOG(LogBetterPADeterminism, Display, TEXT("%d workers: %d bodies, %d constraints, %d bytes"),
+				ThreadCounts[RunIndex], PhysicsAsset->SkeletalBodySetups.Num(), PhysicsAsset->ConstraintSetup.Num(), FirstBytes.Num());
+			continue;
+		}
+
+		const bool bMatches = Bytes.Num() == FirstBytes.Num() && FMemory::Memcmp(Bytes.GetData(), FirstBytes.GetData(), Bytes.Num()) == 0;
+		NumMismatches += bMatches ? 0 : 1;
+		UE_LOG(LogBetterPADeterminism, Display, TEXT("%d workers: %s"), ThreadCounts[RunIndex], bMatches ? TEXT("identical") : TEXT("DIFFERS"));
+	}
+
+	if (NumMismatches > 0)
+	{
+		UE_LOG(LogBetterPADeterminism, Error, TEXT("%d of %d runs differ from the first"), NumMismatches, ThreadCounts.Num() - 1);
+		return 1;
+	}
+
+	return 0;
+}
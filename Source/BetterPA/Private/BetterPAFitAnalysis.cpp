@@ -0,0 +1,247 @@
+#include "BetterPAFitAnalysis.h"
+#include "BetterPAMeshData.h"
+#include "BetterPAShapeKernel.h"
+#include "Engine/SkeletalMesh.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "AnimationRuntime.h"
+#include "Async/ParallelFor.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBetterPAFitAnalysis, Log, All);
+
+namespace
+{
+	// Points processed per parallel work item
+	constexpr int32 FitChunkSize = 4096;
+
+	struct FFitWorkItem
+	{
+		int32 BodyIndex;
+		int32 Start;
+		int32 Count;
+	};
+
+	struct FFitPartial
+	{
+		int32 NumCovered = 0;
+		int32 NumInside = 0;
+		float MaxPenetration = 0.0f;
+		double DistanceSum = 0.0;
+	};
+
+	float Median(TArray<float> Values)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.0f;
+		}
+		Values.Sort();
+		const int32 Mid = Values.Num() / 2;
+		return (Values.Num() % 2) ? Values[Mid] : 0.5f * (Values[Mid - 1] + Values[Mid]);
+	}
+
+	// Robust z-scores based on median absolute deviation
+	void ComputeRobustZScores(const TArray<float>& Values, TArray<float>& OutScores)
+	{
+		const float Med = Median(Values);
+
+		TArray<float> Deviations;
+		Deviations.Reserve(Values.Num());
+		for (float Value : Values)
+		{
+			Deviations.Add(FMath::Abs(Value - Med));
+		}
+		const float MAD = Median(Deviations);
+
+		OutScores.SetNumZeroed(Values.Num());
+		if (MAD > KINDA_SMALL_NUMBER)
+		{
+			for (int32 Index = 0; Index < Values.Num(); ++Index)
+			{
+				OutScores[Index] = 0.6745f * (Values[Index] - Med) / MAD;
+			}
+		}
+	}
+}
+
+bool FBetterPAFitAnalysis::Analyze(const USkeletalMesh* SkeletalMesh, const UPhysicsAsset* PhysicsAsset, const FBetterPAFitAnalysisSettings& Settings, TArray<FBetterPABodyFitStats>& OutStats)
+{
+	OutStats.Reset();
+
+	if (!SkeletalMesh || !PhysicsAsset)
+	{
+		return false;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const FReferenceSkeleton& RefSkeleton = SkeletalMesh->GetRefSkeleton();
+
+	TArray<FTransform> ComponentSpaceTransforms;
+	FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, RefSkeleton.GetRefBonePose(), ComponentSpaceTransforms);
+
+	const int32 NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+
+	// Body shapes and bone transforms, in body order
+	TArray<FTransform> BodyBoneTransforms;
+	TArray<TArray<FBetterPAShapeProxy>> BodyShapes;
+	BodyBoneTransforms.SetNum(NumBodies);
+	BodyShapes.SetNum(NumBodies);
+	OutStats.SetNum(NumBodies);
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[BodyIndex];
+		FBetterPABodyFitStats& Stats = OutStats[BodyIndex];
+		Stats.BodyIndex = BodyIndex;
+
+		if (!BodySetup)
+		{
+			continue;
+		}
+
+		Stats.BoneName = BodySetup->BoneName;
+
+		const int32 BoneIndex = RefSkeleton.FindBoneIndex(BodySetup->BoneName);
+		if (BoneIndex != INDEX_NONE)
+		{
+			BodyBoneTransforms[BodyIndex] = ComponentSpaceTransforms[BoneIndex];
+			FBetterPAShapeProxy::GatherFromAggGeom(BodySetup->AggGeom, BodyShapes[BodyIndex]);
+		}
+	}
+
+	TArray<int32> BoneToBody;
+	BetterPA::MapBonesToBodies(RefSkeleton, [PhysicsAsset](FName BoneName) { return PhysicsAsset->FindBodyIndex(BoneName); }, BoneToBody);
+
+	FBetterPAVertexBuckets VertexBuckets;
+	if (!VertexBuckets.Build(SkeletalMesh, Settings.LODIndex, BoneToBody, BodyBoneTransforms, Settings.MinSkinWeight, Settings.MaxPointsPerBody))
+	{
+		return false;
+	}
+
+	// Split every bucket into fixed-size chunks so large bodies spread across all cores
+	TArray<FFitWorkItem> WorkItems;
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		const int32 NumPoints = BodyShapes[BodyIndex].Num() > 0 ? VertexBuckets.Buckets[BodyIndex].Num() : 0;
+		for (int32 Start = 0; Start < NumPoints; Start += FitChunkSize)
+		{
+			WorkItems.Add({ BodyIndex, Start, FMath::Min(FitChunkSize, NumPoints - Start) });
+		}
+	}
+
+	TArray<FFitPartial> Partials;
+	Partials.SetNum(WorkItems.Num());
+
+	ParallelFor(WorkItems.Num(), [&](int32 ItemIndex)
+	{
+		const FFitWorkItem& Item = WorkItems[ItemIndex];
+		const FBetterPAPointBucket& Bucket = VertexBuckets.Buckets[Item.BodyIndex];
+
+		TArray<float, TInlineAllocator<FitChunkSize>> Distances;
+		Distances.SetNumUninitialized(Item.Count);
+
+		BetterPA::ComputeMinSignedDistances(BodyShapes[Item.BodyIndex],
+			Bucket.X.GetData() + Item.Start, Bucket.Y.GetData() + Item.Start, Bucket.Z.GetData() + Item.Start,
+			Item.Count, Distances.GetData());
+
+		FFitPartial& Partial = Partials[ItemIndex];
+		for (float Distance : Distances)
+		{
+			Partial.NumCovered += (Distance <= Settings.CoverageTolerance) ? 1 : 0;
+			if (Distance < 0.0f)
+			{
+				++Partial.NumInside;
+				Partial.MaxPenetration = FMath::Max(Partial.MaxPenetration, -Distance);
+			}
+			Partial.DistanceSum += Distance;
+		}
+	});
+
+	// Reduce in work item order so the result does not depend on scheduling
+	TArray<FFitPartial> BodyTotals;
+	BodyTotals.SetNum(NumBodies);
+	for (int32 ItemIndex = 0; ItemIndex < WorkItems.Num(); ++ItemIndex)
+	{
+		const FFitPartial& Partial = Partials[ItemIndex];
+		FFitPartial& Total = BodyTotals[WorkItems[ItemIndex].BodyIndex];
+		Total.NumCovered += Partial.NumCovered;
+		Total.NumInside += Partial.NumInside;
+		Total.MaxPenetration = FMath::Max(Total.MaxPenetration, Partial.MaxPenetration);
+		Total.DistanceSum += Partial.DistanceSum;
+	}
+
+	TArray<int32> MeasuredBodies;
+	TArray<float> CoverageValues;
+	TArray<float> PenetrationValues;
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		FBetterPABodyFitStats& Stats = OutStats[BodyIndex];
+		const FFitPartial& Total = BodyTotals[BodyIndex];
+		const int32 NumPoints = BodyShapes[BodyIndex].Num() > 0 ? VertexBuckets.Buckets[BodyIndex].Num() : 0;
+
+		Stats.NumVertices = NumPoints > 0 ? VertexBuckets.NumBodyVertices[BodyIndex] : 0;
+		Stats.NumSampled = NumPoints;
+		if (NumPoints > 0)
+		{
+			Stats.Coverage = (float)Total.NumCovered / NumPoints;
+			Stats.OverInflation = (float)Total.NumInside / NumPoints;
+			Stats.MaxPenetration = Total.MaxPenetration;
+			Stats.MeanDistance = (float)(Total.DistanceSum / NumPoints);
+
+			MeasuredBodies.Add(BodyIndex);
+			CoverageValues.Add(Stats.Coverage);
+			PenetrationValues.Add(Stats.MaxPenetration);
+		}
+	}
+
+	// Flag bodies that cover much less, or penetrate much deeper, than the rest of the asset
+	TArray<float> CoverageScores;
+	TArray<float> PenetrationScores;
+	ComputeRobustZScores(CoverageValues, CoverageScores);
+	ComputeRobustZScores(PenetrationValues, PenetrationScores);
+
+	for (int32 Index = 0; Index < MeasuredBodies.Num(); ++Index)
+	{
+		OutStats[MeasuredBodies[Index]].bOutlier = CoverageScores[Index] < -Settings.OutlierThreshold || PenetrationScores[Index] > Settings.OutlierThreshold;
+	}
+
+	int32 NumVertices = 0;
+	int32 NumSampled = 0;
+	for (const FBetterPABodyFitStats& Stats : OutStats)
+	{
+		NumVertices += Stats.NumVertices;
+		NumSampled += Stats.NumSampled;
+	}
+	UE_LOG(LogBetterPAFitAnalysis, Log, TEXT("%s: %d of %d vertices against %d bodies in %.1f ms, peak %llu bytes of points"),
+		*PhysicsAsset->GetName(), NumSampled, NumVertices, MeasuredBodies.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0, (uint64)VertexBuckets.StreamStats.PeakBytes);
+
+	return true;
+}
+
+FString FBetterPAFitAnalysis::ToCSV(const TArray<FBetterPABodyFitStats>& Stats)
+{
+	FString Result = TEXT("Bone,BodyIndex,Vertices,Sampled,Coverage,OverInflation,MaxPenetration,MeanDistance,Outlier\n");
+	for (const FBetterPABodyFitStats& Body : Stats)
+	{
+		Result += FString::Printf(TEXT("%s,%d,%d,%d,%.4f,%.4f,%.3f,%.3f,%s\n"),
+			*Body.BoneName.ToString(), Body.BodyIndex, Body.NumVertices, Body.NumSampled,
+			Body.Coverage, Body.OverInflation, Body.MaxPenetration, Body.MeanDistance,
+			Body.bOutlier ? TEXT("1") : TEXT("0"));
+	}
+	return Result;
+}
+
+FString FBetterPAFitAnalysis::SaveReport(const UPhysicsAsset* PhysicsAsset, const TArray<FBetterPABodyFitStats>& Stats)
+{
+	const FString FileName = (PhysicsAsset ? PhysicsAsset->GetName() : FString(TEXT("PhysicsAsset"))) + TEXT("_Fit.csv");
+	const FString FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("BetterPA"), TEXT("FitReports"), FileName);
+
+	if (!FFileHelper::SaveStringToFile(ToCSV(Stats), *FilePath))
+	{
+		return FString();
+	}
+	return FilePath;
+}
@@ -0,0 +1,258 @@
+#include "BetterPAFitOptimizer.h"
+#include "HAL/ThreadSafeBool.h"
+#include "BetterPAGenerator.h"
+#include "BetterPAMeshData.h"
+#include "BetterPAShapeKernel.h"
+#include "BetterPAParallel.h"
+
+namespace
+{
+	struct FCapsuleParams
+	{
+		FVector3f Center = FVector3f::ZeroVector;
+		FQuat4f Rotation = FQuat4f::Identity;
+		float Radius = 1.0f;
+		float Length = 0.0f;
+	};
+
+	struct FSegment
+	{
+		FVector A = FVector::ZeroVector;
+		FVector B = FVector::ZeroVector;
+		float Radius = 0.0f;
+	};
+
+	// Per-body search state, kept across rounds
+	struct FBodyState
+	{
+		FBetterPAPointBucket Points;
+		TArray<int32> Neighbours;
+		FCapsuleParams Capsule;
+		float ReferenceRadius = 1.0f;
+		float ReferenceVolume = 1.0f;
+		float CenterStep = 0.0f;
+		float AngleStep = 0.0f;
+		float RadiusStep = 0.0f;
+		float LengthStep = 0.0f;
+		bool bActive = false;
+	};
+
+	FCapsuleParams FromElem(const FKSphylElem& Elem)
+	{
+		FCapsuleParams Params;
+		Params.Center = FVector3f(Elem.Center);
+		Params.Rotation = FQuat4f(FQuat(Elem.Rotation));
+		Params.Radius = Elem.Radius;
+		Params.Length = Elem.Length;
+		return Params;
+	}
+
+	void ToElem(const FCapsuleParams& Params, FKSphylElem& OutElem)
+	{
+		OutElem.Center = FVector(Params.Center);
+		OutElem.Rotation = FQuat(Params.Rotation).Rotator();
+		OutElem.Radius = Params.Radius;
+		OutElem.Length = Params.Length;
+	}
+
+	float CapsuleVolume(float Radius, float Length)
+	{
+		return PI * Radius * Radius * Length + (4.0f / 3.0f) * PI * Radius * Radius * Radius;
+	}
+
+	FSegment ToComponentSegment(const FCapsuleParams& Params, const FTransform& BoneTransform)
+	{
+		const FVector3f HalfAxis = Params.Rotation.GetAxisZ() * (Params.Length * 0.5f);
+		FSegment Segment;
+		Segment.A = BoneTransform.TransformPosition(FVector(Params.Center - HalfAxis));
+		Segment.B = BoneTransform.TransformPosition(FVector(Params.Center + HalfAxis));
+		Segment.Radius = Params.Radius;
+		return Segment;
+	}
+
+	float EvaluateLoss(const FCapsuleParams& Params, const FBodyState& State, const FTransform& BoneTransform, const TArray<FSegment>& Segments, const FBetterPAGenerationSettings& Settings, TArray<float>& Scratch)
+	{
+		FBetterPAShapeProxy Proxy;
+		Proxy.Type = EBetterPAShapeType::Capsule;
+		Proxy.Center = Params.Center;
+		Proxy.AxisX = Params.Rotation.GetAxisX();
+		Proxy.AxisY = Params.Rotation.GetAxisY();
+		Proxy.AxisZ = Params.Rotation.GetAxisZ();
+		Proxy.Extent = FVector3f(Params.Radius, Params.Length * 0.5f, 0.0f);
+
+		const int32 NumPoints = State.Points.Num();
+		Scratch.SetNumUninitialized(NumPoints);
+		BetterPA::ComputeSignedDistances(Proxy, State.Points.X.GetData(), State.Points.Y.GetData(), State.Points.Z.GetData(), NumPoints, Scratch.GetData());
+
+		// Distances are normalized by the heuristic radius so all terms are unitless
+		const float InvRadius = 1.0f / State.ReferenceRadius;
+		float Uncovered = 0.0f;
+		float Overshoot = 0.0f;
+		for (int32 Index = 0; Index < NumPoints; ++Index)
+		{
+			const float Distance = Scratch[Index] * InvRadius;
+			if (Distance > 0.0f)
+			{
+				Uncovered += Distance * Distance;
+			}
+			else
+			{
+				Overshoot += Distance * Distance;
+			}
+		}
+
+		float Loss = (Settings.UncoveredWeight * Uncovered + Settings.OvershootWeight * Overshoot) / NumPoints;
+		Loss += Settings.VolumeWeight * CapsuleVolume(Params.Radius, Params.Length) / State.ReferenceVolume;
+
+		if (State.Neighbours.Num() > 0 && Settings.OverlapWeight > 0.0f)
+		{
+			const FSegment Self = ToComponentSegment(Params, BoneTransform);
+			for (int32 Neighbour : State.Neighbours)
+			{
+				const FSegment& Other = Segments[Neighbour];
+				FVector ClosestSelf;
+				FVector ClosestOther;
+				FMath::SegmentDistToSegmentSafe(Self.A, Self.B, Other.A, Other.B, ClosestSelf, ClosestOther);
+				const float Distance = (float)FVector::Dist(ClosestSelf, ClosestOther);
+
+				// Linked capsules always meet at the joint, only overlap beyond the thinner radius is penalized
+				const float Allowed = FMath::Min(Self.Radius, Other.Radius);
+				const float Penetration = FMath::Max(0.0f, Self.Radius + Other.Radius - Distance - Allowed) * InvRadius;
+				Loss += Settings.OverlapWeight * Penetration * Penetration;
+			}
+		}
+
+		return Loss;
+	}
+
+	FCapsuleParams Perturb(const FCapsuleParams& Params, int32 Dimension, float Sign, const FBodyState& State)
+	{
+		FCapsuleParams Result = Params;
+		switch (Dimension)
+		{
+		case 0: Result.Center.X += Sign * State.CenterStep; break;
+		case 1: Result.Center.Y += Sign * State.CenterStep; break;
+		case 2: Result.Center.Z += Sign * State.CenterStep; break;
+		case 3: Result.Rotation = (FQuat4f(Params.Rotation.GetAxisX(), Sign * State.AngleStep) * Params.Rotation).GetNormalized(); break;
+		case 4: Result.Rotation = (FQuat4f(Params.Rotation.GetAxisY(), Sign * State.AngleStep) * Params.Rotation).GetNormalized(); break;
+		case 5: Result.Radius = FMath::Max(BetterPA::MinCapsuleRadius, Params.Radius + Sign * State.RadiusStep); break;
+		default: Result.Length = FMath::Max(0.0f, Params.Length + Sign * State.LengthStep); break;
+		}
+		return Result;
+	}
+
+	// Gradient-free compass search, one accepted move per dimension and sweep
+	void OptimizeBody(FBodyState& State, const FTransform& BoneTransform, const TArray<FSegment>& Segments, int32 Iterations, const FBetterPAGenerationSettings& Settings)
+	{
+		constexpr int32 NumDimensions = 7;
+		const float MinCenterStep = 0.01f * State.ReferenceRadius;
+
+		TArray<float> Scratch;
+		float BestLoss = EvaluateLoss(State.Capsule, State, BoneTransform, Segments, Settings, Scratch);
+
+		for (int32 Iteration = 0; Iteration < Iterations && State.CenterStep >= MinCenterStep; ++Iteration)
+		{
+			bool bImproved = false;
+			for (int32 Dimension = 0; Dimension < NumDimensions; ++Dimension)
+			{
+				for (float Sign : { 1.0f, -1.0f })
+				{
+					const FCapsuleParams Candidate = Perturb(State.Capsule, Dimension, Sign, State);
+					const float Loss = EvaluateLoss(Candidate, State, BoneTransform, Segments, Settings, Scratch);
+					if (Loss < BestLoss)
+					{
+						BestLoss = Loss;
+						State.Capsule = Candidate;
+						bImproved = true;
+						break;
+					}
+				}
+			}
+
+			if (!bImproved)
+			{
+				State.CenterStep *= 0.5f;
+				State.AngleStep *= 0.5f;
+				State.RadiusStep *= 0.5f;
+				State.LengthStep *= 0.5f;
+			}
+		}
+	}
+}
+
+void FBetterPAFitOptimizer::Optimize(TArray<FKSphylElem>& InOutCapsules, const TArray<FTransform>& BodyBoneTransforms, const TArray<int32>& ParentBodies, const FBetterPAVertexBuckets& Buckets, const FBetterPAGenerationSettings& Settings, const FThreadSafeBool* Cancelled)
+{
+	const int32 NumBodies = InOutCapsules.Num();
+	if (NumBodies == 0)
+	{
+		return;
+	}
+
+	TArray<FBodyState> States;
+	States.SetNum(NumBodies);
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		FBodyState& State = States[BodyIndex];
+		State.Capsule = FromElem(InOutCapsules[BodyIndex]);
+		State.ReferenceRadius = FMath::Max(State.Capsule.Radius, BetterPA::MinCapsuleRadius);
+		State.ReferenceVolume = CapsuleVolume(State.ReferenceRadius, State.Capsule.Length);
+		State.CenterStep = 0.25f * State.ReferenceRadius;
+		State.AngleStep = FMath::DegreesToRadians(10.0f);
+		State.RadiusStep = 0.25f * State.ReferenceRadius;
+		State.LengthStep = 0.25f * FMath::Max(State.Capsule.Length, State.ReferenceRadius);
+
+		const int32 ParentBody = ParentBodies[BodyIndex];
+		if (ParentBody != INDEX_NONE)
+		{
+			State.Neighbours.Add(ParentBody);
+			States[ParentBody].Neighbours.Add(BodyIndex);
+		}
+
+		// Bones without skin influence fall back to the heuristic capsule
+		const FBetterPAPointBucket* Bucket = Buckets.Buckets.IsValidIndex(BodyIndex) ? &Buckets.Buckets[BodyIndex] : nullptr;
+		if (!Bucket || Bucket->Num() < Settings.OptimizerMinPoints)
+		{
+			continue;
+		}
+
+		const int32 Stride = FMath::DivideAndRoundUp(Bucket->Num(), FMath::Max(Settings.OptimizerMaxPoints, 1));
+		State.Points.Reserve(Bucket->Num() / Stride + 1);
+		for (int32 PointIndex = 0; PointIndex < Bucket->Num(); PointIndex += Stride)
+		{
+			State.Points.Add(Bucket->Get(PointIndex));
+		}
+		State.bActive = true;
+	}
+
+	// Jacobi rounds: every body is refined in parallel against the neighbour capsules of the previous round
+	const int32 Rounds = FMath::Max(Settings.OptimizerRounds, 1);
+	const int32 IterationsPerRound = FMath::DivideAndRoundUp(FMath::Max(Settings.OptimizerIterations, 1), Rounds);
+
+	TArray<FSegment> Segments;
+	Segments.SetNum(NumBodies);
+
+	for (int32 Round = 0; Round < Rounds && !(Cancelled && *Cancelled); ++Round)
+	{
+		for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+		{
+			Segments[BodyIndex] = ToComponentSegment(States[BodyIndex].Capsule, BodyBoneTransforms[BodyIndex]);
+		}
+
+		BetterPA::ParallelFor(NumBodies, [&](int32 BodyIndex)
+		{
+			if (States[BodyIndex].bActive)
+			{
+				OptimizeBody(States[BodyIndex], BodyBoneTransforms[BodyIndex], Segments, IterationsPerRound, Settings);
+			}
+		});
+	}
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		if (States[BodyIndex].bActive)
+		{
+			ToElem(States[BodyIndex].Capsule, InOutCapsules[BodyIndex]);
+		}
+	}
+}
@@ -0,0 +1,181 @@
+#include "BetterPAFrameBenchmarkCommandlet.h"
+#include "BetterPAFrameKernel.h"
+#include "Math/RandomStream.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBetterPAFrameBenchmark, Log, All);
+
+namespace
+{
+	// Component space positions of a large rig stay within a few meters of the origin
+	constexpr float PositionRange = 200.0f;
+
+	// Largest float rounding seen on that range is around 1e-4 cm, well below anything the solver resolves
+	constexpr double PositionTolerance = 1.e-3;
+	constexpr double DirectionTolerance = 1.e-5;
+
+	struct FBenchmarkJoint
+	{
+		FTransform Bone;
+		FTransform Parent;
+		FVector End;
+		FQuat Rotation;
+		float OffsetRatio;
+	};
+
+	FTransform MakeRandomTransform(FRandomStream& Random)
+	{
+		return FTransform(FQuat(Random.GetUnitVector(), Random.FRandRange(-UE_PI, UE_PI)), Random.GetUnitVector() * Random.FRandRange(0.0f, PositionRange));
+	}
+
+	double GetQuatError(const FQuat& A, const FQuat& B)
+	{
+		// Q and -Q are the same rotation
+		return FMath::Sqrt(FMath::Min((A - B).SizeSquared(), (A + B).SizeSquared()));
+	}
+
+	double GetSeconds(double StartTime, int32 Iterations)
+	{
+		return (FPlatformTime::Seconds() - StartTime) / FMath::Max(Iterations, 1);
+	}
+}
+
+UBetterPAFrameBenchmarkCommandlet::UBetterPAFrameBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UBetterPAFrameBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 Num = 100000;
+	int32 Iterations = 20;
+	int32 Seed = 1;
+	FParse::Value(*Params, TEXT("Num="), Num);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	Num = FMath::Max(Num, 1);
+	Iterations = FMath::Max(Iterations, 1);
+
+	FRandomStream Random(Seed);
+	TArray<FBenchmarkJoint> Joints;
+	Joints.SetNum(Num);
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		FBenchmarkJoint& Joint = Joints[Index];
+		Joint.Bone = MakeRandomTransform(Random);
+		Joint.Parent = MakeRandomTransform(Random);
+		Joint.End = Joint.Bone.GetLocation() + Random.GetUnitVector() * Random.FRandRange(0.0f, 50.0f);
+		Joint.Rotation = FQuat(Random.GetUnitVector(), Random.FRandRange(-UE_PI, UE_PI));
+		Joint.OffsetRatio = Random.FRandRange(0.3f, 0.7f);
+
+		// Every eighth capsule points straight down, the degenerate case of FindBetweenNormals
+		if (Index % 8 == 7)
+		{
+			Joint.End = Joint.Bone.GetLocation() - FVector::UpVector * 20.0f;
+		}
+	}
+
+	// Scalar references, kept so the timed loops cannot be optimized away
+	TArray<FVector> ScalarCenters;
+	TArray<FQuat> ScalarLocalRotations;
+	TArray<FQuat> ScalarRotations;
+	TArray<FVector> ScalarJointValues;
+	ScalarCenters.SetNum(Num);
+	ScalarLocalRotations.SetNum(Num);
+	ScalarRotations.SetNum(Num);
+	ScalarJointValues.SetNum(Num * 6);
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			const FBenchmarkJoint& Joint = Joints[Index];
+			BetterPA::ComputeCapsuleFrame(Joint.Bone, Joint.Bone.GetLocation(), Joint.End, Joint.OffsetRatio, ScalarCenters[Index], ScalarLocalRotations[Index], ScalarRotations[Index]);
+		}
+	}
+	const double ScalarCapsuleSeconds = GetSeconds(StartTime, Iterations);
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			const FBenchmarkJoint& Joint = Joints[Index];
+			FVector* Values = &ScalarJointValues[Index * 6];
+			BetterPA::ComputeJointFrame(Joint.Bone, Joint.Bone.GetLocation(), Joint.Rotation, Values[0], Values[1], Values[2]);
+			BetterPA::ComputeJointFrame(Joint.Parent, Joint.Bone.GetLocation(), Joint.Rotation, Values[3], Values[4], Values[5]);
+		}
+	}
+	const double ScalarJointSeconds = GetSeconds(StartTime, Iterations);
+
+	// Batches are filled once; Compute alone is timed since that is the part the kernel replaces
+	FBetterPACapsuleFrameBatch CapsuleFrames;
+	FBetterPAJointFrameBatch JointFrames;
+	CapsuleFrames.SetNum(Num);
+	JointFrames.SetNum(Num);
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const FBenchmarkJoint& Joint = Joints[Index];
+		CapsuleFrames.Set(Index, Joint.Bone, Joint.Bone.GetLocation(), Joint.End, Joint.OffsetRatio);
+		JointFrames.Set(Index, Joint.Bone, Joint.Parent, Joint.Bone.GetLocation(), Joint.Rotation);
+	}
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		CapsuleFrames.Compute();
+	}
+	const double BatchCapsuleSeconds = GetSeconds(StartTime, Iterations);
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		JointFrames.Compute();
+	}
+	const double BatchJointSeconds = GetSeconds(StartTime, Iterations);
+
+	double MaxPositionError = 0.0;
+	double MaxDirectionError = 0.0;
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		FVector Center;
+		FQuat LocalRotation;
+		FQuat Rotation;
+		CapsuleFrames.Get(Index, Center, LocalRotation, Rotation);
+		MaxPositionError = FMath::Max(MaxPositionError, (Center - ScalarCenters[Index]).GetAbsMax());
+		MaxDirectionError = FMath::Max3(MaxDirectionError, GetQuatError(LocalRotation, ScalarLocalRotations[Index]), GetQuatError(Rotation, ScalarRotations[Index]));
+
+		FVector Frame[6];
+		JointFrames.GetFrame1(Index, Frame[0], Frame[1], Frame[2]);
+		JointFrames.GetFrame2(Index, Frame[3], Frame[4], Frame[5]);
+		const FVector* Expected = &ScalarJointValues[Index * 6];
+		for (int32 Value = 0; Value < 6; ++Value)
+		{
+			const double Error = (Frame[Value] - Expected[Value]).GetAbsMax();
+			double& MaxError = Value % 3 == 0 ? MaxPositionError : MaxDirectionError;
+			MaxError = FMath::Max(MaxError, Error);
+		}
+	}
+
+	auto LogThroughput = [Num](const TCHAR* Name, double ScalarSeconds, double BatchSeconds)
+	{
+		UE_LOG(LogBetterPAFrameBenchmark, Display, TEXT("%s: scalar %.2f M/s, batch %.2f M/s, %.2fx"), Name,
+			Num / FMath::Max(ScalarSeconds, UE_DOUBLE_SMALL_NUMBER) * 1.e-6, Num / FMath::Max(BatchSeconds, UE_DOUBLE_SMALL_NUMBER) * 1.e-6, ScalarSeconds / FMath::Max(BatchSeconds, UE_DOUBLE_SMALL_NUMBER));
+	};
+
+	UE_LOG(LogBetterPAFrameBenchmark, Display, TEXT("%d bones, %d iterations"), Num, Iterations);
+	LogThroughput(TEXT("Capsule frames"), ScalarCapsuleSeconds, BatchCapsuleSeconds);
+	LogThroughput(TEXT("Joint frames"), ScalarJointSeconds, BatchJointSeconds);
+	UE_LOG(LogBetterPAFrameBenchmark, Display, TEXT("Max error: position %g cm, direction %g"), MaxPositionError, MaxDirectionError);
+
+	if (MaxPositionError > PositionTolerance || MaxDirectionError > DirectionTolerance)
+	{
+		UE_LOG(LogBetterPAFrameBenchmark, Error, TEXT("Batch results differ from the scalar path by more than %g cm or %g"), PositionTolerance, DirectionTolerance);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,338 @@
+#include "BetterPAFrameKernel.h"
+
+namespace
+{
+	struct FVectorSoA
+	{
+		VectorRegister4Float X;
+		VectorRegister4Float Y;
+		VectorRegister4Float Z;
+	};
+
+	struct FQuatSoA
+	{
+		VectorRegister4Float X;
+		VectorRegister4Float Y;
+		VectorRegister4Float Z;
+		VectorRegister4Float W;
+	};
+
+	int32 GetPaddedNum(int32 Num)
+	{
+		return Align(FMath::Max(Num, 0), 4);
+	}
+
+	FVector GetSafeScaleReciprocal(const FTransform& Transform)
+	{
+		// Same tolerance as FTransform::InverseTransformPosition
+		return FTransform::GetSafeScaleReciprocal(Transform.GetScale3D(), UE_SMALL_NUMBER);
+	}
+
+	FORCEINLINE FVectorSoA LoadVector(const float* X, const float* Y, const float* Z, int32 Index)
+	{
+		return FVectorSoA{ VectorLoad(X + Index), VectorLoad(Y + Index), VectorLoad(Z + Index) };
+	}
+
+	FORCEINLINE FQuatSoA LoadQuat(const float* X, const float* Y, const float* Z, const float* W, int32 Index)
+	{
+		return FQuatSoA{ VectorLoad(X + Index), VectorLoad(Y + Index), VectorLoad(Z + Index), VectorLoad(W + Index) };
+	}
+
+	FORCEINLINE void StoreVector(const FVectorSoA& V, float* X, float* Y, float* Z, int32 Index)
+	{
+		VectorStore(V.X, X + Index);
+		VectorStore(V.Y, Y + Index);
+		VectorStore(V.Z, Z + Index);
+	}
+
+	FORCEINLINE FVectorSoA Cross(const FVectorSoA& A, const FVectorSoA& B)
+	{
+		return FVectorSoA{
+			VectorNegateMultiplyAdd(A.Z, B.Y, VectorMultiply(A.Y, B.Z)),
+			VectorNegateMultiplyAdd(A.X, B.Z, VectorMultiply(A.Z, B.X)),
+			VectorNegateMultiplyAdd(A.Y, B.X, VectorMultiply(A.X, B.Y)) };
+	}
+
+	FORCEINLINE FQuatSoA Conjugate(const FQuatSoA& Q)
+	{
+		return FQuatSoA{ VectorNegate(Q.X), VectorNegate(Q.Y), VectorNegate(Q.Z), Q.W };
+	}
+
+	// Hamilton product, B is applied first as with FQuat::operator*
+	FORCEINLINE FQuatSoA Multiply(const FQuatSoA& A, const FQuatSoA& B)
+	{
+		FQuatSoA Result;
+		Result.X = VectorNegateMultiplyAdd(A.Z, B.Y, VectorMultiplyAdd(A.Y, B.Z, VectorMultiplyAdd(A.X, B.W, VectorMultiply(A.W, B.X))));
+		Result.Y = VectorMultiplyAdd(A.Z, B.X, VectorMultiplyAdd(A.Y, B.W, VectorNegateMultiplyAdd(A.X, B.Z, VectorMultiply(A.W, B.Y))));
+		Result.Z = VectorMultiplyAdd(A.Z, B.W, VectorNegateMultiplyAdd(A.Y, B.X, VectorMultiplyAdd(A.X, B.Y, VectorMultiply(A.W, B.Z))));
+		Result.W = VectorNegateMultiplyAdd(A.Z, B.Z, VectorNegateMultiplyAdd(A.Y, B.Y, VectorNegateMultiplyAdd(A.X, B.X, VectorMultiply(A.W, B.W))));
+		return Result;
+	}
+
+	// v + 2w(q x v) + 2q x (q x v), for unit quaternions
+	FORCEINLINE FVectorSoA Rotate(const FQuatSoA& Q, const FVectorSoA& V)
+	{
+		const VectorRegister4Float Two = VectorSetFloat1(2.0f);
+		const FVectorSoA Axis{ Q.X, Q.Y, Q.Z };
+		FVectorSoA T = Cross(Axis, V);
+		T = FVectorSoA{ VectorMultiply(T.X, Two), VectorMultiply(T.Y, Two), VectorMultiply(T.Z, Two) };
+		const FVectorSoA U = Cross(Axis, T);
+		return FVectorSoA{
+			VectorAdd(VectorMultiplyAdd(Q.W, T.X, V.X), U.X),
+			VectorAdd(VectorMultiplyAdd(Q.W, T.Y, V.Y), U.Y),
+			VectorAdd(VectorMultiplyAdd(Q.W, T.Z, V.Z), U.Z) };
+	}
+
+	// Unrotate(Position - Translation) * InvScale, as FTransform::InverseTransformPosition
+	FORCEINLINE FVectorSoA InverseTransformPosition(const FQuatSoA& Rotation, const FVectorSoA& Translation, const FVectorSoA& InvScale, const FVectorSoA& Position)
+	{
+		const FVectorSoA Relative{ VectorSubtract(Position.X, Translation.X), VectorSubtract(Position.Y, Translation.Y), VectorSubtract(Position.Z, Translation.Z) };
+		const FVectorSoA Local = Rotate(Conjugate(Rotation), Relative);
+		return FVectorSoA{ VectorMultiply(Local.X, InvScale.X), VectorMultiply(Local.Y, InvScale.Y), VectorMultiply(Local.Z, InvScale.Z) };
+	}
+
+	FORCEINLINE FVectorSoA GetAxisX(const FQuatSoA& Q)
+	{
+		const VectorRegister4Float One = VectorOneFloat();
+		const VectorRegister4Float Two = VectorSetFloat1(2.0f);
+		return FVectorSoA{
+			VectorNegateMultiplyAdd(Two, VectorMultiplyAdd(Q.Z, Q.Z, VectorMultiply(Q.Y, Q.Y)), One),
+			VectorMultiply(Two, VectorMultiplyAdd(Q.W, Q.Z, VectorMultiply(Q.X, Q.Y))),
+			VectorMultiply(Two, VectorNegateMultiplyAdd(Q.W, Q.Y, VectorMultiply(Q.X, Q.Z))) };
+	}
+
+	FORCEINLINE FVectorSoA GetAxisY(const FQuatSoA& Q)
+	{
+		const VectorRegister4Float One = VectorOneFloat();
+		const VectorRegister4Float Two = VectorSetFloat1(2.0f);
+		return FVectorSoA{
+			VectorMultiply(Two, VectorNegateMultiplyAdd(Q.W, Q.Z, VectorMultiply(Q.X, Q.Y))),
+			VectorNegateMultiplyAdd(Two, VectorMultiplyAdd(Q.Z, Q.Z, VectorMultiply(Q.X, Q.X)), One),
+			VectorMultiply(Two, VectorMultiplyAdd(Q.W, Q.X, VectorMultiply(Q.Y, Q.Z))) };
+	}
+
+	// FQuat::FindBetweenNormals(FVector::UpVector, Direction) for unit or zero directions
+	FORCEINLINE FQuatSoA FindBetweenUp(const FVectorSoA& Direction)
+	{
+		const VectorRegister4Float Zero = VectorZeroFloat();
+		const VectorRegister4Float W = VectorAdd(VectorOneFloat(), Direction.Z);
+
+		// Pointing straight down, any half turn about a horizontal axis will do; this is the engine's choice
+		const VectorRegister4Float Opposite = VectorCompareLT(W, VectorSetFloat1(1.e-6f));
+		FQuatSoA Result;
+		Result.X = VectorSelect(Opposite, Zero, VectorNegate(Direction.Y));
+		Result.Y = VectorSelect(Opposite, VectorSetFloat1(-1.0f), Direction.X);
+		Result.Z = Zero;
+		Result.W = VectorSelect(Opposite, Zero, W);
+
+		const VectorRegister4Float InvLength = VectorDivide(VectorOneFloat(), VectorSqrt(VectorMultiplyAdd(Result.W, Result.W, VectorMultiplyAdd(Result.Y, Result.Y, VectorMultiply(Result.X, Result.X)))));
+		Result.X = VectorMultiply(Result.X, InvLength);
+		Result.Y = VectorMultiply(Result.Y, InvLength);
+		Result.W = VectorMultiply(Result.W, InvLength);
+		return Result;
+	}
+
+	// FVector::GetSafeNormal, zero for vectors shorter than the engine's small number
+	FORCEINLINE FVectorSoA GetSafeNormal(const FVectorSoA& V)
+	{
+		const VectorRegister4Float SmallNumber = VectorSetFloat1(UE_SMALL_NUMBER);
+		const VectorRegister4Float LengthSquared = VectorMultiplyAdd(V.Z, V.Z, VectorMultiplyAdd(V.Y, V.Y, VectorMultiply(V.X, V.X)));
+		const VectorRegister4Float InvLength = VectorDivide(VectorOneFloat(), VectorSqrt(VectorMax(LengthSquared, SmallNumber)));
+		const VectorRegister4Float Scale = VectorSelect(VectorCompareGT(LengthSquared, SmallNumber), InvLength, VectorZeroFloat());
+		return FVectorSoA{ VectorMultiply(V.X, Scale), VectorMultiply(V.Y, Scale), VectorMultiply(V.Z, Scale) };
+	}
+}
+
+void FBetterPACapsuleFrameBatch::SetNum(int32 InNum)
+{
+	NumItems = FMath::Max(InNum, 0);
+	Stride = GetPaddedNum(NumItems);
+	Data.SetNumZeroed(NumStreams * Stride);
+
+	// Padding lanes get an identity bone so they stay finite
+	for (EStream Stream : { BoneQW, BoneInvSX, BoneInvSY, BoneInvSZ })
+	{
+		float* Values = GetStream(Stream);
+		for (int32 Index = 0; Index < Stride; ++Index)
+		{
+			Values[Index] = 1.0f;
+		}
+	}
+}
+
+void FBetterPACapsuleFrameBatch::Set(int32 Index, const FTransform& BoneTransform, const FVector& Start, const FVector& End, float OffsetRatio)
+{
+	check(Index >= 0 && Index < NumItems);
+
+	const FQuat Rotation = BoneTransform.GetRotation();
+	const FVector Translation = BoneTransform.GetTranslation();
+	const FVector InvScale = GetSafeScaleReciprocal(BoneTransform);
+
+	GetStream(BoneQX)[Index] = (float)Rotation.X;
+	GetStream(BoneQY)[Index] = (float)Rotation.Y;
+	GetStream(BoneQZ)[Index] = (float)Rotation.Z;
+	GetStream(BoneQW)[Index] = (float)Rotation.W;
+	GetStream(BoneTX)[Index] = (float)Translation.X;
+	GetStream(BoneTY)[Index] = (float)Translation.Y;
+	GetStream(BoneTZ)[Index] = (float)Translation.Z;
+	GetStream(BoneInvSX)[Index] = (float)InvScale.X;
+	GetStream(BoneInvSY)[Index] = (float)InvScale.Y;
+	GetStream(BoneInvSZ)[Index] = (float)InvScale.Z;
+	GetStream(StartX)[Index] = (float)Start.X;
+	GetStream(StartY)[Index] = (float)Start.Y;
+	GetStream(StartZ)[Index] = (float)Start.Z;
+	GetStream(EndX)[Index] = (float)End.X;
+	GetStream(EndY)[Index] = (float)End.Y;
+	GetStream(EndZ)[Index] = (float)End.Z;
+	GetStream(Offset)[Index] = OffsetRatio;
+}
+
+void FBetterPACapsuleFrameBatch::Compute()
+{
+	for (int32 Index = 0; Index < Stride; Index += 4)
+	{
+		const FQuatSoA Bone = LoadQuat(GetStream(BoneQX), GetStream(BoneQY), GetStream(BoneQZ), GetStream(BoneQW), Index);
+		const FVectorSoA Translation = LoadVector(GetStream(BoneTX), GetStream(BoneTY), GetStream(BoneTZ), Index);
+		const FVectorSoA InvScale = LoadVector(GetStream(BoneInvSX), GetStream(BoneInvSY), GetStream(BoneInvSZ), Index);
+		const FVectorSoA Start = LoadVector(GetStream(StartX), GetStream(StartY), GetStream(StartZ), Index);
+		const FVectorSoA End = LoadVector(GetStream(EndX), GetStream(EndY), GetStream(EndZ), Index);
+		const VectorRegister4Float OffsetRatio = VectorLoad(GetStream(Offset) + Index);
+
+		const FVectorSoA Span{ VectorSubtract(End.X, Start.X), VectorSubtract(End.Y, Start.Y), VectorSubtract(End.Z, Start.Z) };
+		const FVectorSoA Center{ VectorMultiplyAdd(Span.X, OffsetRatio, Start.X), VectorMultiplyAdd(Span.Y, OffsetRatio, Start.Y), VectorMultiplyAdd(Span.Z, OffsetRatio, Start.Z) };
+		StoreVector(InverseTransformPosition(Bone, Translation, InvScale, Center), GetStream(CenterX), GetStream(CenterY), GetStream(CenterZ), Index);
+
+		const FQuatSoA Rotation = FindBetweenUp(GetSafeNormal(Span));
+		VectorStore(Rotation.X, GetStream(QX) + Index);
+		VectorStore(Rotation.Y, GetStream(QY) + Index);
+		VectorStore(Rotation.Z, GetStream(QZ) + Index);
+		VectorStore(Rotation.W, GetStream(QW) + Index);
+
+		const FQuatSoA LocalRotation = Multiply(Conjugate(Bone), Rotation);
+		VectorStore(LocalRotation.X, GetStream(LocalQX) + Index);
+		VectorStore(LocalRotation.Y, GetStream(LocalQY) + Index);
+		VectorStore(LocalRotation.Z, GetStream(LocalQZ) + Index);
+		VectorStore(LocalRotation.W, GetStream(LocalQW) + Index);
+	}
+}
+
+void FBetterPACapsuleFrameBatch::Get(int32 Index, FVector& OutCenter, FQuat& OutLocalRotation, FQuat& OutRotation) const
+{
+	check(Index >= 0 && Index < NumItems);
+	OutCenter = FVector(GetStream(CenterX)[Index], GetStream(CenterY)[Index], GetStream(CenterZ)[Index]);
+	OutLocalRotation = FQuat(GetStream(LocalQX)[Index], GetStream(LocalQY)[Index], GetStream(LocalQZ)[Index], GetStream(LocalQW)[Index]);
+	OutRotation = FQuat(GetStream(QX)[Index], GetStream(QY)[Index], GetStream(QZ)[Index], GetStream(QW)[Index]);
+}
+
+void FBetterPAJointFrameBatch::SetNum(int32 InNum)
+{
+	NumItems = FMath::Max(InNum, 0);
+	Stride = GetPaddedNum(NumItems);
+	Data.SetNumZeroed(NumStreams * Stride);
+
+	for (EStream Stream : { Bone1QW, Bone1InvSX, Bone1InvSY, Bone1InvSZ, Bone2QW, Bone2InvSX, Bone2InvSY, Bone2InvSZ, QW })
+	{
+		float* Values = GetStream(Stream);
+		for (int32 Index = 0; Index < Stride; ++Index)
+		{
+			Values[Index] = 1.0f;
+		}
+	}
+}
+
+void FBetterPAJointFrameBatch::Set(int32 Index, const FTransform& Bone1Transform, const FTransform& Bone2Transform, const FVector& Position, const FQuat& Rotation)
+{
+	check(Index >= 0 && Index < NumItems);
+
+	const FQuat Rotation1 = Bone1Transform.GetRotation();
+	const FVector Translation1 = Bone1Transform.GetTranslation();
+	const FVector InvScale1 = GetSafeScaleReciprocal(Bone1Transform);
+	GetStream(Bone1QX)[Index] = (float)Rotation1.X;
+	GetStream(Bone1QY)[Index] = (float)Rotation1.Y;
+	GetStream(Bone1QZ)[Index] = (float)Rotation1.Z;
+	GetStream(Bone1QW)[Index] = (float)Rotation1.W;
+	GetStream(Bone1TX)[Index] = (float)Translation1.X;
+	GetStream(Bone1TY)[Index] = (float)Translation1.Y;
+	GetStream(Bone1TZ)[Index] = (float)Translation1.Z;
+	GetStream(Bone1InvSX)[Index] = (float)InvScale1.X;
+	GetStream(Bone1InvSY)[Index] = (float)InvScale1.Y;
+	GetStream(Bone1InvSZ)[Index] = (float)InvScale1.Z;
+
+	const FQuat Rotation2 = Bone2Transform.GetRotation();
+	const FVector Translation2 = Bone2Transform.GetTranslation();
+	const FVector InvScale2 = GetSafeScaleReciprocal(Bone2Transform);
+	GetStream(Bone2QX)[Index] = (float)Rotation2.X;
+	GetStream(Bone2QY)[Index] = (float)Rotation2.Y;
+	GetStream(Bone2QZ)[Index] = (float)Rotation2.Z;
+	GetStream(Bone2QW)[Index] = (float)Rotation2.W;
+	GetStream(Bone2TX)[Index] = (float)Translation2.X;
+	GetStream(Bone2TY)[Index] = (float)Translation2.Y;
+	GetStream(Bone2TZ)[Index] = (float)Translation2.Z;
+	GetStream(Bone2InvSX)[Index] = (float)InvScale2.X;
+	GetStream(Bone2InvSY)[Index] = (float)InvScale2.Y;
+	GetStream(Bone2InvSZ)[Index] = (float)InvScale2.Z;
+
+	GetStream(PosX)[Index] = (float)Position.X;
+	GetStream(PosY)[Index] = (float)Position.Y;
+	GetStream(PosZ)[Index] = (float)Position.Z;
+	GetStream(QX)[Index] = (float)Rotation.X;
+	GetStream(QY)[Index] = (float)Rotation.Y;
+	GetStream(QZ)[Index] = (float)Rotation.Z;
+	GetStream(QW)[Index] = (float)Rotation.W;
+}
+
+void FBetterPAJointFrameBatch::Compute()
+{
+	for (int32 Index = 0; Index < Stride; Index += 4)
+	{
+		const FVectorSoA Position = LoadVector(GetStream(PosX), GetStream(PosY), GetStream(PosZ), Index);
+		const FQuatSoA Rotation = LoadQuat(GetStream(QX), GetStream(QY), GetStream(QZ), GetStream(QW), Index);
+
+		const FQuatSoA Bone1 = LoadQuat(GetStream(Bone1QX), GetStream(Bone1QY), GetStream(Bone1QZ), GetStream(Bone1QW), Index);
+		const FVectorSoA Translation1 = LoadVector(GetStream(Bone1TX), GetStream(Bone1TY), GetStream(Bone1TZ), Index);
+		const FVectorSoA InvScale1 = LoadVector(GetStream(Bone1InvSX), GetStream(Bone1InvSY), GetStream(Bone1InvSZ), Index);
+		const FQuatSoA Relative1 = Multiply(Conjugate(Bone1), Rotation);
+		StoreVector(InverseTransformPosition(Bone1, Translation1, InvScale1, Position), GetStream(Pos1X), GetStream(Pos1Y), GetStream(Pos1Z), Index);
+		StoreVector(GetAxisX(Relative1), GetStream(Pri1X), GetStream(Pri1Y), GetStream(Pri1Z), Index);
+		StoreVector(GetAxisY(Relative1), GetStream(Sec1X), GetStream(Sec1Y), GetStream(Sec1Z), Index);
+
+		const FQuatSoA Bone2 = LoadQuat(GetStream(Bone2QX), GetStream(Bone2QY), GetStream(Bone2QZ), GetStream(Bone2QW), Index);
+		const FVectorSoA Translation2 = LoadVector(GetStream(Bone2TX), GetStream(Bone2TY), GetStream(Bone2TZ), Index);
+		const FVectorSoA InvScale2 = LoadVector(GetStream(Bone2InvSX), GetStream(Bone2InvSY), GetStream(Bone2InvSZ), Index);
+		const FQuatSoA Relative2 = Multiply(Conjugate(Bone2), Rotation);
+		StoreVector(InverseTransformPosition(Bone2, Translation2, InvScale2, Position), GetStream(Pos2X), GetStream(Pos2Y), GetStream(Pos2Z), Index);
+		StoreVector(GetAxisX(Relative2), GetStream(Pri2X), GetStream(Pri2Y), GetStream(Pri2Z), Index);
+		StoreVector(GetAxisY(Relative2), GetStream(Sec2X), GetStream(Sec2Y), GetStream(Sec2Z), Index);
+	}
+}
+
+void FBetterPAJointFrameBatch::GetFrame1(int32 Index, FVector& OutPos, FVector& OutPriAxis, FVector& OutSecAxis) const
+{
+	check(Index >= 0 && Index < NumItems);
+	OutPos = FVector(GetStream(Pos1X)[Index], GetStream(Pos1Y)[Index], GetStream(Pos1Z)[Index]);
+	OutPriAxis = FVector(GetStream(Pri1X)[Index], GetStream(Pri1Y)[Index], GetStream(Pri1Z)[Index]);
+	OutSecAxis = FVector(GetStream(Sec1X)[Index], GetStream(Sec1Y)[Index], GetStream(Sec1Z)[Index]);
+}
+
+void FBetterPAJointFrameBatch::GetFrame2(int32 Index, FVector& OutPos, FVector& OutPriAxis, FVector& OutSecAxis) const
+{
+	check(Index >= 0 && Index < NumItems);
+	OutPos = FVector(GetStream(Pos2X)[Index], GetStream(Pos2Y)[Index], GetStream(Pos2Z)[Index]);
+	OutPriAxis = FVector(GetStream(Pri2X)[Index], GetStream(Pri2Y)[Index], GetStream(Pri2Z)[Index]);
+	OutSecAxis = FVector(GetStream(Sec2X)[Index], GetStream(Sec2Y)[Index], GetStream(Sec2Z)[Index]);
+}
+
+void BetterPA::ComputeCapsuleFrame(const FTransform& BoneTransform, const FVector& Start, const FVector& End, float OffsetRatio, FVector& OutCenter, FQuat& OutLocalRotation, FQuat& OutRotation)
+{
+	OutCenter = BoneTransform.InverseTransformPosition(Start + (End - Start) * OffsetRatio);
+	OutRotation = FQuat::FindBetweenNormals(FVector::UpVector, (End - Start).GetSafeNormal());
+	OutLocalRotation = BoneTransform.GetRotation().Inverse() * OutRotation;
+}
+
+void BetterPA::ComputeJointFrame(const FTransform& BoneTransform, const FVector& Position, const FQuat& Rotation, FVector& OutPos, FVector& OutPriAxis, FVector& OutSecAxis)
+{
+	const FQuat Relative = BoneTransform.GetRotation().Inverse() * Rotation;
+	OutPos = BoneTransform.InverseTransformPosition(Position);
+	OutPriAxis = Relative.GetAxisX();
+	OutSecAxis = Relative.GetAxisY();
+}
@@ -1,241 +1,1127 @@
 #include "BetterPAGenerator.h"
+#include "BetterPABodyClassifier.h"
+#include "BetterPABoneChains.h"
+#include "BetterPAConstraintBuilder.h"
+#include "BetterPAConvexDecomposition.h"
+#include "BetterPAFrameKernel.h"
+#include "BetterPAJointLimits.h"
+#include "BetterPAPenetrationResolver.h"
+#include "BetterPAFitOptimizer.h"
+#include "BetterPAMeshData.h"
+#include "BetterPAPoseSampler.h"
+#include "BetterPAShapePriors.h"
+#include "Animation/AnimSequence.h"
 #include "Engine/SkeletalMesh.h"
 #include "PhysicsEngine/PhysicsAsset.h"
 #include "PhysicsEngine/PhysicsConstraintTemplate.h"
 #include "PhysicsEngine/SkeletalBodySetup.h"
 #include "ReferenceSkeleton.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "HAL/ThreadSafeBool.h"
+#include "AnimationRuntime.h"
+#include "Algo/Count.h"
+#include "Editor.h"
+#include "Editor/Transactor.h"
+#include "Hash/xxhash.h"
+#include "ScopedTransaction.h"
 
+#define LOCTEXT_NAMESPACE "BetterPAGenerator"
 
-void FBetterPAGenerator::GeneratePhysicsAsset(USkeletalMesh* SkeletalMesh, UPhysicsAsset* PhysicsAsset, const TSet<FName>& SelectedBones)
+DEFINE_LOG_CATEGORY_STATIC(LogBetterPAGenerator, Log, All);
+
+namespace
+{
+	// Budget of the coarse preview pass, enough for a plausible fit in a fraction of the full optimizer's time
+	constexpr int32 CoarseOptimizerMaxPoints = 256;
+	constexpr int32 CoarseOptimizerIterations = 12;
+
+	float FindDensity(FName BoneName, const FBetterPAGenerationSettings& Settings)
+	{
+		const FString BoneString = BoneName.ToString();
+		float Density = Settings.Density;
+		int32 MatchLength = 0;
+		for (const TPair<FString, float>& Entry : Settings.DensityByBoneName)
+		{
+			if (Entry.Key.Len() > MatchLength && BoneString.Contains(Entry.Key))
+			{
+				Density = Entry.Value;
+				MatchLength = Entry.Key.Len();
+			}
+		}
+		return Density;
+	}
+
+	/**
+	 * Mass from shape volume and density, clamped against the parent so no constraint joins bodies of wildly different mass.
+	 * Bodies are in parent-first order, so a single pass sees every parent's final mass before its children.
+	 */
+	void ComputeMassProperties(TArray<FBetterPABodyResult>& Bodies, const FBetterPAGenerationSettings& Settings)
+	{
+		const float MaxRatio = FMath::Max(Settings.MaxMassRatio, 1.0f);
+		const float ReferenceMass = FMath::Max(Settings.DampingReferenceMass, UE_KINDA_SMALL_NUMBER);
+		const float MaxDampingScale = FMath::Max(Settings.MaxDampingScale, 1.0f);
+
+		for (FBetterPABodyResult& Body : Bodies)
+		{
+			// cm^3 * g/cm^3 -> kg
+			const float Volume = (float)Body.AggGeom.GetVolume(FVector::OneVector);
+			float Mass = FMath::Max(Volume * FindDensity(Body.BoneName, Settings) * 0.001f, UE_KINDA_SMALL_NUMBER);
+
+			if (Body.ParentBody != INDEX_NONE)
+			{
+				const float ParentMass = Bodies[Body.ParentBody].Mass;
+				Mass = FMath::Clamp(Mass, ParentMass / MaxRatio, ParentMass * MaxRatio);
+			}
+
+			// Light bodies jitter the most, give them more damping and let them sleep sooner
+			const float Scale = FMath::Clamp(FMath::Sqrt(ReferenceMass / Mass), 1.0f, MaxDampingScale);
+			Body.Mass = Mass;
+			Body.LinearDamping = Settings.LinearDamping * Scale;
+			Body.AngularDamping = Settings.AngularDamping * Scale;
+			Body.SleepThresholdMultiplier = Scale;
+		}
+	}
+
+	FName SanitizeObjectName(const FString& BaseName)
+	{
+		FString Sanitized = BaseName;
+		for (TCHAR& Char : Sanitized)
+		{
+			if (FCString::Strchr(INVALID_OBJECTNAME_CHARACTERS, Char))
+			{
+				Char = TEXT('_');
+			}
+		}
+		return FName(*Sanitized);
+	}
+
+	// Exact comparison, generation is deterministic so an unchanged body reproduces the same values
+	bool BodyMatches(const USkeletalBodySetup& BodySetup, const FBetterPABodyResult& Body)
+	{
+		if (BodySetup.CollisionTraceFlag != CTF_UseSimpleAsComplex || !FKAggregateGeom::StaticStruct()->CompareScriptStruct(&BodySetup.AggGeom, &Body.AggGeom, PPF_None))
+		{
+			return false;
+		}
+
+		if (BodySetup.PhysicsType != Body.PhysicsType || BodySetup.DefaultInstance.GetCollisionEnabled(false) != Body.CollisionEnabled)
+		{
+			return false;
+		}
+
+		const FBodyInstance& BodyInstance = BodySetup.DefaultInstance;
+		if (Body.Mass <= 0.0f)
+		{
+			// Damping and sleep are only the generator's while it overrides the mass, otherwise they are left as they are
+			return !BodyInstance.bOverrideMass;
+		}
+
+		return BodyInstance.bOverrideMass
+			&& BodyInstance.GetMassOverride() == Body.Mass
+			&& BodyInstance.LinearDamping == Body.LinearDamping
+			&& BodyInstance.AngularDamping == Body.AngularDamping
+			&& BodyInstance.SleepFamily == ESleepFamily::Custom
+			&& BodyInstance.CustomSleepThresholdMultiplier == Body.SleepThresholdMultiplier;
+	}
+
+	// Cooked convex data is cached by body setup guid, so derive it from the asset, the bone and the hulls instead of a random one
+	FGuid MakeBodySetupGuid(const USkeletalBodySetup& BodySetup)
+	{
+		FXxHash64Builder Builder;
+		for (const FKConvexElem& Elem : BodySetup.AggGeom.ConvexElems)
+		{
+			const FTransform Transform = Elem.GetTransform();
+			const FVector Location = Transform.GetLocation();
+			const FQuat Rotation = Transform.GetRotation();
+			const FVector Scale = Transform.GetScale3D();
+			Builder.Update(Elem.VertexData.GetData(), Elem.VertexData.Num() * sizeof(FVector));
+			Builder.Update(&Location, sizeof(Location));
+			Builder.Update(&Rotation, sizeof(Rotation));
+			Builder.Update(&Scale, sizeof(Scale));
+		}
+
+		const FString Path = FString::Printf(TEXT("%s:%s"), *BodySetup.GetOuter()->GetPathName(), *BodySetup.BoneName.ToString());
+		return FGuid::NewDeterministicGuid(Path, Builder.Finalize().Hash);
+	}
+
+	void WriteBody(USkeletalBodySetup& BodySetup, const FBetterPABodyResult& Body)
+	{
+		// Cooked convex data has to go when the old or the new shapes are convex
+		const bool bConvex = BodySetup.AggGeom.ConvexElems.Num() > 0 || Body.AggGeom.ConvexElems.Num() > 0;
+
+		BodySetup.BoneName = Body.BoneName;
+		BodySetup.CollisionTraceFlag = CTF_UseSimpleAsComplex;
+		BodySetup.AggGeom = Body.AggGeom;
+		BodySetup.PhysicsType = Body.PhysicsType;
+		BodySetup.DefaultInstance.SetCollisionEnabled(Body.CollisionEnabled, false);
+		if (bConvex)
+		{
+			BodySetup.InvalidatePhysicsData();
+		}
+
+		// New bodies and invalidated ones were given a random guid, equal results have to serialize identically
+		BodySetup.BodySetupGuid = MakeBodySetupGuid(BodySetup);
+		if (bConvex)
+		{
+			BodySetup.CreatePhysicsMeshes();
+		}
+
+		FBodyInstance& BodyInstance = BodySetup.DefaultInstance;
+		if (Body.Mass > 0.0f)
+		{
+			// Inertia follows from the overridden mass and the fitted shapes
+			BodyInstance.SetMassOverride(Body.Mass);
+			BodyInstance.LinearDamping = Body.LinearDamping;
+			BodyInstance.AngularDamping = Body.AngularDamping;
+			BodyInstance.SleepFamily = ESleepFamily::Custom;
+			BodyInstance.CustomSleepThresholdMultiplier = Body.SleepThresholdMultiplier;
+		}
+		else if (BodyInstance.bOverrideMass)
+		{
+			// Drop what an earlier apply with mass enabled wrote, mass then follows from the shapes again.
+			// Bodies without an override were never written by it, their damping and sleep settings stay as they are.
+			const FBodyInstance& Defaults = GetDefault<USkeletalBodySetup>()->DefaultInstance;
+			BodyInstance.SetMassOverride(Defaults.GetMassOverride(), false);
+			BodyInstance.LinearDamping = Defaults.LinearDamping;
+			BodyInstance.AngularDamping = Defaults.AngularDamping;
+			BodyInstance.SleepFamily = Defaults.SleepFamily;
+			BodyInstance.CustomSleepThresholdMultiplier = Defaults.CustomSleepThresholdMultiplier;
+		}
+	}
+
+	// Limits on free and locked axes are not limits, they keep whatever the template holds
+	float GetLimitToWrite(EAngularConstraintMotion Motion, float Limit, float Existing)
+	{
+		return Motion == EAngularConstraintMotion::ACM_Limited ? Limit : Existing;
+	}
+
+	bool ConstraintMatches(const UPhysicsConstraintTemplate& Template, const FBetterPAConstraintResult& Constraint, FName ChildBone, FName ParentBone)
+	{
+		const FConstraintInstance& Instance = Template.DefaultInstance;
+		return Instance.ConstraintBone1 == ChildBone
+			&& Instance.ConstraintBone2 == ParentBone
+			&& Instance.Pos1 == Constraint.Pos1
+			&& Instance.PriAxis1 == Constraint.PriAxis1
+			&& Instance.SecAxis1 == Constraint.SecAxis1
+			&& Instance.Pos2 == Constraint.Pos2
+			&& Instance.PriAxis2 == Constraint.PriAxis2
+			&& Instance.SecAxis2 == Constraint.SecAxis2
+			&& Instance.GetAngularSwing1Motion() == Constraint.Swing1Motion
+			&& Instance.GetAngularSwing2Motion() == Constraint.Swing2Motion
+			&& Instance.GetAngularTwistMotion() == Constraint.TwistMotion
+			&& Instance.GetAngularSwing1Limit() == GetLimitToWrite(Constraint.Swing1Motion, Constraint.Swing1Limit, Instance.GetAngularSwing1Limit())
+			&& Instance.GetAngularSwing2Limit() == GetLimitToWrite(Constraint.Swing2Motion, Constraint.Swing2Limit, Instance.GetAngularSwing2Limit())
+			&& Instance.GetAngularTwistLimit() == GetLimitToWrite(Constraint.TwistMotion, Constraint.TwistLimit, Instance.GetAngularTwistLimit())
+			&& Instance.GetLinearXMotion() == Constraint.LinearXMotion
+			&& Instance.GetLinearYMotion() == Constraint.LinearYMotion
+			&& Instance.GetLinearZMotion() == Constraint.LinearZMotion
+			&& (!Constraint.HasLimitedLinearAxis() || Instance.GetLinearLimit() == Constraint.LinearLimit)
+			&& FAngularDriveConstraint::StaticStruct()->CompareScriptStruct(&Instance.ProfileInstance.AngularDrive, &Constraint.AngularDrive, PPF_None)
+			&& FLinearDriveConstraint::StaticStruct()->CompareScriptStruct(&Instance.ProfileInstance.LinearDrive, &Constraint.LinearDrive, PPF_None)
+			&& Instance.ProfileInstance.bDisableCollision
+			&& BetterPA::ConstraintProfilesMatch(Template, Constraint.Profiles);
+	}
+
+	void WriteConstraint(UPhysicsConstraintTemplate& Template, const FBetterPAConstraintResult& Constraint, FName ChildBone, FName ParentBone)
+	{
+		FConstraintInstance& Instance = Template.DefaultInstance;
+		Instance.ConstraintBone1 = ChildBone; // Child
+		Instance.ConstraintBone2 = ParentBone; // Parent
+
+		Instance.Pos1 = Constraint.Pos1;
+		Instance.PriAxis1 = Constraint.PriAxis1;
+		Instance.SecAxis1 = Constraint.SecAxis1;
+		Instance.Pos2 = Constraint.Pos2;
+		Instance.PriAxis2 = Constraint.PriAxis2;
+		Instance.SecAxis2 = Constraint.SecAxis2;
+
+		// Limits
+		Instance.SetAngularSwing1Limit(Constraint.Swing1Motion, GetLimitToWrite(Constraint.Swing1Motion, Constraint.Swing1Limit, Instance.GetAngularSwing1Limit()));
+		Instance.SetAngularSwing2Limit(Constraint.Swing2Motion, GetLimitToWrite(Constraint.Swing2Motion, Constraint.Swing2Limit, Instance.GetAngularSwing2Limit()));
+		Instance.SetAngularTwistLimit(Constraint.TwistMotion, GetLimitToWrite(Constraint.TwistMotion, Constraint.TwistLimit, Instance.GetAngularTwistLimit()));
+
+		// Linear
+		const float LinearLimit = Constraint.HasLimitedLinearAxis() ? Constraint.LinearLimit : Instance.GetLinearLimit();
+		Instance.SetLinearXLimit(Constraint.LinearXMotion, LinearLimit);
+		Instance.SetLinearYLimit(Constraint.LinearYMotion, LinearLimit);
+		Instance.SetLinearZLimit(Constraint.LinearZMotion, LinearLimit);
+
+		Instance.ProfileInstance.AngularDrive = Constraint.AngularDrive;
+		Instance.ProfileInstance.LinearDrive = Constraint.LinearDrive;
+
+		// Disable collision between linked bodies
+		Instance.ProfileInstance.bDisableCollision = true;
+
+		// After the default profile, which every named profile starts from
+		BetterPA::WriteConstraintProfiles(Template, Constraint.Profiles);
+	}
+}
+
+FName BetterPA::MakeStableObjectName(UObject* Outer, const FString& BaseName)
+{
+	const FName BaseFName = SanitizeObjectName(BaseName);
+	FName Name = BaseFName;
+	for (int32 Suffix = 1; StaticFindObjectFast(nullptr, Outer, Name); ++Suffix)
+	{
+		Name = FName(BaseFName, Suffix);
+	}
+	return Name;
+}
+
+SIZE_T BetterPA::GetLastTransactionSize(const FText& Title)
+{
+	if (!GEditor || !GEditor->Trans || GEditor->Trans->GetQueueLength() == 0)
+	{
+		return 0;
+	}
+
+	const FTransaction* Transaction = GEditor->Trans->GetTransaction(GEditor->Trans->GetQueueLength() - 1);
+	return Transaction && Transaction->GetContext().Title.EqualTo(Title) ? Transaction->DataSize() : 0;
+}
+
+void FBetterPAGenerator::GeneratePhysicsAsset(USkeletalMesh* SkeletalMesh, UPhysicsAsset* PhysicsAsset, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings)
 {
 	if (!SkeletalMesh || !PhysicsAsset)
 	{
 		return;
 	}
 
+	// Generation itself only uses animations that are already loaded
+	for (const TSoftObjectPtr<UAnimSequence>& Animation : Settings.PoseAnimations)
+	{
+		Animation.LoadSynchronous();
+	}
+
+	FBetterPAGenerationResult Result;
+	if (Generate(SkeletalMesh, SelectedBones, Settings, Result))
+	{
+		ApplyResultTransacted(PhysicsAsset, Result, LOCTEXT("GeneratePhysicsAsset", "Generate Physics Asset"));
+	}
+}
+
+bool FBetterPAGenerator::Generate(const USkeletalMesh* SkeletalMesh, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings, FBetterPAGenerationResult& OutResult, const FThreadSafeBool* Cancelled)
+{
+	return GenerateInternal(SkeletalMesh, SelectedBones, Settings, nullptr, nullptr, OutResult, Cancelled);
+}
+
+bool FBetterPAGenerator::GenerateIncremental(const USkeletalMesh* SkeletalMesh, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings, const TSet<FName>& DirtyBones, const FBetterPAGenerationResult& Previous, FBetterPAGenerationResult& OutResult, const FThreadSafeBool* Cancelled)
+{
+	return GenerateInternal(SkeletalMesh, SelectedBones, Settings, &DirtyBones, &Previous, OutResult, Cancelled);
+}
+
+bool FBetterPAGenerator::MakeCoarseSettings(const USkeletalMesh* SkeletalMesh, const FBetterPAGenerationSettings& Settings, FBetterPAGenerationSettings& OutCoarseSettings)
+{
+	const bool bReadsVertices = Settings.bOptimizeFit || Settings.ConvexBones.Num() > 0 || (Settings.bClassifyBodies && Settings.MinInfluence > 0.0f);
+	const FSkeletalMeshModel* ImportedModel = SkeletalMesh ? SkeletalMesh->GetImportedModel() : nullptr;
+	if (!bReadsVertices || !ImportedModel || ImportedModel->LODModels.Num() == 0)
+	{
+		return false;
+	}
+
+	OutCoarseSettings = Settings;
+	OutCoarseSettings.LODIndex = ImportedModel->LODModels.Num() - 1;
+	OutCoarseSettings.OptimizerMaxPoints = FMath::Min(Settings.OptimizerMaxPoints, CoarseOptimizerMaxPoints);
+	OutCoarseSettings.OptimizerIterations = FMath::Min(Settings.OptimizerIterations, CoarseOptimizerIterations);
+	OutCoarseSettings.OptimizerRounds = 1;
+	OutCoarseSettings.PoseAnimations.Reset();
+	return true;
+}
+
+bool FBetterPAGenerator::GenerateInternal(const USkeletalMesh* SkeletalMesh, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings, const TSet<FName>* DirtyBones, const FBetterPAGenerationResult* Previous, FBetterPAGenerationResult& OutResult, const FThreadSafeBool* Cancelled)
+{
+	OutResult.Reset();
+
+	// Checked between the stages that read the mesh, a cancelled run leaves nothing behind
+	auto CheckCancelled = [Cancelled, &OutResult]()
+	{
+		if (Cancelled && *Cancelled)
+		{
+			OutResult.Reset();
+			return true;
+		}
+		return false;
+	};
+
+	if (!SkeletalMesh)
+	{
+		return false;
+	}
+
 	const FReferenceSkeleton& RefSkeleton = SkeletalMesh->GetRefSkeleton();
 	const TArray<FMeshBoneInfo>& BoneInfo = RefSkeleton.GetRefBoneInfo();
 	const TArray<FTransform>& BonePose = RefSkeleton.GetRefBonePose();
+	const int32 NumBones = BoneInfo.Num();
 
 	// Calculate all component space transforms once
 	TArray<FTransform> ComponentSpaceTransforms;
 	FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, BonePose, ComponentSpaceTransforms);
 
-	PhysicsAsset->SkeletalBodySetups.Empty();
-	PhysicsAsset->ConstraintSetup.Empty();
+	// Child lists and selection flags, built once so every traversal below stays linear
+	TArray<TArray<int32>> ChildrenIndices;
+	ChildrenIndices.SetNum(NumBones);
+	TBitArray<> IsSelected(false, NumBones);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		if (BoneInfo[i].ParentIndex != INDEX_NONE)
+		{
+			ChildrenIndices[BoneInfo[i].ParentIndex].Add(i);
+		}
+		IsSelected[i] = SelectedBones.Contains(BoneInfo[i].Name);
+	}
+
+	// Chain mode thins every chain to each Nth selected bone before any body is placed
+	TArray<FBetterPABoneChain> Chains;
+	TArray<int32> ChainOfBone;
+	TArray<int32> ChainPositionOfBone;
+	ChainOfBone.Init(INDEX_NONE, NumBones);
+	ChainPositionOfBone.Init(INDEX_NONE, NumBones);
+	if (Settings.bChainMode)
+	{
+		BetterPA::FindBoneChains(RefSkeleton, Settings.ChainMinBones, Chains);
+
+		const int32 Stride = FMath::Max(Settings.ChainBoneStride, 1);
+		for (int32 ChainIndex = 0; ChainIndex < Chains.Num(); ++ChainIndex)
+		{
+			const TArray<int32>& ChainBones = Chains[ChainIndex].Bones;
+			int32 NumSelected = 0;
+			for (int32 Position = 0; Position < ChainBones.Num(); ++Position)
+			{
+				const int32 BoneIndex = ChainBones[Position];
+				ChainOfBone[BoneIndex] = ChainIndex;
+				ChainPositionOfBone[BoneIndex] = Position;
+				if (IsSelected[BoneIndex])
+				{
+					IsSelected[BoneIndex] = (NumSelected++ % Stride) == 0;
+				}
+			}
+		}
+	}
+
+	// Learned proportions replace the length heuristic and default limits for the bones the table knows
+	const FBetterPAShapePriorTable* ShapePriors = Settings.bUseShapePriors ? Settings.ShapePriors.Get() : nullptr;
 
 	// BFS Queue: Store Bone Indices
-	TQueue<int32> BoneQueue;
-	
+	TArray<int32> BoneQueue;
+	BoneQueue.Reserve(NumBones);
+
 	// Start from root (usually index 0)
-	if (BoneInfo.Num() > 0)
+	if (NumBones > 0)
 	{
-		BoneQueue.Enqueue(0);
+		BoneQueue.Add(0);
 	}
 
-	// Map to store created BodySetups by BoneName for constraint generation
-	TMap<FName, USkeletalBodySetup*> CreatedBodySetups;
-	// Map to store Bone Index to created BodySetup
-	TMap<int32, USkeletalBodySetup*> BoneIndexToBodySetup;
+	// Map from bone index to the body created for it
+	TArray<int32> BoneToBody;
+	BoneToBody.Init(INDEX_NONE, NumBones);
+	// Nearest selected ancestor per bone, resolved as the BFS reaches it
+	TArray<int32> SelectedAncestor;
+	SelectedAncestor.Init(INDEX_NONE, NumBones);
 
-	while (!BoneQueue.IsEmpty())
-	{
-		int32 CurrentBoneIndex;
-		BoneQueue.Dequeue(CurrentBoneIndex);
+	TArray<FTransform> BodyBoneTransforms;
+	TArray<FQuat> CapsuleRotations;
+
+	// Chain of each body and its position along it, chain tips end up as spheres
+	TArray<int32> BodyChains;
+	TArray<float> BodyChainFractions;
+	TBitArray<> BodyIsChainTip;
 
-		FName BoneName = BoneInfo[CurrentBoneIndex].Name;
+	// Capsules spanning to a child are placed in one batch after the traversal
+	FBetterPACapsuleFrameBatch CapsuleFrames;
+	TArray<int32> CapsuleFrameBodies;
+	TArray<FVector> CapsuleFrameStarts;
+	TArray<FVector> CapsuleFrameEnds;
+	TArray<float> CapsuleFrameOffsets;
 
-		// Find children
-		TArray<int32> ChildrenIndices;
-		for (int32 i = 0; i < BoneInfo.Num(); ++i)
+	// Align Z axis to Y axis (RightVector) for bodies without a selected child
+	const FQuat LeafRotation = FQuat::FindBetweenNormals(FVector::UpVector, FVector::RightVector);
+
+	for (int32 QueueIndex = 0; QueueIndex < BoneQueue.Num(); ++QueueIndex)
+	{
+		const int32 CurrentBoneIndex = BoneQueue[QueueIndex];
+		const FName BoneName = BoneInfo[CurrentBoneIndex].Name;
+
+		for (int32 ChildIdx : ChildrenIndices[CurrentBoneIndex])
 		{
-			if (BoneInfo[i].ParentIndex == CurrentBoneIndex)
-			{
-				ChildrenIndices.Add(i);
-				BoneQueue.Enqueue(i);
-			}
+			SelectedAncestor[ChildIdx] = IsSelected[CurrentBoneIndex] ? CurrentBoneIndex : SelectedAncestor[CurrentBoneIndex];
+			BoneQueue.Add(ChildIdx);
 		}
 
 		// Skip if not selected
-		if (!SelectedBones.Contains(BoneName))
+		if (!IsSelected[CurrentBoneIndex])
 		{
 			continue;
 		}
 
-		// Create Body Setup
-		USkeletalBodySetup* NewBodySetup = NewObject<USkeletalBodySetup>(PhysicsAsset, NAME_None, RF_Transactional);
-		NewBodySetup->BoneName = BoneName;
-		NewBodySetup->CollisionTraceFlag = CTF_UseSimpleAsComplex;
-		
 		FKSphylElem SphylElem;
-		
+
 		// Use pre-calculated component space transform
-		FTransform CurrentBoneTransform = ComponentSpaceTransforms[CurrentBoneIndex];
-		
-		// Find the nearest selected child (or child of child)
-		int32 TargetChildIndex = INDEX_NONE;
-		
+		const FTransform& CurrentBoneTransform = ComponentSpaceTransforms[CurrentBoneIndex];
+
 		// BFS to find the nearest selected descendant
-		TQueue<int32> SearchQueue;
-		for (int32 ChildIdx : ChildrenIndices)
-		{
-			SearchQueue.Enqueue(ChildIdx);
-		}
-		
-		while(!SearchQueue.IsEmpty())
+		int32 TargetChildIndex = INDEX_NONE;
+		TArray<int32, TInlineAllocator<16>> SearchQueue(ChildrenIndices[CurrentBoneIndex]);
+		for (int32 SearchIndex = 0; SearchIndex < SearchQueue.Num(); ++SearchIndex)
 		{
-			int32 CandidateIndex;
-			SearchQueue.Dequeue(CandidateIndex);
-			
-			if (SelectedBones.Contains(BoneInfo[CandidateIndex].Name))
+			const int32 CandidateIndex = SearchQueue[SearchIndex];
+			if (IsSelected[CandidateIndex])
 			{
 				TargetChildIndex = CandidateIndex;
 				break; // Found one
 			}
-			
+
 			// If not selected, add its children to search
-			for (int32 i = 0; i < BoneInfo.Num(); ++i)
-			{
-				if (BoneInfo[i].ParentIndex == CandidateIndex)
-				{
-					SearchQueue.Enqueue(i);
-				}
-			}
+			SearchQueue.Append(ChildrenIndices[CandidateIndex]);
+		}
+
+		// The last body of a chain spans down to the chain's leaf
+		const int32 ChainIndex = ChainOfBone[CurrentBoneIndex];
+		if (TargetChildIndex == INDEX_NONE && ChainIndex != INDEX_NONE && Chains[ChainIndex].Bones.Last() != CurrentBoneIndex)
+		{
+			TargetChildIndex = Chains[ChainIndex].Bones.Last();
 		}
 
 		FQuat CapsuleRotation = FQuat::Identity;
 
 		if (TargetChildIndex != INDEX_NONE)
 		{
-			FTransform ChildBoneTransform = ComponentSpaceTransforms[TargetChildIndex];
-			
+			const FTransform& ChildBoneTransform = ComponentSpaceTransforms[TargetChildIndex];
+
 			FVector StartPos = CurrentBoneTransform.GetLocation();
 			FVector EndPos = ChildBoneTransform.GetLocation();
-			
-			FVector MidPoint = (StartPos + EndPos) * 0.5f;
 			float Length = FVector::Dist(StartPos, EndPos);
-			
-			// Transform MidPoint to Bone Space
-			FVector LocalMidPoint = CurrentBoneTransform.InverseTransformPosition(MidPoint);
-			
-			// Orientation: Capsule should align with the bone to child vector
-			FVector Direction = (EndPos - StartPos).GetSafeNormal();
-			
-			// Calculate rotation to align Z axis (Capsule axis) with Direction
-			FQuat Rotation = FQuat::FindBetweenNormals(FVector::UpVector, Direction); 
-			
-			// Convert to local rotation relative to bone
-			FQuat LocalRotation = CurrentBoneTransform.GetRotation().Inverse() * Rotation;
-			CapsuleRotation = Rotation; // Store world rotation for constraint
-
-			SphylElem.Center = LocalMidPoint;
-			SphylElem.Rotation = LocalRotation.Rotator();
-			
-			// Radius scales with length: 25cm length -> 3cm radius
-			SphylElem.Radius = (Length / 25.0f) * 3.0f;
-			SphylElem.Length = Length; 
+
+			float RadiusRatio = 0.0f;
+			float LengthRatio = 0.0f;
+			float OffsetRatio = 0.5f;
+			const bool bHasPrior = ShapePriors && ShapePriors->FindShape(BoneName, false, RadiusRatio, LengthRatio, OffsetRatio);
+
+			// Center at OffsetRatio along the bone to child vector, capsule Z axis along it; filled in by the batch below
+			CapsuleFrameBodies.Add(OutResult.Bodies.Num());
+			CapsuleFrameStarts.Add(StartPos);
+			CapsuleFrameEnds.Add(EndPos);
+			CapsuleFrameOffsets.Add(bHasPrior ? OffsetRatio : 0.5f);
+
+			if (bHasPrior)
+			{
+				SphylElem.Radius = FMath::Max(Length * RadiusRatio, BetterPA::MinCapsuleRadius);
+				SphylElem.Length = Length * LengthRatio;
+			}
+			else
+			{
+				// Radius scales with length: 25cm length -> 3cm radius
+				SphylElem.Radius = FMath::Max((Length / 25.0f) * 3.0f, BetterPA::MinCapsuleRadius);
+				SphylElem.Length = Length;
+			}
 		}
 		else
 		{
-			// No selected children: Use parent's length if available, otherwise default
+			// No selected children: Use the distance to the nearest selected parent if available, otherwise default
 			float Length = 5.0f;
-			
-			// Try to find parent length
-			// We need to find the distance from parent to this bone
-			int32 ParentIndex = BoneInfo[CurrentBoneIndex].ParentIndex;
-			// Trace back to find the nearest selected parent
-			while (ParentIndex != INDEX_NONE)
-			{
-				if (SelectedBones.Contains(BoneInfo[ParentIndex].Name))
+
+			const int32 ParentIndex = SelectedAncestor[CurrentBoneIndex];
+			if (ParentIndex != INDEX_NONE)
+			{
+				Length = FVector::Dist(ComponentSpaceTransforms[ParentIndex].GetLocation(), CurrentBoneTransform.GetLocation());
+			}
+
+			SphylElem.Center = FVector::ZeroVector;
+			CapsuleRotation = CurrentBoneTransform.GetRotation() * LeafRotation; // Store world rotation
+			SphylElem.Rotation = LeafRotation.Rotator();
+
+			float RadiusRatio = 0.0f;
+			float LengthRatio = 0.0f;
+			float OffsetRatio = 0.0f;
+			if (ShapePriors && ShapePriors->FindShape(BoneName, true, RadiusRatio, LengthRatio, OffsetRatio))
+			{
+				SphylElem.Radius = FMath::Max(Length * RadiusRatio, BetterPA::MinCapsuleRadius);
+				SphylElem.Length = Length * LengthRatio;
+			}
+			else
+			{
+				SphylElem.Radius = FMath::Max((Length / 25.0f) * 3.0f, BetterPA::MinCapsuleRadius);
+				SphylElem.Length = Length;
+			}
+		}
+
+		if (ChainIndex != INDEX_NONE)
+		{
+			// Thin strand: radius from the span, cylinder shortened so neighbouring chain bodies only touch
+			const float Span = SphylElem.Length;
+			SphylElem.Radius = FMath::Clamp(Span * Settings.ChainRadiusRatio, BetterPA::MinCapsuleRadius, FMath::Max(Settings.ChainMaxRadius, BetterPA::MinCapsuleRadius));
+			SphylElem.Length = FMath::Max(Span - 2.0f * SphylElem.Radius, 0.0f);
+		}
+
+		const int32 BodyIndex = OutResult.Bodies.AddDefaulted();
+		FBetterPABodyResult& Body = OutResult.Bodies[BodyIndex];
+		Body.BoneName = BoneName;
+		Body.BoneIndex = CurrentBoneIndex;
+		Body.ParentBody = SelectedAncestor[CurrentBoneIndex] != INDEX_NONE ? BoneToBody[SelectedAncestor[CurrentBoneIndex]] : INDEX_NONE;
+		Body.AggGeom.SphylElems.Add(SphylElem);
+
+		BoneToBody[CurrentBoneIndex] = BodyIndex;
+		BodyBoneTransforms.Add(CurrentBoneTransform);
+		CapsuleRotations.Add(CapsuleRotation);
+		BodyChains.Add(ChainIndex);
+		BodyChainFractions.Add(ChainIndex != INDEX_NONE ? Chains[ChainIndex].GetFraction(ChainPositionOfBone[CurrentBoneIndex]) : 0.0f);
+		BodyIsChainTip.Add(ChainIndex != INDEX_NONE && TargetChildIndex == INDEX_NONE);
+	}
+
+	CapsuleFrames.SetNum(CapsuleFrameBodies.Num());
+	for (int32 FrameIndex = 0; FrameIndex < CapsuleFrameBodies.Num(); ++FrameIndex)
+	{
+		const int32 BodyIndex = CapsuleFrameBodies[FrameIndex];
+		CapsuleFrames.Set(FrameIndex, BodyBoneTransforms[BodyIndex], CapsuleFrameStarts[FrameIndex], CapsuleFrameEnds[FrameIndex], CapsuleFrameOffsets[FrameIndex]);
+	}
+	CapsuleFrames.Compute();
+
+	for (int32 FrameIndex = 0; FrameIndex < CapsuleFrameBodies.Num(); ++FrameIndex)
+	{
+		const int32 BodyIndex = CapsuleFrameBodies[FrameIndex];
+		FKSphylElem& SphylElem = OutResult.Bodies[BodyIndex].AggGeom.SphylElems[0];
+		FQuat LocalRotation;
+		CapsuleFrames.Get(FrameIndex, SphylElem.Center, LocalRotation, CapsuleRotations[BodyIndex]);
+		SphylElem.Rotation = LocalRotation.Rotator();
+	}
+
+	const int32 NumBodies = OutResult.Bodies.Num();
+
+	// Decide which bodies need fitting. Everything is refitted unless a previous result is given.
+	TBitArray<> RefitBody(true, NumBodies);
+
+	// Previous body whose hulls a convex body keeps, its capsule is still fitted for the joint frame
+	TArray<int32> PreviousHullBody;
+	PreviousHullBody.Init(INDEX_NONE, NumBodies);
+	if (Previous && DirtyBones)
+	{
+		// Affected bones: each toggled bone, its nearest selected ancestor and its whole subtree
+		TBitArray<> AffectedBones(false, NumBones);
+		TBitArray<> ExpandedBones(false, NumBones);
+		TArray<int32> SubtreeStack;
+		for (const FName& DirtyBone : *DirtyBones)
+		{
+			const int32 DirtyIndex = RefSkeleton.FindBoneIndex(DirtyBone);
+			if (DirtyIndex == INDEX_NONE)
+			{
+				continue;
+			}
+
+			if (SelectedAncestor[DirtyIndex] != INDEX_NONE)
+			{
+				AffectedBones[SelectedAncestor[DirtyIndex]] = true;
+			}
+
+			SubtreeStack.Add(DirtyIndex);
+			while (SubtreeStack.Num() > 0)
+			{
+				const int32 BoneIndex = SubtreeStack.Pop();
+				if (!ExpandedBones[BoneIndex])
 				{
-					FTransform ParentTransform = ComponentSpaceTransforms[ParentIndex];
-					Length = FVector::Dist(ParentTransform.GetLocation(), CurrentBoneTransform.GetLocation());
-					break;
+					ExpandedBones[BoneIndex] = true;
+					AffectedBones[BoneIndex] = true;
+					SubtreeStack.Append(ChildrenIndices[BoneIndex]);
 				}
-				ParentIndex = BoneInfo[ParentIndex].ParentIndex;
 			}
+		}
+
+		TMap<FName, int32> PreviousBodies;
+		PreviousBodies.Reserve(Previous->Bodies.Num());
+		for (int32 BodyIndex = 0; BodyIndex < Previous->Bodies.Num(); ++BodyIndex)
+		{
+			PreviousBodies.Add(Previous->Bodies[BodyIndex].BoneName, BodyIndex);
+		}
+
+		for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+		{
+			FBetterPABodyResult& Body = OutResult.Bodies[BodyIndex];
+			const int32* PreviousIndex = PreviousBodies.Find(Body.BoneName);
+			if (PreviousIndex && !AffectedBones[Body.BoneIndex] && Previous->Bodies[*PreviousIndex].AggGeom.SphylElems.Num() > 0)
+			{
+				Body.AggGeom = Previous->Bodies[*PreviousIndex].AggGeom;
+				CapsuleRotations[BodyIndex] = BodyBoneTransforms[BodyIndex].GetRotation() * FQuat(Body.AggGeom.SphylElems[0].Rotation);
+				RefitBody[BodyIndex] = false;
+			}
+			else if (PreviousIndex && !AffectedBones[Body.BoneIndex] && Previous->Bodies[*PreviousIndex].AggGeom.ConvexElems.Num() > 0)
+			{
+				PreviousHullBody[BodyIndex] = *PreviousIndex;
+			}
+		}
+	}
+
+	if (Settings.bOptimizeFit && NumBodies > 0 && RefitBody.Contains(true))
+	{
+		// Only bodies being refitted get vertex buckets, the optimizer keeps the others as they are
+		TArray<int32> VertexBoneToBody;
+		BetterPA::MapBonesToBodies(RefSkeleton, [&](FName BoneName)
+		{
+			const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
+			return BoneIndex != INDEX_NONE ? BoneToBody[BoneIndex] : INDEX_NONE;
+		}, VertexBoneToBody);
+
+		for (int32& BodyIndex : VertexBoneToBody)
+		{
+			if (BodyIndex != INDEX_NONE && !RefitBody[BodyIndex])
+			{
+				BodyIndex = INDEX_NONE;
+			}
+		}
+
+		TArray<const UAnimSequence*> PoseAnimations;
+		for (const TSoftObjectPtr<UAnimSequence>& Animation : Settings.PoseAnimations)
+		{
+			if (const UAnimSequence* LoadedAnimation = Animation.Get())
+			{
+				PoseAnimations.Add(LoadedAnimation);
+			}
+		}
+
+		if (CheckCancelled())
+		{
+			return false;
+		}
+
+		FBetterPAVertexBuckets VertexBuckets;
+		if (PoseAnimations.Num() > 0)
+		{
+			TArray<int32> BodyBoneIndices;
+			BodyBoneIndices.Reserve(NumBodies);
+			for (const FBetterPABodyResult& Body : OutResult.Bodies)
+			{
+				BodyBoneIndices.Add(Body.BoneIndex);
+			}
+
+			FBetterPAPoseSamplingSettings SamplingSettings;
+			SamplingSettings.SamplesPerAnimation = Settings.PoseSamplesPerAnimation;
+			SamplingSettings.LODIndex = Settings.LODIndex;
+			SamplingSettings.MinSkinWeight = Settings.MinSkinWeight;
+			SamplingSettings.MaxPointsPerBody = Settings.OptimizerMaxPoints;
+			FBetterPAPoseSampler::BuildBuckets(SkeletalMesh, PoseAnimations, VertexBoneToBody, BodyBoneIndices, SamplingSettings, VertexBuckets);
+		}
+		else
+		{
+			VertexBuckets.Build(SkeletalMesh, Settings.LODIndex, VertexBoneToBody, BodyBoneTransforms, Settings.MinSkinWeight, Settings.OptimizerMaxPoints);
+			UE_LOG(LogBetterPAGenerator, Verbose, TEXT("Fit points of %s: %lld vertices in %d chunks, peak %llu bytes"),
+				*SkeletalMesh->GetName(), VertexBuckets.StreamStats.NumVertices, VertexBuckets.StreamStats.NumChunks, (uint64)VertexBuckets.StreamStats.PeakBytes);
+		}
+
+		TArray<FKSphylElem> Capsules;
+		TArray<int32> ParentBodies;
+		Capsules.Reserve(NumBodies);
+		ParentBodies.Reserve(NumBodies);
+		for (const FBetterPABodyResult& Body : OutResult.Bodies)
+		{
+			Capsules.Add(Body.AggGeom.SphylElems[0]);
+			ParentBodies.Add(Body.ParentBody);
+		}
+
+		FBetterPAFitOptimizer::Optimize(Capsules, BodyBoneTransforms, ParentBodies, VertexBuckets, Settings, Cancelled);
+		if (CheckCancelled())
+		{
+			return false;
+		}
+
+		for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+		{
+			if (!RefitBody[BodyIndex])
+			{
+				continue;
+			}
+			OutResult.Bodies[BodyIndex].AggGeom.SphylElems[0] = Capsules[BodyIndex];
+			CapsuleRotations[BodyIndex] = BodyBoneTransforms[BodyIndex].GetRotation() * FQuat(Capsules[BodyIndex].Rotation);
+		}
+	}
+
+	// Generate Constraint with Parent
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		const FBetterPABodyResult& Body = OutResult.Bodies[BodyIndex];
+		if (Body.ParentBody != INDEX_NONE)
+		{
+			FBetterPAConstraintResult& Constraint = OutResult.Constraints.AddDefaulted_GetRef();
+			Constraint.ChildBody = BodyIndex;
+			Constraint.ParentBody = Body.ParentBody;
+		}
+	}
+
+	// Joint at the child bone, oriented like the child capsule (component space), relative to the child (Bone1) and the parent (Bone2)
+	FBetterPAJointFrameBatch JointFrames;
+	JointFrames.SetNum(OutResult.Constraints.Num());
+	for (int32 ConstraintIndex = 0; ConstraintIndex < OutResult.Constraints.Num(); ++ConstraintIndex)
+	{
+		const FBetterPAConstraintResult& Constraint = OutResult.Constraints[ConstraintIndex];
+		const FTransform& CurrentBoneTransform = BodyBoneTransforms[Constraint.ChildBody];
+		JointFrames.Set(ConstraintIndex, CurrentBoneTransform, BodyBoneTransforms[Constraint.ParentBody], CurrentBoneTransform.GetLocation(), CapsuleRotations[Constraint.ChildBody]);
+	}
+	JointFrames.Compute();
+
+	for (int32 ConstraintIndex = 0; ConstraintIndex < OutResult.Constraints.Num(); ++ConstraintIndex)
+	{
+		FBetterPAConstraintResult& Constraint = OutResult.Constraints[ConstraintIndex];
+		const int32 BodyIndex = Constraint.ChildBody;
+		const FBetterPABodyResult& Body = OutResult.Bodies[BodyIndex];
+
+		JointFrames.GetFrame1(ConstraintIndex, Constraint.Pos1, Constraint.PriAxis1, Constraint.SecAxis1);
+		JointFrames.GetFrame2(ConstraintIndex, Constraint.Pos2, Constraint.PriAxis2, Constraint.SecAxis2);
+
+		// Strands stay stiff near the scalp or root and loosen towards the tip
+		if (BodyChains[BodyIndex] != INDEX_NONE)
+		{
+			const float SwingLimit = FMath::Lerp(Settings.ChainRootSwingLimit, Settings.ChainTipSwingLimit, BodyChainFractions[BodyIndex]);
+			Constraint.Swing1Limit = SwingLimit;
+			Constraint.Swing2Limit = SwingLimit;
+			Constraint.TwistLimit = Settings.ChainTwistLimit;
+		}
+		else if (ShapePriors)
+		{
+			ShapePriors->FindLimits(Body.BoneName, Constraint.Swing1Limit, Constraint.Swing2Limit, Constraint.TwistLimit);
+		}
+	}
+
+	if (Chains.Num() > 0)
+	{
+		TArray<TArray<int32>> ChainBodies;
+		ChainBodies.SetNum(Chains.Num());
+		for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+		{
+			if (BodyChains[BodyIndex] == INDEX_NONE)
+			{
+				continue;
+			}
+			ChainBodies[BodyChains[BodyIndex]].Add(BodyIndex);
+
+			// Shapes are final here, constraints above still used the capsule axis
+			if (Settings.bChainSpheres || BodyIsChainTip[BodyIndex])
+			{
+				FKAggregateGeom& AggGeom = OutResult.Bodies[BodyIndex].AggGeom;
+				FKSphereElem Sphere(AggGeom.SphylElems[0].Radius);
+				Sphere.Center = AggGeom.SphylElems[0].Center;
+				AggGeom.SphylElems.Reset();
+				AggGeom.SphereElems.Add(Sphere);
+			}
+		}
+
+		// No collision anywhere inside a chain, strands only need to collide with the rest of the body
+		for (const TArray<int32>& Bodies : ChainBodies)
+		{
+			for (int32 First = 0; First < Bodies.Num(); ++First)
+			{
+				for (int32 Second = First + 1; Second < Bodies.Num(); ++Second)
+				{
+					OutResult.DisabledCollisions.Emplace(Bodies[First], Bodies[Second]);
+				}
+			}
+		}
+	}
+
+	if (Settings.ConvexBones.Num() > 0 && NumBodies > 0)
+	{
+		// Convex bodies the change did not reach take their hulls from the previous result, only the others are decomposed
+		TBitArray<> ConvexBodies(false, NumBodies);
+		TBitArray<> DecomposedBodies(false, NumBodies);
+		for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+		{
+			ConvexBodies[BodyIndex] = Settings.ConvexBones.Contains(OutResult.Bodies[BodyIndex].BoneName);
+			DecomposedBodies[BodyIndex] = ConvexBodies[BodyIndex] && PreviousHullBody[BodyIndex] == INDEX_NONE;
+		}
+
+		TArray<TArray<FKConvexElem>> Hulls;
+		Hulls.SetNum(NumBodies);
+		if (DecomposedBodies.Contains(true))
+		{
+			// Reference pose vertices mostly weighted to each convex bone, in the bone's space
+			TArray<int32> ConvexBoneToBody;
+			BetterPA::MapBonesToBodies(RefSkeleton, [&](FName BoneName)
+			{
+				const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
+				return BoneIndex != INDEX_NONE ? BoneToBody[BoneIndex] : INDEX_NONE;
+			}, ConvexBoneToBody);
+
+			for (int32& BodyIndex : ConvexBoneToBody)
+			{
+				if (BodyIndex != INDEX_NONE && !DecomposedBodies[BodyIndex])
+				{
+					BodyIndex = INDEX_NONE;
+				}
+			}
+
+			if (CheckCancelled())
+			{
+				return false;
+			}
+
+			FBetterPAConvexSettings ConvexSettings;
+			ConvexSettings.MaxHulls = Settings.MaxHullsPerBone;
+			ConvexSettings.MaxHullVertices = Settings.MaxHullVertices;
+			ConvexSettings.MaxConcavity = Settings.MaxConcavity;
+
+			FBetterPAVertexBuckets ConvexBuckets;
+			ConvexBuckets.Build(SkeletalMesh, Settings.LODIndex, ConvexBoneToBody, BodyBoneTransforms, Settings.MinSkinWeight, ConvexSettings.MaxPoints);
+
+			FBetterPAConvexDecomposition::DecomposeBodies(ConvexBuckets, DecomposedBodies, ConvexSettings, Hulls);
+		}
+
+		// Bodies without enough vertices keep their capsule
+		for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+		{
+			if (ConvexBodies[BodyIndex] && PreviousHullBody[BodyIndex] != INDEX_NONE)
+			{
+				Hulls[BodyIndex] = Previous->Bodies[PreviousHullBody[BodyIndex]].AggGeom.ConvexElems;
+			}
+			if (ConvexBodies[BodyIndex] && Hulls[BodyIndex].Num() > 0)
+			{
+				FKAggregateGeom& AggGeom = OutResult.Bodies[BodyIndex].AggGeom;
+				AggGeom.SphylElems.Reset();
+				AggGeom.SphereElems.Reset();
+				AggGeom.ConvexElems = MoveTemp(Hulls[BodyIndex]);
+			}
+		}
+	}
+
+	if (Settings.bClassifyBodies && NumBodies > 0)
+	{
+		// Share of the mesh's reference pose vertices each body owns
+		TArray<float> Influence;
+		if (Settings.MinInfluence > 0.0f)
+		{
+			TArray<int32> InfluenceBoneToBody;
+			BetterPA::MapBonesToBodies(RefSkeleton, [&](FName BoneName)
+			{
+				const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
+				return BoneIndex != INDEX_NONE ? BoneToBody[BoneIndex] : INDEX_NONE;
+			}, InfluenceBoneToBody);
+
+			// Only counts are needed, so the vertices are streamed instead of bucketed
+			FBetterPAVertexStreamSettings StreamSettings;
+			StreamSettings.LODIndex = Settings.LODIndex;
+			TArray<FBetterPABodyVertexStats> BodyVertexStats;
+			FBetterPAVertexStreamStats StreamStats;
+			if (BetterPA::GatherBodyVertexStats(SkeletalMesh, StreamSettings, InfluenceBoneToBody, BodyBoneTransforms, Settings.MinSkinWeight, BodyVertexStats, StreamStats) && StreamStats.NumVertices > 0)
+			{
+				Influence.Reserve(NumBodies);
+				for (const FBetterPABodyVertexStats& Stats : BodyVertexStats)
+				{
+					Influence.Add((float)((double)Stats.NumVertices / StreamStats.NumVertices));
+				}
+			}
+			UE_LOG(LogBetterPAGenerator, Verbose, TEXT("Influence of %s: %lld vertices in %d chunks, peak %llu bytes instead of %llu for a copy"),
+				*SkeletalMesh->GetName(), StreamStats.NumVertices, StreamStats.NumChunks, (uint64)StreamStats.PeakBytes, (uint64)StreamStats.CopyBytes);
+		}
+
+		TBitArray<> ChainBodies(false, NumBodies);
+		for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+		{
+			ChainBodies[BodyIndex] = BodyChains[BodyIndex] != INDEX_NONE;
+		}
+
+		FBetterPABodyClassifier::Classify(OutResult, ChainBodies, Influence, Settings);
+	}
+
+	// After classification, which decides which bodies collide at all, and before mass, which depends on the final volumes
+	if (Settings.bResolvePenetration)
+	{
+		FBetterPAPenetrationResolver::Resolve(OutResult, ComponentSpaceTransforms, Settings.PenetrationMargin, OutResult.PenetrationFixes);
+
+		const int32 NumResidual = Algo::CountIf(OutResult.PenetrationFixes, [](const FBetterPAPenetrationFix& Fix) { return Fix.ResidualDepth > 0.0f; });
+		if (NumResidual > 0)
+		{
+			UE_LOG(LogBetterPAGenerator, Warning, TEXT("%s: %d bodies still overlap a body they collide with after penetration resolution, see the residual depth in the generation report"),
+				*SkeletalMesh->GetName(), NumResidual);
+		}
+	}
+
+	// Shapes are final from here on
+	if (Settings.bSweepJointLimits)
+	{
+		TArray<int32> SweptConstraints;
+		for (int32 ConstraintIndex = 0; ConstraintIndex < OutResult.Constraints.Num(); ++ConstraintIndex)
+		{
+			if (BodyChains[OutResult.Constraints[ConstraintIndex].ChildBody] == INDEX_NONE)
+			{
+				SweptConstraints.Add(ConstraintIndex);
+			}
+		}
+
+		FBetterPAJointLimitSettings LimitSettings;
+		LimitSettings.MinLimit = Settings.SweepMinLimit;
+		LimitSettings.MaxSwingLimit = Settings.SweepMaxSwingLimit;
+		LimitSettings.MaxTwistLimit = Settings.SweepMaxTwistLimit;
+		LimitSettings.Tolerance = Settings.SweepTolerance;
+
+		const double SweepStartTime = FPlatformTime::Seconds();
+		const int32 NumTightened = FBetterPAJointLimitSweep::Sweep(OutResult, ComponentSpaceTransforms, SweptConstraints, LimitSettings);
+		UE_LOG(LogBetterPAGenerator, Verbose, TEXT("Joint limits of %s: %d of %d joints limited by geometry in %.1f ms"),
+			*SkeletalMesh->GetName(), NumTightened, SweptConstraints.Num(), (FPlatformTime::Seconds() - SweepStartTime) * 1000.0);
+	}
+
+	if (Settings.bComputeMass)
+	{
+		ComputeMassProperties(OutResult.Bodies, Settings);
+	}
+
+	if (CheckCancelled())
+	{
+		return false;
+	}
+
+	for (const FBetterPAConstraintProfileRule& Rule : Settings.ConstraintProfiles)
+	{
+		if (Rule.Name.IsNone() || OutResult.ConstraintProfileNames.Contains(Rule.Name))
+		{
+			continue;
+		}
+
+		OutResult.ConstraintProfileNames.Add(Rule.Name);
+		for (FBetterPAConstraintResult& Constraint : OutResult.Constraints)
+		{
+			Constraint.Profiles.Add(BetterPA::MakeConstraintProfile(Rule, Constraint.Swing1Limit, Constraint.Swing2Limit, Constraint.TwistLimit));
+		}
+	}
+
+	return true;
+}
+
+FBetterPAApplyStats FBetterPAGenerator::ApplyResult(UPhysicsAsset* PhysicsAsset, const FBetterPAGenerationResult& Result)
+{
+	FBetterPAApplyStats Stats;
+	if (!PhysicsAsset)
+	{
+		return Stats;
+	}
+
+	// The asset snapshot covers the body and constraint arrays and the collision table, objects are only recorded when they change
+	PhysicsAsset->Modify();
+
+	TMap<FName, USkeletalBodySetup*> ExistingBodies;
+	for (USkeletalBodySetup* BodySetup : PhysicsAsset->SkeletalBodySetups)
+	{
+		if (BodySetup)
+		{
+			ExistingBodies.Add(BodySetup->BoneName, BodySetup);
+		}
+	}
+
+	TMap<FBetterPABonePair, UPhysicsConstraintTemplate*> ExistingConstraints;
+	for (UPhysicsConstraintTemplate* Constraint : PhysicsAsset->ConstraintSetup)
+	{
+		if (Constraint)
+		{
+			ExistingConstraints.Add(FBetterPABonePair(Constraint->DefaultInstance.ConstraintBone1, Constraint->DefaultInstance.ConstraintBone2), Constraint);
+		}
+	}
+
+	// Removed objects are only dropped from the arrays, renaming them would snapshot each one
+	PhysicsAsset->SkeletalBodySetups.Reset();
+	PhysicsAsset->ConstraintSetup.Reset();
+	// Keyed by body index, so entries for the old bodies would point at the wrong ones
+	PhysicsAsset->CollisionDisableTable.Empty(Result.DisabledCollisions.Num());
+
+	for (const FBetterPABodyResult& Body : Result.Bodies)
+	{
+		const FString BaseName = TEXT("Body_") + Body.BoneName.ToString();
+		USkeletalBodySetup* BodySetup = nullptr;
+		if (ExistingBodies.RemoveAndCopyValue(Body.BoneName, BodySetup))
+		{
+			if (BodyMatches(*BodySetup, Body))
+			{
+				++Stats.NumUnchanged;
+			}
+			else
+			{
+				BodySetup->Modify();
+				WriteBody(*BodySetup, Body);
+				++Stats.NumChanged;
+			}
+		}
+		else
+		{
+			// A body dropped by an earlier apply still owns the name, bring it back instead of taking a suffixed one
+			BodySetup = FindObjectFast<USkeletalBodySetup>(PhysicsAsset, SanitizeObjectName(BaseName));
+			if (BodySetup && BodySetup->BoneName == Body.BoneName)
+			{
+				if (!BodyMatches(*BodySetup, Body))
+				{
+					BodySetup->Modify();
+					WriteBody(*BodySetup, Body);
+				}
+			}
+			else
+			{
+				BodySetup = NewObject<USkeletalBodySetup>(PhysicsAsset, BetterPA::MakeStableObjectName(PhysicsAsset, BaseName), RF_Transactional);
+				WriteBody(*BodySetup, Body);
+			}
+			++Stats.NumAdded;
+		}
+
+		PhysicsAsset->SkeletalBodySetups.Add(BodySetup);
+	}
+
+	for (const FBetterPAConstraintResult& Constraint : Result.Constraints)
+	{
+		const FName ChildBone = Result.Bodies[Constraint.ChildBody].BoneName;
+		const FName ParentBone = Result.Bodies[Constraint.ParentBody].BoneName;
+		const FString BaseName = FString::Printf(TEXT("Constraint_%s_%s"), *ChildBone.ToString(), *ParentBone.ToString());
+
+		UPhysicsConstraintTemplate* Template = nullptr;
+		if (ExistingConstraints.RemoveAndCopyValue(FBetterPABonePair(ChildBone, ParentBone), Template))
+		{
+			if (ConstraintMatches(*Template, Constraint, ChildBone, ParentBone))
+			{
+				++Stats.NumUnchanged;
+			}
+			else
+			{
+				Template->Modify();
+				WriteConstraint(*Template, Constraint, ChildBone, ParentBone);
+				++Stats.NumChanged;
+			}
+		}
+		else
+		{
+			Template = FindObjectFast<UPhysicsConstraintTemplate>(PhysicsAsset, SanitizeObjectName(BaseName));
+			if (Template && FBetterPABonePair(Template->DefaultInstance.ConstraintBone1, Template->DefaultInstance.ConstraintBone2) == FBetterPABonePair(ChildBone, ParentBone))
+			{
+				if (!ConstraintMatches(*Template, Constraint, ChildBone, ParentBone))
+				{
+					Template->Modify();
+					WriteConstraint(*Template, Constraint, ChildBone, ParentBone);
+				}
+			}
+			else
+			{
+				Template = NewObject<UPhysicsConstraintTemplate>(PhysicsAsset, BetterPA::MakeStableObjectName(PhysicsAsset, BaseName), RF_Transactional);
+				WriteConstraint(*Template, Constraint, ChildBone, ParentBone);
+			}
+			++Stats.NumAdded;
+		}
+
+		PhysicsAsset->ConstraintSetup.Add(Template);
+	}
+
+	Stats.NumRemoved = ExistingBodies.Num() + ExistingConstraints.Num();
+
+	BetterPA::AddConstraintProfileNames(PhysicsAsset, Result.ConstraintProfileNames);
+
+	for (const TPair<int32, int32>& Pair : Result.DisabledCollisions)
+	{
+		PhysicsAsset->DisableCollision(Pair.Key, Pair.Value);
+	}
 
-			SphylElem.Center = FVector::ZeroVector;
-			
-			// Align Z axis to Y axis (RightVector)
-			FQuat Rotation = FQuat::FindBetweenNormals(FVector::UpVector, FVector::RightVector);
-			CapsuleRotation = CurrentBoneTransform.GetRotation() * Rotation; // Store world rotation
-
-			SphylElem.Rotation = Rotation.Rotator();
-			SphylElem.Radius = (Length / 25.0f) * 3.0f;
-			SphylElem.Length = Length;
-		}
-
-		NewBodySetup->AggGeom.SphylElems.Add(SphylElem);
-		PhysicsAsset->SkeletalBodySetups.Add(NewBodySetup);
-		CreatedBodySetups.Add(BoneName, NewBodySetup);
-		BoneIndexToBodySetup.Add(CurrentBoneIndex, NewBodySetup);
-
-		// Generate Constraint with Parent
-		int32 ParentIndex = BoneInfo[CurrentBoneIndex].ParentIndex;
-		FName ParentBoneName = NAME_None;
-		int32 FoundParentIndex = INDEX_NONE;
-		
-		// Find nearest selected parent
-		while (ParentIndex != INDEX_NONE)
-		{
-			if (SelectedBones.Contains(BoneInfo[ParentIndex].Name))
-			{
-				ParentBoneName = BoneInfo[ParentIndex].Name;
-				FoundParentIndex = ParentIndex;
-				break;
-			}
-			ParentIndex = BoneInfo[ParentIndex].ParentIndex;
-		}
-
-		if (CreatedBodySetups.Contains(ParentBoneName))
-		{
-			UPhysicsConstraintTemplate* NewConstraint = NewObject<UPhysicsConstraintTemplate>(PhysicsAsset, NAME_None, RF_Transactional);
-			
-			NewConstraint->DefaultInstance.ConstraintBone1 = BoneName; // Child
-			NewConstraint->DefaultInstance.ConstraintBone2 = ParentBoneName; // Parent
-			
-			// Position at child joint
-			// Pos1 is relative to Child Bone
-			NewConstraint->DefaultInstance.Pos1 = FVector::ZeroVector;
-			
-			// Orientation: Same as child capsule orientation.
-			// CapsuleRotation is in World Space (Component Space).
-			// We need it relative to Child Bone.
-			FQuat RelRot1 = CurrentBoneTransform.GetRotation().Inverse() * CapsuleRotation;
-			NewConstraint->DefaultInstance.PriAxis1 = RelRot1.GetAxisX();
-			NewConstraint->DefaultInstance.SecAxis1 = RelRot1.GetAxisY();
-
-			// Set constraint transform relative to parent bone (Bone2)
-			// Location: Child Bone Location relative to Parent Bone
-			FTransform ParentTransform = ComponentSpaceTransforms[FoundParentIndex];
-			FVector RelPos2 = ParentTransform.InverseTransformPosition(CurrentBoneTransform.GetLocation());
-			NewConstraint->DefaultInstance.Pos2 = RelPos2;
-			
-			// Orientation: Same as child capsule orientation, but relative to Parent Bone.
-			FQuat RelRot2 = ParentTransform.GetRotation().Inverse() * CapsuleRotation;
-			NewConstraint->DefaultInstance.PriAxis2 = RelRot2.GetAxisX();
-			NewConstraint->DefaultInstance.SecAxis2 = RelRot2.GetAxisY();
-
-			// Limits
-			// Angular: Limited 45 degrees
-			NewConstraint->DefaultInstance.SetAngularSwing1Limit(EAngularConstraintMotion::ACM_Limited, 45.0f);
-			NewConstraint->DefaultInstance.SetAngularSwing2Limit(EAngularConstraintMotion::ACM_Limited, 45.0f);
-			NewConstraint->DefaultInstance.SetAngularTwistLimit(EAngularConstraintMotion::ACM_Limited, 45.0f);
-
-			// Linear: Locked
-			NewConstraint->DefaultInstance.SetLinearXLimit(ELinearConstraintMotion::LCM_Locked, 0.0f);
-			NewConstraint->DefaultInstance.SetLinearYLimit(ELinearConstraintMotion::LCM_Locked, 0.0f);
-			NewConstraint->DefaultInstance.SetLinearZLimit(ELinearConstraintMotion::LCM_Locked, 0.0f);
-			
-			// Disable collision between linked bodies
-			NewConstraint->DefaultInstance.ProfileInstance.bDisableCollision = true;
-
-			PhysicsAsset->ConstraintSetup.Add(NewConstraint);
-		}
-	}
-	
 	PhysicsAsset->UpdateBodySetupIndexMap();
 	PhysicsAsset->UpdateBoundsBodiesArray();
 	PhysicsAsset->MarkPackageDirty();
+	return Stats;
 }
+
+FBetterPAApplyStats FBetterPAGenerator::ApplyResultTransacted(UPhysicsAsset* PhysicsAsset, const FBetterPAGenerationResult& Result, const FText& Description)
+{
+	FBetterPAApplyStats Stats;
+	{
+		const FScopedTransaction Transaction(Description);
+		Stats = ApplyResult(PhysicsAsset, Result);
+	}
+	Stats.TransactionBytes = BetterPA::GetLastTransactionSize(Description);
+
+	UE_LOG(LogBetterPAGenerator, Log, TEXT("%s on %s: %d added, %d changed, %d removed, %d unchanged, %llu bytes of undo memory"),
+		*Description.ToString(), *GetNameSafe(PhysicsAsset), Stats.NumAdded, Stats.NumChanged, Stats.NumRemoved, Stats.NumUnchanged, (uint64)Stats.TransactionBytes);
+	return Stats;
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,878 @@
+#include "BetterPAInterchange.h"
+#include "BetterPAGenerator.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "ReferenceSkeleton.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+using namespace BetterPA::Interchange;
+
+static_assert(PLATFORM_LITTLE_ENDIAN, "Interchange records are written and read in place as little-endian");
+static_assert(sizeof(FHeader) == 192, "Interchange header layout changed, bump Version");
+static_assert(sizeof(FBodyRecord) == 44, "Interchange body layout changed, bump Version");
+static_assert(sizeof(FShapeRecord) == 48, "Interchange shape layout changed, bump Version");
+static_assert(sizeof(FHullRecord) == 36, "Interchange hull layout changed, bump Version");
+static_assert(sizeof(FVertexRecord) == 12, "Interchange vertex layout changed, bump Version");
+static_assert(sizeof(FDriveRecord) == 16, "Interchange drive layout changed, bump Version");
+static_assert(sizeof(FConstraintRecord) == 256, "Interchange constraint layout changed, bump Version");
+static_assert(sizeof(FProfileRecord) == 32, "Interchange profile layout changed, bump Version");
+static_assert(sizeof(FPairRecord) == 8, "Interchange pair layout changed, bump Version");
+
+namespace
+{
+	void StoreVector(float (&Out)[3], const FVector& Vector)
+	{
+		Out[0] = (float)Vector.X;
+		Out[1] = (float)Vector.Y;
+		Out[2] = (float)Vector.Z;
+	}
+
+	void StoreRotator(float (&Out)[3], const FRotator& Rotator)
+	{
+		Out[0] = (float)Rotator.Pitch;
+		Out[1] = (float)Rotator.Yaw;
+		Out[2] = (float)Rotator.Roll;
+	}
+
+	FVector LoadVector(const float (&In)[3])
+	{
+		return FVector(In[0], In[1], In[2]);
+	}
+
+	FRotator LoadRotator(const float (&In)[3])
+	{
+		return FRotator(In[0], In[1], In[2]);
+	}
+
+	void StoreDrive(FDriveRecord& Out, const FConstraintDrive& Drive)
+	{
+		Out.Stiffness = Drive.Stiffness;
+		Out.Damping = Drive.Damping;
+		Out.MaxForce = Drive.MaxForce;
+		Out.bPositionDrive = Drive.bEnablePositionDrive ? 1 : 0;
+		Out.bVelocityDrive = Drive.bEnableVelocityDrive ? 1 : 0;
+	}
+
+	void LoadDrive(FConstraintDrive& Out, const FDriveRecord& In)
+	{
+		Out.Stiffness = In.Stiffness;
+		Out.Damping = In.Damping;
+		Out.MaxForce = In.MaxForce;
+		Out.bEnablePositionDrive = In.bPositionDrive != 0;
+		Out.bEnableVelocityDrive = In.bVelocityDrive != 0;
+	}
+
+	EAngularConstraintMotion LoadAngularMotion(uint8 Motion)
+	{
+		return Motion < EAngularConstraintMotion::ACM_MAX ? (EAngularConstraintMotion)Motion : EAngularConstraintMotion::ACM_Limited;
+	}
+
+	ELinearConstraintMotion LoadLinearMotion(uint8 Motion)
+	{
+		return Motion < ELinearConstraintMotion::LCM_MAX ? (ELinearConstraintMotion)Motion : ELinearConstraintMotion::LCM_Locked;
+	}
+
+	// Each name is stored once, bodies and profiles refer to it by index
+	struct FNameTableWriter
+	{
+		TMap<FName, uint32> Indices;
+		TArray<uint32> Offsets;
+		TArray<uint8> Data;
+
+		uint32 Add(FName Name)
+		{
+			if (const uint32* Existing = Indices.Find(Name))
+			{
+				return *Existing;
+			}
+
+			const FTCHARToUTF8 Utf8(*Name.ToString());
+			const uint32 Index = Offsets.Num();
+			Offsets.Add(Data.Num());
+			Data.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+			Indices.Add(Name, Index);
+			return Index;
+		}
+	};
+
+	template <typename RecordType>
+	FSection AppendSection(TArray<uint8>& Data, const TArray<RecordType>& Records)
+	{
+		const int32 Offset = Align(Data.Num(), 8);
+		Data.SetNumZeroed(Offset);
+		Data.Append(reinterpret_cast<const uint8*>(Records.GetData()), Records.Num() * sizeof(RecordType));
+		return FSection{ (uint64)Offset, (uint64)Records.Num() };
+	}
+
+	template <typename RecordType>
+	bool GetSection(TConstArrayView<uint8> Data, const FSection& Section, TConstArrayView<RecordType>& OutRecords)
+	{
+		const uint64 Size = (uint64)Data.Num();
+		if (Section.Offset % 8 != 0 || Section.Offset > Size || Section.Count > (Size - Section.Offset) / sizeof(RecordType) || Section.Count > MAX_int32)
+		{
+			return false;
+		}
+
+		OutRecords = TConstArrayView<RecordType>(reinterpret_cast<const RecordType*>(Data.GetData() + Section.Offset), (int32)Section.Count);
+		return true;
+	}
+
+	bool IsValidRange(uint32 First, uint32 Num, int32 SectionNum)
+	{
+		return (uint64)First + Num <= (uint64)SectionNum;
+	}
+
+	// Sections of a validated file, pointing into the caller's memory
+	struct FInterchangeView
+	{
+		TConstArrayView<FBodyRecord> Bodies;
+		TConstArrayView<FShapeRecord> Shapes;
+		TConstArrayView<FHullRecord> Hulls;
+		TConstArrayView<FVertexRecord> HullVertices;
+		TConstArrayView<FConstraintRecord> Constraints;
+		TConstArrayView<FProfileRecord> Profiles;
+		TConstArrayView<uint32> ProfileNames;
+		TConstArrayView<FPairRecord> DisabledPairs;
+		TConstArrayView<uint32> NameOffsets;
+		TConstArrayView<uint8> NameData;
+		TConstArrayView<uint8> Settings;
+
+		bool Init(TConstArrayView<uint8> Data, FString& OutError)
+		{
+			if (Data.Num() < (int32)sizeof(FHeader) || !IsAligned(Data.GetData(), 8))
+			{
+				OutError = TEXT("File too small or not 8-byte aligned");
+				return false;
+			}
+
+			const FHeader& Header = *reinterpret_cast<const FHeader*>(Data.GetData());
+			if (Header.Magic != Magic)
+			{
+				OutError = TEXT("Not a BetterPA interchange file");
+				return false;
+			}
+			if (Header.Version != Version || Header.HeaderSize != sizeof(FHeader))
+			{
+				OutError = FString::Printf(TEXT("Unsupported interchange version %u"), Header.Version);
+				return false;
+			}
+
+			if (!GetSection(Data, Header.Bodies, Bodies)
+				|| !GetSection(Data, Header.Shapes, Shapes)
+				|| !GetSection(Data, Header.Hulls, Hulls)
+				|| !GetSection(Data, Header.HullVertices, HullVertices)
+				|| !GetSection(Data, Header.Constraints, Constraints)
+				|| !GetSection(Data, Header.Profiles, Profiles)
+				|| !GetSection(Data, Header.ProfileNames, ProfileNames)
+				|| !GetSection(Data, Header.DisabledPairs, DisabledPairs)
+				|| !GetSection(Data, Header.NameOffsets, NameOffsets)
+				|| !GetSection(Data, Header.NameData, NameData)
+				|| !GetSection(Data, Header.Settings, Settings))
+			{
+				OutError = TEXT("Section out of bounds");
+				return false;
+			}
+
+			if (NameOffsets.Num() == 0 || NameOffsets.Last() > (uint32)NameData.Num())
+			{
+				OutError = TEXT("Name table out of bounds");
+				return false;
+			}
+			return true;
+		}
+
+		int32 GetNumNames() const
+		{
+			return NameOffsets.Num() - 1;
+		}
+
+		bool GetName(uint32 Index, FName& OutName) const
+		{
+			if (Index >= (uint32)GetNumNames() || NameOffsets[Index] > NameOffsets[Index + 1])
+			{
+				return false;
+			}
+
+			const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(NameData.GetData() + NameOffsets[Index]), NameOffsets[Index + 1] - NameOffsets[Index]);
+			OutName = FName(Converted.Length(), Converted.Get());
+			return true;
+		}
+
+		FString GetNameString(uint32 Index) const
+		{
+			FName Name;
+			return GetName(Index, Name) ? Name.ToString() : FString::Printf(TEXT("<name %u>"), Index);
+		}
+	};
+
+	FString FormatFloat(float Value)
+	{
+		// Nine significant digits round-trip any float exactly
+		return FString::Printf(TEXT("%.9g"), Value);
+	}
+
+	FString FormatFloats(const float* Values, int32 Num)
+	{
+		FString Text;
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			Text += (Index > 0 ? TEXT(" ") : TEXT("")) + FormatFloat(Values[Index]);
+		}
+		return Text;
+	}
+
+	FString FormatDrive(const FDriveRecord& Drive)
+	{
+		return FString::Printf(TEXT("%s %s %s %u%u"), *FormatFloat(Drive.Stiffness), *FormatFloat(Drive.Damping), *FormatFloat(Drive.MaxForce), Drive.bPositionDrive, Drive.bVelocityDrive);
+	}
+}
+
+void FBetterPAInterchange::Write(const FBetterPAGenerationResult& Result, const FBetterPAGenerationSettings* Settings, TArray<uint8>& OutData)
+{
+	FNameTableWriter Names;
+	TArray<FBodyRecord> Bodies;
+	TArray<FShapeRecord> Shapes;
+	TArray<FHullRecord> Hulls;
+	TArray<FVertexRecord> HullVertices;
+	TArray<FConstraintRecord> Constraints;
+	TArray<FProfileRecord> Profiles;
+	TArray<uint32> ProfileNames;
+	TArray<FPairRecord> DisabledPairs;
+	TArray<uint8> SettingsText;
+
+	Bodies.Reserve(Result.Bodies.Num());
+	for (const FBetterPABodyResult& Body : Result.Bodies)
+	{
+		FBodyRecord& Record = Bodies.AddZeroed_GetRef();
+		Record.Name = Names.Add(Body.BoneName);
+		Record.ParentBody = Body.ParentBody;
+
+		Record.FirstShape = Shapes.Num();
+		for (const FKSphylElem& Sphyl : Body.AggGeom.SphylElems)
+		{
+			FShapeRecord& Shape = Shapes.AddZeroed_GetRef();
+			Shape.Type = (uint8)EShapeType::Sphyl;
+			StoreVector(Shape.Center, Sphyl.Center);
+			StoreRotator(Shape.Rotation, Sphyl.Rotation);
+			Shape.Radius = Sphyl.Radius;
+			Shape.Length = Sphyl.Length;
+		}
+		for (const FKSphereElem& Sphere : Body.AggGeom.SphereElems)
+		{
+			FShapeRecord& Shape = Shapes.AddZeroed_GetRef();
+			Shape.Type = (uint8)EShapeType::Sphere;
+			StoreVector(Shape.Center, Sphere.Center);
+			Shape.Radius = Sphere.Radius;
+		}
+		for (const FKBoxElem& Box : Body.AggGeom.BoxElems)
+		{
+			FShapeRecord& Shape = Shapes.AddZeroed_GetRef();
+			Shape.Type = (uint8)EShapeType::Box;
+			StoreVector(Shape.Center, Box.Center);
+			StoreRotator(Shape.Rotation, Box.Rotation);
+			StoreVector(Shape.Extent, FVector(Box.X, Box.Y, Box.Z));
+		}
+		Record.NumShapes = Shapes.Num() - Record.FirstShape;
+
+		Record.FirstHull = Hulls.Num();
+		for (const FKConvexElem& Convex : Body.AggGeom.ConvexElems)
+		{
+			const FTransform Transform = Convex.GetTransform();
+			const FQuat Rotation = Transform.GetRotation();
+
+			FHullRecord& Hull = Hulls.AddZeroed_GetRef();
+			Hull.FirstVertex = HullVertices.Num();
+			Hull.NumVertices = Convex.VertexData.Num();
+			StoreVector(Hull.Translation, Transform.GetTranslation());
+			Hull.Rotation[0] = (float)Rotation.X;
+			Hull.Rotation[1] = (float)Rotation.Y;
+			Hull.Rotation[2] = (float)Rotation.Z;
+			Hull.Rotation[3] = (float)Rotation.W;
+
+			for (const FVector& Vertex : Convex.VertexData)
+			{
+				StoreVector(HullVertices.AddZeroed_GetRef().Position, Vertex);
+			}
+		}
+		Record.NumHulls = Hulls.Num() - Record.FirstHull;
+
+		Record.Mass = Body.Mass;
+		Record.LinearDamping = Body.LinearDamping;
+		Record.AngularDamping = Body.AngularDamping;
+		Record.SleepThresholdMultiplier = Body.SleepThresholdMultiplier;
+		Record.PhysicsType = (uint8)Body.PhysicsType.GetValue();
+		Record.CollisionEnabled = (uint8)Body.CollisionEnabled.GetValue();
+		Record.Class = (uint8)Body.Class;
+	}
+
+	Constraints.Reserve(Result.Constraints.Num());
+	for (const FBetterPAConstraintResult& Constraint : Result.Constraints)
+	{
+		FConstraintRecord& Record = Constraints.AddZeroed_GetRef();
+		Record.ChildBody = Constraint.ChildBody;
+		Record.ParentBody = Constraint.ParentBody;
+		StoreVector(Record.Pos1, Constraint.Pos1);
+		StoreVector(Record.PriAxis1, Constraint.PriAxis1);
+		StoreVector(Record.SecAxis1, Constraint.SecAxis1);
+		StoreVector(Record.Pos2, Constraint.Pos2);
+		StoreVector(Record.PriAxis2, Constraint.PriAxis2);
+		StoreVector(Record.SecAxis2, Constraint.SecAxis2);
+		Record.Swing1Limit = Constraint.Swing1Limit;
+		Record.Swing2Limit = Constraint.Swing2Limit;
+		Record.TwistLimit = Constraint.TwistLimit;
+		Record.AngularMotion[0] = (uint8)Constraint.Swing1Motion.GetValue();
+		Record.AngularMotion[1] = (uint8)Constraint.Swing2Motion.GetValue();
+		Record.AngularMotion[2] = (uint8)Constraint.TwistMotion.GetValue();
+		Record.LinearMotion[0] = (uint8)Constraint.LinearXMotion.GetValue();
+		Record.LinearMotion[1] = (uint8)Constraint.LinearYMotion.GetValue();
+		Record.LinearMotion[2] = (uint8)Constraint.LinearZMotion.GetValue();
+		Record.LinearLimit = Constraint.LinearLimit;
+
+		const FAngularDriveConstraint& AngularDrive = Constraint.AngularDrive;
+		Record.AngularDriveMode = (uint8)AngularDrive.AngularDriveMode.GetValue();
+		StoreDrive(Record.AngularDrives[0], AngularDrive.SlerpDrive);
+		StoreDrive(Record.AngularDrives[1], AngularDrive.TwistDrive);
+		StoreDrive(Record.AngularDrives[2], AngularDrive.SwingDrive);
+		StoreRotator(Record.OrientationTarget, AngularDrive.OrientationTarget);
+		StoreVector(Record.AngularVelocityTarget, AngularDrive.AngularVelocityTarget);
+
+		const FLinearDriveConstraint& LinearDrive = Constraint.LinearDrive;
+		StoreDrive(Record.LinearDrives[0], LinearDrive.XDrive);
+		StoreDrive(Record.LinearDrives[1], LinearDrive.YDrive);
+		StoreDrive(Record.LinearDrives[2], LinearDrive.ZDrive);
+		StoreVector(Record.PositionTarget, LinearDrive.PositionTarget);
+		StoreVector(Record.VelocityTarget, LinearDrive.VelocityTarget);
+
+		Record.FirstProfile = Profiles.Num();
+		for (const FBetterPAConstraintProfile& Profile : Constraint.Profiles)
+		{
+			FProfileRecord& ProfileRecord = Profiles.AddZeroed_GetRef();
+			ProfileRecord.Name = Names.Add(Profile.Name);
+			ProfileRecord.Swing1Limit = Profile.Swing1Limit;
+			ProfileRecord.Swing2Limit = Profile.Swing2Limit;
+			ProfileRecord.TwistLimit = Profile.TwistLimit;
+			ProfileRecord.LimitStiffness = Profile.LimitStiffness;
+			ProfileRecord.LimitDamping = Profile.LimitDamping;
+			ProfileRecord.DriveStiffness = Profile.DriveStiffness;
+			ProfileRecord.DriveDamping = Profile.DriveDamping;
+		}
+		Record.NumProfiles = Profiles.Num() - Record.FirstProfile;
+	}
+
+	for (FName ProfileName : Result.ConstraintProfileNames)
+	{
+		ProfileNames.Add(Names.Add(ProfileName));
+	}
+
+	for (const TPair<int32, int32>& Pair : Result.DisabledCollisions)
+	{
+		DisabledPairs.Add(FPairRecord{ Pair.Key, Pair.Value });
+	}
+
+	if (Settings)
+	{
+		FString Text;
+		FBetterPAGenerationSettings::StaticStruct()->ExportText(Text, Settings, nullptr, nullptr, PPF_None, nullptr);
+		const FTCHARToUTF8 Utf8(*Text);
+		SettingsText.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+	}
+
+	Names.Offsets.Add(Names.Data.Num());
+
+	FHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.HeaderSize = sizeof(FHeader);
+
+	OutData.Reset();
+	OutData.SetNumZeroed(sizeof(FHeader));
+	Header.Bodies = AppendSection(OutData, Bodies);
+	Header.Shapes = AppendSection(OutData, Shapes);
+	Header.Hulls = AppendSection(OutData, Hulls);
+	Header.HullVertices = AppendSection(OutData, HullVertices);
+	Header.Constraints = AppendSection(OutData, Constraints);
+	Header.Profiles = AppendSection(OutData, Profiles);
+	Header.ProfileNames = AppendSection(OutData, ProfileNames);
+	Header.DisabledPairs = AppendSection(OutData, DisabledPairs);
+	Header.NameOffsets = AppendSection(OutData, Names.Offsets);
+	Header.NameData = AppendSection(OutData, Names.Data);
+	Header.Settings = AppendSection(OutData, SettingsText);
+	FMemory::Memcpy(OutData.GetData(), &Header, sizeof(FHeader));
+}
+
+bool FBetterPAInterchange::Read(TConstArrayView<uint8> Data, const FReferenceSkeleton& RefSkeleton, FBetterPAGenerationResult& OutResult, TOptional<FBetterPAGenerationSettings>* OutSettings, FString& OutError)
+{
+	OutResult.Reset();
+
+	FInterchangeView View;
+	if (!View.Init(Data, OutError))
+	{
+		return false;
+	}
+
+	// New index of each stored body, INDEX_NONE where the skeleton has no such bone
+	const int32 NumBodies = View.Bodies.Num();
+	TArray<int32> BodyMap;
+	BodyMap.Init(INDEX_NONE, NumBodies);
+	OutResult.Bodies.Reserve(NumBodies);
+
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		const FBodyRecord& Record = View.Bodies[BodyIndex];
+		FName BoneName;
+		if (!View.GetName(Record.Name, BoneName)
+			|| !IsValidRange(Record.FirstShape, Record.NumShapes, View.Shapes.Num())
+			|| !IsValidRange(Record.FirstHull, Record.NumHulls, View.Hulls.Num()))
+		{
+			OutError = FString::Printf(TEXT("Body %d out of bounds"), BodyIndex);
+			return false;
+		}
+
+		const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
+		if (BoneIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		BodyMap[BodyIndex] = OutResult.Bodies.Num();
+		FBetterPABodyResult& Body = OutResult.Bodies.AddDefaulted_GetRef();
+		Body.BoneName = BoneName;
+		Body.BoneIndex = BoneIndex;
+		Body.ParentBody = Record.ParentBody;
+
+		for (const FShapeRecord& Shape : View.Shapes.Slice(Record.FirstShape, Record.NumShapes))
+		{
+			switch ((EShapeType)Shape.Type)
+			{
+			case EShapeType::Sphyl:
+			{
+				FKSphylElem& Sphyl = Body.AggGeom.SphylElems.AddDefaulted_GetRef();
+				Sphyl.Center = LoadVector(Shape.Center);
+				Sphyl.Rotation = LoadRotator(Shape.Rotation);
+				Sphyl.Radius = Shape.Radius;
+				Sphyl.Length = Shape.Length;
+				break;
+			}
+			case EShapeType::Sphere:
+			{
+				FKSphereElem& Sphere = Body.AggGeom.SphereElems.AddDefaulted_GetRef();
+				Sphere.Center = LoadVector(Shape.Center);
+				Sphere.Radius = Shape.Radius;
+				break;
+			}
+			case EShapeType::Box:
+			{
+				FKBoxElem& Box = Body.AggGeom.BoxElems.AddDefaulted_GetRef();
+				Box.Center = LoadVector(Shape.Center);
+				Box.Rotation = LoadRotator(Shape.Rotation);
+				Box.X = Shape.Extent[0];
+				Box.Y = Shape.Extent[1];
+				Box.Z = Shape.Extent[2];
+				break;
+			}
+			default:
+				OutError = FString::Printf(TEXT("Unknown shape type %u on body %d"), Shape.Type, BodyIndex);
+				return false;
+			}
+		}
+
+		for (const FHullRecord& Hull : View.Hulls.Slice(Record.FirstHull, Record.NumHulls))
+		{
+			if (!IsValidRange(Hull.FirstVertex, Hull.NumVertices, View.HullVertices.Num()))
+			{
+				OutError = FString::Printf(TEXT("Hull of body %d out of bounds"), BodyIndex);
+				return false;
+			}
+
+			FKConvexElem& Convex = Body.AggGeom.ConvexElems.AddDefaulted_GetRef();
+			Convex.VertexData.Reserve(Hull.NumVertices);
+			for (const FVertexRecord& Vertex : View.HullVertices.Slice(Hull.FirstVertex, Hull.NumVertices))
+			{
+				Convex.VertexData.Add(LoadVector(Vertex.Position));
+			}
+			Convex.SetTransform(FTransform(FQuat(Hull.Rotation[0], Hull.Rotation[1], Hull.Rotation[2], Hull.Rotation[3]), LoadVector(Hull.Translation)));
+			Convex.UpdateElemBox();
+		}
+
+		Body.Mass = Record.Mass;
+		Body.LinearDamping = Record.LinearDamping;
+		Body.AngularDamping = Record.AngularDamping;
+		Body.SleepThresholdMultiplier = Record.SleepThresholdMultiplier;
+		Body.PhysicsType = (EPhysicsType)Record.PhysicsType;
+		Body.CollisionEnabled = (ECollisionEnabled::Type)Record.CollisionEnabled;
+		Body.Class = Record.Class < (uint8)EBetterPABodyClass::Num ? (EBetterPABodyClass)Record.Class : EBetterPABodyClass::Full;
+	}
+
+	// Children of dropped bodies attach to the nearest kept ancestor
+	for (FBetterPABodyResult& Body : OutResult.Bodies)
+	{
+		int32 Parent = Body.ParentBody;
+		for (int32 Step = 0; View.Bodies.IsValidIndex(Parent) && BodyMap[Parent] == INDEX_NONE && Step < NumBodies; ++Step)
+		{
+			Parent = View.Bodies[Parent].ParentBody;
+		}
+		Body.ParentBody = View.Bodies.IsValidIndex(Parent) ? BodyMap[Parent] : INDEX_NONE;
+	}
+
+	OutResult.Constraints.Reserve(View.Constraints.Num());
+	for (const FConstraintRecord& Record : View.Constraints)
+	{
+		if (!IsValidRange(Record.FirstProfile, Record.NumProfiles, View.Profiles.Num()))
+		{
+			OutError = TEXT("Constraint profiles out of bounds");
+			return false;
+		}
+		if (!View.Bodies.IsValidIndex(Record.ChildBody) || !View.Bodies.IsValidIndex(Record.ParentBody)
+			|| BodyMap[Record.ChildBody] == INDEX_NONE || BodyMap[Record.ParentBody] == INDEX_NONE)
+		{
+			continue;
+		}
+
+		FBetterPAConstraintResult& Constraint = OutResult.Constraints.AddDefaulted_GetRef();
+		Constraint.ChildBody = BodyMap[Record.ChildBody];
+		Constraint.ParentBody = BodyMap[Record.ParentBody];
+		Constraint.Pos1 = LoadVector(Record.Pos1);
+		Constraint.PriAxis1 = LoadVector(Record.PriAxis1);
+		Constraint.SecAxis1 = LoadVector(Record.SecAxis1);
+		Constraint.Pos2 = LoadVector(Record.Pos2);
+		Constraint.PriAxis2 = LoadVector(Record.PriAxis2);
+		Constraint.SecAxis2 = LoadVector(Record.SecAxis2);
+		Constraint.Swing1Limit = Record.Swing1Limit;
+		Constraint.Swing2Limit = Record.Swing2Limit;
+		Constraint.TwistLimit = Record.TwistLimit;
+		Constraint.Swing1Motion = LoadAngularMotion(Record.AngularMotion[0]);
+		Constraint.Swing2Motion = LoadAngularMotion(Record.AngularMotion[1]);
+		Constraint.TwistMotion = LoadAngularMotion(Record.AngularMotion[2]);
+		Constraint.LinearXMotion = LoadLinearMotion(Record.LinearMotion[0]);
+		Constraint.LinearYMotion = LoadLinearMotion(Record.LinearMotion[1]);
+		Constraint.LinearZMotion = LoadLinearMotion(Record.LinearMotion[2]);
+		Constraint.LinearLimit = Record.LinearLimit;
+
+		FAngularDriveConstraint& AngularDrive = Constraint.AngularDrive;
+		AngularDrive.AngularDriveMode = Record.AngularDriveMode == EAngularDriveMode::TwistAndSwing ? EAngularDriveMode::TwistAndSwing : EAngularDriveMode::SLERP;
+		LoadDrive(AngularDrive.SlerpDrive, Record.AngularDrives[0]);
+		LoadDrive(AngularDrive.TwistDrive, Record.AngularDrives[1]);
+		LoadDrive(AngularDrive.SwingDrive, Record.AngularDrives[2]);
+		AngularDrive.OrientationTarget = LoadRotator(Record.OrientationTarget);
+		AngularDrive.AngularVelocityTarget = LoadVector(Record.AngularVelocityTarget);
+
+		FLinearDriveConstraint& LinearDrive = Constraint.LinearDrive;
+		LoadDrive(LinearDrive.XDrive, Record.LinearDrives[0]);
+		LoadDrive(LinearDrive.YDrive, Record.LinearDrives[1]);
+		LoadDrive(LinearDrive.ZDrive, Record.LinearDrives[2]);
+		LinearDrive.PositionTarget = LoadVector(Record.PositionTarget);
+		LinearDrive.VelocityTarget = LoadVector(Record.VelocityTarget);
+
+		Constraint.Profiles.Reserve(Record.NumProfiles);
+		for (const FProfileRecord& ProfileRecord : View.Profiles.Slice(Record.FirstProfile, Record.NumProfiles))
+		{
+			FBetterPAConstraintProfile& Profile = Constraint.Profiles.AddDefaulted_GetRef();
+			if (!View.GetName(ProfileRecord.Name, Profile.Name))
+			{
+				OutError = TEXT("Profile name out of bounds");
+				return false;
+			}
+			Profile.Swing1Limit = ProfileRecord.Swing1Limit;
+			Profile.Swing2Limit = ProfileRecord.Swing2Limit;
+			Profile.TwistLimit = ProfileRecord.TwistLimit;
+			Profile.LimitStiffness = ProfileRecord.LimitStiffness;
+			Profile.LimitDamping = ProfileRecord.LimitDamping;
+			Profile.DriveStiffness = ProfileRecord.DriveStiffness;
+			Profile.DriveDamping = ProfileRecord.DriveDamping;
+		}
+	}
+
+	for (uint32 NameIndex : View.ProfileNames)
+	{
+		FName ProfileName;
+		if (!View.GetName(NameIndex, ProfileName))
+		{
+			OutError = TEXT("Profile name out of bounds");
+			return false;
+		}
+		OutResult.ConstraintProfileNames.Add(ProfileName);
+	}
+
+	for (const FPairRecord& Pair : View.DisabledPairs)
+	{
+		if (View.Bodies.IsValidIndex(Pair.BodyA) && View.Bodies.IsValidIndex(Pair.BodyB) && BodyMap[Pair.BodyA] != INDEX_NONE && BodyMap[Pair.BodyB] != INDEX_NONE)
+		{
+			OutResult.DisabledCollisions.Emplace(BodyMap[Pair.BodyA], BodyMap[Pair.BodyB]);
+		}
+	}
+
+	if (OutSettings && View.Settings.Num() > 0)
+	{
+		const FUTF8ToTCHAR Text(reinterpret_cast<const ANSICHAR*>(View.Settings.GetData()), View.Settings.Num());
+		const FString SettingsText(Text.Length(), Text.Get());
+		UScriptStruct* SettingsStruct = FBetterPAGenerationSettings::StaticStruct();
+		if (!SettingsStruct->ImportText(*SettingsText, &OutSettings->Emplace(), nullptr, PPF_None, GLog, SettingsStruct->GetName()))
+		{
+			OutError = TEXT("Could not read the generation settings");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FBetterPAInterchange::ToText(TConstArrayView<uint8> Data, FString& OutText, FString& OutError)
+{
+	FInterchangeView View;
+	if (!View.Init(Data, OutError))
+	{
+		return false;
+	}
+
+	TStringBuilder<4096> Text;
+	Text.Appendf(TEXT("BPAX %u\n"), Version);
+
+	for (int32 BodyIndex = 0; BodyIndex < View.Bodies.Num(); ++BodyIndex)
+	{
+		const FBodyRecord& Record = View.Bodies[BodyIndex];
+		Text.Appendf(TEXT("body %d %s parent %d mass %s damping %s %s sleep %s type %u collision %u class %u\n"),
+			BodyIndex, *View.GetNameString(Record.Name), Record.ParentBody,
+			*FormatFloat(Record.Mass), *FormatFloat(Record.LinearDamping), *FormatFloat(Record.AngularDamping), *FormatFloat(Record.SleepThresholdMultiplier),
+			Record.PhysicsType, Record.CollisionEnabled, Record.Class);
+
+		if (IsValidRange(Record.FirstShape, Record.NumShapes, View.Shapes.Num()))
+		{
+			for (const FShapeRecord& Shape : View.Shapes.Slice(Record.FirstShape, Record.NumShapes))
+			{
+				switch ((EShapeType)Shape.Type)
+				{
+				case EShapeType::Sphyl:
+					Text.Appendf(TEXT("  sphyl center %s rotation %s radius %s length %s\n"), *FormatFloats(Shape.Center, 3), *FormatFloats(Shape.Rotation, 3), *FormatFloat(Shape.Radius), *FormatFloat(Shape.Length));
+					break;
+				case EShapeType::Sphere:
+					Text.Appendf(TEXT("  sphere center %s radius %s\n"), *FormatFloats(Shape.Center, 3), *FormatFloat(Shape.Radius));
+					break;
+				case EShapeType::Box:
+					Text.Appendf(TEXT("  box center %s rotation %s extent %s\n"), *FormatFloats(Shape.Center, 3), *FormatFloats(Shape.Rotation, 3), *FormatFloats(Shape.Extent, 3));
+					break;
+				default:
+					Text.Appendf(TEXT("  shape type %u\n"), Shape.Type);
+					break;
+				}
+			}
+		}
+
+		if (IsValidRange(Record.FirstHull, Record.NumHulls, View.Hulls.Num()))
+		{
+			for (const FHullRecord& Hull : View.Hulls.Slice(Record.FirstHull, Record.NumHulls))
+			{
+				Text.Appendf(TEXT("  hull translation %s rotation %s vertices %u\n"), *FormatFloats(Hull.Translation, 3), *FormatFloats(Hull.Rotation, 4), Hull.NumVertices);
+				if (IsValidRange(Hull.FirstVertex, Hull.NumVertices, View.HullVertices.Num()))
+				{
+					for (const FVertexRecord& Vertex : View.HullVertices.Slice(Hull.FirstVertex, Hull.NumVertices))
+					{
+						Text.Appendf(TEXT("    %s\n"), *FormatFloats(Vertex.Position, 3));
+					}
+				}
+			}
+		}
+	}
+
+	auto GetBodyName = [&View](int32 BodyIndex)
+	{
+		return View.Bodies.IsValidIndex(BodyIndex) ? View.GetNameString(View.Bodies[BodyIndex].Name) : FString::Printf(TEXT("<body %d>"), BodyIndex);
+	};
+
+	for (const FConstraintRecord& Record : View.Constraints)
+	{
+		Text.Appendf(TEXT("constraint %s %s frame1 %s | %s | %s frame2 %s | %s | %s limits %s %s %s\n"),
+			*GetBodyName(Record.ChildBody), *GetBodyName(Record.ParentBody),
+			*FormatFloats(Record.Pos1, 3), *FormatFloats(Record.PriAxis1, 3), *FormatFloats(Record.SecAxis1, 3),
+			*FormatFloats(Record.Pos2, 3), *FormatFloats(Record.PriAxis2, 3), *FormatFloats(Record.SecAxis2, 3),
+			*FormatFloat(Record.Swing1Limit), *FormatFloat(Record.Swing2Limit), *FormatFloat(Record.TwistLimit));
+		Text.Appendf(TEXT("  motion %u %u %u linear %u %u %u limit %s\n"),
+			Record.AngularMotion[0], Record.AngularMotion[1], Record.AngularMotion[2],
+			Record.LinearMotion[0], Record.LinearMotion[1], Record.LinearMotion[2], *FormatFloat(Record.LinearLimit));
+		Text.Appendf(TEXT("  angulardrive mode %u slerp %s twist %s swing %s target %s velocity %s\n"), Record.AngularDriveMode,
+			*FormatDrive(Record.AngularDrives[0]), *FormatDrive(Record.AngularDrives[1]), *FormatDrive(Record.AngularDrives[2]),
+			*FormatFloats(Record.OrientationTarget, 3), *FormatFloats(Record.AngularVelocityTarget, 3));
+		Text.Appendf(TEXT("  lineardrive x %s y %s z %s target %s velocity %s\n"),
+			*FormatDrive(Record.LinearDrives[0]), *FormatDrive(Record.LinearDrives[1]), *FormatDrive(Record.LinearDrives[2]),
+			*FormatFloats(Record.PositionTarget, 3), *FormatFloats(Record.VelocityTarget, 3));
+
+		if (IsValidRange(Record.FirstProfile, Record.NumProfiles, View.Profiles.Num()))
+		{
+			for (const FProfileRecord& Profile : View.Profiles.Slice(Record.FirstProfile, Record.NumProfiles))
+			{
+				Text.Appendf(TEXT("  profile %s limits %s %s %s soft %s %s drive %s %s\n"), *View.GetNameString(Profile.Name),
+					*FormatFloat(Profile.Swing1Limit), *FormatFloat(Profile.Swing2Limit), *FormatFloat(Profile.TwistLimit),
+					*FormatFloat(Profile.LimitStiffness), *FormatFloat(Profile.LimitDamping),
+					*FormatFloat(Profile.DriveStiffness), *FormatFloat(Profile.DriveDamping));
+			}
+		}
+	}
+
+	for (uint32 NameIndex : View.ProfileNames)
+	{
+		Text.Appendf(TEXT("profilename %s\n"), *View.GetNameString(NameIndex));
+	}
+
+	for (const FPairRecord& Pair : View.DisabledPairs)
+	{
+		Text.Appendf(TEXT("disabled %s %s\n"), *GetBodyName(Pair.BodyA), *GetBodyName(Pair.BodyB));
+	}
+
+	if (View.Settings.Num() > 0)
+	{
+		const FUTF8ToTCHAR Settings(reinterpret_cast<const ANSICHAR*>(View.Settings.GetData()), View.Settings.Num());
+		Text.Append(TEXT("settings "));
+		Text.Append(Settings.Get(), Settings.Length());
+		Text.Append(TEXT("\n"));
+	}
+
+	OutText = Text.ToString();
+	return true;
+}
+
+void FBetterPAInterchange::ResultFromAsset(const UPhysicsAsset* PhysicsAsset, FBetterPAGenerationResult& OutResult)
+{
+	OutResult.Reset();
+	if (!PhysicsAsset)
+	{
+		return;
+	}
+
+	// The disable table is keyed by asset body index, which null entries would shift
+	TMap<FName, int32> BodyByBone;
+	TArray<int32> BodyBySetup;
+	BodyBySetup.Init(INDEX_NONE, PhysicsAsset->SkeletalBodySetups.Num());
+	for (int32 SetupIndex = 0; SetupIndex < PhysicsAsset->SkeletalBodySetups.Num(); ++SetupIndex)
+	{
+		const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[SetupIndex];
+		if (!BodySetup)
+		{
+			continue;
+		}
+
+		BodyBySetup[SetupIndex] = OutResult.Bodies.Num();
+
+		BodyByBone.Add(BodySetup->BoneName, OutResult.Bodies.Num());
+		FBetterPABodyResult& Body = OutResult.Bodies.AddDefaulted_GetRef();
+		Body.BoneName = BodySetup->BoneName;
+		Body.AggGeom = BodySetup->AggGeom;
+		Body.PhysicsType = BodySetup->PhysicsType;
+		Body.CollisionEnabled = BodySetup->DefaultInstance.GetCollisionEnabled(false);
+
+		// Damping and sleep are read whether or not the mass is overridden, hand tuned values come back either way
+		const FBodyInstance& BodyInstance = BodySetup->DefaultInstance;
+		Body.Mass = BodyInstance.bOverrideMass ? BodyInstance.GetMassOverride() : 0.0f;
+		Body.LinearDamping = BodyInstance.LinearDamping;
+		Body.AngularDamping = BodyInstance.AngularDamping;
+		Body.SleepThresholdMultiplier = BodyInstance.CustomSleepThresholdMultiplier;
+	}
+
+	for (const UPhysicsConstraintTemplate* Template : PhysicsAsset->ConstraintSetup)
+	{
+		if (!Template)
+		{
+			continue;
+		}
+
+		// Bone1 is the child by asset convention
+		const FConstraintInstance& Instance = Template->DefaultInstance;
+		const int32* ChildBody = BodyByBone.Find(Instance.ConstraintBone1);
+		const int32* ParentBody = BodyByBone.Find(Instance.ConstraintBone2);
+		if (!ChildBody || !ParentBody)
+		{
+			continue;
+		}
+
+		OutResult.Bodies[*ChildBody].ParentBody = *ParentBody;
+
+		FBetterPAConstraintResult& Constraint = OutResult.Constraints.AddDefaulted_GetRef();
+		Constraint.ChildBody = *ChildBody;
+		Constraint.ParentBody = *ParentBody;
+		Constraint.Pos1 = Instance.Pos1;
+		Constraint.PriAxis1 = Instance.PriAxis1;
+		Constraint.SecAxis1 = Instance.SecAxis1;
+		Constraint.Pos2 = Instance.Pos2;
+		Constraint.PriAxis2 = Instance.PriAxis2;
+		Constraint.SecAxis2 = Instance.SecAxis2;
+		Constraint.Swing1Motion = Instance.GetAngularSwing1Motion();
+		Constraint.Swing2Motion = Instance.GetAngularSwing2Motion();
+		Constraint.TwistMotion = Instance.GetAngularTwistMotion();
+		Constraint.LinearXMotion = Instance.GetLinearXMotion();
+		Constraint.LinearYMotion = Instance.GetLinearYMotion();
+		Constraint.LinearZMotion = Instance.GetLinearZMotion();
+
+		// Free and locked axes have no limit, whatever value they hold is not carried over
+		Constraint.Swing1Limit = Constraint.Swing1Motion == EAngularConstraintMotion::ACM_Limited ? Instance.GetAngularSwing1Limit() : 0.0f;
+		Constraint.Swing2Limit = Constraint.Swing2Motion == EAngularConstraintMotion::ACM_Limited ? Instance.GetAngularSwing2Limit() : 0.0f;
+		Constraint.TwistLimit = Constraint.TwistMotion == EAngularConstraintMotion::ACM_Limited ? Instance.GetAngularTwistLimit() : 0.0f;
+		Constraint.LinearLimit = Constraint.HasLimitedLinearAxis() ? Instance.GetLinearLimit() : 0.0f;
+
+		Constraint.AngularDrive = Instance.ProfileInstance.AngularDrive;
+		Constraint.LinearDrive = Instance.ProfileInstance.LinearDrive;
+
+		for (const FPhysicsConstraintProfileHandle& Handle : Template->ProfileHandles)
+		{
+			const FConstraintProfileProperties& Properties = Handle.ProfileProperties;
+			FBetterPAConstraintProfile& Profile = Constraint.Profiles.AddDefaulted_GetRef();
+			Profile.Name = Handle.ProfileName;
+			Profile.Swing1Limit = Properties.ConeLimit.Swing1LimitDegrees;
+			Profile.Swing2Limit = Properties.ConeLimit.Swing2LimitDegrees;
+			Profile.TwistLimit = Properties.TwistLimit.TwistLimitDegrees;
+			Profile.LimitStiffness = Properties.ConeLimit.bSoftConstraint ? Properties.ConeLimit.Stiffness : 0.0f;
+			Profile.LimitDamping = Properties.ConeLimit.bSoftConstraint ? Properties.ConeLimit.Damping : 0.0f;
+			Profile.DriveStiffness = Properties.AngularDrive.SlerpDrive.bEnablePositionDrive ? Properties.AngularDrive.SlerpDrive.Stiffness : 0.0f;
+			Profile.DriveDamping = Properties.AngularDrive.SlerpDrive.bEnableVelocityDrive ? Properties.AngularDrive.SlerpDrive.Damping : 0.0f;
+			OutResult.ConstraintProfileNames.AddUnique(Handle.ProfileName);
+		}
+	}
+
+	for (const TPair<FRigidBodyIndexPair, bool>& Entry : PhysicsAsset->CollisionDisableTable)
+	{
+		if (Entry.Value && BodyBySetup.IsValidIndex(Entry.Key.Indices[0]) && BodyBySetup.IsValidIndex(Entry.Key.Indices[1])
+			&& BodyBySetup[Entry.Key.Indices[0]] != INDEX_NONE && BodyBySetup[Entry.Key.Indices[1]] != INDEX_NONE)
+		{
+			OutResult.DisabledCollisions.Emplace(BodyBySetup[Entry.Key.Indices[0]], BodyBySetup[Entry.Key.Indices[1]]);
+		}
+	}
+
+	// The table is a hash map, sort so the same asset always exports the same bytes
+	OutResult.DisabledCollisions.Sort([](const TPair<int32, int32>& A, const TPair<int32, int32>& B)
+	{
+		return A.Key != B.Key ? A.Key < B.Key : A.Value < B.Value;
+	});
+}
+
+bool FBetterPAInterchange::SaveToFile(const FString& FilePath, const FBetterPAGenerationResult& Result, const FBetterPAGenerationSettings* Settings)
+{
+	TArray<uint8> Data;
+	Write(Result, Settings, Data);
+
+	FString Text;
+	FString Error;
+	return FFileHelper::SaveArrayToFile(Data, *FilePath)
+		&& ToText(Data, Text, Error)
+		&& FFileHelper::SaveStringToFile(Text, *FPaths::ChangeExtension(FilePath, TEXT("txt")), FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+}
+
+bool FBetterPAInterchange::LoadFromFile(const FString& FilePath, const FReferenceSkeleton& RefSkeleton, FBetterPAGenerationResult& OutResult, TOptional<FBetterPAGenerationSettings>* OutSettings, FString& OutError)
+{
+	// Region is declared after the handle so it is unmapped first
+	TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+	TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile ? MappedFile->MapRegion() : nullptr);
+	if (MappedRegion && MappedRegion->GetMappedSize() <= MAX_int32)
+	{
+		return Read(TConstArrayView<uint8>(MappedRegion->GetMappedPtr(), (int32)MappedRegion->GetMappedSize()), RefSkeleton, OutResult, OutSettings, OutError);
+	}
+
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *FilePath))
+	{
+		OutError = FString::Printf(TEXT("Could not read %s"), *FilePath);
+		return false;
+	}
+	return Read(Data, RefSkeleton, OutResult, OutSettings, OutError);
+}
@@ -0,0 +1,269 @@
+#include "BetterPAJointLimits.h"
+#include "BetterPAGenerator.h"
+#include "BetterPAParallel.h"
+
+namespace
+{
+	// Component space segment, A and B coincide for spheres
+	struct FSegment
+	{
+		FVector A = FVector::ZeroVector;
+		FVector B = FVector::ZeroVector;
+		float Radius = 0.0f;
+	};
+
+	struct FNeighbour
+	{
+		TArray<FSegment> Segments;
+
+		// Overlap above which the child counts as penetrating, relative to the reference pose
+		float Threshold = 0.0f;
+	};
+
+	uint64 MakePairKey(int32 A, int32 B)
+	{
+		return ((uint64)(uint32)FMath::Min(A, B) << 32) | (uint32)FMath::Max(A, B);
+	}
+
+	void GatherSegments(const FBetterPABodyResult& Body, const FTransform& BoneTransform, TArray<FSegment>& OutSegments)
+	{
+		for (const FKSphylElem& Elem : Body.AggGeom.SphylElems)
+		{
+			const FTransform ElemTransform = Elem.GetTransform() * BoneTransform;
+			const FVector HalfAxis = ElemTransform.GetUnitAxis(EAxis::Z) * (Elem.Length * 0.5f);
+
+			FSegment& Segment = OutSegments.AddDefaulted_GetRef();
+			Segment.A = ElemTransform.GetLocation() - HalfAxis;
+			Segment.B = ElemTransform.GetLocation() + HalfAxis;
+			Segment.Radius = Elem.Radius;
+		}
+
+		for (const FKSphereElem& Elem : Body.AggGeom.SphereElems)
+		{
+			FSegment& Segment = OutSegments.AddDefaulted_GetRef();
+			Segment.A = BoneTransform.TransformPosition(Elem.Center);
+			Segment.B = Segment.A;
+			Segment.Radius = Elem.Radius;
+		}
+	}
+
+	float GetDepth(const FSegment& First, const FSegment& Second)
+	{
+		FVector ClosestFirst;
+		FVector ClosestSecond;
+		FMath::SegmentDistToSegmentSafe(First.A, First.B, Second.A, Second.B, ClosestFirst, ClosestSecond);
+		return First.Radius + Second.Radius - (float)FVector::Dist(ClosestFirst, ClosestSecond);
+	}
+
+	float GetDepth(TConstArrayView<FSegment> First, TConstArrayView<FSegment> Second)
+	{
+		float Depth = -UE_BIG_NUMBER;
+		for (const FSegment& FirstSegment : First)
+		{
+			for (const FSegment& SecondSegment : Second)
+			{
+				Depth = FMath::Max(Depth, GetDepth(FirstSegment, SecondSegment));
+			}
+		}
+		return Depth;
+	}
+
+	class FJointSweep
+	{
+	public:
+		FJointSweep(TConstArrayView<FSegment> InChild, const FVector& InPivot, TConstArrayView<FNeighbour> InNeighbours, const FBetterPAJointLimitSettings& InSettings)
+			: Child(InChild)
+			, Pivot(InPivot)
+			, Neighbours(InNeighbours)
+			, Settings(InSettings)
+		{
+			Rotated.SetNum(Child.Num());
+		}
+
+		// Largest angle the child turns about Axis, in both directions, before it penetrates a neighbour
+		float FindLimit(const FVector& Axis, float MaxAngle)
+		{
+			if (Neighbours.Num() == 0)
+			{
+				return MaxAngle;
+			}
+			return FMath::Min(FindLimitInDirection(Axis, MaxAngle), FindLimitInDirection(-Axis, MaxAngle));
+		}
+
+	private:
+		float FindLimitInDirection(const FVector& Axis, float MaxAngle)
+		{
+			const int32 CoarseSteps = FMath::Max(Settings.CoarseSteps, 1);
+			const float Step = MaxAngle / CoarseSteps;
+
+			// Step out from the reference pose and stop at the first contact, so a limb that only touches late costs a few tests
+			float FreeAngle = 0.0f;
+			float BlockedAngle = -1.0f;
+			for (int32 StepIndex = 1; StepIndex <= CoarseSteps; ++StepIndex)
+			{
+				const float Angle = Step * StepIndex;
+				if (IsBlocked(Axis, Angle))
+				{
+					BlockedAngle = Angle;
+					break;
+				}
+				FreeAngle = Angle;
+			}
+
+			if (BlockedAngle < 0.0f)
+			{
+				return MaxAngle;
+			}
+
+			for (int32 StepIndex = 0; StepIndex < Settings.BisectionSteps; ++StepIndex)
+			{
+				const float Angle = (FreeAngle + BlockedAngle) * 0.5f;
+				if (IsBlocked(Axis, Angle))
+				{
+					BlockedAngle = Angle;
+				}
+				else
+				{
+					FreeAngle = Angle;
+				}
+			}
+			return FreeAngle;
+		}
+
+		bool IsBlocked(const FVector& Axis, float Angle)
+		{
+			const FQuat Rotation(Axis, FMath::DegreesToRadians(Angle));
+			for (int32 Index = 0; Index < Child.Num(); ++Index)
+			{
+				Rotated[Index].A = Pivot + Rotation.RotateVector(Child[Index].A - Pivot);
+				Rotated[Index].B = Pivot + Rotation.RotateVector(Child[Index].B - Pivot);
+				Rotated[Index].Radius = Child[Index].Radius;
+			}
+
+			for (const FNeighbour& Neighbour : Neighbours)
+			{
+				if (GetDepth(Rotated, Neighbour.Segments) > Neighbour.Threshold)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		TConstArrayView<FSegment> Child;
+		FVector Pivot;
+		TConstArrayView<FNeighbour> Neighbours;
+		const FBetterPAJointLimitSettings& Settings;
+		TArray<FSegment> Rotated;
+	};
+}
+
+int32 FBetterPAJointLimitSweep::Sweep(FBetterPAGenerationResult& Result, const TArray<FTransform>& BoneTransforms, TConstArrayView<int32> ConstraintIndices, const FBetterPAJointLimitSettings& Settings)
+{
+	const int32 NumBodies = Result.Bodies.Num();
+	if (ConstraintIndices.Num() == 0 || NumBodies == 0)
+	{
+		return 0;
+	}
+
+	// Component space shapes of every body, shared by all joints
+	TArray<TArray<FSegment>> BodySegments;
+	TArray<TArray<int32>> ChildBodies;
+	BodySegments.SetNum(NumBodies);
+	ChildBodies.SetNum(NumBodies);
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		const FBetterPABodyResult& Body = Result.Bodies[BodyIndex];
+		if (BoneTransforms.IsValidIndex(Body.BoneIndex))
+		{
+			GatherSegments(Body, BoneTransforms[Body.BoneIndex], BodySegments[BodyIndex]);
+		}
+		if (Body.ParentBody != INDEX_NONE)
+		{
+			ChildBodies[Body.ParentBody].Add(BodyIndex);
+		}
+	}
+
+	// Siblings that never collide cannot push each other's limits
+	TSet<uint64> DisabledPairs;
+	DisabledPairs.Reserve(Result.DisabledCollisions.Num());
+	for (const TPair<int32, int32>& Pair : Result.DisabledCollisions)
+	{
+		DisabledPairs.Add(MakePairKey(Pair.Key, Pair.Value));
+	}
+
+	TArray<uint8> Tightened;
+	Tightened.SetNumZeroed(ConstraintIndices.Num());
+
+	BetterPA::ParallelFor(ConstraintIndices.Num(), [&](int32 Index)
+	{
+		FBetterPAConstraintResult& Constraint = Result.Constraints[ConstraintIndices[Index]];
+		const FBetterPABodyResult& Child = Result.Bodies[Constraint.ChildBody];
+		const TArray<FSegment>& ChildSegments = BodySegments[Constraint.ChildBody];
+		if (ChildSegments.Num() == 0 || !BoneTransforms.IsValidIndex(Child.BoneIndex))
+		{
+			return;
+		}
+
+		const FTransform& ChildTransform = BoneTransforms[Child.BoneIndex];
+		const FVector Pivot = ChildTransform.TransformPosition(Constraint.Pos1);
+		const FVector TwistAxis = ChildTransform.TransformVectorNoScale(Constraint.PriAxis1).GetSafeNormal();
+		const FVector Swing2Axis = ChildTransform.TransformVectorNoScale(Constraint.SecAxis1).GetSafeNormal();
+		const FVector Swing1Axis = (TwistAxis ^ Swing2Axis).GetSafeNormal();
+
+		// Whatever the child covers while turning about the pivot stays inside this sphere
+		float Reach = 0.0f;
+		for (const FSegment& Segment : ChildSegments)
+		{
+			Reach = FMath::Max(Reach, (float)FMath::Max(FVector::Dist(Segment.A, Pivot), FVector::Dist(Segment.B, Pivot)) + Segment.Radius);
+		}
+
+		TArray<int32, TInlineAllocator<8>> Candidates;
+		Candidates.Add(Constraint.ParentBody);
+		for (const int32 Sibling : ChildBodies[Constraint.ParentBody])
+		{
+			if (Sibling != Constraint.ChildBody && !DisabledPairs.Contains(MakePairKey(Sibling, Constraint.ChildBody)))
+			{
+				Candidates.Add(Sibling);
+			}
+		}
+
+		TArray<FNeighbour, TInlineAllocator<8>> Neighbours;
+		for (const int32 Candidate : Candidates)
+		{
+			const TArray<FSegment>& Segments = BodySegments[Candidate];
+			const bool bInReach = Segments.ContainsByPredicate([&](const FSegment& Segment)
+			{
+				return FMath::PointDistToSegment(Pivot, Segment.A, Segment.B) - Segment.Radius < Reach;
+			});
+			if (!bInReach)
+			{
+				continue;
+			}
+
+			// Shapes meeting at the joint already overlap in the reference pose, only overlap beyond that is a contact
+			FNeighbour& Neighbour = Neighbours.AddDefaulted_GetRef();
+			Neighbour.Segments = Segments;
+			Neighbour.Threshold = FMath::Max(GetDepth(ChildSegments, Segments), 0.0f) + Settings.Tolerance;
+		}
+
+		FJointSweep JointSweep(ChildSegments, Pivot, Neighbours, Settings);
+		const float MaxSwing = FMath::Max(Settings.MaxSwingLimit, Settings.MinLimit);
+		const float MaxTwist = FMath::Max(Settings.MaxTwistLimit, Settings.MinLimit);
+		const float Swing1 = JointSweep.FindLimit(Swing1Axis, MaxSwing);
+		const float Swing2 = JointSweep.FindLimit(Swing2Axis, MaxSwing);
+		const float Twist = JointSweep.FindLimit(TwistAxis, MaxTwist);
+
+		Constraint.Swing1Limit = FMath::Clamp(Swing1, Settings.MinLimit, MaxSwing);
+		Constraint.Swing2Limit = FMath::Clamp(Swing2, Settings.MinLimit, MaxSwing);
+		Constraint.TwistLimit = FMath::Clamp(Twist, Settings.MinLimit, MaxTwist);
+		Tightened[Index] = Swing1 < MaxSwing || Swing2 < MaxSwing || Twist < MaxTwist;
+	});
+
+	int32 NumTightened = 0;
+	for (const uint8 bTightened : Tightened)
+	{
+		NumTightened += bTightened;
+	}
+	return NumTightened;
+}
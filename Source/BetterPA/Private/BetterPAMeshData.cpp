@@ -0,0 +1,270 @@
+#include "BetterPAMeshData.h"
+#include "Engine/SkeletalMesh.h"
+#include "ReferenceSkeleton.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "Rendering/SkeletalMeshLODModel.h"
+#include "BetterPAParallel.h"
+#include "Math/RandomStream.h"
+
+void BetterPA::MapBonesToBodies(const FReferenceSkeleton& RefSkeleton, TFunctionRef<int32(FName)> FindBodyIndex, TArray<int32>& OutBoneToBody)
+{
+	const TArray<FMeshBoneInfo>& BoneInfo = RefSkeleton.GetRefBoneInfo();
+	OutBoneToBody.Init(INDEX_NONE, BoneInfo.Num());
+
+	for (int32 BoneIndex = 0; BoneIndex < BoneInfo.Num(); ++BoneIndex)
+	{
+		const int32 BodyIndex = FindBodyIndex(BoneInfo[BoneIndex].Name);
+		if (BodyIndex != INDEX_NONE)
+		{
+			OutBoneToBody[BoneIndex] = BodyIndex;
+		}
+		else if (BoneInfo[BoneIndex].ParentIndex != INDEX_NONE)
+		{
+			// Parent is already resolved
+			OutBoneToBody[BoneIndex] = OutBoneToBody[BoneInfo[BoneIndex].ParentIndex];
+		}
+	}
+}
+
+float BetterPA::AccumulateBodyWeights(const FSkelMeshSection& Section, const FSoftSkinVertex& Vertex, const TArray<int32>& BoneToBody, FBetterPABodyWeights& OutBodyWeights)
+{
+	OutBodyWeights.Reset();
+	float TotalWeight = 0.0f;
+
+	for (int32 InfluenceIndex = 0; InfluenceIndex < MAX_TOTAL_INFLUENCES; ++InfluenceIndex)
+	{
+		const float Weight = (float)Vertex.InfluenceWeights[InfluenceIndex];
+		if (Weight <= 0.0f || !Section.BoneMap.IsValidIndex(Vertex.InfluenceBones[InfluenceIndex]))
+		{
+			continue;
+		}
+
+		TotalWeight += Weight;
+
+		const int32 BoneIndex = Section.BoneMap[Vertex.InfluenceBones[InfluenceIndex]];
+		const int32 BodyIndex = BoneToBody.IsValidIndex(BoneIndex) ? BoneToBody[BoneIndex] : INDEX_NONE;
+		if (BodyIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		TPair<int32, float>* Existing = OutBodyWeights.FindByPredicate([BodyIndex](const TPair<int32, float>& Pair) { return Pair.Key == BodyIndex; });
+		if (Existing)
+		{
+			Existing->Value += Weight;
+		}
+		else
+		{
+			OutBodyWeights.Emplace(BodyIndex, Weight);
+		}
+	}
+
+	return TotalWeight;
+}
+
+bool FBetterPAVertexStream::Run(const USkeletalMesh* SkeletalMesh, const FBetterPAVertexStreamSettings& Settings, SIZE_T SlotBytes,
+	TFunctionRef<void(int32 Slot, const FBetterPAVertexChunk& Chunk)> ProcessChunk, TFunctionRef<void(int32 Slot)> MergeSlot, FBetterPAVertexStreamStats& OutStats)
+{
+	OutStats = FBetterPAVertexStreamStats();
+
+	const FSkeletalMeshModel* ImportedModel = SkeletalMesh ? SkeletalMesh->GetImportedModel() : nullptr;
+	if (!ImportedModel || !ImportedModel->LODModels.IsValidIndex(Settings.LODIndex))
+	{
+		return false;
+	}
+
+	const FSkeletalMeshLODModel& LODModel = ImportedModel->LODModels[Settings.LODIndex];
+	const int32 ChunkSize = FMath::Max(Settings.ChunkSize, 1);
+	const int32 ChunksPerWave = FMath::Max(Settings.ChunksPerWave, 1);
+
+	// Only chunk descriptors are built up front, the vertices stay where they are
+	TArray<FBetterPAVertexChunk> Chunks;
+	for (int32 SectionIndex = 0; SectionIndex < LODModel.Sections.Num(); ++SectionIndex)
+	{
+		const FSkelMeshSection& Section = LODModel.Sections[SectionIndex];
+		if (Section.bDisabled)
+		{
+			continue;
+		}
+
+		const TConstArrayView<FSoftSkinVertex> SectionVertices(Section.SoftVertices);
+		for (int32 FirstVertex = 0; FirstVertex < SectionVertices.Num(); FirstVertex += ChunkSize)
+		{
+			FBetterPAVertexChunk& Chunk = Chunks.AddDefaulted_GetRef();
+			Chunk.Section = &Section;
+			Chunk.SectionIndex = SectionIndex;
+			Chunk.FirstVertex = FirstVertex;
+			Chunk.Vertices = SectionVertices.Slice(FirstVertex, FMath::Min(ChunkSize, SectionVertices.Num() - FirstVertex));
+		}
+		OutStats.NumVertices += SectionVertices.Num();
+	}
+
+	OutStats.NumChunks = Chunks.Num();
+	OutStats.CopyBytes = (SIZE_T)OutStats.NumVertices * sizeof(FSoftSkinVertex);
+	OutStats.PeakBytes = Chunks.GetAllocatedSize() + (SIZE_T)FMath::Min(ChunksPerWave, Chunks.Num()) * SlotBytes;
+
+	for (int32 WaveStart = 0; WaveStart < Chunks.Num(); WaveStart += ChunksPerWave)
+	{
+		const int32 WaveSize = FMath::Min(ChunksPerWave, Chunks.Num() - WaveStart);
+		BetterPA::ParallelFor(WaveSize, [&](int32 Slot)
+		{
+			ProcessChunk(Slot, Chunks[WaveStart + Slot]);
+		});
+
+		for (int32 Slot = 0; Slot < WaveSize; ++Slot)
+		{
+			MergeSlot(Slot);
+		}
+	}
+
+	return true;
+}
+
+bool BetterPA::GatherBodyVertexStats(const USkeletalMesh* SkeletalMesh, const FBetterPAVertexStreamSettings& Settings, const TArray<int32>& BoneToBody, const TArray<FTransform>& BodyBoneTransforms, float MinWeight,
+	TArray<FBetterPABodyVertexStats>& OutBodyStats, FBetterPAVertexStreamStats& OutStreamStats)
+{
+	const int32 NumBodies = BodyBoneTransforms.Num();
+	OutBodyStats.Reset();
+	OutBodyStats.SetNum(NumBodies);
+
+	TArray<TArray<FBetterPABodyVertexStats>> SlotStats;
+	SlotStats.SetNum(FMath::Max(Settings.ChunksPerWave, 1));
+	for (TArray<FBetterPABodyVertexStats>& Stats : SlotStats)
+	{
+		Stats.SetNum(NumBodies);
+	}
+
+	const bool bRead = FBetterPAVertexStream::Run(SkeletalMesh, Settings, NumBodies * sizeof(FBetterPABodyVertexStats),
+		[&](int32 Slot, const FBetterPAVertexChunk& Chunk)
+		{
+			TArray<FBetterPABodyVertexStats>& Stats = SlotStats[Slot];
+			FBetterPABodyWeights BodyWeights;
+			for (const FSoftSkinVertex& Vertex : Chunk.Vertices)
+			{
+				const float TotalWeight = AccumulateBodyWeights(*Chunk.Section, Vertex, BoneToBody, BodyWeights);
+				if (TotalWeight <= 0.0f)
+				{
+					continue;
+				}
+
+				const FVector Position(Vertex.Position);
+				for (const TPair<int32, float>& BodyWeight : BodyWeights)
+				{
+					const float Weight = BodyWeight.Value / TotalWeight;
+					if (Weight >= MinWeight)
+					{
+						Stats[BodyWeight.Key].Add(FVector3f(BodyBoneTransforms[BodyWeight.Key].InverseTransformPosition(Position)), Weight);
+					}
+				}
+			}
+		},
+		[&](int32 Slot)
+		{
+			for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+			{
+				OutBodyStats[BodyIndex].Merge(SlotStats[Slot][BodyIndex]);
+				SlotStats[Slot][BodyIndex] = FBetterPABodyVertexStats();
+			}
+		},
+		OutStreamStats);
+
+	OutStreamStats.PeakBytes += OutBodyStats.GetAllocatedSize() + SlotStats.GetAllocatedSize();
+	return bRead;
+}
+
+bool FBetterPAVertexBuckets::Build(const USkeletalMesh* SkeletalMesh, int32 LODIndex, const TArray<int32>& BoneToBody, const TArray<FTransform>& BodyBoneTransforms, float MinWeight, int32 MaxPointsPerBody)
+{
+	const int32 NumBodies = BodyBoneTransforms.Num();
+	Buckets.Reset();
+	Buckets.SetNum(NumBodies);
+	NumBodyVertices.Init(0, NumBodies);
+	NumSourceVertices = 0;
+
+	// Reservoir state per body, seeded by body index like the pose sampler's
+	const int32 Capacity = MaxPointsPerBody > 0 ? MaxPointsPerBody : MAX_int32;
+	TArray<FRandomStream> Streams;
+	Streams.Reserve(NumBodies);
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		Streams.Emplace(BodyIndex + 1);
+	}
+
+	FBetterPAVertexStreamSettings Settings;
+	Settings.LODIndex = LODIndex;
+
+	// Each slot collects its chunk's points, appended in chunk order so buckets come out as a sequential read would fill them
+	TArray<TArray<FBetterPAPointBucket>> SlotBuckets;
+	SlotBuckets.SetNum(Settings.ChunksPerWave);
+	SIZE_T PeakSlotBytes = 0;
+
+	const bool bRead = FBetterPAVertexStream::Run(SkeletalMesh, Settings, 0,
+		[&](int32 Slot, const FBetterPAVertexChunk& Chunk)
+		{
+			TArray<FBetterPAPointBucket>& ChunkBuckets = SlotBuckets[Slot];
+			ChunkBuckets.SetNum(NumBodies);
+
+			FBetterPABodyWeights BodyWeights;
+			for (const FSoftSkinVertex& Vertex : Chunk.Vertices)
+			{
+				const float TotalWeight = BetterPA::AccumulateBodyWeights(*Chunk.Section, Vertex, BoneToBody, BodyWeights);
+				if (TotalWeight <= 0.0f)
+				{
+					continue;
+				}
+
+				const FVector Position(Vertex.Position);
+				for (const TPair<int32, float>& BodyWeight : BodyWeights)
+				{
+					if (BodyWeight.Value / TotalWeight >= MinWeight)
+					{
+						const FVector LocalPosition = BodyBoneTransforms[BodyWeight.Key].InverseTransformPosition(Position);
+						ChunkBuckets[BodyWeight.Key].Add(FVector3f(LocalPosition));
+					}
+				}
+			}
+		},
+		[&](int32 Slot)
+		{
+			TArray<FBetterPAPointBucket>& ChunkBuckets = SlotBuckets[Slot];
+			SIZE_T SlotBytes = 0;
+			for (int32 BodyIndex = 0; BodyIndex < ChunkBuckets.Num(); ++BodyIndex)
+			{
+				FBetterPAPointBucket& Source = ChunkBuckets[BodyIndex];
+				FBetterPAPointBucket& Target = Buckets[BodyIndex];
+				SlotBytes += Source.X.GetAllocatedSize() * 3;
+
+				int32& Seen = NumBodyVertices[BodyIndex];
+				for (int32 PointIndex = 0; PointIndex < Source.Num(); ++PointIndex)
+				{
+					++Seen;
+					if (Target.Num() < Capacity)
+					{
+						Target.Add(Source.Get(PointIndex));
+						continue;
+					}
+
+					const int64 TargetIndex = (int64)(Streams[BodyIndex].GetFraction() * Seen);
+					if (TargetIndex < Capacity)
+					{
+						Target.X[TargetIndex] = Source.X[PointIndex];
+						Target.Y[TargetIndex] = Source.Y[PointIndex];
+						Target.Z[TargetIndex] = Source.Z[PointIndex];
+					}
+				}
+				Source.Reset();
+			}
+			PeakSlotBytes = FMath::Max(PeakSlotBytes, SlotBytes);
+		},
+		StreamStats);
+
+	NumSourceVertices = (int32)StreamStats.NumVertices;
+
+	// Slot buckets keep their capacity between waves, so every slot may hold the largest chunk's points
+	SIZE_T BucketBytes = 0;
+	for (const FBetterPAPointBucket& Bucket : Buckets)
+	{
+		BucketBytes += Bucket.X.GetAllocatedSize() * 3;
+	}
+	StreamStats.PeakBytes += BucketBytes + PeakSlotBytes * FMath::Min(Settings.ChunksPerWave, StreamStats.NumChunks);
+	return bRead;
+}
@@ -0,0 +1,37 @@
+#include "BetterPAParallel.h"
+#include "Async/ParallelFor.h"
+#include <atomic>
+
+namespace
+{
+	std::atomic<int32> MaxWorkers(0);
+}
+
+void BetterPA::ParallelFor(int32 Num, TFunctionRef<void(int32)> Body)
+{
+	const int32 Cap = MaxWorkers.load();
+	if (Cap == 1)
+	{
+		::ParallelFor(Num, Body, EParallelForFlags::ForceSingleThread);
+		return;
+	}
+
+	// Batches at least Num / Cap indices wide leave at most Cap batches to run at once
+	const int32 MinBatchSize = Cap > 1 ? FMath::DivideAndRoundUp(Num, Cap) : 1;
+	::ParallelFor(TEXT("BetterPA"), Num, MinBatchSize, Body);
+}
+
+int32 BetterPA::GetMaxWorkers()
+{
+	return MaxWorkers.load();
+}
+
+BetterPA::FScopedMaxWorkers::FScopedMaxWorkers(int32 InMaxWorkers)
+	: PreviousMaxWorkers(MaxWorkers.exchange(FMath::Max(InMaxWorkers, 0)))
+{
+}
+
+BetterPA::FScopedMaxWorkers::~FScopedMaxWorkers()
+{
+	MaxWorkers.store(PreviousMaxWorkers);
+}
@@ -0,0 +1,354 @@
+#include "BetterPAPenetrationResolver.h"
+#include "BetterPAGenerator.h"
+
+namespace
+{
+	// Closest point parameters this close to a segment end count as the end cap
+	constexpr float EndCapTolerance = 0.01f;
+
+	// Passes over the contacts before the overlaps that are left are reported
+	constexpr int32 MaxPasses = 8;
+
+	struct FShape
+	{
+		int32 Body = INDEX_NONE;
+		// Index into the body's sphyl or sphere elements
+		int32 Element = INDEX_NONE;
+		bool bSphere = false;
+
+		// Component space segment, A and B coincide for spheres
+		FVector Center = FVector::ZeroVector;
+		FVector Axis = FVector::UpVector;
+		float Length = 0.0f;
+		float Radius = 0.0f;
+
+		// Bone space axis, to move the element's center when a capsule is shortened
+		FVector LocalAxis = FVector::UpVector;
+		FVector LocalCenter = FVector::ZeroVector;
+
+		FVector GetA() const { return Center - Axis * (Length * 0.5f); }
+		FVector GetB() const { return Center + Axis * (Length * 0.5f); }
+
+		FBox GetBounds(float Margin) const
+		{
+			const FVector Extent(Radius + Margin);
+			FBox Bounds(GetA() - Extent, GetA() + Extent);
+			return Bounds + FBox(GetB() - Extent, GetB() + Extent);
+		}
+	};
+
+	uint64 MakePairKey(int32 A, int32 B)
+	{
+		return ((uint64)(uint32)FMath::Min(A, B) << 32) | (uint32)FMath::Max(A, B);
+	}
+
+	// Penetration depth and the closest point parameters along each segment
+	float GetDepth(const FShape& First, const FShape& Second, float Margin, float& OutFirstT, float& OutSecondT)
+	{
+		FVector ClosestFirst;
+		FVector ClosestSecond;
+		FMath::SegmentDistToSegmentSafe(First.GetA(), First.GetB(), Second.GetA(), Second.GetB(), ClosestFirst, ClosestSecond);
+
+		OutFirstT = First.Length > UE_KINDA_SMALL_NUMBER ? (float)((ClosestFirst - First.GetA()) | First.Axis) / First.Length : 0.5f;
+		OutSecondT = Second.Length > UE_KINDA_SMALL_NUMBER ? (float)((ClosestSecond - Second.GetA()) | Second.Axis) / Second.Length : 0.5f;
+		return First.Radius + Second.Radius + Margin - (float)FVector::Dist(ClosestFirst, ClosestSecond);
+	}
+
+	// Moves the end cap at parameter T inwards by Amount, returns false if the capsule is not touching with an end cap or is too short
+	bool ShortenAtEnd(FShape& Shape, float T, float Amount)
+	{
+		if (Shape.bSphere || Shape.Length < Amount || (T > EndCapTolerance && T < 1.0f - EndCapTolerance))
+		{
+			return false;
+		}
+
+		const float Sign = T <= EndCapTolerance ? 1.0f : -1.0f;
+		Shape.Length -= Amount;
+		Shape.Center += Shape.Axis * (Sign * Amount * 0.5f);
+		Shape.LocalCenter += Shape.LocalAxis * (Sign * Amount * 0.5f);
+		return true;
+	}
+}
+
+void FBetterPAPenetrationResolver::Resolve(FBetterPAGenerationResult& Result, const TArray<FTransform>& BoneTransforms, float Margin, TArray<FBetterPAPenetrationFix>& OutFixes)
+{
+	OutFixes.Reset();
+
+	TArray<FShape> Shapes;
+	Shapes.Reserve(Result.Bodies.Num());
+	for (int32 BodyIndex = 0; BodyIndex < Result.Bodies.Num(); ++BodyIndex)
+	{
+		const FBetterPABodyResult& Body = Result.Bodies[BodyIndex];
+		// Bodies without physics collision cannot push each other apart, whatever they overlap
+		if (!BoneTransforms.IsValidIndex(Body.BoneIndex) || Body.AggGeom.ConvexElems.Num() > 0 || !CollisionEnabledHasPhysics(Body.CollisionEnabled))
+		{
+			continue;
+		}
+
+		const FTransform& BoneTransform = BoneTransforms[Body.BoneIndex];
+		for (int32 ElemIndex = 0; ElemIndex < Body.AggGeom.SphylElems.Num(); ++ElemIndex)
+		{
+			const FKSphylElem& Elem = Body.AggGeom.SphylElems[ElemIndex];
+			const FTransform ElemTransform = Elem.GetTransform() * BoneTransform;
+
+			FShape& Shape = Shapes.AddDefaulted_GetRef();
+			Shape.Body = BodyIndex;
+			Shape.Element = ElemIndex;
+			Shape.Center = ElemTransform.GetLocation();
+			Shape.Axis = ElemTransform.GetUnitAxis(EAxis::Z);
+			Shape.Length = Elem.Length;
+			Shape.Radius = Elem.Radius;
+			Shape.LocalAxis = Elem.Rotation.Quaternion().GetAxisZ();
+			Shape.LocalCenter = Elem.Center;
+		}
+		for (int32 ElemIndex = 0; ElemIndex < Body.AggGeom.SphereElems.Num(); ++ElemIndex)
+		{
+			const FKSphereElem& Elem = Body.AggGeom.SphereElems[ElemIndex];
+
+			FShape& Shape = Shapes.AddDefaulted_GetRef();
+			Shape.Body = BodyIndex;
+			Shape.Element = ElemIndex;
+			Shape.bSphere = true;
+			Shape.Center = BoneTransform.TransformPosition(Elem.Center);
+			Shape.Radius = Elem.Radius;
+			Shape.LocalCenter = Elem.Center;
+		}
+	}
+
+	if (Shapes.Num() < 2)
+	{
+		return;
+	}
+
+	// Pairs that never collide: constraint neighbours and explicitly disabled pairs
+	TSet<uint64> IgnoredPairs;
+	IgnoredPairs.Reserve(Result.Constraints.Num() + Result.DisabledCollisions.Num());
+	for (const FBetterPAConstraintResult& Constraint : Result.Constraints)
+	{
+		IgnoredPairs.Add(MakePairKey(Constraint.ChildBody, Constraint.ParentBody));
+	}
+	for (const TPair<int32, int32>& Pair : Result.DisabledCollisions)
+	{
+		IgnoredPairs.Add(MakePairKey(Pair.Key, Pair.Value));
+	}
+
+	// Cells about the size of an average shape keep both the cells per shape and the shapes per cell small
+	double SizeSum = 0.0;
+	for (const FShape& Shape : Shapes)
+	{
+		SizeSum += Shape.GetBounds(Margin).GetSize().GetMax();
+	}
+	const double CellSize = FMath::Max(SizeSum / Shapes.Num(), 1.0);
+
+	TMap<FIntVector, TArray<int32, TInlineAllocator<4>>> Grid;
+	Grid.Reserve(Shapes.Num() * 2);
+	for (int32 ShapeIndex = 0; ShapeIndex < Shapes.Num(); ++ShapeIndex)
+	{
+		const FBox Bounds = Shapes[ShapeIndex].GetBounds(Margin);
+		const FIntVector Min(FMath::FloorToInt(Bounds.Min.X / CellSize), FMath::FloorToInt(Bounds.Min.Y / CellSize), FMath::FloorToInt(Bounds.Min.Z / CellSize));
+		const FIntVector Max(FMath::FloorToInt(Bounds.Max.X / CellSize), FMath::FloorToInt(Bounds.Max.Y / CellSize), FMath::FloorToInt(Bounds.Max.Z / CellSize));
+		for (int32 X = Min.X; X <= Max.X; ++X)
+		{
+			for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+			{
+				for (int32 Z = Min.Z; Z <= Max.Z; ++Z)
+				{
+					Grid.FindOrAdd(FIntVector(X, Y, Z)).Add(ShapeIndex);
+				}
+			}
+		}
+	}
+
+	struct FContact
+	{
+		int32 First;
+		int32 Second;
+		float Depth;
+	};
+
+	TSet<uint64> TestedPairs;
+	TArray<FContact> Contacts;
+	for (const TPair<FIntVector, TArray<int32, TInlineAllocator<4>>>& Cell : Grid)
+	{
+		const TArray<int32, TInlineAllocator<4>>& CellShapes = Cell.Value;
+		for (int32 I = 0; I < CellShapes.Num(); ++I)
+		{
+			for (int32 J = I + 1; J < CellShapes.Num(); ++J)
+			{
+				const FShape& First = Shapes[CellShapes[I]];
+				const FShape& Second = Shapes[CellShapes[J]];
+				bool bAlreadyTested = false;
+				TestedPairs.Add(MakePairKey(CellShapes[I], CellShapes[J]), &bAlreadyTested);
+				if (bAlreadyTested || First.Body == Second.Body || IgnoredPairs.Contains(MakePairKey(First.Body, Second.Body)))
+				{
+					continue;
+				}
+
+				float FirstT;
+				float SecondT;
+				const float Depth = GetDepth(First, Second, Margin, FirstT, SecondT);
+				if (Depth > 0.0f)
+				{
+					Contacts.Add({ CellShapes[I], CellShapes[J], Depth });
+				}
+			}
+		}
+	}
+
+	// Deepest first, later contacts are re-measured since earlier fixes may already have separated them
+	// Fixes only ever shrink shapes, so no pair outside these contacts can start to overlap
+	// Ties broken by shape so the order never depends on how the grid was filled
+	Contacts.Sort([](const FContact& A, const FContact& B)
+	{
+		if (A.Depth != B.Depth)
+		{
+			return A.Depth > B.Depth;
+		}
+		return A.First != B.First ? A.First < B.First : A.Second < B.Second;
+	});
+
+	TArray<float> OriginalRadius;
+	TArray<float> OriginalLength;
+	OriginalRadius.Reserve(Shapes.Num());
+	OriginalLength.Reserve(Shapes.Num());
+	for (const FShape& Shape : Shapes)
+	{
+		OriginalRadius.Add(Shape.Radius);
+		OriginalLength.Add(Shape.Length);
+	}
+
+	TArray<float> ContactDepth;
+	ContactDepth.Init(0.0f, Shapes.Num());
+	TArray<int32> ContactBody;
+	ContactBody.Init(INDEX_NONE, Shapes.Num());
+
+	for (const FContact& Contact : Contacts)
+	{
+		for (const int32 ShapeIndex : { Contact.First, Contact.Second })
+		{
+			if (Contact.Depth > ContactDepth[ShapeIndex])
+			{
+				ContactDepth[ShapeIndex] = Contact.Depth;
+				ContactBody[ShapeIndex] = Shapes[Contact.First == ShapeIndex ? Contact.Second : Contact.First].Body;
+			}
+		}
+	}
+
+	// Repeat until a pass changes nothing, a pair stopped by the radius floor can still be separated by shortening on a later pass
+	for (int32 Pass = 0; Pass < MaxPasses; ++Pass)
+	{
+		bool bChanged = false;
+		for (const FContact& Contact : Contacts)
+		{
+			FShape& First = Shapes[Contact.First];
+			FShape& Second = Shapes[Contact.Second];
+
+			float FirstT;
+			float SecondT;
+			float Depth = GetDepth(First, Second, Margin, FirstT, SecondT);
+			if (Depth <= UE_KINDA_SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			const float FirstRadius = First.Radius;
+			const float SecondRadius = Second.Radius;
+			const float FirstLength = First.Length;
+			const float SecondLength = Second.Length;
+
+			// Relative change of each option: pulling in one end cap, or thinning both shapes
+			// Radii already at the floor cannot give anything, so shortening is the only option left
+			const float ShrinkableRadius = FMath::Max(First.Radius - BetterPA::MinCapsuleRadius, 0.0f) + FMath::Max(Second.Radius - BetterPA::MinCapsuleRadius, 0.0f);
+			const float RadiusSum = First.Radius + Second.Radius;
+			const float FirstShortenCost = First.Length > Depth ? Depth / (First.Length + 2.0f * First.Radius) : MAX_flt;
+			const float SecondShortenCost = Second.Length > Depth ? Depth / (Second.Length + 2.0f * Second.Radius) : MAX_flt;
+			const float RadiusCost = RadiusSum > UE_KINDA_SMALL_NUMBER && ShrinkableRadius > UE_KINDA_SMALL_NUMBER ? Depth / RadiusSum : MAX_flt;
+
+			FShape& Shorter = FirstShortenCost <= SecondShortenCost ? First : Second;
+			const float ShorterT = FirstShortenCost <= SecondShortenCost ? FirstT : SecondT;
+			if (FMath::Min(FirstShortenCost, SecondShortenCost) < RadiusCost && ShortenAtEnd(Shorter, ShorterT, Depth))
+			{
+				Depth = GetDepth(First, Second, Margin, FirstT, SecondT);
+			}
+
+			// Whatever is left comes off the radii, in proportion so thin shapes keep their shape
+			if (Depth > 0.0f && RadiusSum > UE_KINDA_SMALL_NUMBER)
+			{
+				First.Radius = FMath::Max(First.Radius - Depth * First.Radius / RadiusSum, BetterPA::MinCapsuleRadius);
+				Second.Radius = FMath::Max(Second.Radius - Depth * Second.Radius / RadiusSum, BetterPA::MinCapsuleRadius);
+			}
+
+			bChanged |= First.Radius != FirstRadius || Second.Radius != SecondRadius || First.Length != FirstLength || Second.Length != SecondLength;
+		}
+
+		if (!bChanged)
+		{
+			break;
+		}
+	}
+
+	// The radius floor can stop a fix short when neither shape can be shortened, or the pass cap can be reached first
+	TArray<float> ResidualDepth;
+	ResidualDepth.Init(0.0f, Shapes.Num());
+	for (const FContact& Contact : Contacts)
+	{
+		float FirstT;
+		float SecondT;
+		const float Depth = GetDepth(Shapes[Contact.First], Shapes[Contact.Second], Margin, FirstT, SecondT);
+		if (Depth > UE_KINDA_SMALL_NUMBER)
+		{
+			ResidualDepth[Contact.First] = FMath::Max(ResidualDepth[Contact.First], Depth);
+			ResidualDepth[Contact.Second] = FMath::Max(ResidualDepth[Contact.Second], Depth);
+		}
+	}
+
+	// Write back, and report every body with a shape that changed or is still overlapping
+	TMap<int32, int32> FixByBody;
+	for (int32 ShapeIndex = 0; ShapeIndex < Shapes.Num(); ++ShapeIndex)
+	{
+		const FShape& Shape = Shapes[ShapeIndex];
+		const float RadiusChange = Shape.Radius - OriginalRadius[ShapeIndex];
+		const float LengthChange = Shape.Length - OriginalLength[ShapeIndex];
+		if (RadiusChange == 0.0f && LengthChange == 0.0f && ResidualDepth[ShapeIndex] == 0.0f)
+		{
+			continue;
+		}
+
+		FKAggregateGeom& AggGeom = Result.Bodies[Shape.Body].AggGeom;
+		if (Shape.bSphere)
+		{
+			AggGeom.SphereElems[Shape.Element].Radius = Shape.Radius;
+		}
+		else
+		{
+			FKSphylElem& Elem = AggGeom.SphylElems[Shape.Element];
+			Elem.Radius = Shape.Radius;
+			Elem.Length = Shape.Length;
+			Elem.Center = Shape.LocalCenter;
+		}
+
+		// Bodies with several shapes report their largest change and deepest overlap
+		if (const int32* FixIndex = FixByBody.Find(Shape.Body))
+		{
+			FBetterPAPenetrationFix& Fix = OutFixes[*FixIndex];
+			if (ContactDepth[ShapeIndex] > Fix.Depth)
+			{
+				Fix.Depth = ContactDepth[ShapeIndex];
+				Fix.OtherBody = ContactBody[ShapeIndex];
+			}
+			Fix.RadiusChange = FMath::Min(Fix.RadiusChange, RadiusChange);
+			Fix.LengthChange = FMath::Min(Fix.LengthChange, LengthChange);
+			Fix.ResidualDepth = FMath::Max(Fix.ResidualDepth, ResidualDepth[ShapeIndex]);
+			continue;
+		}
+
+		FixByBody.Add(Shape.Body, OutFixes.Num());
+		FBetterPAPenetrationFix& Fix = OutFixes.AddDefaulted_GetRef();
+		Fix.Body = Shape.Body;
+		Fix.OtherBody = ContactBody[ShapeIndex];
+		Fix.Depth = ContactDepth[ShapeIndex];
+		Fix.RadiusChange = RadiusChange;
+		Fix.LengthChange = LengthChange;
+		Fix.ResidualDepth = ResidualDepth[ShapeIndex];
+	}
+}
@@ -0,0 +1,293 @@
+#include "BetterPAPoseSampler.h"
+#include "BetterPAMeshData.h"
+#include "BetterPAParallel.h"
+#include "Engine/SkeletalMesh.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/Skeleton.h"
+#include "ReferenceSkeleton.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "Rendering/SkeletalMeshLODModel.h"
+#include "AnimationRuntime.h"
+
+namespace
+{
+	// Vertices of one body influenced by a single bone, padded to a multiple of four with zero weights
+	struct FInfluenceBucket
+	{
+		int32 BoneIndex = INDEX_NONE;
+
+		// Component space reference pose positions
+		FBetterPAPointBucket Positions;
+		TArray<float> Weights;
+
+		// Index of the vertex within the body
+		TArray<int32> Vertices;
+	};
+
+	struct FBodySkin
+	{
+		int32 NumVertices = 0;
+		TArray<FInfluenceBucket> Influences;
+	};
+
+	void BuildBodySkins(const FSkeletalMeshLODModel& LODModel, const TArray<int32>& BoneToBody, int32 NumBodies, float MinWeight, TArray<FBodySkin>& OutSkins, int32& OutNumSourceVertices)
+	{
+		OutSkins.SetNum(NumBodies);
+		OutNumSourceVertices = 0;
+
+		// Influence bucket of each bone, per body
+		TArray<TMap<int32, int32>> BucketOfBone;
+		BucketOfBone.SetNum(NumBodies);
+
+		for (const FSkelMeshSection& Section : LODModel.Sections)
+		{
+			if (Section.bDisabled)
+			{
+				continue;
+			}
+
+			for (const FSoftSkinVertex& Vertex : Section.SoftVertices)
+			{
+				++OutNumSourceVertices;
+
+				FBetterPABodyWeights BodyWeights;
+				const float TotalWeight = BetterPA::AccumulateBodyWeights(Section, Vertex, BoneToBody, BodyWeights);
+				if (TotalWeight <= 0.0f)
+				{
+					continue;
+				}
+
+				for (const TPair<int32, float>& BodyWeight : BodyWeights)
+				{
+					if (BodyWeight.Value / TotalWeight < MinWeight)
+					{
+						continue;
+					}
+
+					FBodySkin& Skin = OutSkins[BodyWeight.Key];
+					const int32 BodyVertex = Skin.NumVertices++;
+
+					// Skinning uses every influence, including bones that belong to other bodies
+					for (int32 InfluenceIndex = 0; InfluenceIndex < MAX_TOTAL_INFLUENCES; ++InfluenceIndex)
+					{
+						const float Weight = (float)Vertex.InfluenceWeights[InfluenceIndex];
+						if (Weight <= 0.0f || !Section.BoneMap.IsValidIndex(Vertex.InfluenceBones[InfluenceIndex]))
+						{
+							continue;
+						}
+
+						const int32 BoneIndex = Section.BoneMap[Vertex.InfluenceBones[InfluenceIndex]];
+						int32& BucketIndex = BucketOfBone[BodyWeight.Key].FindOrAdd(BoneIndex, INDEX_NONE);
+						if (BucketIndex == INDEX_NONE)
+						{
+							BucketIndex = Skin.Influences.AddDefaulted();
+							Skin.Influences[BucketIndex].BoneIndex = BoneIndex;
+						}
+
+						FInfluenceBucket& Bucket = Skin.Influences[BucketIndex];
+						Bucket.Positions.Add(Vertex.Position);
+						Bucket.Weights.Add(Weight / TotalWeight);
+						Bucket.Vertices.Add(BodyVertex);
+					}
+				}
+			}
+		}
+
+		for (FBodySkin& Skin : OutSkins)
+		{
+			for (FInfluenceBucket& Bucket : Skin.Influences)
+			{
+				while (Bucket.Weights.Num() % 4 != 0)
+				{
+					Bucket.Positions.Add(FVector3f::ZeroVector);
+					Bucket.Weights.Add(0.0f);
+					Bucket.Vertices.Add(0);
+				}
+			}
+		}
+	}
+
+	// Linear blend skinning of one body's vertices straight into the space of the body's bone
+	void SkinBody(const FBodySkin& Skin, const TArray<FTransform>& SkinTransforms, const FTransform& InverseBodyTransform, TArray<float>& OutX, TArray<float>& OutY, TArray<float>& OutZ)
+	{
+		OutX.SetNumZeroed(Skin.NumVertices);
+		OutY.SetNumZeroed(Skin.NumVertices);
+		OutZ.SetNumZeroed(Skin.NumVertices);
+
+		for (const FInfluenceBucket& Bucket : Skin.Influences)
+		{
+			const FMatrix44f M((SkinTransforms[Bucket.BoneIndex] * InverseBodyTransform).ToMatrixWithScale());
+			const VectorRegister4Float M00 = VectorSetFloat1(M.M[0][0]);
+			const VectorRegister4Float M01 = VectorSetFloat1(M.M[0][1]);
+			const VectorRegister4Float M02 = VectorSetFloat1(M.M[0][2]);
+			const VectorRegister4Float M10 = VectorSetFloat1(M.M[1][0]);
+			const VectorRegister4Float M11 = VectorSetFloat1(M.M[1][1]);
+			const VectorRegister4Float M12 = VectorSetFloat1(M.M[1][2]);
+			const VectorRegister4Float M20 = VectorSetFloat1(M.M[2][0]);
+			const VectorRegister4Float M21 = VectorSetFloat1(M.M[2][1]);
+			const VectorRegister4Float M22 = VectorSetFloat1(M.M[2][2]);
+			const VectorRegister4Float M30 = VectorSetFloat1(M.M[3][0]);
+			const VectorRegister4Float M31 = VectorSetFloat1(M.M[3][1]);
+			const VectorRegister4Float M32 = VectorSetFloat1(M.M[3][2]);
+
+			const float* X = Bucket.Positions.X.GetData();
+			const float* Y = Bucket.Positions.Y.GetData();
+			const float* Z = Bucket.Positions.Z.GetData();
+			const float* W = Bucket.Weights.GetData();
+			const int32* Vertices = Bucket.Vertices.GetData();
+
+			alignas(16) float WX[4];
+			alignas(16) float WY[4];
+			alignas(16) float WZ[4];
+
+			// Buckets are padded, padding carries zero weight
+			for (int32 Index = 0; Index < Bucket.Weights.Num(); Index += 4)
+			{
+				const VectorRegister4Float PX = VectorLoad(X + Index);
+				const VectorRegister4Float PY = VectorLoad(Y + Index);
+				const VectorRegister4Float PZ = VectorLoad(Z + Index);
+				const VectorRegister4Float PW = VectorLoad(W + Index);
+
+				const VectorRegister4Float TX = VectorMultiplyAdd(PZ, M20, VectorMultiplyAdd(PY, M10, VectorMultiplyAdd(PX, M00, M30)));
+				const VectorRegister4Float TY = VectorMultiplyAdd(PZ, M21, VectorMultiplyAdd(PY, M11, VectorMultiplyAdd(PX, M01, M31)));
+				const VectorRegister4Float TZ = VectorMultiplyAdd(PZ, M22, VectorMultiplyAdd(PY, M12, VectorMultiplyAdd(PX, M02, M32)));
+
+				VectorStoreAligned(VectorMultiply(TX, PW), WX);
+				VectorStoreAligned(VectorMultiply(TY, PW), WY);
+				VectorStoreAligned(VectorMultiply(TZ, PW), WZ);
+
+				for (int32 Lane = 0; Lane < 4; ++Lane)
+				{
+					const int32 Vertex = Vertices[Index + Lane];
+					OutX[Vertex] += WX[Lane];
+					OutY[Vertex] += WY[Lane];
+					OutZ[Vertex] += WZ[Lane];
+				}
+			}
+		}
+	}
+}
+
+bool FBetterPAPoseSampler::BuildBuckets(const USkeletalMesh* SkeletalMesh, TConstArrayView<const UAnimSequence*> Animations, const TArray<int32>& BoneToBody, const TArray<int32>& BodyBoneIndices, const FBetterPAPoseSamplingSettings& Settings, FBetterPAVertexBuckets& OutBuckets)
+{
+	const int32 NumBodies = BodyBoneIndices.Num();
+	OutBuckets.Buckets.Reset();
+	OutBuckets.Buckets.SetNum(NumBodies);
+	OutBuckets.NumSourceVertices = 0;
+
+	const FSkeletalMeshModel* ImportedModel = SkeletalMesh ? SkeletalMesh->GetImportedModel() : nullptr;
+	if (!ImportedModel || !ImportedModel->LODModels.IsValidIndex(Settings.LODIndex))
+	{
+		return false;
+	}
+
+	TArray<FBodySkin> Skins;
+	BuildBodySkins(ImportedModel->LODModels[Settings.LODIndex], BoneToBody, NumBodies, Settings.MinSkinWeight, Skins, OutBuckets.NumSourceVertices);
+
+	const FReferenceSkeleton& RefSkeleton = SkeletalMesh->GetRefSkeleton();
+	const TArray<FTransform>& RefBonePose = RefSkeleton.GetRefBonePose();
+	const int32 NumBones = RefBonePose.Num();
+	const USkeleton* Skeleton = SkeletalMesh->GetSkeleton();
+
+	TArray<FTransform> InverseRefTransforms;
+	FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, RefBonePose, InverseRefTransforms);
+	for (FTransform& Transform : InverseRefTransforms)
+	{
+		Transform = Transform.Inverse();
+	}
+
+	// Reference pose first, then evenly spaced frames of every animation on the mesh's skeleton
+	TArray<TPair<const UAnimSequence*, double>> Frames;
+	Frames.Emplace(nullptr, 0.0);
+	for (const UAnimSequence* Animation : Animations)
+	{
+		if (!Animation || Animation->GetSkeleton() != Skeleton)
+		{
+			continue;
+		}
+
+		const int32 NumSamples = FMath::Max(1, Settings.SamplesPerAnimation);
+		const double PlayLength = Animation->GetPlayLength();
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			Frames.Emplace(Animation, NumSamples > 1 ? PlayLength * Sample / (NumSamples - 1) : 0.0);
+		}
+	}
+
+	// Reservoir state per body, seeded by body index so results do not depend on scheduling
+	const int32 Capacity = FMath::Max(1, Settings.MaxPointsPerBody);
+	TArray<int64> PointsSeen;
+	PointsSeen.Init(0, NumBodies);
+	TArray<FRandomStream> Streams;
+	Streams.Reserve(NumBodies);
+	for (int32 BodyIndex = 0; BodyIndex < NumBodies; ++BodyIndex)
+	{
+		Streams.Emplace(BodyIndex + 1);
+		OutBuckets.Buckets[BodyIndex].Reserve(FMath::Min(Capacity, Skins[BodyIndex].NumVertices * Frames.Num()));
+	}
+
+	TArray<FTransform> LocalPose;
+	TArray<FTransform> ComponentPose;
+	TArray<FTransform> SkinTransforms;
+	SkinTransforms.SetNum(NumBones);
+
+	for (const TPair<const UAnimSequence*, double>& Frame : Frames)
+	{
+		LocalPose = RefBonePose;
+		if (Frame.Key)
+		{
+			const FAnimExtractContext ExtractionContext(Frame.Value);
+			for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+			{
+				const int32 SkeletonBoneIndex = Skeleton->GetSkeletonBoneIndexFromMeshBoneIndex(SkeletalMesh, BoneIndex);
+				if (SkeletonBoneIndex != INDEX_NONE)
+				{
+					Frame.Key->GetBoneTransform(LocalPose[BoneIndex], FSkeletonPoseBoneIndex(SkeletonBoneIndex), ExtractionContext, false);
+				}
+			}
+		}
+
+		FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, LocalPose, ComponentPose);
+		for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+		{
+			SkinTransforms[BoneIndex] = InverseRefTransforms[BoneIndex] * ComponentPose[BoneIndex];
+		}
+
+		BetterPA::ParallelFor(NumBodies, [&](int32 BodyIndex)
+		{
+			const FBodySkin& Skin = Skins[BodyIndex];
+			if (Skin.NumVertices == 0)
+			{
+				return;
+			}
+
+			TArray<float> X;
+			TArray<float> Y;
+			TArray<float> Z;
+			SkinBody(Skin, SkinTransforms, ComponentPose[BodyBoneIndices[BodyIndex]].Inverse(), X, Y, Z);
+
+			FBetterPAPointBucket& Bucket = OutBuckets.Buckets[BodyIndex];
+			FRandomStream& Stream = Streams[BodyIndex];
+			int64& Seen = PointsSeen[BodyIndex];
+			for (int32 Vertex = 0; Vertex < Skin.NumVertices; ++Vertex)
+			{
+				++Seen;
+				if (Bucket.Num() < Capacity)
+				{
+					Bucket.Add(FVector3f(X[Vertex], Y[Vertex], Z[Vertex]));
+					continue;
+				}
+
+				const int64 Slot = (int64)(Stream.GetFraction() * Seen);
+				if (Slot < Capacity)
+				{
+					Bucket.X[Slot] = X[Vertex];
+					Bucket.Y[Slot] = Y[Vertex];
+					Bucket.Z[Slot] = Z[Vertex];
+				}
+			}
+		});
+	}
+
+	return true;
+}
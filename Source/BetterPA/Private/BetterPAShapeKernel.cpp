@@ -0,0 +1,225 @@
+#include "BetterPAShapeKernel.h"
+#include "PhysicsEngine/AggregateGeom.h"
+
+namespace
+{
+	FBetterPAShapeProxy MakeProxy(EBetterPAShapeType Type, const FTransform& ElemTransform, const FVector3f& Extent)
+	{
+		FBetterPAShapeProxy Proxy;
+		Proxy.Type = Type;
+		Proxy.Center = FVector3f(ElemTransform.GetLocation());
+		Proxy.AxisX = FVector3f(ElemTransform.GetUnitAxis(EAxis::X));
+		Proxy.AxisY = FVector3f(ElemTransform.GetUnitAxis(EAxis::Y));
+		Proxy.AxisZ = FVector3f(ElemTransform.GetUnitAxis(EAxis::Z));
+		Proxy.Extent = Extent;
+		return Proxy;
+	}
+}
+
+FBetterPAShapeProxy FBetterPAShapeProxy::FromSphere(const FKSphereElem& Elem)
+{
+	return MakeProxy(EBetterPAShapeType::Sphere, Elem.GetTransform(), FVector3f(Elem.Radius, 0.0f, 0.0f));
+}
+
+FBetterPAShapeProxy FBetterPAShapeProxy::FromCapsule(const FKSphylElem& Elem)
+{
+	return MakeProxy(EBetterPAShapeType::Capsule, Elem.GetTransform(), FVector3f(Elem.Radius, Elem.Length * 0.5f, 0.0f));
+}
+
+FBetterPAShapeProxy FBetterPAShapeProxy::FromBox(const FKBoxElem& Elem)
+{
+	// Box elements store full extents
+	return MakeProxy(EBetterPAShapeType::Box, Elem.GetTransform(), FVector3f(Elem.X, Elem.Y, Elem.Z) * 0.5f);
+}
+
+FBetterPAShapeProxy FBetterPAShapeProxy::FromConvex(const FKConvexElem& Elem)
+{
+	const FTransform ElemTransform = Elem.GetTransform();
+
+	TArray<FPlane> Planes;
+	Elem.GetPlanes(Planes);
+	if (Planes.Num() < 4)
+	{
+		const FTransform BoxTransform(ElemTransform.GetRotation(), ElemTransform.TransformPosition(Elem.ElemBox.GetCenter()));
+		return MakeProxy(EBetterPAShapeType::Box, BoxTransform, FVector3f(Elem.ElemBox.GetExtent()));
+	}
+
+	FBetterPAShapeProxy Proxy = MakeProxy(EBetterPAShapeType::Convex, ElemTransform, FVector3f::ZeroVector);
+	Proxy.Planes.Reserve(Planes.Num());
+	for (const FPlane& Plane : Planes)
+	{
+		Proxy.Planes.Add(FPlane4f(Plane));
+	}
+	return Proxy;
+}
+
+void FBetterPAShapeProxy::GatherFromAggGeom(const FKAggregateGeom& AggGeom, TArray<FBetterPAShapeProxy>& OutProxies)
+{
+	for (const FKSphereElem& Elem : AggGeom.SphereElems)
+	{
+		OutProxies.Add(FromSphere(Elem));
+	}
+	for (const FKSphylElem& Elem : AggGeom.SphylElems)
+	{
+		OutProxies.Add(FromCapsule(Elem));
+	}
+	for (const FKBoxElem& Elem : AggGeom.BoxElems)
+	{
+		OutProxies.Add(FromBox(Elem));
+	}
+	for (const FKConvexElem& Elem : AggGeom.ConvexElems)
+	{
+		OutProxies.Add(FromConvex(Elem));
+	}
+}
+
+float BetterPA::ComputeSignedDistance(const FBetterPAShapeProxy& Shape, const FVector3f& Point)
+{
+	const FVector3f Rel = Point - Shape.Center;
+	const FVector3f Local(FVector3f::DotProduct(Rel, Shape.AxisX), FVector3f::DotProduct(Rel, Shape.AxisY), FVector3f::DotProduct(Rel, Shape.AxisZ));
+
+	switch (Shape.Type)
+	{
+	case EBetterPAShapeType::Capsule:
+	{
+		const float ClampedZ = FMath::Clamp(Local.Z, -Shape.Extent.Y, Shape.Extent.Y);
+		return FVector3f(Local.X, Local.Y, Local.Z - ClampedZ).Size() - Shape.Extent.X;
+	}
+	case EBetterPAShapeType::Box:
+	{
+		const FVector3f Q = Local.GetAbs() - Shape.Extent;
+		const FVector3f Outside(FMath::Max(Q.X, 0.0f), FMath::Max(Q.Y, 0.0f), FMath::Max(Q.Z, 0.0f));
+		return Outside.Size() + FMath::Min(Q.GetMax(), 0.0f);
+	}
+	case EBetterPAShapeType::Convex:
+	{
+		float Distance = -MAX_flt;
+		for (const FPlane4f& Plane : Shape.Planes)
+		{
+			Distance = FMath::Max(Distance, Plane.PlaneDot(Local));
+		}
+		return Distance;
+	}
+	case EBetterPAShapeType::Sphere:
+	default:
+		return Local.Size() - Shape.Extent.X;
+	}
+}
+
+void BetterPA::ComputeSignedDistances(const FBetterPAShapeProxy& Shape, const float* X, const float* Y, const float* Z, int32 Num, float* OutDistances)
+{
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float CX = VectorSetFloat1(Shape.Center.X);
+	const VectorRegister4Float CY = VectorSetFloat1(Shape.Center.Y);
+	const VectorRegister4Float CZ = VectorSetFloat1(Shape.Center.Z);
+	const VectorRegister4Float AXx = VectorSetFloat1(Shape.AxisX.X);
+	const VectorRegister4Float AXy = VectorSetFloat1(Shape.AxisX.Y);
+	const VectorRegister4Float AXz = VectorSetFloat1(Shape.AxisX.Z);
+	const VectorRegister4Float AYx = VectorSetFloat1(Shape.AxisY.X);
+	const VectorRegister4Float AYy = VectorSetFloat1(Shape.AxisY.Y);
+	const VectorRegister4Float AYz = VectorSetFloat1(Shape.AxisY.Z);
+	const VectorRegister4Float AZx = VectorSetFloat1(Shape.AxisZ.X);
+	const VectorRegister4Float AZy = VectorSetFloat1(Shape.AxisZ.Y);
+	const VectorRegister4Float AZz = VectorSetFloat1(Shape.AxisZ.Z);
+	const VectorRegister4Float EX = VectorSetFloat1(Shape.Extent.X);
+	const VectorRegister4Float EY = VectorSetFloat1(Shape.Extent.Y);
+	const VectorRegister4Float EZ = VectorSetFloat1(Shape.Extent.Z);
+	const VectorRegister4Float NegEY = VectorNegate(EY);
+
+	int32 Index = 0;
+	for (; Index + 4 <= Num; Index += 4)
+	{
+		const VectorRegister4Float RX = VectorSubtract(VectorLoad(X + Index), CX);
+		const VectorRegister4Float RY = VectorSubtract(VectorLoad(Y + Index), CY);
+		const VectorRegister4Float RZ = VectorSubtract(VectorLoad(Z + Index), CZ);
+
+		// Rotate into element space
+		const VectorRegister4Float LX = VectorMultiplyAdd(RZ, AXz, VectorMultiplyAdd(RY, AXy, VectorMultiply(RX, AXx)));
+		const VectorRegister4Float LY = VectorMultiplyAdd(RZ, AYz, VectorMultiplyAdd(RY, AYy, VectorMultiply(RX, AYx)));
+		const VectorRegister4Float LZ = VectorMultiplyAdd(RZ, AZz, VectorMultiplyAdd(RY, AZy, VectorMultiply(RX, AZx)));
+
+		VectorRegister4Float Distance;
+		switch (Shape.Type)
+		{
+		case EBetterPAShapeType::Capsule:
+		{
+			const VectorRegister4Float DZ = VectorSubtract(LZ, VectorMin(VectorMax(LZ, NegEY), EY));
+			const VectorRegister4Float LenSq = VectorMultiplyAdd(DZ, DZ, VectorMultiplyAdd(LY, LY, VectorMultiply(LX, LX)));
+			Distance = VectorSubtract(VectorSqrt(LenSq), EX);
+			break;
+		}
+		case EBetterPAShapeType::Box:
+		{
+			const VectorRegister4Float QX = VectorSubtract(VectorAbs(LX), EX);
+			const VectorRegister4Float QY = VectorSubtract(VectorAbs(LY), EY);
+			const VectorRegister4Float QZ = VectorSubtract(VectorAbs(LZ), EZ);
+			const VectorRegister4Float OX = VectorMax(QX, Zero);
+			const VectorRegister4Float OY = VectorMax(QY, Zero);
+			const VectorRegister4Float OZ = VectorMax(QZ, Zero);
+			const VectorRegister4Float Outside = VectorSqrt(VectorMultiplyAdd(OZ, OZ, VectorMultiplyAdd(OY, OY, VectorMultiply(OX, OX))));
+			const VectorRegister4Float Inside = VectorMin(VectorMax(QX, VectorMax(QY, QZ)), Zero);
+			Distance = VectorAdd(Outside, Inside);
+			break;
+		}
+		case EBetterPAShapeType::Convex:
+		{
+			Distance = VectorSetFloat1(-MAX_flt);
+			for (const FPlane4f& Plane : Shape.Planes)
+			{
+				const VectorRegister4Float PlaneDot = VectorMultiplyAdd(LZ, VectorSetFloat1(Plane.Z), VectorMultiplyAdd(LY, VectorSetFloat1(Plane.Y), VectorMultiply(LX, VectorSetFloat1(Plane.X))));
+				Distance = VectorMax(Distance, VectorSubtract(PlaneDot, VectorSetFloat1(Plane.W)));
+			}
+			break;
+		}
+		case EBetterPAShapeType::Sphere:
+		default:
+		{
+			const VectorRegister4Float LenSq = VectorMultiplyAdd(LZ, LZ, VectorMultiplyAdd(LY, LY, VectorMultiply(LX, LX)));
+			Distance = VectorSubtract(VectorSqrt(LenSq), EX);
+			break;
+		}
+		}
+
+		VectorStore(Distance, OutDistances + Index);
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		OutDistances[Index] = ComputeSignedDistance(Shape, FVector3f(X[Index], Y[Index], Z[Index]));
+	}
+}
+
+void BetterPA::ComputeMinSignedDistances(TArrayView<const FBetterPAShapeProxy> Shapes, const float* X, const float* Y, const float* Z, int32 Num, float* OutDistances)
+{
+	if (Shapes.Num() == 0)
+	{
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			OutDistances[Index] = MAX_flt;
+		}
+		return;
+	}
+
+	ComputeSignedDistances(Shapes[0], X, Y, Z, Num, OutDistances);
+
+	if (Shapes.Num() > 1)
+	{
+		TArray<float, TInlineAllocator<1024>> Scratch;
+		Scratch.SetNumUninitialized(Num);
+
+		for (int32 ShapeIndex = 1; ShapeIndex < Shapes.Num(); ++ShapeIndex)
+		{
+			ComputeSignedDistances(Shapes[ShapeIndex], X, Y, Z, Num, Scratch.GetData());
+
+			int32 Index = 0;
+			for (; Index + 4 <= Num; Index += 4)
+			{
+				VectorStore(VectorMin(VectorLoad(OutDistances + Index), VectorLoad(Scratch.GetData() + Index)), OutDistances + Index);
+			}
+			for (; Index < Num; ++Index)
+			{
+				OutDistances[Index] = FMath::Min(OutDistances[Index], Scratch[Index]);
+			}
+		}
+	}
+}
@@ -0,0 +1,472 @@
+#include "BetterPAShapePriors.h"
+#include "BetterPAAutoRegen.h"
+#include "BetterPAParallel.h"
+#include "Engine/SkeletalMesh.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "AnimationRuntime.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopedSlowTask.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/StrongObjectPtr.h"
+
+#define LOCTEXT_NAMESPACE "BetterPAShapePriors"
+
+namespace
+{
+	constexpr int32 ShapePriorVersion = 1;
+
+	// Leaf bodies are measured against their parent, so they get their own entry
+	const TCHAR* LeafSuffix = TEXT("@leaf");
+
+	bool IsIgnoredToken(const FString& Token)
+	{
+		static const TCHAR* IgnoredTokens[] = { TEXT("l"), TEXT("r"), TEXT("left"), TEXT("right"), TEXT("lft"), TEXT("rgt"), TEXT("bip"), TEXT("def") };
+		for (const TCHAR* Ignored : IgnoredTokens)
+		{
+			if (Token == Ignored)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+void FBetterPAShapePriorSums::Accumulate(const FBetterPAShapePriorSums& Other)
+{
+	NumShapes += Other.NumShapes;
+	RadiusRatio += Other.RadiusRatio;
+	LengthRatio += Other.LengthRatio;
+	OffsetRatio += Other.OffsetRatio;
+
+	NumLimits += Other.NumLimits;
+	Swing1Limit += Other.Swing1Limit;
+	Swing2Limit += Other.Swing2Limit;
+	TwistLimit += Other.TwistLimit;
+}
+
+FArchive& operator<<(FArchive& Ar, FBetterPAShapePriorSums& Sums)
+{
+	Ar << Sums.NumShapes << Sums.RadiusRatio << Sums.LengthRatio << Sums.OffsetRatio;
+	Ar << Sums.NumLimits << Sums.Swing1Limit << Sums.Swing2Limit << Sums.TwistLimit;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FBetterPAShapePriorSource& Source)
+{
+	Ar << Source.TimeStamp;
+	Ar << Source.Patterns;
+	return Ar;
+}
+
+bool FBetterPAShapePriorTable::FindShape(FName BoneName, bool bLeaf, float& OutRadiusRatio, float& OutLengthRatio, float& OutOffsetRatio) const
+{
+	FString Key = FBetterPAShapePriors::MakeBonePattern(BoneName);
+	if (bLeaf)
+	{
+		Key += LeafSuffix;
+	}
+
+	const FBetterPAShapePriorSums* Sums = Patterns.Find(Key);
+	if (!Sums || Sums->NumShapes < FMath::Max(MinSamples, 1))
+	{
+		return false;
+	}
+
+	OutRadiusRatio = (float)(Sums->RadiusRatio / Sums->NumShapes);
+	OutLengthRatio = (float)(Sums->LengthRatio / Sums->NumShapes);
+	OutOffsetRatio = (float)(Sums->OffsetRatio / Sums->NumShapes);
+	return true;
+}
+
+bool FBetterPAShapePriorTable::FindLimits(FName BoneName, float& OutSwing1Limit, float& OutSwing2Limit, float& OutTwistLimit) const
+{
+	const FBetterPAShapePriorSums* Sums = Patterns.Find(FBetterPAShapePriors::MakeBonePattern(BoneName));
+	if (!Sums || Sums->NumLimits < FMath::Max(MinSamples, 1))
+	{
+		return false;
+	}
+
+	OutSwing1Limit = (float)(Sums->Swing1Limit / Sums->NumLimits);
+	OutSwing2Limit = (float)(Sums->Swing2Limit / Sums->NumLimits);
+	OutTwistLimit = (float)(Sums->TwistLimit / Sums->NumLimits);
+	return true;
+}
+
+void FBetterPAShapePriorTable::RebuildPatterns()
+{
+	Sources.KeySort([](const FString& A, const FString& B) { return A < B; });
+
+	Patterns.Reset();
+	for (const TPair<FString, FBetterPAShapePriorSource>& Source : Sources)
+	{
+		for (const TPair<FString, FBetterPAShapePriorSums>& Pattern : Source.Value.Patterns)
+		{
+			Patterns.FindOrAdd(Pattern.Key).Accumulate(Pattern.Value);
+		}
+	}
+}
+
+void FBetterPAShapePriorTable::Serialize(FArchive& Ar)
+{
+	int32 Version = ShapePriorVersion;
+	Ar << Version;
+	if (Ar.IsLoading() && Version != ShapePriorVersion)
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << MinSamples;
+	Ar << Sources;
+
+	if (Ar.IsLoading())
+	{
+		RebuildPatterns();
+	}
+}
+
+bool FBetterPAShapePriorTable::Save(const FString& FilePath) const
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	const_cast<FBetterPAShapePriorTable*>(this)->Serialize(Writer);
+	return FFileHelper::SaveArrayToFile(Data, *FilePath);
+}
+
+bool FBetterPAShapePriorTable::Load(const FString& FilePath)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *FilePath, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	Serialize(Reader);
+	return !Reader.IsError();
+}
+
+FString FBetterPAShapePriorTable::GetDefaultPath()
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("BetterPA"), TEXT("ShapePriors.bin"));
+}
+
+FString FBetterPAShapePriors::MakeBonePattern(FName BoneName)
+{
+	FString Name = BoneName.ToString();
+
+	// Rig namespace, e.g. "mixamorig:"
+	int32 ColonIndex = INDEX_NONE;
+	if (Name.FindLastChar(TEXT(':'), ColonIndex))
+	{
+		Name.RightChopInline(ColonIndex + 1);
+	}
+
+	// Separators, digits and lower to upper case steps split tokens
+	TArray<FString, TInlineAllocator<8>> Tokens;
+	FString Token;
+	for (const TCHAR Char : Name)
+	{
+		const bool bCaseStep = FChar::IsUpper(Char) && Token.Len() > 0 && FChar::IsLower(Token[Token.Len() - 1]);
+		if (!FChar::IsAlpha(Char) || bCaseStep)
+		{
+			if (Token.Len() > 0)
+			{
+				Tokens.Add(MoveTemp(Token));
+				Token.Reset();
+			}
+			if (!FChar::IsAlpha(Char))
+			{
+				continue;
+			}
+		}
+		Token.AppendChar(Char);
+	}
+	if (Token.Len() > 0)
+	{
+		Tokens.Add(MoveTemp(Token));
+	}
+
+	FString Pattern;
+	for (const FString& Part : Tokens)
+	{
+		const FString Lower = Part.ToLower();
+		if (!IsIgnoredToken(Lower))
+		{
+			Pattern += Lower;
+		}
+	}
+	return Pattern.Len() > 0 ? Pattern : Name.ToLower();
+}
+
+bool FBetterPAShapePriors::ExtractAsset(const UPhysicsAsset* PhysicsAsset, FBetterPAShapePriorSource& OutSource)
+{
+	OutSource.Patterns.Reset();
+
+	const USkeletalMesh* SkeletalMesh = PhysicsAsset ? PhysicsAsset->PreviewSkeletalMesh.Get() : nullptr;
+	if (!SkeletalMesh)
+	{
+		return false;
+	}
+
+	const FReferenceSkeleton& RefSkeleton = SkeletalMesh->GetRefSkeleton();
+	const int32 NumBones = RefSkeleton.GetNum();
+
+	TArray<FTransform> ComponentSpaceTransforms;
+	FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, RefSkeleton.GetRefBonePose(), ComponentSpaceTransforms);
+
+	TArray<TArray<int32>> ChildrenIndices;
+	ChildrenIndices.SetNum(NumBones);
+	for (int32 BoneIndex = 1; BoneIndex < NumBones; ++BoneIndex)
+	{
+		ChildrenIndices[RefSkeleton.GetParentIndex(BoneIndex)].Add(BoneIndex);
+	}
+
+	// Bones with a body play the part of the generator's selected bones
+	TBitArray<> HasBody(false, NumBones);
+	for (const USkeletalBodySetup* BodySetup : PhysicsAsset->SkeletalBodySetups)
+	{
+		const int32 BoneIndex = BodySetup ? RefSkeleton.FindBoneIndex(BodySetup->BoneName) : INDEX_NONE;
+		if (BoneIndex != INDEX_NONE)
+		{
+			HasBody[BoneIndex] = true;
+		}
+	}
+
+	for (const USkeletalBodySetup* BodySetup : PhysicsAsset->SkeletalBodySetups)
+	{
+		const int32 BoneIndex = BodySetup ? RefSkeleton.FindBoneIndex(BodySetup->BoneName) : INDEX_NONE;
+		if (BoneIndex == INDEX_NONE || BodySetup->AggGeom.SphylElems.Num() == 0)
+		{
+			continue;
+		}
+
+		// Bone length measured the way the generator measures it: to the nearest body below, or from the nearest body above for leaves
+		int32 TargetChildIndex = INDEX_NONE;
+		TArray<int32, TInlineAllocator<16>> SearchQueue(ChildrenIndices[BoneIndex]);
+		for (int32 SearchIndex = 0; SearchIndex < SearchQueue.Num(); ++SearchIndex)
+		{
+			if (HasBody[SearchQueue[SearchIndex]])
+			{
+				TargetChildIndex = SearchQueue[SearchIndex];
+				break;
+			}
+			SearchQueue.Append(ChildrenIndices[SearchQueue[SearchIndex]]);
+		}
+
+		const FTransform& BoneTransform = ComponentSpaceTransforms[BoneIndex];
+		const FKSphylElem& Sphyl = BodySetup->AggGeom.SphylElems[0];
+		FString Key = MakeBonePattern(BodySetup->BoneName);
+		FBetterPAShapePriorSums Sample;
+
+		if (TargetChildIndex != INDEX_NONE)
+		{
+			const FVector Start = BoneTransform.GetLocation();
+			const FVector Bone = ComponentSpaceTransforms[TargetChildIndex].GetLocation() - Start;
+			const float Length = Bone.Size();
+			if (Length < UE_KINDA_SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			const FVector Center = BoneTransform.TransformPosition(Sphyl.Center);
+			Sample.OffsetRatio = FVector::DotProduct(Center - Start, Bone / Length) / Length;
+			Sample.RadiusRatio = Sphyl.Radius / Length;
+			Sample.LengthRatio = Sphyl.Length / Length;
+		}
+		else
+		{
+			float Length = 5.0f;
+			for (int32 Ancestor = RefSkeleton.GetParentIndex(BoneIndex); Ancestor != INDEX_NONE; Ancestor = RefSkeleton.GetParentIndex(Ancestor))
+			{
+				if (HasBody[Ancestor])
+				{
+					Length = FVector::Dist(ComponentSpaceTransforms[Ancestor].GetLocation(), BoneTransform.GetLocation());
+					break;
+				}
+			}
+			if (Length < UE_KINDA_SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			Sample.RadiusRatio = Sphyl.Radius / Length;
+			Sample.LengthRatio = Sphyl.Length / Length;
+			Key += LeafSuffix;
+		}
+
+		Sample.NumShapes = 1;
+		OutSource.Patterns.FindOrAdd(Key).Accumulate(Sample);
+	}
+
+	// Bone1 is the child by asset convention; the generator limits every angular axis, so only fully limited constraints are learned from
+	for (const UPhysicsConstraintTemplate* Constraint : PhysicsAsset->ConstraintSetup)
+	{
+		if (!Constraint)
+		{
+			continue;
+		}
+
+		const FConstraintInstance& Instance = Constraint->DefaultInstance;
+		if (Instance.GetAngularSwing1Motion() != EAngularConstraintMotion::ACM_Limited
+			|| Instance.GetAngularSwing2Motion() != EAngularConstraintMotion::ACM_Limited
+			|| Instance.GetAngularTwistMotion() != EAngularConstraintMotion::ACM_Limited)
+		{
+			continue;
+		}
+
+		FBetterPAShapePriorSums Sample;
+		Sample.NumLimits = 1;
+		Sample.Swing1Limit = Instance.GetAngularSwing1Limit();
+		Sample.Swing2Limit = Instance.GetAngularSwing2Limit();
+		Sample.TwistLimit = Instance.GetAngularTwistLimit();
+		OutSource.Patterns.FindOrAdd(MakeBonePattern(Instance.ConstraintBone1)).Accumulate(Sample);
+	}
+
+	return true;
+}
+
+int32 FBetterPAShapePriors::Update(FBetterPAShapePriorTable& Table, const FBetterPAShapePriorSettings& Settings)
+{
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.ClassPaths.Add(UPhysicsAsset::StaticClass()->GetClassPathName());
+	Filter.bRecursivePaths = true;
+	Filter.PackagePaths = Settings.PackagePaths;
+	if (Filter.PackagePaths.Num() == 0)
+	{
+		Filter.PackagePaths.Add(TEXT("/Game"));
+	}
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+	Assets.Sort([](const FAssetData& A, const FAssetData& B) { return A.PackageName.LexicalLess(B.PackageName); });
+
+	// Assets the editor generated would feed the priors their own output, only hand made ones are learned from
+	TSet<FString> Generated;
+	FBetterPAGenerationRecordTable Records;
+	if (Records.Load(FBetterPAGenerationRecordTable::GetDefaultPath()))
+	{
+		for (const TPair<FString, FBetterPAGenerationRecord>& Record : Records.Records)
+		{
+			Generated.Add(Record.Value.PhysicsAsset.GetLongPackageName());
+		}
+	}
+	Assets.RemoveAll([&Generated](const FAssetData& Asset) { return Generated.Contains(Asset.PackageName.ToString()); });
+
+	// Deleted and generated packages, assets outside the scanned folders are left as they are
+	TArray<FString> Deleted;
+	for (const TPair<FString, FBetterPAShapePriorSource>& Source : Table.Sources)
+	{
+		if (!FPackageName::DoesPackageExist(Source.Key) || Generated.Contains(Source.Key))
+		{
+			Deleted.Add(Source.Key);
+		}
+	}
+	for (const FString& PackageName : Deleted)
+	{
+		Table.Sources.Remove(PackageName);
+	}
+
+	// Only packages saved since they were last read
+	TArray<FAssetData> Stale;
+	TArray<FDateTime> StaleTimeStamps;
+	for (const FAssetData& Asset : Assets)
+	{
+		const FString PackageName = Asset.PackageName.ToString();
+		FString FileName;
+		if (!FPackageName::DoesPackageExist(PackageName, &FileName))
+		{
+			continue;
+		}
+
+		const FDateTime TimeStamp = IFileManager::Get().GetTimeStamp(*FileName);
+		const FBetterPAShapePriorSource* Existing = Table.Sources.Find(PackageName);
+		if (Settings.bFullRebuild || !Existing || Existing->TimeStamp != TimeStamp)
+		{
+			Stale.Add(Asset);
+			StaleTimeStamps.Add(TimeStamp);
+		}
+	}
+
+	const int32 BatchSize = FMath::Max(1, Settings.BatchSize);
+	FScopedSlowTask SlowTask((float)Stale.Num(), LOCTEXT("LearningShapePriors", "Learning shape priors from physics assets..."));
+	SlowTask.MakeDialog(true);
+
+	int32 NumRead = 0;
+	for (int32 BatchStart = 0; BatchStart < Stale.Num(); BatchStart += BatchSize)
+	{
+		if (SlowTask.ShouldCancel())
+		{
+			break;
+		}
+
+		const int32 BatchEnd = FMath::Min(BatchStart + BatchSize, Stale.Num());
+		SlowTask.EnterProgressFrame((float)(BatchEnd - BatchStart));
+
+		for (int32 AssetIndex = BatchStart; AssetIndex < BatchEnd; ++AssetIndex)
+		{
+			LoadPackageAsync(Stale[AssetIndex].PackageName.ToString());
+		}
+		FlushAsyncLoading();
+
+		TArray<TStrongObjectPtr<UPhysicsAsset>> Batch;
+		Batch.SetNum(BatchEnd - BatchStart);
+		for (int32 AssetIndex = BatchStart; AssetIndex < BatchEnd; ++AssetIndex)
+		{
+			if (UPhysicsAsset* PhysicsAsset = Cast<UPhysicsAsset>(Stale[AssetIndex].FastGetAsset(false)))
+			{
+				Batch[AssetIndex - BatchStart].Reset(PhysicsAsset);
+				if (!PhysicsAsset->PreviewSkeletalMesh.IsNull() && !PhysicsAsset->PreviewSkeletalMesh.IsValid())
+				{
+					LoadPackageAsync(PhysicsAsset->PreviewSkeletalMesh.ToSoftObjectPath().GetLongPackageName());
+				}
+			}
+		}
+		FlushAsyncLoading();
+
+		TArray<FBetterPAShapePriorSource> BatchSources;
+		BatchSources.SetNum(Batch.Num());
+		BetterPA::ParallelFor(Batch.Num(), [&](int32 Index)
+		{
+			FBetterPAShapePriors::ExtractAsset(Batch[Index].Get(), BatchSources[Index]);
+		});
+
+		// Assets without a preview mesh are recorded empty, so they are not reloaded until they change
+		for (int32 Index = 0; Index < Batch.Num(); ++Index)
+		{
+			BatchSources[Index].TimeStamp = StaleTimeStamps[BatchStart + Index];
+			Table.Sources.Add(Stale[BatchStart + Index].PackageName.ToString(), MoveTemp(BatchSources[Index]));
+		}
+		NumRead += Batch.Num();
+
+		Batch.Reset();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	Table.RebuildPatterns();
+	return NumRead;
+}
+
+TSharedPtr<const FBetterPAShapePriorTable> FBetterPAShapePriors::LoadDefault()
+{
+	TSharedRef<FBetterPAShapePriorTable> Table = MakeShared<FBetterPAShapePriorTable>();
+	if (!Table->Load(FBetterPAShapePriorTable::GetDefaultPath()))
+	{
+		return nullptr;
+	}
+	return Table;
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,68 @@
+#include "BetterPAShapePriorsCommandlet.h"
+#include "BetterPAShapePriors.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBetterPAShapePriors, Log, All);
+
+UBetterPAShapePriorsCommandlet::UBetterPAShapePriorsCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UBetterPAShapePriorsCommandlet::Main(const FString& Params)
+{
+	FBetterPAShapePriorSettings Settings;
+
+	FString Paths;
+	if (FParse::Value(*Params, TEXT("Paths="), Paths, false))
+	{
+		TArray<FString> PathList;
+		Paths.ParseIntoArray(PathList, TEXT("+"));
+		for (const FString& Path : PathList)
+		{
+			Settings.PackagePaths.Add(FName(*Path));
+		}
+	}
+	FParse::Value(*Params, TEXT("BatchSize="), Settings.BatchSize);
+	Settings.bFullRebuild = FParse::Param(*Params, TEXT("Full"));
+
+	const FString TablePath = FBetterPAShapePriorTable::GetDefaultPath();
+	FBetterPAShapePriorTable Table;
+	if (!Settings.bFullRebuild && !Table.Load(TablePath))
+	{
+		UE_LOG(LogBetterPAShapePriors, Display, TEXT("No usable table at %s, building from scratch"), *TablePath);
+		Table = FBetterPAShapePriorTable();
+	}
+	FParse::Value(*Params, TEXT("MinSamples="), Table.MinSamples);
+
+	const int32 NumRead = FBetterPAShapePriors::Update(Table, Settings);
+
+	TArray<FString> PatternNames;
+	Table.Patterns.GetKeys(PatternNames);
+	PatternNames.Sort();
+	for (const FString& PatternName : PatternNames)
+	{
+		const FBetterPAShapePriorSums& Sums = Table.Patterns[PatternName];
+		UE_LOG(LogBetterPAShapePriors, Display, TEXT("%s: %d shapes, radius %.3f, length %.3f, offset %.3f; %d limits, swing %.1f / %.1f, twist %.1f"),
+			*PatternName,
+			Sums.NumShapes,
+			Sums.NumShapes > 0 ? Sums.RadiusRatio / Sums.NumShapes : 0.0,
+			Sums.NumShapes > 0 ? Sums.LengthRatio / Sums.NumShapes : 0.0,
+			Sums.NumShapes > 0 ? Sums.OffsetRatio / Sums.NumShapes : 0.0,
+			Sums.NumLimits,
+			Sums.NumLimits > 0 ? Sums.Swing1Limit / Sums.NumLimits : 0.0,
+			Sums.NumLimits > 0 ? Sums.Swing2Limit / Sums.NumLimits : 0.0,
+			Sums.NumLimits > 0 ? Sums.TwistLimit / Sums.NumLimits : 0.0);
+	}
+
+	if (!Table.Save(TablePath))
+	{
+		UE_LOG(LogBetterPAShapePriors, Error, TEXT("Could not write %s"), *TablePath);
+		return 1;
+	}
+
+	UE_LOG(LogBetterPAShapePriors, Display, TEXT("%d assets read, %d patterns from %d assets. Table: %s"), NumRead, Table.Patterns.Num(), Table.Sources.Num(), *TablePath);
+	return 0;
+}
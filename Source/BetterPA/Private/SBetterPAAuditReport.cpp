@@ -0,0 +1,190 @@
+#include "SBetterPAAuditReport.h"
+#include "Widgets/Text/STextBlock.h"
+#include "Widgets/Layout/SBorder.h"
+#include "Widgets/Input/SButton.h"
+
+namespace BetterPAAuditReportColumns
+{
+	static const FName Asset("Asset");
+	static const FName Issue("Issue");
+	static const FName Bone("Bone");
+	static const FName Detail("Detail");
+	static const FName Fix("Fix");
+}
+
+class SBetterPAAuditReportRow : public SMultiColumnTableRow<TSharedPtr<FBetterPAAuditFinding>>
+{
+public:
+	SLATE_BEGIN_ARGS(SBetterPAAuditReportRow) {}
+		SLATE_ARGUMENT(TSharedPtr<FBetterPAAuditFinding>, Item)
+		SLATE_EVENT(FOnClicked, OnFix)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs, const TSharedRef<STableViewBase>& OwnerTable)
+	{
+		Item = InArgs._Item;
+		OnFix = InArgs._OnFix;
+		SMultiColumnTableRow<TSharedPtr<FBetterPAAuditFinding>>::Construct(FSuperRowType::FArguments(), OwnerTable);
+	}
+
+	virtual TSharedRef<SWidget> GenerateWidgetForColumn(const FName& ColumnName) override
+	{
+		if (ColumnName == BetterPAAuditReportColumns::Fix)
+		{
+			TSharedPtr<FBetterPAAuditFinding> Finding = Item;
+			return SNew(SButton)
+				.Text_Lambda([Finding]() { return FText::FromString(Finding->bFixed ? TEXT("Fixed") : TEXT("Fix")); })
+				.IsEnabled_Lambda([Finding]() { return !Finding->bFixed && FBetterPAAudit::IsFixable(Finding->Issue); })
+				.ToolTipText(FText::FromString(TEXT("Removes dangling or duplicate objects, or regenerates the asset from its current bones")))
+				.OnClicked(OnFix);
+		}
+
+		FText Text;
+		if (ColumnName == BetterPAAuditReportColumns::Asset)
+		{
+			Text = FText::FromString(Item->AssetPath.GetAssetName());
+		}
+		else if (ColumnName == BetterPAAuditReportColumns::Issue)
+		{
+			Text = FText::FromString(FBetterPAAudit::GetIssueName(Item->Issue));
+		}
+		else if (ColumnName == BetterPAAuditReportColumns::Bone)
+		{
+			Text = Item->OtherBoneName.IsNone()
+				? FText::FromName(Item->BoneName)
+				: FText::FromString(FString::Printf(TEXT("%s - %s"), *Item->BoneName.ToString(), *Item->OtherBoneName.ToString()));
+		}
+		else if (ColumnName == BetterPAAuditReportColumns::Detail)
+		{
+			Text = FText::FromString(Item->Detail);
+		}
+
+		return SNew(STextBlock)
+			.Text(Text)
+			.ToolTipText(FText::FromString(Item->AssetPath.ToString()));
+	}
+
+private:
+	TSharedPtr<FBetterPAAuditFinding> Item;
+	FOnClicked OnFix;
+};
+
+void SBetterPAAuditReport::Construct(const FArguments& InArgs)
+{
+	SortColumn = BetterPAAuditReportColumns::Asset;
+	SortMode = EColumnSortMode::Ascending;
+	ReportPath = InArgs._ReportPath;
+
+	for (const FBetterPAAuditFinding& Finding : InArgs._Findings)
+	{
+		Items.Add(MakeShared<FBetterPAAuditFinding>(Finding));
+	}
+	SortItems();
+
+	auto MakeColumn = [this](FName ColumnId, const FString& Label, float FillWidth)
+	{
+		return SHeaderRow::Column(ColumnId)
+			.DefaultLabel(FText::FromString(Label))
+			.FillWidth(FillWidth)
+			.SortMode(this, &SBetterPAAuditReport::GetColumnSortMode, ColumnId)
+			.OnSort(this, &SBetterPAAuditReport::OnSortModeChanged);
+	};
+
+	ChildSlot
+	[
+		SNew(SBorder)
+		.Padding(4)
+		[
+			SNew(SVerticalBox)
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(2)
+			[
+				SNew(STextBlock)
+				.Text(this, &SBetterPAAuditReport::GetSummaryText)
+			]
+			+ SVerticalBox::Slot()
+			.FillHeight(1.0f)
+			[
+				SAssignNew(ListView, SListView<TSharedPtr<FBetterPAAuditFinding>>)
+				.ListItemsSource(&Items)
+				.OnGenerateRow(this, &SBetterPAAuditReport::OnGenerateRow)
+				.SelectionMode(ESelectionMode::Single)
+				.HeaderRow
+				(
+					SNew(SHeaderRow)
+					+ MakeColumn(BetterPAAuditReportColumns::Asset, TEXT("Asset"), 2.0f)
+					+ MakeColumn(BetterPAAuditReportColumns::Issue, TEXT("Issue"), 1.5f)
+					+ MakeColumn(BetterPAAuditReportColumns::Bone, TEXT("Bone"), 2.0f)
+					+ MakeColumn(BetterPAAuditReportColumns::Detail, TEXT("Detail"), 2.0f)
+					+ SHeaderRow::Column(BetterPAAuditReportColumns::Fix)
+					.DefaultLabel(FText::FromString(TEXT("Fix")))
+					.FixedWidth(70.0f)
+				)
+			]
+		]
+	];
+}
+
+TSharedRef<ITableRow> SBetterPAAuditReport::OnGenerateRow(TSharedPtr<FBetterPAAuditFinding> Item, const TSharedRef<STableViewBase>& OwnerTable)
+{
+	return SNew(SBetterPAAuditReportRow, OwnerTable)
+		.Item(Item)
+		.OnFix(this, &SBetterPAAuditReport::OnFix, Item);
+}
+
+FReply SBetterPAAuditReport::OnFix(TSharedPtr<FBetterPAAuditFinding> Item)
+{
+	if (Item.IsValid())
+	{
+		FBetterPAAudit::FixFinding(*Item);
+	}
+	return FReply::Handled();
+}
+
+FText SBetterPAAuditReport::GetSummaryText() const
+{
+	int32 NumFixed = 0;
+	for (const TSharedPtr<FBetterPAAuditFinding>& Item : Items)
+	{
+		NumFixed += Item->bFixed ? 1 : 0;
+	}
+	return FText::FromString(FString::Printf(TEXT("%d findings, %d fixed. Report: %s"), Items.Num(), NumFixed, *ReportPath));
+}
+
+void SBetterPAAuditReport::OnSortModeChanged(EColumnSortPriority::Type Priority, const FName& ColumnId, EColumnSortMode::Type NewSortMode)
+{
+	SortColumn = ColumnId;
+	SortMode = NewSortMode;
+	SortItems();
+
+	if (ListView.IsValid())
+	{
+		ListView->RequestListRefresh();
+	}
+}
+
+EColumnSortMode::Type SBetterPAAuditReport::GetColumnSortMode(FName ColumnId) const
+{
+	return SortColumn == ColumnId ? SortMode : EColumnSortMode::None;
+}
+
+void SBetterPAAuditReport::SortItems()
+{
+	const bool bAscending = SortMode != EColumnSortMode::Descending;
+	const FName Column = SortColumn;
+
+	auto GetKey = [Column](const FBetterPAAuditFinding& Finding) -> FString
+	{
+		if (Column == BetterPAAuditReportColumns::Issue) return FBetterPAAudit::GetIssueName(Finding.Issue);
+		if (Column == BetterPAAuditReportColumns::Bone) return Finding.BoneName.ToString();
+		if (Column == BetterPAAuditReportColumns::Detail) return Finding.Detail;
+		return Finding.AssetPath.ToString();
+	};
+
+	// Stable so a secondary order from the previous sort survives
+	Items.StableSort([bAscending, &GetKey](const TSharedPtr<FBetterPAAuditFinding>& A, const TSharedPtr<FBetterPAAuditFinding>& B)
+	{
+		return bAscending ? GetKey(*A) < GetKey(*B) : GetKey(*B) < GetKey(*A);
+	});
+}
@@ -6,6 +6,7 @@
 void SBetterPABonePicker::Construct(const FArguments& InArgs)
 {
 	SkeletalMesh = InArgs._SkeletalMesh;
+	OnBonesToggled = InArgs._OnBonesToggled;
 
 	if (SkeletalMesh)
 	{
@@ -85,7 +86,14 @@ void SBetterPABonePicker::OnGetChildren(TSharedPtr<FBetterPABoneItem> Item, TArr
 void SBetterPABonePicker::OnCheckStateChanged(ECheckBoxState NewState, TSharedPtr<FBetterPABoneItem> Item)
 {
 	bool bIsSelected = (NewState == ECheckBoxState::Checked);
-	RecursivelySetSelection(Item, bIsSelected);
+
+	TArray<FName> ToggledBones;
+	RecursivelySetSelection(Item, bIsSelected, ToggledBones);
+
+	if (ToggledBones.Num() > 0)
+	{
+		OnBonesToggled.ExecuteIfBound(ToggledBones, GetSelectedBones());
+	}
 }
 
 ECheckBoxState SBetterPABonePicker::GetCheckState(TSharedPtr<FBetterPABoneItem> Item) const
@@ -93,12 +101,16 @@ ECheckBoxState SBetterPABonePicker::GetCheckState(TSharedPtr<FBetterPABoneItem>
 	return Item->bIsSelected ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
 }
 
-void SBetterPABonePicker::RecursivelySetSelection(TSharedPtr<FBetterPABoneItem> Item, bool bSelected)
+void SBetterPABonePicker::RecursivelySetSelection(TSharedPtr<FBetterPABoneItem> Item, bool bSelected, TArray<FName>& OutToggledBones)
 {
-	Item->bIsSelected = bSelected;
+	if (Item->bIsSelected != bSelected)
+	{
+		Item->bIsSelected = bSelected;
+		OutToggledBones.Add(Item->BoneName);
+	}
 	for (auto& Child : Item->Children)
 	{
-		RecursivelySetSelection(Child, bSelected);
+		RecursivelySetSelection(Child, bSelected, OutToggledBones);
 	}
 }
 
@@ -1,5 +1,5 @@
 #include "SBetterPAConstraintGraph.h"
-#include "EdGraph/EdGraph.h"
+#include "BetterPAConstraintEdGraph.h"
 #include "SGraphPanel.h"
 #include "Widgets/Layout/SBorder.h"
 #include "Widgets/Text/STextBlock.h"
@@ -10,19 +10,135 @@
 #include "PhysicsEngine/PhysicsConstraintTemplate.h"
 #include "Framework/MultiBox/MultiBoxBuilder.h"
 #include "GraphEditor.h"
-#include "AnimationRuntime.h"
+#include "Editor.h"
 #include "Widgets/Input/SCheckBox.h"
 #include "Widgets/Input/SSpinBox.h"
+#include "Widgets/Input/SSearchBox.h"
+
+namespace
+{
+	// Spacing between graph layers and between nodes of a layer
+	constexpr int32 LayerSpacingX = 300;
+	constexpr int32 NodeSpacingY = 90;
+
+	struct FGraphLayoutNode
+	{
+		// Bodies represented by the node, in parent-to-child order
+		TArray<int32> Bodies;
+		TArray<int32> Children;
+		TArray<int32> Parents;
+		int32 Layer = 0;
+		float SortKey = 0.0f;
+	};
+
+	// Assigns layers by breadth-first depth and orders each layer by the barycenter of its parents.
+	// Linear apart from the per-layer sort, so O(n log n) overall.
+	void LayoutLayered(TArray<FGraphLayoutNode>& Nodes, TArray<FVector2D>& OutPositions)
+	{
+		const int32 NumNodes = Nodes.Num();
+		TArray<int32> Order;
+		Order.Reserve(NumNodes);
+		TBitArray<> Visited(false, NumNodes);
+
+		// Roots first, then anything only reachable through a cycle
+		for (int32 Pass = 0; Pass < 2; ++Pass)
+		{
+			for (int32 Seed = 0; Seed < NumNodes; ++Seed)
+			{
+				if (Visited[Seed] || (Pass == 0 && Nodes[Seed].Parents.Num() > 0))
+				{
+					continue;
+				}
+
+				Visited[Seed] = true;
+				Nodes[Seed].Layer = 0;
+				const int32 QueueStart = Order.Add(Seed);
+				for (int32 QueueIndex = QueueStart; QueueIndex < Order.Num(); ++QueueIndex)
+				{
+					const int32 Current = Order[QueueIndex];
+					for (int32 Child : Nodes[Current].Children)
+					{
+						if (!Visited[Child])
+						{
+							Visited[Child] = true;
+							Nodes[Child].Layer = Nodes[Current].Layer + 1;
+							Order.Add(Child);
+						}
+					}
+				}
+			}
+		}
+
+		int32 NumLayers = 0;
+		for (const FGraphLayoutNode& Node : Nodes)
+		{
+			NumLayers = FMath::Max(NumLayers, Node.Layer + 1);
+		}
+
+		TArray<TArray<int32>> Layers;
+		Layers.SetNum(NumLayers);
+		for (int32 NodeIndex : Order)
+		{
+			Layers[Nodes[NodeIndex].Layer].Add(NodeIndex);
+		}
+
+		// Rank inside the previous layers, used as barycenter input
+		TArray<int32> Rank;
+		Rank.Init(0, NumNodes);
+		OutPositions.SetNum(NumNodes);
+
+		for (int32 LayerIndex = 0; LayerIndex < NumLayers; ++LayerIndex)
+		{
+			TArray<int32>& Layer = Layers[LayerIndex];
+
+			if (LayerIndex > 0)
+			{
+				for (int32 NodeIndex : Layer)
+				{
+					FGraphLayoutNode& Node = Nodes[NodeIndex];
+					float Sum = 0.0f;
+					int32 Count = 0;
+					for (int32 Parent : Node.Parents)
+					{
+						if (Nodes[Parent].Layer < LayerIndex)
+						{
+							Sum += Rank[Parent];
+							++Count;
+						}
+					}
+					Node.SortKey = Count > 0 ? Sum / Count : 0.0f;
+				}
+
+				Layer.StableSort([&Nodes](int32 A, int32 B) { return Nodes[A].SortKey < Nodes[B].SortKey; });
+			}
+
+			for (int32 Position = 0; Position < Layer.Num(); ++Position)
+			{
+				Rank[Layer[Position]] = Position;
+				OutPositions[Layer[Position]] = FVector2D(LayerIndex * LayerSpacingX, (Position - Layer.Num() / 2) * NodeSpacingY);
+			}
+		}
+	}
+}
 
 void SBetterPAConstraintGraph::Construct(const FArguments& InArgs)
 {
 	PhysicsAsset = InArgs._PhysicsAsset;
-	CurrentMode = EConstraintGenerationMode::Standard;
-	bScaleByDistance = false;
-	ScalingFactor = 1.0f;
+	bCollapseChains = true;
+	MinChainLength = 4;
+	GraphObj = nullptr;
+	bPendingAssetSync = false;
+	bAssetSyncScheduled = false;
 	
 	CreateGraph();
 
+	if (GEditor)
+	{
+		GEditor->RegisterForUndo(this);
+	}
+	ObjectModifiedHandle = FCoreUObjectDelegates::OnObjectModified.AddSP(this, &SBetterPAConstraintGraph::OnObjectModified);
+	ObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddSP(this, &SBetterPAConstraintGraph::OnObjectPropertyChanged);
+
 	ChildSlot
 	[
 		SNew(SBorder)
@@ -52,11 +168,30 @@ void SBetterPAConstraintGraph::Construct(const FArguments& InArgs)
 				+ SVerticalBox::Slot()
 				.AutoHeight()
 				.Padding(0, 4, 0, 0)
+				[
+					SNew(SButton)
+					.Text(FText::FromString("Load from Asset"))
+					.ToolTipText(FText::FromString("Replace the graph with all bodies and constraints of the physics asset"))
+					.OnClicked(this, &SBetterPAConstraintGraph::OnLoadFromAsset)
+				]
+				+ SVerticalBox::Slot()
+				.AutoHeight()
+				.Padding(0, 4, 0, 0)
 				[
 					SNew(SButton)
 					.Text(FText::FromString("Apply Constraints"))
 					.OnClicked(this, &SBetterPAConstraintGraph::OnApplyChanges)
 				]
+				+ SVerticalBox::Slot()
+				.AutoHeight()
+				.Padding(0, 4, 0, 0)
+				[
+					SNew(SButton)
+					.Text(FText::FromString("Write Ragdoll Profiles"))
+					.ToolTipText(FText::FromString("Derive the ragdoll profiles from the default limits of every constraint in the asset"))
+					.IsEnabled_Lambda([this]() { return GraphObj && GraphObj->ConstraintSettings.Profiles.Num() > 0; })
+					.OnClicked(this, &SBetterPAConstraintGraph::OnWriteProfiles)
+				]
 			]
 			+ SHorizontalBox::Slot()
 			.FillWidth(1.0f)
@@ -67,13 +202,31 @@ void SBetterPAConstraintGraph::Construct(const FArguments& InArgs)
 	];
 }
 
+SBetterPAConstraintGraph::~SBetterPAConstraintGraph()
+{
+	FCoreUObjectDelegates::OnObjectModified.Remove(ObjectModifiedHandle);
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(ObjectPropertyChangedHandle);
+
+	if (GEditor)
+	{
+		GEditor->UnregisterForUndo(this);
+	}
+
+	if (GraphObj)
+	{
+		GraphObj->RemoveFromRoot();
+		GraphObj = nullptr;
+	}
+}
+
 void SBetterPAConstraintGraph::CreateGraph()
 {
 	if (!GraphObj)
 	{
-		GraphObj = NewObject<UEdGraph>(GetTransientPackage(), NAME_None, RF_Transactional);
+		GraphObj = NewObject<UBetterPAConstraintEdGraph>(GetTransientPackage(), NAME_None, RF_Transactional);
 		GraphObj->Schema = UBetterPAConstraintGraphSchema::StaticClass();
 		GraphObj->AddToRoot();
+		GraphObj->Initialize(PhysicsAsset);
 	}
 
 	GraphPanel = SNew(SGraphPanel)
@@ -82,44 +235,144 @@ void SBetterPAConstraintGraph::CreateGraph()
 
 TSharedRef<SWidget> SBetterPAConstraintGraph::CreateBodyList()
 {
-	TSharedPtr<SVerticalBox> ListBox = SNew(SVerticalBox);
+	BodyItems.Reset();
 
 	if (PhysicsAsset)
 	{
-		// Sort BodySetups by BoneName
-		TArray<USkeletalBodySetup*> SortedBodySetups = PhysicsAsset->SkeletalBodySetups;
-		SortedBodySetups.Sort([](const USkeletalBodySetup& A, const USkeletalBodySetup& B)
+		BodyItems.Reserve(PhysicsAsset->SkeletalBodySetups.Num());
+		for (int32 BodyIndex = 0; BodyIndex < PhysicsAsset->SkeletalBodySetups.Num(); ++BodyIndex)
 		{
-			return A.BoneName.ToString() < B.BoneName.ToString();
-		});
-
-		for (int32 i = 0; i < SortedBodySetups.Num(); ++i)
-		{
-			USkeletalBodySetup* BodySetup = SortedBodySetups[i];
-			if (BodySetup)
+			if (const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[BodyIndex])
 			{
-				// We need the original index for the node creation, so we need to find it
-				int32 OriginalIndex = PhysicsAsset->SkeletalBodySetups.Find(BodySetup);
-				
-				ListBox->AddSlot()
-				.AutoHeight()
-				.Padding(2)
-				[
-					SNew(SButton)
-					.Text(FText::FromName(BodySetup->BoneName))
-					.OnClicked(this, &SBetterPAConstraintGraph::OnAddBodyNode, BodySetup->BoneName, OriginalIndex)
-				];
+				TSharedPtr<FBetterPABodyListItem> Item = MakeShared<FBetterPABodyListItem>();
+				Item->BoneName = BodySetup->BoneName;
+				Item->BodyIndex = BodyIndex;
+				Item->SearchKey = BodySetup->BoneName.ToString().ToLower();
+				BodyItems.Add(Item);
 			}
 		}
+
+		// Sorted once by the cached key, filtering keeps the order
+		BodyItems.Sort([](const TSharedPtr<FBetterPABodyListItem>& A, const TSharedPtr<FBetterPABodyListItem>& B)
+		{
+			return A->SearchKey < B->SearchKey;
+		});
 	}
 
-	return SNew(SScrollBox)
-		+ SScrollBox::Slot()
+	FilteredBodyItems = BodyItems;
+
+	return SNew(SVerticalBox)
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding(0, 0, 0, 4)
+		[
+			SNew(SSearchBox)
+			.HintText(FText::FromString("Filter bodies"))
+			.OnTextChanged(this, &SBetterPAConstraintGraph::OnBodyFilterChanged)
+		]
+		+ SVerticalBox::Slot()
+		.FillHeight(1.0f)
+		[
+			SAssignNew(BodyListView, SListView<TSharedPtr<FBetterPABodyListItem>>)
+			.ListItemsSource(&FilteredBodyItems)
+			.OnGenerateRow(this, &SBetterPAConstraintGraph::OnGenerateBodyRow)
+			.OnMouseButtonDoubleClick(this, &SBetterPAConstraintGraph::OnBodyDoubleClicked)
+			.SelectionMode(ESelectionMode::Multi)
+		]
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding(0, 4, 0, 0)
 		[
-			ListBox.ToSharedRef()
+			SNew(SButton)
+			.Text(FText::FromString("Add Selected to Graph"))
+			.ToolTipText(FText::FromString("Adds a node for every selected body that is not in the graph yet. Double click a body to add just that one."))
+			.OnClicked(this, &SBetterPAConstraintGraph::OnAddSelectedBodies)
 		];
 }
 
+TSharedRef<ITableRow> SBetterPAConstraintGraph::OnGenerateBodyRow(TSharedPtr<FBetterPABodyListItem> Item, const TSharedRef<STableViewBase>& OwnerTable)
+{
+	const FName BoneName = Item->BoneName;
+
+	// Only visible rows exist, so the per-frame graph lookup stays cheap
+	return SNew(STableRow<TSharedPtr<FBetterPABodyListItem>>, OwnerTable)
+	[
+		SNew(SHorizontalBox)
+		+ SHorizontalBox::Slot()
+		.FillWidth(1.0f)
+		[
+			SNew(STextBlock)
+			.Text(FText::FromName(BoneName))
+			.ColorAndOpacity_Lambda([this, BoneName]()
+			{
+				return IsBoneInGraph(BoneName) ? FSlateColor::UseSubduedForeground() : FSlateColor::UseForeground();
+			})
+		]
+		+ SHorizontalBox::Slot()
+		.AutoWidth()
+		.Padding(6, 0, 0, 0)
+		[
+			SNew(STextBlock)
+			.Text(FText::FromString("In Graph"))
+			.ColorAndOpacity(FSlateColor::UseSubduedForeground())
+			.Visibility_Lambda([this, BoneName]()
+			{
+				return IsBoneInGraph(BoneName) ? EVisibility::Visible : EVisibility::Collapsed;
+			})
+		]
+	];
+}
+
+void SBetterPAConstraintGraph::OnBodyFilterChanged(const FText& NewText)
+{
+	const FString NewFilter = NewText.ToString().TrimStartAndEnd().ToLower();
+
+	// Narrowing the filter only needs to look at what is currently shown
+	const bool bNarrowing = !BodyFilter.IsEmpty() && NewFilter.StartsWith(BodyFilter, ESearchCase::CaseSensitive);
+	if (!bNarrowing)
+	{
+		FilteredBodyItems = BodyItems;
+	}
+
+	if (!NewFilter.IsEmpty())
+	{
+		FilteredBodyItems.RemoveAll([&NewFilter](const TSharedPtr<FBetterPABodyListItem>& Item)
+		{
+			return !Item->SearchKey.Contains(NewFilter, ESearchCase::CaseSensitive);
+		});
+	}
+
+	BodyFilter = NewFilter;
+	BodyListView->RequestListRefresh();
+}
+
+void SBetterPAConstraintGraph::OnBodyDoubleClicked(TSharedPtr<FBetterPABodyListItem> Item)
+{
+	if (Item.IsValid())
+	{
+		AddBodyNodes(MakeArrayView(&Item, 1));
+	}
+}
+
+FReply SBetterPAConstraintGraph::OnAddSelectedBodies()
+{
+	TArray<TSharedPtr<FBetterPABodyListItem>> SelectedItems = BodyListView->GetSelectedItems();
+
+	// Selection order is click order, add in list order instead
+	SelectedItems.Sort([](const TSharedPtr<FBetterPABodyListItem>& A, const TSharedPtr<FBetterPABodyListItem>& B)
+	{
+		return A->SearchKey < B->SearchKey;
+	});
+
+	AddBodyNodes(SelectedItems);
+	return FReply::Handled();
+}
+
+bool SBetterPAConstraintGraph::IsBoneInGraph(FName BoneName) const
+{
+	return GraphObj && GraphObj->ContainsBone(BoneName);
+}
+
 TSharedRef<SWidget> SBetterPAConstraintGraph::CreateSettingsPanel()
 {
 	return SNew(SVerticalBox)
@@ -192,268 +445,458 @@ TSharedRef<SWidget> SBetterPAConstraintGraph::CreateSettingsPanel()
 					.MaxValue(10.0f)
 				]
 			]
+		]
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding(2)
+		[
+			SNew(SCheckBox)
+			.IsChecked(this, &SBetterPAConstraintGraph::GetRagdollProfilesCheckState)
+			.OnCheckStateChanged(this, &SBetterPAConstraintGraph::OnRagdollProfilesChanged)
+			.ToolTipText(FText::FromString("Give new constraints LimpDeath, Stumble and HitReaction profiles next to their default limits"))
+			[
+				SNew(STextBlock).Text(FText::FromString("Ragdoll Profiles"))
+			]
+		]
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding(2, 6, 2, 2)
+		[
+			SNew(STextBlock)
+			.Text(FText::FromString("Graph Settings"))
+			.Font(FCoreStyle::GetDefaultFontStyle("Bold", 10))
+		]
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding(2)
+		[
+			SNew(SCheckBox)
+			.IsChecked(this, &SBetterPAConstraintGraph::GetLiveSyncCheckState)
+			.OnCheckStateChanged(this, &SBetterPAConstraintGraph::OnLiveSyncChanged)
+			.ToolTipText(FText::FromString("Add and remove constraints as links are edited, one undoable transaction per edit"))
+			[
+				SNew(STextBlock).Text(FText::FromString("Live Sync"))
+			]
+		]
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding(2)
+		[
+			SNew(SCheckBox)
+			.IsChecked(this, &SBetterPAConstraintGraph::GetCollapseChainsCheckState)
+			.OnCheckStateChanged(this, &SBetterPAConstraintGraph::OnCollapseChainsChanged)
+			[
+				SNew(STextBlock).Text(FText::FromString("Collapse Bone Chains"))
+			]
+		]
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding(2)
+		[
+			SNew(SHorizontalBox)
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.Padding(0, 0, 4, 0)
+			[
+				SNew(STextBlock).Text(FText::FromString("Min Chain Length:"))
+			]
+			+ SHorizontalBox::Slot()
+			.FillWidth(1.0f)
+			[
+				SNew(SSpinBox<int32>)
+				.Value(this, &SBetterPAConstraintGraph::GetMinChainLength)
+				.OnValueChanged(this, &SBetterPAConstraintGraph::OnMinChainLengthChanged)
+				.MinValue(2)
+				.MaxValue(64)
+			]
 		];
 }
 
-FReply SBetterPAConstraintGraph::OnAddBodyNode(FName BoneName, int32 BodyIndex)
+void SBetterPAConstraintGraph::AddBodyNodes(TConstArrayView<TSharedPtr<FBetterPABodyListItem>> Items)
 {
-	if (GraphObj)
+	if (!GraphObj)
 	{
+		return;
+	}
+
+	TArray<UBetterPAConstraintGraphNode*> AddedNodes;
+	for (const TSharedPtr<FBetterPABodyListItem>& Item : Items)
+	{
+		if (GraphObj->ContainsBone(Item->BoneName))
+		{
+			continue;
+		}
+
 		UBetterPAConstraintGraphNode* NewNode = NewObject<UBetterPAConstraintGraphNode>(GraphObj);
-		NewNode->BoneName = BoneName;
-		NewNode->BodyIndex = BodyIndex;
-		
+		NewNode->BoneName = Item->BoneName;
+		NewNode->BodyIndex = Item->BodyIndex;
+
 		NewNode->CreateNewGuid();
+		// Stack manually added nodes so they don't all land on top of each other
 		NewNode->NodePosX = 0;
-		NewNode->NodePosY = 0;
+		NewNode->NodePosY = GraphObj->Nodes.Num() * NodeSpacingY;
 		NewNode->AllocateDefaultPins();
-		
-		GraphObj->AddNode(NewNode);
-		NewNode->GetGraph()->NotifyGraphChanged();
+
+		GraphObj->AddNode(NewNode, false, false);
+		AddedNodes.Add(NewNode);
+	}
+
+	if (AddedNodes.Num() > 0)
+	{
+		// Show the constraints the asset already has on these bones, so applying later does not read them as removed
+		GraphObj->LinkFromAsset(AddedNodes);
+		GraphObj->NotifyGraphChanged();
 	}
-	return FReply::Handled();
 }
 
-FReply SBetterPAConstraintGraph::OnApplyChanges()
+FReply SBetterPAConstraintGraph::OnLoadFromAsset()
 {
 	if (!PhysicsAsset || !GraphObj)
 	{
 		return FReply::Handled();
 	}
 
-	for (UEdGraphNode* Node : GraphObj->Nodes)
+	const int32 NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+
+	// Constraint edges between body indices, parent to child
+	TArray<TArray<int32>> BodyChildren;
+	TArray<int32> BodyInDegree;
+	BodyChildren.SetNum(NumBodies);
+	BodyInDegree.Init(0, NumBodies);
+
+	for (UPhysicsConstraintTemplate* Constraint : PhysicsAsset->ConstraintSetup)
 	{
-		UBetterPAConstraintGraphNode* SourceNode = Cast<UBetterPAConstraintGraphNode>(Node);
-		if (!SourceNode) continue;
+		if (!Constraint)
+		{
+			continue;
+		}
 
-		// Check outputs
-		for (UEdGraphPin* Pin : SourceNode->Pins)
+		FName ParentBone;
+		FName ChildBone;
+		GraphObj->GetContext().GetParentAndChild(Constraint->DefaultInstance.ConstraintBone1, Constraint->DefaultInstance.ConstraintBone2, ParentBone, ChildBone);
+
+		const int32 ChildBody = PhysicsAsset->FindBodyIndex(ChildBone);
+		const int32 ParentBody = PhysicsAsset->FindBodyIndex(ParentBone);
+		if (ChildBody != INDEX_NONE && ParentBody != INDEX_NONE && ChildBody != ParentBody)
+		{
+			BodyChildren[ParentBody].Add(ChildBody);
+			++BodyInDegree[ChildBody];
+		}
+	}
+
+	// Visit bodies top-down so a chain is always entered at its head
+	TArray<int32> BodyOrder;
+	BodyOrder.Reserve(NumBodies);
+	TBitArray<> BodyVisited(false, NumBodies);
+	for (int32 Pass = 0; Pass < 2; ++Pass)
+	{
+		for (int32 Seed = 0; Seed < NumBodies; ++Seed)
 		{
-			if (Pin->Direction == EGPD_Output)
+			if (BodyVisited[Seed] || (Pass == 0 && BodyInDegree[Seed] > 0))
 			{
-				for (UEdGraphPin* LinkedPin : Pin->LinkedTo)
+				continue;
+			}
+
+			BodyVisited[Seed] = true;
+			for (int32 QueueIndex = BodyOrder.Add(Seed); QueueIndex < BodyOrder.Num(); ++QueueIndex)
+			{
+				for (int32 Child : BodyChildren[BodyOrder[QueueIndex]])
 				{
-					UBetterPAConstraintGraphNode* TargetNode = Cast<UBetterPAConstraintGraphNode>(LinkedPin->GetOwningNode());
-					if (TargetNode)
+					if (!BodyVisited[Child])
 					{
-						FName Bone1Name = SourceNode->BoneName;
-						FName Bone2Name = TargetNode->BoneName;
+						BodyVisited[Child] = true;
+						BodyOrder.Add(Child);
+					}
+				}
+			}
+		}
+	}
 
-						// Check if constraint already exists
-						bool bExists = false;
-						for (UPhysicsConstraintTemplate* ExistingConstraint : PhysicsAsset->ConstraintSetup)
-						{
-							if ((ExistingConstraint->DefaultInstance.ConstraintBone1 == Bone1Name && ExistingConstraint->DefaultInstance.ConstraintBone2 == Bone2Name) ||
-								(ExistingConstraint->DefaultInstance.ConstraintBone1 == Bone2Name && ExistingConstraint->DefaultInstance.ConstraintBone2 == Bone1Name))
-							{
-								bExists = true;
-								break;
-							}
-						}
+	// Group bodies into graph nodes, runs of single-parent single-child bodies become one summary node
+	TArray<FGraphLayoutNode> LayoutNodes;
+	TArray<int32> NodeOfBody;
+	NodeOfBody.Init(INDEX_NONE, NumBodies);
 
-						if (bExists)
-						{
-							continue; // Skip existing
-						}
+	for (int32 Body : BodyOrder)
+	{
+		if (NodeOfBody[Body] != INDEX_NONE)
+		{
+			continue;
+		}
 
-						// Create Constraint between SourceNode and TargetNode
-						UPhysicsConstraintTemplate* NewConstraint = NewObject<UPhysicsConstraintTemplate>(PhysicsAsset, NAME_None, RF_Transactional);
-						
-						NewConstraint->DefaultInstance.ConstraintBone1 = Bone1Name;
-						NewConstraint->DefaultInstance.ConstraintBone2 = Bone2Name;
-						
-						NewConstraint->DefaultInstance.ProfileInstance.bDisableCollision = true;
-
-						// Calculate Transforms
-						FTransform T1 = FTransform::Identity;
-						FTransform T2 = FTransform::Identity;
-						bool bTransformsValid = false;
-						
-						// We need to find the center of the capsules, not just the bone locations.
-						// The bone location is T1.GetLocation().
-						// The capsule center is defined in the BodySetup AggGeom.
-						FVector Body1Center = FVector::ZeroVector;
-						FVector Body2Center = FVector::ZeroVector;
-
-						if (USkeletalMesh* SkelMesh = PhysicsAsset->PreviewSkeletalMesh.Get())
-						{
-							const FReferenceSkeleton& RefSkeleton = SkelMesh->GetRefSkeleton();
-							int32 BoneIndex1 = RefSkeleton.FindBoneIndex(Bone1Name);
-							int32 BoneIndex2 = RefSkeleton.FindBoneIndex(Bone2Name);
-							
-							if (BoneIndex1 != INDEX_NONE && BoneIndex2 != INDEX_NONE)
-							{
-								TArray<FTransform> ComponentSpaceTransforms;
-								FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, RefSkeleton.GetRefBonePose(), ComponentSpaceTransforms);
-								
-								T1 = ComponentSpaceTransforms[BoneIndex1];
-								T2 = ComponentSpaceTransforms[BoneIndex2];
-								bTransformsValid = true;
-								
-								// Find BodySetup for Bone1
-								int32 BodyIndex1 = PhysicsAsset->FindBodyIndex(Bone1Name);
-								if (BodyIndex1 != INDEX_NONE)
-								{
-									USkeletalBodySetup* BS1 = PhysicsAsset->SkeletalBodySetups[BodyIndex1];
-									if (BS1 && BS1->AggGeom.SphylElems.Num() > 0)
-									{
-										// Use the first capsule's center (transformed to component space)
-										// SphylElem.Center is in Bone Space (Local to T1)
-										Body1Center = T1.TransformPosition(BS1->AggGeom.SphylElems[0].Center);
-									}
-									else
-									{
-										Body1Center = T1.GetLocation();
-									}
-								}
-								
-								// Find BodySetup for Bone2
-								int32 BodyIndex2 = PhysicsAsset->FindBodyIndex(Bone2Name);
-								if (BodyIndex2 != INDEX_NONE)
-								{
-									USkeletalBodySetup* BS2 = PhysicsAsset->SkeletalBodySetups[BodyIndex2];
-									if (BS2 && BS2->AggGeom.SphylElems.Num() > 0)
-									{
-										Body2Center = T2.TransformPosition(BS2->AggGeom.SphylElems[0].Center);
-									}
-									else
-									{
-										Body2Center = T2.GetLocation();
-									}
-								}
-							}
-						}
+		TArray<int32> Chain;
+		Chain.Add(Body);
+		if (bCollapseChains)
+		{
+			int32 Current = Body;
+			while (BodyChildren[Current].Num() == 1)
+			{
+				const int32 Next = BodyChildren[Current][0];
+				if (BodyInDegree[Next] != 1 || NodeOfBody[Next] != INDEX_NONE || Next == Body)
+				{
+					break;
+				}
+				Chain.Add(Next);
+				Current = Next;
+			}
 
-						if (CurrentMode == EConstraintGenerationMode::Standard)
-						{
-							// Standard Mode: Locked Linear, Limited Angular (45 deg)
-							NewConstraint->DefaultInstance.SetAngularSwing1Limit(EAngularConstraintMotion::ACM_Limited, 45.0f);
-							NewConstraint->DefaultInstance.SetAngularSwing2Limit(EAngularConstraintMotion::ACM_Limited, 45.0f);
-							NewConstraint->DefaultInstance.SetAngularTwistLimit(EAngularConstraintMotion::ACM_Limited, 45.0f);
-
-							NewConstraint->DefaultInstance.SetLinearXLimit(ELinearConstraintMotion::LCM_Locked, 0.0f);
-							NewConstraint->DefaultInstance.SetLinearYLimit(ELinearConstraintMotion::LCM_Locked, 0.0f);
-							NewConstraint->DefaultInstance.SetLinearZLimit(ELinearConstraintMotion::LCM_Locked, 0.0f);
-
-							if (bTransformsValid)
-							{
-								// Constraint at Body2 (Target) location (Standard behavior: usually at child bone)
-								
-								// Pos1 (Relative to Body1/Parent)
-								NewConstraint->DefaultInstance.Pos1 = T1.InverseTransformPosition(T2.GetLocation());
-								
-								// Orientation relative to Body1/Parent (aligned with Child)
-								FQuat RelRot1 = T1.GetRotation().Inverse() * T2.GetRotation();
-								NewConstraint->DefaultInstance.PriAxis1 = RelRot1.GetAxisX();
-								NewConstraint->DefaultInstance.SecAxis1 = RelRot1.GetAxisY();
-
-								// Pos2 (Relative to Body2/Child)
-								NewConstraint->DefaultInstance.Pos2 = FVector::ZeroVector;
-								
-								// Orientation relative to Body2/Child (Identity)
-								NewConstraint->DefaultInstance.PriAxis2 = FVector(1,0,0);
-								NewConstraint->DefaultInstance.SecAxis2 = FVector(0,1,0);
-							}
-						}
-						else if (CurrentMode == EConstraintGenerationMode::Mesh)
-						{
-							// Mesh Mode: Free Angular, Limited Linear
-							NewConstraint->DefaultInstance.SetAngularSwing1Limit(EAngularConstraintMotion::ACM_Free, 0.0f);
-							NewConstraint->DefaultInstance.SetAngularSwing2Limit(EAngularConstraintMotion::ACM_Free, 0.0f);
-							NewConstraint->DefaultInstance.SetAngularTwistLimit(EAngularConstraintMotion::ACM_Free, 0.0f);
-
-							float LinearLimit = 0.0f;
-							if (bTransformsValid)
-							{
-								// Distance between CENTERS of capsules
-								float Distance = FVector::Dist(Body1Center, Body2Center);
-								if (bScaleByDistance)
-								{
-									LinearLimit = Distance * ScalingFactor;
-								}
-								else
-								{
-									LinearLimit = 10.0f; 
-								}
-							}
-
-							NewConstraint->DefaultInstance.SetLinearXLimit(ELinearConstraintMotion::LCM_Limited, LinearLimit);
-							NewConstraint->DefaultInstance.SetLinearYLimit(ELinearConstraintMotion::LCM_Limited, LinearLimit);
-							NewConstraint->DefaultInstance.SetLinearZLimit(ELinearConstraintMotion::LCM_Limited, LinearLimit);
-
-							if (bTransformsValid)
-							{
-								// Constraint at Midpoint of CENTERS
-								FVector MidPoint = (Body1Center + Body2Center) * 0.5f;
-
-								// Pos1 (Relative to Body1)
-								NewConstraint->DefaultInstance.Pos1 = T1.InverseTransformPosition(MidPoint);
-								// Orientation: Identity relative to world? Or aligned with connection?
-								// Usually constraints are aligned with one of the bodies or the connection.
-								// Let's align with Body1 for simplicity, or World.
-								// If Free Angular, orientation matters less for limits, but matters for reference frames.
-								NewConstraint->DefaultInstance.PriAxis1 = FVector(1,0,0);
-								NewConstraint->DefaultInstance.SecAxis1 = FVector(0,1,0);
-
-								// Pos2 (Relative to Body2)
-								NewConstraint->DefaultInstance.Pos2 = T2.InverseTransformPosition(MidPoint);
-								
-								// Orientation relative to Body2 (to match Body1's frame at that point if we want them aligned)
-								// If we use Body1's rotation as the constraint frame:
-								FQuat RelRot = T2.GetRotation().Inverse() * T1.GetRotation();
-								NewConstraint->DefaultInstance.PriAxis2 = RelRot.GetAxisX();
-								NewConstraint->DefaultInstance.SecAxis2 = RelRot.GetAxisY();
-							}
-						}
+			if (Chain.Num() < MinChainLength)
+			{
+				Chain.SetNum(1);
+			}
+		}
 
-						PhysicsAsset->ConstraintSetup.Add(NewConstraint);
-					}
+		const int32 NodeIndex = LayoutNodes.AddDefaulted();
+		for (int32 ChainBody : Chain)
+		{
+			NodeOfBody[ChainBody] = NodeIndex;
+		}
+		LayoutNodes[NodeIndex].Bodies = MoveTemp(Chain);
+	}
+
+	// Node level edges, links inside a collapsed chain are implied
+	for (int32 ParentBody = 0; ParentBody < NumBodies; ++ParentBody)
+	{
+		for (int32 ChildBody : BodyChildren[ParentBody])
+		{
+			const int32 ParentNode = NodeOfBody[ParentBody];
+			const int32 ChildNode = NodeOfBody[ChildBody];
+			if (ParentNode != ChildNode && ParentNode != INDEX_NONE && ChildNode != INDEX_NONE)
+			{
+				LayoutNodes[ParentNode].Children.AddUnique(ChildNode);
+				LayoutNodes[ChildNode].Parents.AddUnique(ParentNode);
+			}
+		}
+	}
+
+	TArray<FVector2D> Positions;
+	LayoutLayered(LayoutNodes, Positions);
+
+	// Drop the old nodes in bulk, the indices are rebuilt once the new nodes are in and the change is announced once
+	GraphObj->RemoveAllNodes();
+
+	TArray<UBetterPAConstraintGraphNode*> GraphNodes;
+	GraphNodes.Reserve(LayoutNodes.Num());
+	for (int32 NodeIndex = 0; NodeIndex < LayoutNodes.Num(); ++NodeIndex)
+	{
+		const FGraphLayoutNode& LayoutNode = LayoutNodes[NodeIndex];
+		const int32 HeadBody = LayoutNode.Bodies[0];
+
+		UBetterPAConstraintGraphNode* NewNode = NewObject<UBetterPAConstraintGraphNode>(GraphObj);
+		NewNode->BoneName = PhysicsAsset->SkeletalBodySetups[HeadBody] ? PhysicsAsset->SkeletalBodySetups[HeadBody]->BoneName : NAME_None;
+		NewNode->BodyIndex = HeadBody;
+		if (LayoutNode.Bodies.Num() > 1)
+		{
+			for (int32 ChainBody : LayoutNode.Bodies)
+			{
+				if (const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups.IsValidIndex(ChainBody) ? PhysicsAsset->SkeletalBodySetups[ChainBody].Get() : nullptr)
+				{
+					NewNode->CollapsedBones.Add(BodySetup->BoneName);
 				}
 			}
 		}
+
+		NewNode->CreateNewGuid();
+		NewNode->NodePosX = FMath::RoundToInt(Positions[NodeIndex].X);
+		NewNode->NodePosY = FMath::RoundToInt(Positions[NodeIndex].Y);
+		NewNode->AllocateDefaultPins();
+
+		GraphObj->Nodes.Add(NewNode);
+		GraphNodes.Add(NewNode);
 	}
 
-	PhysicsAsset->UpdateBodySetupIndexMap();
-	PhysicsAsset->UpdateBoundsBodiesArray();
-	PhysicsAsset->MarkPackageDirty();
+	for (int32 NodeIndex = 0; NodeIndex < LayoutNodes.Num(); ++NodeIndex)
+	{
+		UEdGraphPin* OutPin = GraphNodes[NodeIndex]->FindPin(TEXT("Out"));
+		for (int32 ChildNode : LayoutNodes[NodeIndex].Children)
+		{
+			UEdGraphPin* InPin = GraphNodes[ChildNode]->FindPin(TEXT("In"));
+			if (OutPin && InPin)
+			{
+				OutPin->MakeLinkTo(InPin);
+			}
+		}
+	}
+
+	GraphObj->RebuildIndex();
+	GraphObj->NotifyGraphChanged();
+
+	return FReply::Handled();
+}
+
+FReply SBetterPAConstraintGraph::OnApplyChanges()
+{
+	if (PhysicsAsset && GraphObj)
+	{
+		GraphObj->ApplyToAsset();
+	}
 	
 	return FReply::Handled();
 }
 
+void SBetterPAConstraintGraph::PostUndo(bool bSuccess)
+{
+	// Undo restores the asset and the graph links from the same transaction, the diff only fixes what is left over
+	if (GraphObj)
+	{
+		GraphObj->RebuildLinkIndex();
+		GraphObj->SyncFromAsset();
+	}
+}
+
+void SBetterPAConstraintGraph::PostRedo(bool bSuccess)
+{
+	PostUndo(bSuccess);
+}
+
+void SBetterPAConstraintGraph::OnObjectModified(UObject* Object)
+{
+	QueueAssetSync(Object);
+}
+
+void SBetterPAConstraintGraph::OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+{
+	QueueAssetSync(Object);
+}
+
+void SBetterPAConstraintGraph::QueueAssetSync(UObject* Object)
+{
+	if (!PhysicsAsset || !GraphObj || !Object || GraphObj->IsApplyingToAsset())
+	{
+		return;
+	}
+
+	if (Object == PhysicsAsset)
+	{
+		bPendingAssetSync = true;
+	}
+	else if (UPhysicsConstraintTemplate* Constraint = Cast<UPhysicsConstraintTemplate>(Object))
+	{
+		if (Constraint->GetOuter() != PhysicsAsset)
+		{
+			return;
+		}
+		PendingConstraintSyncs.Add(Constraint);
+	}
+	else
+	{
+		return;
+	}
+
+	// Modify() is called before the edit happens, so look at the asset once the current frame is done
+	if (!bAssetSyncScheduled)
+	{
+		bAssetSyncScheduled = true;
+		RegisterActiveTimer(0.0f, FWidgetActiveTimerDelegate::CreateSP(this, &SBetterPAConstraintGraph::OnDeferredAssetSync));
+	}
+}
+
+EActiveTimerReturnType SBetterPAConstraintGraph::OnDeferredAssetSync(double InCurrentTime, float InDeltaTime)
+{
+	bAssetSyncScheduled = false;
+
+	if (GraphObj)
+	{
+		// Asset edits only matter to the graph through its constraint list, edited constraints are synced one by one
+		if (bPendingAssetSync)
+		{
+			GraphObj->SyncConstraintSetup();
+		}
+		for (const TWeakObjectPtr<UPhysicsConstraintTemplate>& Constraint : PendingConstraintSyncs)
+		{
+			GraphObj->SyncConstraint(Constraint.Get());
+		}
+	}
+
+	bPendingAssetSync = false;
+	PendingConstraintSyncs.Reset();
+	return EActiveTimerReturnType::Stop;
+}
+
 void SBetterPAConstraintGraph::OnModeChanged(ECheckBoxState NewState, EConstraintGenerationMode Mode)
 {
 	if (NewState == ECheckBoxState::Checked)
 	{
-		CurrentMode = Mode;
+		GraphObj->ConstraintSettings.Mode = Mode;
 	}
 }
 
 ECheckBoxState SBetterPAConstraintGraph::GetModeCheckState(EConstraintGenerationMode Mode) const
 {
-	return CurrentMode == Mode ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+	return GraphObj->ConstraintSettings.Mode == Mode ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
 }
 
 void SBetterPAConstraintGraph::OnScaleByDistanceChanged(ECheckBoxState NewState)
 {
-	bScaleByDistance = (NewState == ECheckBoxState::Checked);
+	GraphObj->ConstraintSettings.bScaleByDistance = (NewState == ECheckBoxState::Checked);
 }
 
 ECheckBoxState SBetterPAConstraintGraph::GetScaleByDistanceCheckState() const
 {
-	return bScaleByDistance ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+	return GraphObj->ConstraintSettings.bScaleByDistance ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
 }
 
 void SBetterPAConstraintGraph::OnScalingFactorChanged(float NewValue)
 {
-	ScalingFactor = NewValue;
+	GraphObj->ConstraintSettings.ScalingFactor = NewValue;
 }
 
 float SBetterPAConstraintGraph::GetScalingFactor() const
 {
-	return ScalingFactor;
+	return GraphObj->ConstraintSettings.ScalingFactor;
 }
 
 bool SBetterPAConstraintGraph::IsMeshSettingsEnabled() const
 {
-	return CurrentMode == EConstraintGenerationMode::Mesh;
+	return GraphObj->ConstraintSettings.Mode == EConstraintGenerationMode::Mesh;
+}
+
+void SBetterPAConstraintGraph::OnRagdollProfilesChanged(ECheckBoxState NewState)
+{
+	GraphObj->ConstraintSettings.Profiles = NewState == ECheckBoxState::Checked ? BetterPA::GetRagdollProfilePresets() : TArray<FBetterPAConstraintProfileRule>();
+}
+
+ECheckBoxState SBetterPAConstraintGraph::GetRagdollProfilesCheckState() const
+{
+	return GraphObj->ConstraintSettings.Profiles.Num() > 0 ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+}
+
+FReply SBetterPAConstraintGraph::OnWriteProfiles()
+{
+	if (PhysicsAsset && GraphObj)
+	{
+		GraphObj->ApplyProfilesToAsset();
+	}
+
+	return FReply::Handled();
+}
+
+void SBetterPAConstraintGraph::OnLiveSyncChanged(ECheckBoxState NewState)
+{
+	GraphObj->bLiveSync = (NewState == ECheckBoxState::Checked);
+}
+
+ECheckBoxState SBetterPAConstraintGraph::GetLiveSyncCheckState() const
+{
+	return GraphObj->bLiveSync ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+}
+
+void SBetterPAConstraintGraph::OnCollapseChainsChanged(ECheckBoxState NewState)
+{
+	bCollapseChains = (NewState == ECheckBoxState::Checked);
+}
+
+ECheckBoxState SBetterPAConstraintGraph::GetCollapseChainsCheckState() const
+{
+	return bCollapseChains ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+}
+
+void SBetterPAConstraintGraph::OnMinChainLengthChanged(int32 NewValue)
+{
+	MinChainLength = NewValue;
+}
+
+int32 SBetterPAConstraintGraph::GetMinChainLength() const
+{
+	return MinChainLength;
 }
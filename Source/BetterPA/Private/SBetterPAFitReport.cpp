@@ -0,0 +1,174 @@
+#include "SBetterPAFitReport.h"
+#include "Widgets/Text/STextBlock.h"
+#include "Widgets/Layout/SBorder.h"
+
+namespace BetterPAFitReportColumns
+{
+	static const FName Bone("Bone");
+	static const FName Vertices("Vertices");
+	static const FName Coverage("Coverage");
+	static const FName OverInflation("OverInflation");
+	static const FName MaxPenetration("MaxPenetration");
+	static const FName MeanDistance("MeanDistance");
+}
+
+class SBetterPAFitReportRow : public SMultiColumnTableRow<TSharedPtr<FBetterPABodyFitStats>>
+{
+public:
+	SLATE_BEGIN_ARGS(SBetterPAFitReportRow) {}
+		SLATE_ARGUMENT(TSharedPtr<FBetterPABodyFitStats>, Item)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs, const TSharedRef<STableViewBase>& OwnerTable)
+	{
+		Item = InArgs._Item;
+		SMultiColumnTableRow<TSharedPtr<FBetterPABodyFitStats>>::Construct(FSuperRowType::FArguments(), OwnerTable);
+	}
+
+	virtual TSharedRef<SWidget> GenerateWidgetForColumn(const FName& ColumnName) override
+	{
+		FText Text;
+		if (ColumnName == BetterPAFitReportColumns::Bone)
+		{
+			Text = FText::FromName(Item->BoneName);
+		}
+		else if (ColumnName == BetterPAFitReportColumns::Vertices)
+		{
+			Text = FText::AsNumber(Item->NumVertices);
+		}
+		else if (ColumnName == BetterPAFitReportColumns::Coverage)
+		{
+			Text = FText::AsPercent(Item->Coverage);
+		}
+		else if (ColumnName == BetterPAFitReportColumns::OverInflation)
+		{
+			Text = FText::AsPercent(Item->OverInflation);
+		}
+		else if (ColumnName == BetterPAFitReportColumns::MaxPenetration)
+		{
+			Text = FText::FromString(FString::Printf(TEXT("%.2f"), Item->MaxPenetration));
+		}
+		else if (ColumnName == BetterPAFitReportColumns::MeanDistance)
+		{
+			Text = FText::FromString(FString::Printf(TEXT("%.2f"), Item->MeanDistance));
+		}
+
+		return SNew(STextBlock)
+			.Text(Text)
+			.ColorAndOpacity(Item->bOutlier ? FLinearColor(1.0f, 0.35f, 0.2f) : FLinearColor::White);
+	}
+
+private:
+	TSharedPtr<FBetterPABodyFitStats> Item;
+};
+
+void SBetterPAFitReport::Construct(const FArguments& InArgs)
+{
+	SortColumn = BetterPAFitReportColumns::Coverage;
+	SortMode = EColumnSortMode::Ascending;
+	ReportPath = InArgs._ReportPath;
+	NumOutliers = 0;
+
+	for (const FBetterPABodyFitStats& Stats : InArgs._Stats)
+	{
+		Items.Add(MakeShared<FBetterPABodyFitStats>(Stats));
+		NumOutliers += Stats.bOutlier ? 1 : 0;
+	}
+	SortItems();
+
+	auto MakeColumn = [this](FName ColumnId, const FString& Label, float FillWidth)
+	{
+		return SHeaderRow::Column(ColumnId)
+			.DefaultLabel(FText::FromString(Label))
+			.FillWidth(FillWidth)
+			.SortMode(this, &SBetterPAFitReport::GetColumnSortMode, ColumnId)
+			.OnSort(this, &SBetterPAFitReport::OnSortModeChanged);
+	};
+
+	ChildSlot
+	[
+		SNew(SBorder)
+		.Padding(4)
+		[
+			SNew(SVerticalBox)
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(2)
+			[
+				SNew(STextBlock)
+				.Text(FText::FromString(FString::Printf(TEXT("%d bodies, %d outliers. Report: %s"), Items.Num(), NumOutliers, *ReportPath)))
+			]
+			+ SVerticalBox::Slot()
+			.FillHeight(1.0f)
+			[
+				SAssignNew(ListView, SListView<TSharedPtr<FBetterPABodyFitStats>>)
+				.ListItemsSource(&Items)
+				.OnGenerateRow(this, &SBetterPAFitReport::OnGenerateRow)
+				.SelectionMode(ESelectionMode::Single)
+				.HeaderRow
+				(
+					SNew(SHeaderRow)
+					+ MakeColumn(BetterPAFitReportColumns::Bone, TEXT("Bone"), 2.0f)
+					+ MakeColumn(BetterPAFitReportColumns::Vertices, TEXT("Vertices"), 1.0f)
+					+ MakeColumn(BetterPAFitReportColumns::Coverage, TEXT("Coverage"), 1.0f)
+					+ MakeColumn(BetterPAFitReportColumns::OverInflation, TEXT("Over-Inflation"), 1.0f)
+					+ MakeColumn(BetterPAFitReportColumns::MaxPenetration, TEXT("Max Penetration"), 1.0f)
+					+ MakeColumn(BetterPAFitReportColumns::MeanDistance, TEXT("Mean Distance"), 1.0f)
+				)
+			]
+		]
+	];
+}
+
+TSharedRef<ITableRow> SBetterPAFitReport::OnGenerateRow(TSharedPtr<FBetterPABodyFitStats> Item, const TSharedRef<STableViewBase>& OwnerTable)
+{
+	return SNew(SBetterPAFitReportRow, OwnerTable)
+		.Item(Item);
+}
+
+void SBetterPAFitReport::OnSortModeChanged(EColumnSortPriority::Type Priority, const FName& ColumnId, EColumnSortMode::Type NewSortMode)
+{
+	SortColumn = ColumnId;
+	SortMode = NewSortMode;
+	SortItems();
+
+	if (ListView.IsValid())
+	{
+		ListView->RequestListRefresh();
+	}
+}
+
+EColumnSortMode::Type SBetterPAFitReport::GetColumnSortMode(FName ColumnId) const
+{
+	return SortColumn == ColumnId ? SortMode : EColumnSortMode::None;
+}
+
+void SBetterPAFitReport::SortItems()
+{
+	const bool bAscending = SortMode != EColumnSortMode::Descending;
+	const FName Column = SortColumn;
+
+	auto GetKey = [Column](const FBetterPABodyFitStats& Stats) -> float
+	{
+		if (Column == BetterPAFitReportColumns::Vertices) return (float)Stats.NumVertices;
+		if (Column == BetterPAFitReportColumns::OverInflation) return Stats.OverInflation;
+		if (Column == BetterPAFitReportColumns::MaxPenetration) return Stats.MaxPenetration;
+		if (Column == BetterPAFitReportColumns::MeanDistance) return Stats.MeanDistance;
+		return Stats.Coverage;
+	};
+
+	if (Column == BetterPAFitReportColumns::Bone)
+	{
+		Items.Sort([bAscending](const TSharedPtr<FBetterPABodyFitStats>& A, const TSharedPtr<FBetterPABodyFitStats>& B)
+		{
+			return bAscending ? A->BoneName.LexicalLess(B->BoneName) : B->BoneName.LexicalLess(A->BoneName);
+		});
+	}
+	else
+	{
+		Items.Sort([bAscending, &GetKey](const TSharedPtr<FBetterPABodyFitStats>& A, const TSharedPtr<FBetterPABodyFitStats>& B)
+		{
+			return bAscending ? GetKey(*A) < GetKey(*B) : GetKey(*B) < GetKey(*A);
+		});
+	}
+}
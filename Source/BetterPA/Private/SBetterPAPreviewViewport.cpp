@@ -0,0 +1,306 @@
+#include "SBetterPAPreviewViewport.h"
+#include "EditorViewportClient.h"
+#include "Engine/SkeletalMesh.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "AnimationRuntime.h"
+#include "SceneManagement.h"
+#include "Async/Async.h"
+
+namespace
+{
+	// Delay after the last bone toggle before regenerating
+	constexpr float PreviewDebounceSeconds = 0.15f;
+}
+
+class FBetterPAPreviewViewportClient : public FEditorViewportClient
+{
+public:
+	FBetterPAPreviewViewportClient(FPreviewScene& InPreviewScene, const TSharedRef<SBetterPAPreviewViewport>& InViewport, const USkeletalMesh* InSkeletalMesh)
+		: FEditorViewportClient(nullptr, &InPreviewScene, StaticCastSharedRef<SEditorViewport>(InViewport))
+	{
+		SetRealtime(false);
+		EngineShowFlags.SetGrid(true);
+
+		if (InSkeletalMesh)
+		{
+			const FReferenceSkeleton& RefSkeleton = InSkeletalMesh->GetRefSkeleton();
+			FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, RefSkeleton.GetRefBonePose(), ComponentSpaceTransforms);
+
+			const FBoxSphereBounds Bounds = InSkeletalMesh->GetBounds();
+			SetViewLocation(Bounds.Origin + FVector(0.0f, Bounds.SphereRadius * 2.5f, 0.0f));
+			SetViewRotation(FRotator(0.0f, -90.0f, 0.0f));
+		}
+	}
+
+	void SetResult(TSharedPtr<const FBetterPAGenerationResult> InResult)
+	{
+		Result = InResult;
+		Invalidate();
+	}
+
+	virtual void Draw(const FSceneView* View, FPrimitiveDrawInterface* PDI) override
+	{
+		FEditorViewportClient::Draw(View, PDI);
+
+		if (!Result.IsValid())
+		{
+			return;
+		}
+
+		const FLinearColor BodyColor(0.2f, 0.8f, 0.2f);
+		const FLinearColor ConstraintColor(1.0f, 0.6f, 0.1f);
+
+		for (const FBetterPABodyResult& Body : Result->Bodies)
+		{
+			if (!ComponentSpaceTransforms.IsValidIndex(Body.BoneIndex))
+			{
+				continue;
+			}
+
+			const FTransform& BoneTransform = ComponentSpaceTransforms[Body.BoneIndex];
+
+			for (const FKSphylElem& Elem : Body.AggGeom.SphylElems)
+			{
+				const FTransform ElemTransform = Elem.GetTransform() * BoneTransform;
+				DrawWireCapsule(PDI, ElemTransform.GetLocation(),
+					ElemTransform.GetUnitAxis(EAxis::X), ElemTransform.GetUnitAxis(EAxis::Y), ElemTransform.GetUnitAxis(EAxis::Z),
+					BodyColor, Elem.Radius, Elem.Length * 0.5f + Elem.Radius, 16, SDPG_World);
+			}
+
+			for (const FKSphereElem& Elem : Body.AggGeom.SphereElems)
+			{
+				DrawWireSphere(PDI, Elem.GetTransform() * BoneTransform, BodyColor, Elem.Radius, 16, SDPG_World);
+			}
+
+			for (const FKBoxElem& Elem : Body.AggGeom.BoxElems)
+			{
+				const FVector HalfExtent(Elem.X * 0.5f, Elem.Y * 0.5f, Elem.Z * 0.5f);
+				DrawWireBox(PDI, (Elem.GetTransform() * BoneTransform).ToMatrixWithScale(), FBox(-HalfExtent, HalfExtent), BodyColor, SDPG_World);
+			}
+
+			// Hulls are not cooked during preview, show their vertices and bounds
+			for (const FKConvexElem& Elem : Body.AggGeom.ConvexElems)
+			{
+				const FTransform ElemTransform = Elem.GetTransform() * BoneTransform;
+				for (const FVector& Vertex : Elem.VertexData)
+				{
+					PDI->DrawPoint(ElemTransform.TransformPosition(Vertex), BodyColor, 4.0f, SDPG_World);
+				}
+				DrawWireBox(PDI, ElemTransform.ToMatrixWithScale(), Elem.ElemBox, BodyColor, SDPG_World);
+			}
+		}
+
+		for (const FBetterPAConstraintResult& Constraint : Result->Constraints)
+		{
+			const FBetterPABodyResult& Child = Result->Bodies[Constraint.ChildBody];
+			const FBetterPABodyResult& Parent = Result->Bodies[Constraint.ParentBody];
+			if (!ComponentSpaceTransforms.IsValidIndex(Child.BoneIndex) || !ComponentSpaceTransforms.IsValidIndex(Parent.BoneIndex))
+			{
+				continue;
+			}
+
+			const FVector Joint = ComponentSpaceTransforms[Parent.BoneIndex].TransformPosition(Constraint.Pos2);
+			PDI->DrawLine(ComponentSpaceTransforms[Parent.BoneIndex].GetLocation(), Joint, ConstraintColor, SDPG_Foreground);
+			DrawWireSphere(PDI, FTransform(Joint), ConstraintColor, 1.0f, 8, SDPG_Foreground);
+		}
+	}
+
+private:
+	TArray<FTransform> ComponentSpaceTransforms;
+	TSharedPtr<const FBetterPAGenerationResult> Result;
+};
+
+SBetterPAPreviewViewport::SBetterPAPreviewViewport()
+	: SkeletalMesh(nullptr)
+	, PreviewScene(FPreviewScene::ConstructionValues())
+	, PreviewComponent(nullptr)
+	, bShowingCoarse(false)
+	, CoarseLODIndex(INDEX_NONE)
+	, bPendingFullRebuild(false)
+	, bHasPendingRequest(false)
+	, RequestRevision(0)
+	, ResultRevision(0)
+	, bUpdateInFlight(false)
+{
+}
+
+SBetterPAPreviewViewport::~SBetterPAPreviewViewport()
+{
+	// The background update reads the mesh, make sure it is done before the widget lets go of it
+	if (UpdateCancelled.IsValid())
+	{
+		*UpdateCancelled = true;
+	}
+	if (UpdateTask.IsValid())
+	{
+		UpdateTask.Wait();
+	}
+}
+
+void SBetterPAPreviewViewport::Construct(const FArguments& InArgs)
+{
+	SkeletalMesh = InArgs._SkeletalMesh;
+
+	if (SkeletalMesh)
+	{
+		PreviewComponent = NewObject<USkeletalMeshComponent>(GetTransientPackage(), NAME_None, RF_Transient);
+		PreviewComponent->SetSkeletalMesh(SkeletalMesh);
+		PreviewScene.AddComponent(PreviewComponent, FTransform::Identity);
+	}
+
+	SEditorViewport::Construct(SEditorViewport::FArguments());
+}
+
+TSharedRef<FEditorViewportClient> SBetterPAPreviewViewport::MakeEditorViewportClient()
+{
+	PreviewClient = MakeShared<FBetterPAPreviewViewportClient>(PreviewScene, SharedThis(this), SkeletalMesh);
+	return PreviewClient.ToSharedRef();
+}
+
+void SBetterPAPreviewViewport::RequestUpdate(const TSet<FName>& SelectedBones, const TArray<FName>& DirtyBones, const FBetterPAGenerationSettings& Settings, bool bFullRebuild)
+{
+	PendingSelectedBones = SelectedBones;
+	PendingDirtyBones.Append(DirtyBones);
+	PendingSettings = Settings;
+	bPendingFullRebuild |= bFullRebuild;
+	bHasPendingRequest = true;
+	++RequestRevision;
+
+	// The refined fit in flight is for settings that no longer apply, a full rebuild is queued anyway
+	if (bFullRebuild && bUpdateInFlight && UpdateCancelled.IsValid())
+	{
+		*UpdateCancelled = true;
+	}
+
+	// Restart the debounce window on every change
+	if (TSharedPtr<FActiveTimerHandle> Timer = DebounceTimer.Pin())
+	{
+		UnRegisterActiveTimer(Timer.ToSharedRef());
+	}
+	DebounceTimer = RegisterActiveTimer(PreviewDebounceSeconds, FWidgetActiveTimerDelegate::CreateSP(this, &SBetterPAPreviewViewport::OnDebounceElapsed));
+}
+
+TSharedPtr<const FBetterPAGenerationResult> SBetterPAPreviewViewport::GetUpToDateResult() const
+{
+	return (ResultRevision == RequestRevision && !bHasPendingRequest) ? CurrentResult : nullptr;
+}
+
+EActiveTimerReturnType SBetterPAPreviewViewport::OnDebounceElapsed(double InCurrentTime, float InDeltaTime)
+{
+	StartPendingUpdate();
+	return EActiveTimerReturnType::Stop;
+}
+
+void SBetterPAPreviewViewport::StartPendingUpdate()
+{
+	// A running update picks up the pending request when it finishes
+	if (bUpdateInFlight || !bHasPendingRequest || !SkeletalMesh)
+	{
+		return;
+	}
+
+	const USkeletalMesh* Mesh = SkeletalMesh;
+	TSet<FName> SelectedBones = MoveTemp(PendingSelectedBones);
+	TSet<FName> DirtyBones = MoveTemp(PendingDirtyBones);
+	const FBetterPAGenerationSettings Settings = PendingSettings;
+	// A coarse fit on screen means the last refined pass never landed for these settings
+	const bool bFullRebuild = bPendingFullRebuild || !CurrentResult.IsValid() || bShowingCoarse;
+	TSharedPtr<const FBetterPAGenerationResult> Previous = CurrentResult;
+	const int32 Revision = RequestRevision;
+
+	PendingSelectedBones.Reset();
+	PendingDirtyBones.Reset();
+	bPendingFullRebuild = false;
+	bHasPendingRequest = false;
+	bUpdateInFlight = true;
+	UpdateCancelled = MakeShared<FThreadSafeBool>(false);
+
+	TWeakPtr<SBetterPAPreviewViewport> WeakThis = SharedThis(this);
+	TSharedPtr<FThreadSafeBool> Cancelled = UpdateCancelled;
+
+	UpdateTask = Async(EAsyncExecution::ThreadPool, [Mesh, SelectedBones = MoveTemp(SelectedBones), DirtyBones = MoveTemp(DirtyBones), Settings, bFullRebuild, Previous, Revision, Cancelled, WeakThis]()
+	{
+		TSharedPtr<FBetterPAGenerationResult> NewResult = MakeShared<FBetterPAGenerationResult>();
+		bool bFinished = false;
+		if (bFullRebuild)
+		{
+			// Incremental updates refit a handful of bodies and are quick enough without a coarse pass
+			FBetterPAGenerationSettings CoarseSettings;
+			if (FBetterPAGenerator::MakeCoarseSettings(Mesh, Settings, CoarseSettings))
+			{
+				TSharedPtr<FBetterPAGenerationResult> CoarseResult = MakeShared<FBetterPAGenerationResult>();
+				if (FBetterPAGenerator::Generate(Mesh, SelectedBones, CoarseSettings, *CoarseResult, Cancelled.Get()))
+				{
+					const int32 LODIndex = CoarseSettings.LODIndex;
+					AsyncTask(ENamedThreads::GameThread, [WeakThis, CoarseResult, LODIndex, Revision]()
+					{
+						if (TSharedPtr<SBetterPAPreviewViewport> Viewport = WeakThis.Pin())
+						{
+							Viewport->OnCoarseResult(CoarseResult, LODIndex, Revision);
+						}
+					});
+				}
+			}
+
+			bFinished = FBetterPAGenerator::Generate(Mesh, SelectedBones, Settings, *NewResult, Cancelled.Get());
+		}
+		else
+		{
+			bFinished = FBetterPAGenerator::GenerateIncremental(Mesh, SelectedBones, Settings, DirtyBones, *Previous, *NewResult, Cancelled.Get());
+		}
+
+		// A cancelled pass reports no result, the viewport keeps what it had and moves on to the pending request
+		if (!bFinished && *Cancelled)
+		{
+			NewResult.Reset();
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, NewResult, Revision]()
+		{
+			if (TSharedPtr<SBetterPAPreviewViewport> Viewport = WeakThis.Pin())
+			{
+				Viewport->OnUpdateFinished(NewResult, Revision);
+			}
+		});
+	});
+}
+
+void SBetterPAPreviewViewport::OnCoarseResult(TSharedPtr<const FBetterPAGenerationResult> CoarseResult, int32 LODIndex, int32 Revision)
+{
+	// Stale when a newer request came in while the coarse pass ran
+	if (Revision != RequestRevision || !bUpdateInFlight)
+	{
+		return;
+	}
+
+	bShowingCoarse = true;
+	CoarseLODIndex = LODIndex;
+	if (PreviewClient.IsValid())
+	{
+		PreviewClient->SetResult(CoarseResult);
+	}
+}
+
+void SBetterPAPreviewViewport::OnUpdateFinished(TSharedPtr<const FBetterPAGenerationResult> NewResult, int32 Revision)
+{
+	bUpdateInFlight = false;
+	UpdateCancelled.Reset();
+
+	if (NewResult.IsValid())
+	{
+		CurrentResult = NewResult;
+		ResultRevision = Revision;
+		bShowingCoarse = false;
+
+		if (PreviewClient.IsValid())
+		{
+			PreviewClient->SetResult(CurrentResult);
+		}
+	}
+
+	// Changes that arrived while this update ran, and whose debounce already elapsed
+	if (bHasPendingRequest && !DebounceTimer.IsValid())
+	{
+		StartPendingUpdate();
+	}
+}
@@ -4,9 +4,12 @@
 
 #include "Modules/ModuleManager.h"
 #include "ContentBrowserDelegates.h"
+#include "BetterPAAutoRegen.h"
 
 class USkeletalMesh;
 class UPhysicsAsset;
+struct FBetterPAGenerationSettings;
+struct FBetterPAGenerationResult;
 
 class FBetterPAModule : public IModuleInterface
 {
@@ -20,10 +23,22 @@ private:
 	TSharedRef<FExtender> OnExtendContentBrowserAssetSelectionMenu(const TArray<FAssetData>& SelectedAssets);
 	void AddMenuEntry(FMenuBuilder& MenuBuilder, FAssetData SelectedAsset);
 	void OnGenerateBetterPA(FAssetData SelectedAsset);
-	void GeneratePhysicsAsset(FAssetData SelectedAsset, USkeletalMesh* SkeletalMesh, const TSet<FName>& SelectedBones);
+	void GeneratePhysicsAsset(FAssetData SelectedAsset, USkeletalMesh* SkeletalMesh, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings, const FBetterPAGenerationResult* PreviewResult);
 	
 	// New Menu Entry for Physics Asset
 	TSharedRef<FExtender> OnExtendContentBrowserPhysicsAssetSelectionMenu(const TArray<FAssetData>& SelectedAssets);
 	void AddPhysicsAssetMenuEntry(FMenuBuilder& MenuBuilder, FAssetData SelectedAsset);
 	void OnOpenConstraintGraph(FAssetData SelectedAsset);
+	void OnAnalyzeFitQuality(FAssetData SelectedAsset);
+	void OnExportInterchange(FAssetData SelectedAsset);
+	void OnImportInterchange(FAssetData SelectedAsset);
+
+	// Folder context menu for the project-wide audit
+	TSharedRef<FExtender> OnExtendContentBrowserPathSelectionMenu(const TArray<FString>& SelectedPaths);
+	void AddPathMenuEntry(FMenuBuilder& MenuBuilder, TArray<FString> SelectedPaths);
+	void OnAuditPhysicsAssets(TArray<FString> SelectedPaths);
+	void OnLearnShapePriors(TArray<FString> SelectedPaths);
+
+	// Keeps generated physics assets in step with reimported meshes
+	FBetterPAAutoRegenerator AutoRegenerator;
 };
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/SoftObjectPath.h"
+
+class UPhysicsAsset;
+
+enum class EBetterPAAuditIssue : uint8
+{
+	// Capsule or sphere radius (or a box extent) too small to simulate
+	DegenerateShape,
+	// Constraint names a bone that is not in the skeleton or has no body
+	ConstraintMissingBone,
+	// Body for a bone the skeleton no longer has
+	BodyMissingBone,
+	// Body with no constraint path to the root body
+	UnreachableBody,
+	// Second constraint between the same two bones
+	DuplicateConstraint,
+	// No preview mesh, bone checks were skipped
+	MissingPreviewMesh
+};
+
+struct FBetterPAAuditFinding
+{
+	FSoftObjectPath AssetPath;
+	EBetterPAAuditIssue Issue = EBetterPAAuditIssue::DegenerateShape;
+	FName BoneName;
+	FName OtherBoneName;
+	FString Detail;
+	bool bFixed = false;
+};
+
+struct FBetterPAAuditSettings
+{
+	// Content folders to scan recursively, /Game when empty
+	TArray<FName> PackagePaths;
+
+	// Physics assets loaded at once, everything loaded for a batch is released before the next one
+	int32 BatchSize = 32;
+
+	// Shapes with a radius or extent below this (cm) are reported
+	float MinShapeSize = 0.1f;
+};
+
+class BETTERPA_API FBetterPAAudit
+{
+public:
+	static const TCHAR* GetIssueName(EBetterPAAuditIssue Issue);
+
+	// True if FixFinding can repair the issue
+	static bool IsFixable(EBetterPAAuditIssue Issue);
+
+	// Checks one loaded asset. Read only, so several assets can be audited in parallel.
+	static void AuditAsset(const UPhysicsAsset* PhysicsAsset, const FBetterPAAuditSettings& Settings, TArray<FBetterPAAuditFinding>& OutFindings);
+
+	// Finds physics assets through the asset registry, loads them in asynchronous batches and audits each batch in parallel
+	static void RunAudit(const FBetterPAAuditSettings& Settings, TArray<FBetterPAAuditFinding>& OutFindings);
+
+	/**
+	 * Repairs the asset a finding points at, as one undoable transaction.
+	 * Dangling and duplicate objects are removed. A degenerate body has its shapes refitted with the settings the asset was generated with,
+	 * and an unreachable body is constrained to its nearest ancestor body. Nothing else on the asset is touched.
+	 */
+	static bool FixFinding(FBetterPAAuditFinding& Finding);
+
+	static FString ToCSV(const TArray<FBetterPAAuditFinding>& Findings);
+
+	// Writes the CSV report to Saved/BetterPA/Audit and returns the file path
+	static FString SaveReport(const TArray<FBetterPAAuditFinding>& Findings);
+};
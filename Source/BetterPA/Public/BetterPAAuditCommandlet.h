@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BetterPAAuditCommandlet.generated.h"
+
+/**
+ * Audits every physics asset under the given content paths and writes a CSV report.
+ * Usage: -run=BetterPAAudit [-Paths=/Game/A+/Game/B] [-BatchSize=32] [-Fix]
+ * With -Fix, fixable findings are repaired and the affected packages saved.
+ */
+UCLASS()
+class UBetterPAAuditCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBetterPAAuditCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	// End of UCommandlet interface
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BetterPAGenerator.h"
+#include "Containers/Ticker.h"
+#include "Async/Future.h"
+#include "HAL/ThreadSafeBool.h"
+#include "UObject/StrongObjectPtr.h"
+
+class USkeletalMesh;
+class UPhysicsAsset;
+
+// Settings and bone selection a physics asset was generated with, and the state of the mesh it was generated from
+struct FBetterPAGenerationRecord
+{
+	FSoftObjectPath PhysicsAsset;
+	FBetterPAGenerationSettings Settings;
+	TArray<FName> SelectedBones;
+
+	// Per bone: name, parent, reference pose and the skinned vertices it drives on the settings' LOD
+	TMap<FName, uint64> BoneHashes;
+
+	friend FArchive& operator<<(FArchive& Ar, FBetterPAGenerationRecord& Record);
+};
+
+// Every generated physics asset the editor keeps up to date with its mesh
+struct BETTERPA_API FBetterPAGenerationRecordTable
+{
+	// Keyed by skeletal mesh object path
+	TMap<FString, FBetterPAGenerationRecord> Records;
+
+	void Serialize(FArchive& Ar);
+	bool Save(const FString& FilePath) const;
+	bool Load(const FString& FilePath);
+
+	// Record of the mesh the asset was generated from, nullptr if the editor did not generate it
+	const FBetterPAGenerationRecord* FindByPhysicsAsset(const FSoftObjectPath& PhysicsAsset) const;
+
+	// Saved/BetterPA/GenerationRecords.bin
+	static FString GetDefaultPath();
+};
+
+/**
+ * Regenerates physics assets when the mesh they were generated from is reimported or edited.
+ * Events are coalesced to one check per mesh on the next tick, and the check only hashes the reference skeleton and skin
+ * data, so an unchanged reimport costs the hash. Changed meshes are regenerated in the background from a copy taken on the
+ * game thread, refitting only the bones whose hash changed unless bones were added or removed. Bodies, constraints and
+ * disabled pairs between bones the change did not reach are kept as the asset has them, hand edits included, and one
+ * notification lists what was regenerated.
+ */
+class BETTERPA_API FBetterPAAutoRegenerator
+{
+public:
+	void Register();
+	void Unregister();
+
+	// Remembers how the asset was generated, so later changes to the mesh regenerate it the same way
+	void RecordGeneration(const USkeletalMesh* SkeletalMesh, const UPhysicsAsset* PhysicsAsset, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings);
+
+	// How the asset was generated, nullptr if it was not generated by the editor
+	const FBetterPAGenerationRecord* FindRecord(const UPhysicsAsset* PhysicsAsset);
+
+	static void HashSourceData(const USkeletalMesh* SkeletalMesh, int32 LODIndex, TMap<FName, uint64>& OutBoneHashes);
+
+private:
+	struct FRegeneration
+	{
+		TStrongObjectPtr<USkeletalMesh> SkeletalMesh;
+		TStrongObjectPtr<UPhysicsAsset> PhysicsAsset;
+		TMap<FName, uint64> BoneHashes;
+
+		// Transient copy of the mesh the worker reads, so edits on the game thread cannot change the data under it
+		TStrongObjectPtr<USkeletalMesh> Snapshot;
+
+		// Selected bones the change did not reach, their asset data wins over the regenerated one
+		TSet<FName> UntouchedBones;
+
+		TSharedPtr<FThreadSafeBool> Cancelled;
+		TFuture<void> Task;
+
+		// Set when the mesh changed again while its regeneration ran
+		bool bRequeue = false;
+	};
+
+	void OnPostEngineInit();
+	void OnAssetReimport(UObject* Object);
+	void OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent);
+	void QueueCheck(UObject* Object);
+	bool ProcessQueuedChecks(float DeltaTime);
+	void LoadTable();
+	void StartRegeneration(USkeletalMesh* SkeletalMesh, const FBetterPAGenerationRecord& Record, TMap<FName, uint64>&& BoneHashes);
+	void OnRegenerationFinished(const FString& MeshPath, TSharedPtr<const FBetterPAGenerationResult> Result);
+
+	FBetterPAGenerationRecordTable Table;
+	bool bTableLoaded = false;
+
+	TSet<FString> QueuedMeshes;
+	TMap<FString, FRegeneration> InFlight;
+
+	// Assets regenerated since the last notification
+	TArray<FString> RegeneratedAssets;
+
+	FTSTicker::FDelegateHandle TickerHandle;
+	FDelegateHandle PostEngineInitHandle;
+	FDelegateHandle ReimportHandle;
+	FDelegateHandle PropertyChangedHandle;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FBetterPAGenerationResult;
+struct FBetterPAGenerationSettings;
+
+// Why a body got its physics type and collision response, the first matching rule wins
+enum class EBetterPABodyClass : uint8
+{
+	// No rule matched, simulated with full collision
+	Full,
+	// Owns too little of the mesh to matter, e.g. twist and helper bones
+	LowInfluence,
+	// Shape volume below the size threshold, e.g. fingers and toes
+	Small,
+	// Further from the root body than the simulated depth
+	Deep,
+	// Part of a hair, tail or strap chain
+	Chain,
+
+	Num
+};
+
+// What the classification saved, counted over the generated bodies and their shapes
+struct FBetterPABodyClassSummary
+{
+	int32 NumBodies = 0;
+	int32 NumSimulated = 0;
+	int32 NumShapes = 0;
+
+	// Shapes that still take part in contact generation and in scene queries
+	int32 NumContactShapes = 0;
+	int32 NumQueryShapes = 0;
+
+	int32 NumPerClass[(int32)EBetterPABodyClass::Num] = {};
+};
+
+class BETTERPA_API FBetterPABodyClassifier
+{
+public:
+	static const TCHAR* GetClassName(EBetterPABodyClass Class);
+
+	/**
+	 * Assigns each body a class from its shape volume, depth below the root body, chain membership and skin influence,
+	 * then gives it the physics type and collision response the settings map that class to.
+	 * ChainBodies and Influence are indexed by body; Influence is the fraction of mesh vertices weighted to the body, empty to skip that rule.
+	 */
+	static void Classify(FBetterPAGenerationResult& Result, const TBitArray<>& ChainBodies, const TArray<float>& Influence, const FBetterPAGenerationSettings& Settings);
+
+	static FBetterPABodyClassSummary Summarize(const FBetterPAGenerationResult& Result);
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FReferenceSkeleton;
+
+// Run of single-child bones ending in a leaf, such as a hair strand, tail or strap
+struct FBetterPABoneChain
+{
+	// Bone indices from the top of the chain down to the leaf
+	TArray<int32> Bones;
+
+	// Reference pose distance from the top of the chain to each bone
+	TArray<float> Distances;
+
+	float GetLength() const { return Distances.Num() > 0 ? Distances.Last() : 0.0f; }
+
+	// Position along the chain in [0, 1], 0 at the top
+	float GetFraction(int32 ChainPosition) const
+	{
+		const float Length = GetLength();
+		return Length > UE_KINDA_SMALL_NUMBER ? Distances[ChainPosition] / Length : 0.0f;
+	}
+};
+
+namespace BetterPA
+{
+	/**
+	 * Finds every chain of at least MinBones bones. A chain starts below a bone with several children and follows
+	 * single children down to a leaf; runs that end in a branch (spines, limbs) are not chains.
+	 * Relies on the reference skeleton storing parents before their children.
+	 */
+	BETTERPA_API void FindBoneChains(const FReferenceSkeleton& RefSkeleton, int32 MinBones, TArray<FBetterPABoneChain>& OutChains);
+}
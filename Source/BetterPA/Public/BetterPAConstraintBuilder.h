@@ -0,0 +1,96 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BetterPAGenerator.h"
+
+class UPhysicsAsset;
+class UPhysicsConstraintTemplate;
+
+enum class EConstraintGenerationMode
+{
+	Standard,
+	Mesh
+};
+
+struct FBetterPAConstraintSettings
+{
+	EConstraintGenerationMode Mode = EConstraintGenerationMode::Standard;
+	bool bScaleByDistance = false;
+	float ScalingFactor = 1.0f;
+
+	// Named profiles written to each created constraint, derived from its default limits
+	TArray<FBetterPAConstraintProfileRule> Profiles;
+};
+
+// Unordered bone pair, a constraint between A and B is the same link as one between B and A
+struct FBetterPABonePair
+{
+	FName First;
+	FName Second;
+
+	FBetterPABonePair() = default;
+	FBetterPABonePair(FName A, FName B)
+	{
+		const bool bSwap = B.CompareIndexes(A) < 0;
+		First = bSwap ? B : A;
+		Second = bSwap ? A : B;
+	}
+
+	bool operator==(const FBetterPABonePair& Other) const
+	{
+		return First == Other.First && Second == Other.Second;
+	}
+
+	friend uint32 GetTypeHash(const FBetterPABonePair& Pair)
+	{
+		return HashCombine(GetTypeHash(Pair.First), GetTypeHash(Pair.Second));
+	}
+};
+
+// Reference pose of the physics asset's preview mesh, captured once and shared by every constraint built from it
+struct BETTERPA_API FBetterPAConstraintContext
+{
+	TArray<FTransform> ComponentSpaceTransforms;
+	TArray<int32> ParentIndices;
+	TMap<FName, int32> BoneIndices;
+
+	void Init(const UPhysicsAsset* PhysicsAsset);
+
+	int32 FindBone(FName BoneName) const;
+
+	// Orders two linked bones by hierarchy. Unrelated bones keep the asset convention of Bone2 being the parent.
+	void GetParentAndChild(FName Bone1, FName Bone2, FName& OutParent, FName& OutChild) const;
+};
+
+class BETTERPA_API FBetterPAConstraintBuilder
+{
+public:
+	// Creates a configured constraint between two bodies. The caller adds it to the asset.
+	static UPhysicsConstraintTemplate* CreateConstraint(UPhysicsAsset* PhysicsAsset, FName Bone1Name, FName Bone2Name, const FBetterPAConstraintSettings& Settings, const FBetterPAConstraintContext& Context);
+
+	// Creates one constraint per (Bone1, Bone2) link, with every joint frame computed in a single batch
+	static void CreateConstraints(UPhysicsAsset* PhysicsAsset, TConstArrayView<TPair<FName, FName>> Links, const FBetterPAConstraintSettings& Settings, const FBetterPAConstraintContext& Context, TArray<UPhysicsConstraintTemplate*>& OutConstraints);
+
+	// Index of the constraint linking the two bones in either direction, or INDEX_NONE
+	static int32 FindConstraint(const UPhysicsAsset* PhysicsAsset, FName BoneA, FName BoneB);
+
+	// Derives the rules' profiles for every constraint of the asset from its default limits. Only constraints whose profiles change are modified; returns how many did.
+	static int32 WriteProfiles(UPhysicsAsset* PhysicsAsset, TConstArrayView<FBetterPAConstraintProfileRule> Rules);
+};
+
+namespace BetterPA
+{
+	// Limp death, stumble and hit reaction
+	BETTERPA_API TArray<FBetterPAConstraintProfileRule> GetRagdollProfilePresets();
+
+	BETTERPA_API FBetterPAConstraintProfile MakeConstraintProfile(const FBetterPAConstraintProfileRule& Rule, float Swing1Limit, float Swing2Limit, float TwistLimit);
+
+	// Each profile goes into the constraint's handle of the same name, starting from the default profile; handles of other profiles are kept
+	BETTERPA_API void WriteConstraintProfiles(UPhysicsConstraintTemplate& Constraint, TConstArrayView<FBetterPAConstraintProfile> Profiles);
+
+	// True if WriteConstraintProfiles would leave the constraint as it is
+	BETTERPA_API bool ConstraintProfilesMatch(const UPhysicsConstraintTemplate& Constraint, TConstArrayView<FBetterPAConstraintProfile> Profiles);
+
+	// Registers profile names on the asset so they show up in the physics asset editor and SetConstraintProfile
+	BETTERPA_API void AddConstraintProfileNames(UPhysicsAsset* PhysicsAsset, TConstArrayView<FName> Names);
+}
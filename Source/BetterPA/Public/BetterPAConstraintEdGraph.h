@@ -0,0 +1,127 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EdGraph/EdGraph.h"
+#include "BetterPAConstraintBuilder.h"
+#include "BetterPAConstraintEdGraph.generated.h"
+
+class UPhysicsAsset;
+class UPhysicsConstraintTemplate;
+class UBetterPAConstraintGraphNode;
+
+/**
+ * Constraint graph bound to a physics asset.
+ * Keeps an index of the asset's constraints so link edits and external asset edits are synced one edge at a time.
+ */
+UCLASS()
+class BETTERPA_API UBetterPAConstraintEdGraph : public UEdGraph
+{
+	GENERATED_BODY()
+
+public:
+	FBetterPAConstraintSettings ConstraintSettings;
+
+	// Push link edits to the asset as they happen
+	bool bLiveSync = true;
+
+	void Initialize(UPhysicsAsset* InPhysicsAsset);
+
+	UPhysicsAsset* GetPhysicsAsset() const { return PhysicsAsset.Get(); }
+	const FBetterPAConstraintContext& GetContext() const { return Context; }
+
+	// True while the graph itself is modifying the asset, external edit notifications can be ignored
+	bool IsApplyingToAsset() const { return bApplyingToAsset; }
+
+	// Called by the schema after a link was made or broken in the graph
+	void OnLinkAdded(UEdGraphPin* A, UEdGraphPin* B);
+	void OnLinkRemoved(UEdGraphPin* A, UEdGraphPin* B);
+
+	// Graph to asset: adds constraints for every link and removes the constraints of links broken in the graph since the last apply
+	void ApplyToAsset();
+
+	// Writes the ConstraintSettings profiles to every constraint of the asset as one transaction, returns how many constraints changed
+	int32 ApplyProfilesToAsset();
+
+	// Asset to graph: diffs every constraint of the asset against the index and patches only the changed links, for undo and redo
+	void SyncFromAsset();
+
+	// Asset to graph for an edit of the asset's constraint list: only the range that differs from the last seen list is diffed
+	void SyncConstraintSetup();
+
+	// Asset to graph for a single edited constraint
+	void SyncConstraint(UPhysicsConstraintTemplate* Constraint);
+
+	// Links newly added nodes to the nodes they already share a constraint with in the asset, returns true if the graph changed
+	bool LinkFromAsset(TConstArrayView<UBetterPAConstraintGraphNode*> AddedNodes);
+
+	// Re-reads the asset without touching the graph, for when the graph was rebuilt from the asset
+	void RebuildIndex();
+
+	// Re-reads the graph links, for when they changed without going through the schema (undo, bulk rebuilds)
+	void RebuildLinkIndex();
+
+	// Drops every node and link in one go for a rebuild, without a change notification per node
+	void RemoveAllNodes();
+
+	// Connection queries used while dragging, all constant time
+	bool AreNodesLinked(const UEdGraphNode* A, const UEdGraphNode* B) const;
+	int32 GetNumParentLinks(const UEdGraphNode* Node) const;
+	bool AreNodesConnected(const UEdGraphNode* A, const UEdGraphNode* B) const;
+	bool IsConstrainedInAsset(FName BoneA, FName BoneB) const { return ConstraintsByPair.Contains(FBetterPABonePair(BoneA, BoneB)); }
+
+	// True if a node shows the bone, on its own or inside a collapsed chain
+	bool ContainsBone(FName BoneName) const { return FindNode(BoneName) != nullptr; }
+
+	// UEdGraph interface
+	virtual void AddNode(UEdGraphNode* NodeToAdd, bool bUserAction = false, bool bSelectNewNode = true) override;
+	virtual bool RemoveNode(UEdGraphNode* NodeToRemove, bool bBreakAllLinks = true) override;
+	// End of UEdGraph interface
+
+private:
+	void RebuildNodeIndex();
+	UBetterPAConstraintGraphNode* FindNode(FName BoneName) const;
+
+	// Bone pair of the constraint a link between the two pins stands for
+	bool GetLinkBones(UEdGraphPin* A, UEdGraphPin* B, FName& OutBone1, FName& OutBone2) const;
+
+	// Links or unlinks the nodes holding the two bones, returns true if the graph changed
+	bool SetNodesLinked(const FBetterPABonePair& Pair, bool bLinked);
+
+	void AddLinkToIndex(const UEdGraphNode* Source, const UEdGraphNode* Target);
+	void RemoveLinkFromIndex(const UEdGraphNode* Source, const UEdGraphNode* Target);
+	void SplitComponent(const UEdGraphNode* Source, const UEdGraphNode* Target);
+	int32 FindComponent(int32 NodeId) const;
+	int32 GetNodeId(const UEdGraphNode* Node);
+
+	void IndexConstraint(UPhysicsConstraintTemplate* Constraint, const FBetterPABonePair& Pair);
+	void UnindexConstraint(const TWeakObjectPtr<UPhysicsConstraintTemplate>& Constraint);
+	void SnapshotConstraintSetup();
+
+	TWeakObjectPtr<UPhysicsAsset> PhysicsAsset;
+	FBetterPAConstraintContext Context;
+
+	// Bone pair each known constraint linked when it was last seen, and the reverse lookup
+	TMap<TWeakObjectPtr<UPhysicsConstraintTemplate>, FBetterPABonePair> KnownConstraints;
+	TMap<FBetterPABonePair, TWeakObjectPtr<UPhysicsConstraintTemplate>> ConstraintsByPair;
+
+	// Links the user broke while live sync was off, keyed by the head bones of the two nodes. Only these lose their constraint on apply.
+	TSet<FBetterPABonePair> BrokenLinks;
+
+	// The asset's constraint list as of the last sync, in order
+	TArray<TWeakObjectPtr<UPhysicsConstraintTemplate>> SetupSnapshot;
+
+	// Every bone shown in the graph, including the inner bones of collapsed chains
+	TMap<FName, TWeakObjectPtr<UBetterPAConstraintGraphNode>> NodesByBone;
+
+	// Graph links as unordered node pairs, plus the number of links into each node
+	TSet<TPair<const UEdGraphNode*, const UEdGraphNode*>> LinkedNodes;
+	TMap<const UEdGraphNode*, int32> NumParentLinks;
+
+	// Union-find over nodes for loop detection. Removing a link cannot be undone in place, so when it was a bridge the smaller side is relabelled.
+	TMap<const UEdGraphNode*, int32> NodeIds;
+	mutable TArray<int32> ComponentParents;
+	TMap<const UEdGraphNode*, TArray<const UEdGraphNode*, TInlineAllocator<4>>> Adjacency;
+
+	bool bSuppressSync = false;
+	bool bApplyingToAsset = false;
+};
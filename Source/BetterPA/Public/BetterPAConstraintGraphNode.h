@@ -18,6 +18,18 @@ public:
 	UPROPERTY()
 	int32 BodyIndex;
 
+	// Bones of a collapsed chain in parent-to-child order, empty for single body nodes
+	UPROPERTY()
+	TArray<FName> CollapsedBones;
+
+	bool IsCollapsedChain() const { return CollapsedBones.Num() > 1; }
+
+	// Bone that incoming links attach to (the chain head)
+	FName GetInputBoneName() const { return IsCollapsedChain() ? CollapsedBones[0] : BoneName; }
+
+	// Bone that outgoing links start from (the chain tail)
+	FName GetOutputBoneName() const { return IsCollapsedChain() ? CollapsedBones.Last() : BoneName; }
+
 	// UEdGraphNode interface
 	virtual FText GetNodeTitle(ENodeTitleType::Type TitleType) const override;
 	virtual FLinearColor GetNodeTitleColor() const override;
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FKConvexElem;
+struct FBetterPAPointBucket;
+struct FBetterPAVertexBuckets;
+
+struct FBetterPAConvexSettings
+{
+	// Hull budget per body
+	int32 MaxHulls = 4;
+
+	// Vertex budget per hull, also the number of support directions each hull is sampled along
+	int32 MaxHullVertices = 24;
+
+	// A part is split while some point sits deeper inside its hull than this fraction of the part's size
+	float MaxConcavity = 0.05f;
+
+	// Parts are never split below this many points
+	int32 MinHullPoints = 8;
+
+	// Larger point sets are thinned to this many before decomposing
+	int32 MaxPoints = 8192;
+};
+
+class BETTERPA_API FBetterPAConvexDecomposition
+{
+public:
+	/**
+	 * Approximate convex decomposition of a point set.
+	 * The most concave part is split along its principal axis until every part is close to convex or the hull budget is spent.
+	 * Each hull keeps the extreme points along MaxHullVertices directions, so it stays inside the budget and inside the true hull.
+	 */
+	static void Decompose(const FBetterPAPointBucket& Points, const FBetterPAConvexSettings& Settings, TArray<FKConvexElem>& OutHulls);
+
+	/**
+	 * Decomposes the bucket of every body set in BodyMask, in parallel across bodies.
+	 * Results are cached by point set and settings, so bones whose vertices did not change are not recomputed.
+	 * The cache holds the most recently used decompositions, so a long editor session keeps the bones it is working on.
+	 */
+	static void DecomposeBodies(const FBetterPAVertexBuckets& Buckets, const TBitArray<>& BodyMask, const FBetterPAConvexSettings& Settings, TArray<TArray<FKConvexElem>>& OutHulls);
+
+	static void ClearCache();
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BetterPACrowdBenchmarkCommandlet.generated.h"
+
+/**
+ * Spawns a crowd of fully simulated ragdolls per physics asset in an empty world, steps it a fixed number of frames and
+ * reports physics step time, solver contacts, bodies, constraints and physics memory side by side, one column per asset.
+ * Usage: -run=BetterPACrowdBenchmark -Assets=/Game/A.A+/Game/B.B [-Count=100] [-Frames=300] [-WarmupFrames=30] [-DeltaTime=0.0166667] [-Spacing=150]
+ * Each asset simulates its preview mesh. The report is also written as CSV under Saved/BetterPA/Benchmarks.
+ * Physics memory is read from the low level memory tracker's physics tags, run with -llm to get it.
+ * Returns non-zero if an asset could not be loaded or has no preview mesh.
+ */
+UCLASS()
+class UBetterPACrowdBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBetterPACrowdBenchmarkCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	// End of UCommandlet interface
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BetterPADeterminismCommandlet.generated.h"
+
+/**
+ * Generates a physics asset for a skeletal mesh once per worker count and checks that every run serializes to the same bytes.
+ * Usage: -run=BetterPADeterminism -Mesh=/Game/Path/Mesh [-Threads=1+4+0] [-Optimize] [-Chains] [-SweepLimits]
+ *        [-ConvexBones=spine_03+head] [-PoseAnimations=/Game/A.A+/Game/B.B]
+ * A thread count of 0 means no cap. Returns non-zero if any run differs from the first or an animation could not be loaded.
+ */
+UCLASS()
+class UBetterPADeterminismCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBetterPADeterminismCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	// End of UCommandlet interface
+};
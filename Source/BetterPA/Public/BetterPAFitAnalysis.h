@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USkeletalMesh;
+class UPhysicsAsset;
+
+struct FBetterPAFitAnalysisSettings
+{
+	// Mesh LOD the vertices are read from
+	int32 LODIndex = 0;
+
+	// Minimum normalized skin weight for a vertex to count towards a body
+	float MinSkinWeight = 0.2f;
+
+	// A vertex is covered when it lies inside the body or at most this far (cm) outside it
+	float CoverageTolerance = 2.0f;
+
+	// Robust z-score above which a body is flagged as an outlier
+	float OutlierThreshold = 3.0f;
+
+	// Vertices sampled per body, the statistics are measured on the sample
+	int32 MaxPointsPerBody = 16384;
+};
+
+struct FBetterPABodyFitStats
+{
+	FName BoneName;
+	int32 BodyIndex = INDEX_NONE;
+	int32 NumVertices = 0;
+
+	// How many of the body's vertices the statistics below were measured on, at most MaxPointsPerBody
+	int32 NumSampled = 0;
+
+	// Fraction of the body's vertices within CoverageTolerance of its shapes
+	float Coverage = 0.0f;
+
+	// Fraction of the body's vertices that end up inside its shapes (shape pokes through the skin)
+	float OverInflation = 0.0f;
+
+	// Deepest vertex inside the shapes, in cm
+	float MaxPenetration = 0.0f;
+
+	// Mean signed distance of the body's vertices to its shapes, in cm
+	float MeanDistance = 0.0f;
+
+	bool bOutlier = false;
+};
+
+class BETTERPA_API FBetterPAFitAnalysis
+{
+public:
+	// Measures how well every body of the physics asset covers the skinned vertices of its bones
+	static bool Analyze(const USkeletalMesh* SkeletalMesh, const UPhysicsAsset* PhysicsAsset, const FBetterPAFitAnalysisSettings& Settings, TArray<FBetterPABodyFitStats>& OutStats);
+
+	static FString ToCSV(const TArray<FBetterPABodyFitStats>& Stats);
+
+	// Writes the CSV report to Saved/BetterPA/FitReports and returns the file path
+	static FString SaveReport(const UPhysicsAsset* PhysicsAsset, const TArray<FBetterPABodyFitStats>& Stats);
+};
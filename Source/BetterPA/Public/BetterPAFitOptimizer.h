@@ -0,0 +1,19 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FKSphylElem;
+struct FBetterPAVertexBuckets;
+struct FBetterPAGenerationSettings;
+class FThreadSafeBool;
+
+class BETTERPA_API FBetterPAFitOptimizer
+{
+public:
+	/**
+	 * Refines capsule center, axis, radius and length per body to minimize uncovered vertices, volume overshoot and neighbour overlap.
+	 * Capsules and buckets are in the space of each body's bone; BodyBoneTransforms are the component space bone transforms.
+	 * Bodies with too few skinned vertices keep their input capsule. Stops after the current round once Cancelled is set.
+	 */
+	static void Optimize(TArray<FKSphylElem>& InOutCapsules, const TArray<FTransform>& BodyBoneTransforms, const TArray<int32>& ParentBodies, const FBetterPAVertexBuckets& Buckets, const FBetterPAGenerationSettings& Settings, const FThreadSafeBool* Cancelled = nullptr);
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BetterPAFrameBenchmarkCommandlet.generated.h"
+
+/**
+ * Times the batched capsule and joint frame kernels against their scalar references on random bones and checks they agree.
+ * Usage: -run=BetterPAFrameBenchmark [-Num=100000] [-Iterations=20] [-Seed=1]
+ * Returns non-zero if any result differs from the scalar path by more than the tolerance.
+ */
+UCLASS()
+class UBetterPAFrameBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBetterPAFrameBenchmarkCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	// End of UCommandlet interface
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Capsule placement for a batch of bodies, spanning from a point near each body's bone towards its child.
+ * Inputs and outputs are kept as struct-of-arrays padded to a multiple of four, so Compute processes four bodies per
+ * vector instruction with no scalar tail and a body's result does not depend on its position in the batch.
+ */
+struct BETTERPA_API FBetterPACapsuleFrameBatch
+{
+	void SetNum(int32 InNum);
+	int32 Num() const { return NumItems; }
+
+	// Bone transform, capsule start and end in component space; the center sits OffsetRatio of the way from Start to End
+	void Set(int32 Index, const FTransform& BoneTransform, const FVector& Start, const FVector& End, float OffsetRatio);
+
+	void Compute();
+
+	// Center relative to the bone, rotation (capsule Z along Start to End) relative to the bone and in component space
+	void Get(int32 Index, FVector& OutCenter, FQuat& OutLocalRotation, FQuat& OutRotation) const;
+
+private:
+	enum EStream
+	{
+		BoneQX, BoneQY, BoneQZ, BoneQW,
+		BoneTX, BoneTY, BoneTZ,
+		BoneInvSX, BoneInvSY, BoneInvSZ,
+		StartX, StartY, StartZ,
+		EndX, EndY, EndZ,
+		Offset,
+		CenterX, CenterY, CenterZ,
+		LocalQX, LocalQY, LocalQZ, LocalQW,
+		QX, QY, QZ, QW,
+		NumStreams
+	};
+
+	float* GetStream(EStream Stream) { return Data.GetData() + Stream * Stride; }
+	const float* GetStream(EStream Stream) const { return Data.GetData() + Stream * Stride; }
+
+	TArray<float> Data;
+	int32 NumItems = 0;
+	int32 Stride = 0;
+};
+
+/**
+ * Constraint frames for a batch of joints: a joint position and frame rotation in component space, expressed relative to
+ * the two bones the constraint joins. Laid out and computed like FBetterPACapsuleFrameBatch.
+ */
+struct BETTERPA_API FBetterPAJointFrameBatch
+{
+	void SetNum(int32 InNum);
+	int32 Num() const { return NumItems; }
+
+	void Set(int32 Index, const FTransform& Bone1Transform, const FTransform& Bone2Transform, const FVector& Position, const FQuat& Rotation);
+
+	void Compute();
+
+	// Position, primary and secondary axis of the frame relative to bone 1 and bone 2
+	void GetFrame1(int32 Index, FVector& OutPos, FVector& OutPriAxis, FVector& OutSecAxis) const;
+	void GetFrame2(int32 Index, FVector& OutPos, FVector& OutPriAxis, FVector& OutSecAxis) const;
+
+private:
+	enum EStream
+	{
+		Bone1QX, Bone1QY, Bone1QZ, Bone1QW,
+		Bone1TX, Bone1TY, Bone1TZ,
+		Bone1InvSX, Bone1InvSY, Bone1InvSZ,
+		Bone2QX, Bone2QY, Bone2QZ, Bone2QW,
+		Bone2TX, Bone2TY, Bone2TZ,
+		Bone2InvSX, Bone2InvSY, Bone2InvSZ,
+		PosX, PosY, PosZ,
+		QX, QY, QZ, QW,
+		Pos1X, Pos1Y, Pos1Z, Pri1X, Pri1Y, Pri1Z, Sec1X, Sec1Y, Sec1Z,
+		Pos2X, Pos2Y, Pos2Z, Pri2X, Pri2Y, Pri2Z, Sec2X, Sec2Y, Sec2Z,
+		NumStreams
+	};
+
+	float* GetStream(EStream Stream) { return Data.GetData() + Stream * Stride; }
+	const float* GetStream(EStream Stream) const { return Data.GetData() + Stream * Stride; }
+
+	TArray<float> Data;
+	int32 NumItems = 0;
+	int32 Stride = 0;
+};
+
+namespace BetterPA
+{
+	// Scalar references with the same math in double precision, for validation and benchmarks
+	BETTERPA_API void ComputeCapsuleFrame(const FTransform& BoneTransform, const FVector& Start, const FVector& End, float OffsetRatio, FVector& OutCenter, FQuat& OutLocalRotation, FQuat& OutRotation);
+	BETTERPA_API void ComputeJointFrame(const FTransform& BoneTransform, const FVector& Position, const FQuat& Rotation, FVector& OutPos, FVector& OutPriAxis, FVector& OutSecAxis);
+}
@@ -1,12 +1,452 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "PhysicsEngine/AggregateGeom.h"
+#include "Engine/EngineTypes.h"
+#include "PhysicsEngine/BodySetupEnums.h"
+#include "PhysicsEngine/ConstraintDrives.h"
+#include "PhysicsEngine/ConstraintTypes.h"
+#include "BetterPABodyClassifier.h"
+#include "BetterPAGenerator.generated.h"
 
 class USkeletalMesh;
 class UPhysicsAsset;
+class UAnimSequence;
+struct FBetterPAShapePriorTable;
+class FThreadSafeBool;
+
+// Rule for one named constraint profile, derived from each constraint's generated limits.
+// Game code switches between profiles with SetConstraintProfile instead of loading a physics asset per behaviour.
+USTRUCT()
+struct BETTERPA_API FBetterPAConstraintProfileRule
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Profile")
+	FName Name;
+
+	// Multiplies the generated swing and twist limits
+	UPROPERTY(EditAnywhere, Category = "Profile")
+	float LimitScale = 1.0f;
+
+	// Soft limits with this stiffness and damping, hard limits when zero
+	UPROPERTY(EditAnywhere, Category = "Profile")
+	float LimitStiffness = 0.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Profile")
+	float LimitDamping = 0.0f;
+
+	// Slerp drive towards the reference pose, off when zero
+	UPROPERTY(EditAnywhere, Category = "Profile")
+	float DriveStiffness = 0.0f;
+
+	// Drive damping as a fraction of critical damping for DriveStiffness
+	UPROPERTY(EditAnywhere, Category = "Profile")
+	float DriveDampingRatio = 1.0f;
+};
+
+// Physics type and collision response given to one class of bodies
+USTRUCT()
+struct BETTERPA_API FBetterPABodyClassResponse
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Classification")
+	TEnumAsByte<EPhysicsType> PhysicsType = PhysType_Default;
+
+	UPROPERTY(EditAnywhere, Category = "Classification")
+	TEnumAsByte<ECollisionEnabled::Type> CollisionEnabled = ECollisionEnabled::QueryAndPhysics;
+
+	FBetterPABodyClassResponse() = default;
+	FBetterPABodyClassResponse(EPhysicsType InPhysicsType, ECollisionEnabled::Type InCollisionEnabled)
+		: PhysicsType(InPhysicsType)
+		, CollisionEnabled(InCollisionEnabled)
+	{
+	}
+};
+
+USTRUCT()
+struct BETTERPA_API FBetterPAGenerationSettings
+{
+	GENERATED_BODY()
+
+	// Refine each capsule against the skinned vertices of its bones after the one-shot fit
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	bool bOptimizeFit = false;
+
+	// Start each capsule and limit from the proportions learned from the project's physics assets, where the table knows the bone. Opt in, the picker leaves it off even when a table exists
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	bool bUseShapePriors = false;
+
+	// Built by FBetterPAShapePriors::Update, not owned by the settings
+	TSharedPtr<const FBetterPAShapePriorTable> ShapePriors;
+
+	// Mesh LOD the skinned vertices are read from
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	int32 LODIndex = 0;
+
+	// Minimum normalized skin weight for a vertex to drive a body
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	float MinSkinWeight = 0.5f;
+
+	// Pattern search steps per body
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	int32 OptimizerIterations = 48;
+
+	// Neighbour overlap is resolved over this many parallel rounds
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	int32 OptimizerRounds = 3;
+
+	// Vertices per body fed to the optimizer, larger buckets are subsampled
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	int32 OptimizerMaxPoints = 4096;
+
+	// Bodies with fewer skinned vertices keep the heuristic capsule
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	int32 OptimizerMinPoints = 16;
+
+	// Loss weights: vertices left outside the shape, vertices inside the shape, shape volume and overlap with neighbours
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	float UncoveredWeight = 1.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	float OvershootWeight = 4.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	float VolumeWeight = 0.05f;
+
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	float OverlapWeight = 1.0f;
+
+	// Fit to the mesh skinned at frames of these animations as well as the reference pose, so capsules hold up at bent joints.
+	// Only loaded animations are used, generation never loads assets.
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	TArray<TSoftObjectPtr<UAnimSequence>> PoseAnimations;
+
+	// Frames sampled evenly over each pose animation
+	UPROPERTY(EditAnywhere, Category = "Fitting")
+	int32 PoseSamplesPerAnimation = 8;
+
+	// Treat hair, tails and straps as chains: bodies on every Nth bone only, limits that loosen towards the tip and no collision inside a chain
+	UPROPERTY(EditAnywhere, Category = "Chains")
+	bool bChainMode = false;
+
+	// Runs of single-child bones ending in a leaf need at least this many bones to count as a chain
+	UPROPERTY(EditAnywhere, Category = "Chains")
+	int32 ChainMinBones = 5;
+
+	// Every Nth selected bone of a chain gets a body, the bones in between are covered by its shape
+	UPROPERTY(EditAnywhere, Category = "Chains")
+	int32 ChainBoneStride = 3;
+
+	// Strand radius as a fraction of the span a chain body covers, clamped to ChainMaxRadius (cm)
+	UPROPERTY(EditAnywhere, Category = "Chains")
+	float ChainRadiusRatio = 0.15f;
+
+	UPROPERTY(EditAnywhere, Category = "Chains")
+	float ChainMaxRadius = 2.5f;
+
+	// Spheres instead of short capsules, cheaper but leaves gaps on long strides
+	UPROPERTY(EditAnywhere, Category = "Chains")
+	bool bChainSpheres = false;
+
+	// Swing limit at the top and the tip of a chain, interpolated by distance along it
+	UPROPERTY(EditAnywhere, Category = "Chains")
+	float ChainRootSwingLimit = 15.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Chains")
+	float ChainTipSwingLimit = 45.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Chains")
+	float ChainTwistLimit = 10.0f;
+
+	// Override each body's mass with its shape volume times density, and its damping and sleep threshold from that mass.
+	// Opt in, off leaves mass, damping and sleep at the engine's material defaults
+	UPROPERTY(EditAnywhere, Category = "Mass")
+	bool bComputeMass = false;
+
+	// Density (g/cm^3) of bodies no table entry matches, soft tissue is close to water
+	UPROPERTY(EditAnywhere, Category = "Mass")
+	float Density = 1.0f;
+
+	// Density per bone name fragment, matched case-insensitively with the longest fragment winning (e.g. "hair" -> 0.3)
+	UPROPERTY(EditAnywhere, Category = "Mass")
+	TMap<FString, float> DensityByBoneName;
+
+	// Largest mass ratio allowed across a constraint, lighter children are raised to it
+	UPROPERTY(EditAnywhere, Category = "Mass")
+	float MaxMassRatio = 8.0f;
+
+	// Damping of a body of DampingReferenceMass (kg), lighter bodies get up to MaxDampingScale times more
+	UPROPERTY(EditAnywhere, Category = "Mass")
+	float LinearDamping = 0.01f;
+
+	UPROPERTY(EditAnywhere, Category = "Mass")
+	float AngularDamping = 0.1f;
+
+	UPROPERTY(EditAnywhere, Category = "Mass")
+	float DampingReferenceMass = 10.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Mass")
+	float MaxDampingScale = 4.0f;
+
+	// Bones fitted with convex hulls instead of a capsule, for rigid armor plates, backpacks and props
+	UPROPERTY(EditAnywhere, Category = "Convex")
+	TSet<FName> ConvexBones;
+
+	UPROPERTY(EditAnywhere, Category = "Convex")
+	int32 MaxHullsPerBone = 4;
+
+	UPROPERTY(EditAnywhere, Category = "Convex")
+	int32 MaxHullVertices = 24;
+
+	// Parts deeper than this fraction of their size inside their own hull are split further
+	UPROPERTY(EditAnywhere, Category = "Convex")
+	float MaxConcavity = 0.05f;
+
+	// Shrink or shorten shapes that start out overlapping a body they collide with, so ragdolls do not pop on activation.
+	// Opt in, since it changes the fitted shapes
+	UPROPERTY(EditAnywhere, Category = "Collision")
+	bool bResolvePenetration = false;
+
+	// Gap (cm) left between colliding shapes after resolution
+	UPROPERTY(EditAnywhere, Category = "Collision")
+	float PenetrationMargin = 0.0f;
+
+	// Set each joint's swing and twist limits to where the child starts penetrating its parent or a sibling, instead of the fixed defaults.
+	// Chain joints keep their chain limits.
+	UPROPERTY(EditAnywhere, Category = "Limits")
+	bool bSweepJointLimits = false;
+
+	// Largest limits the sweep can produce, joints with nothing in reach get these
+	UPROPERTY(EditAnywhere, Category = "Limits")
+	float SweepMaxSwingLimit = 120.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Limits")
+	float SweepMaxTwistLimit = 90.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Limits")
+	float SweepMinLimit = 5.0f;
+
+	// Overlap (cm) a swept child may gain on a neighbour before the limit is reached
+	UPROPERTY(EditAnywhere, Category = "Limits")
+	float SweepTolerance = 0.5f;
+
+	// Named profiles written to every generated constraint next to its default limits
+	UPROPERTY(EditAnywhere, Category = "Profiles")
+	TArray<FBetterPAConstraintProfileRule> ConstraintProfiles;
+
+	// Make small, deep, chain and helper bodies kinematic or query-only instead of simulating and colliding everything
+	UPROPERTY(EditAnywhere, Category = "Classification")
+	bool bClassifyBodies = false;
+
+	// Bodies owning less than this fraction of the mesh's skinned vertices, 0 to skip the rule
+	UPROPERTY(EditAnywhere, Category = "Classification")
+	float MinInfluence = 0.002f;
+
+	UPROPERTY(EditAnywhere, Category = "Classification")
+	FBetterPABodyClassResponse LowInfluenceResponse = FBetterPABodyClassResponse(PhysType_Kinematic, ECollisionEnabled::NoCollision);
+
+	// Bodies with a smaller shape volume (cm^3), a finger segment is around 15
+	UPROPERTY(EditAnywhere, Category = "Classification")
+	float SmallBodyVolume = 30.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Classification")
+	FBetterPABodyClassResponse SmallBodyResponse = FBetterPABodyClassResponse(PhysType_Kinematic, ECollisionEnabled::QueryOnly);
+
+	// Bodies more than this many constraints below the root body, 0 to skip the rule
+	UPROPERTY(EditAnywhere, Category = "Classification")
+	int32 MaxSimulatedDepth = 0;
+
+	UPROPERTY(EditAnywhere, Category = "Classification")
+	FBetterPABodyClassResponse DeepBodyResponse = FBetterPABodyClassResponse(PhysType_Kinematic, ECollisionEnabled::QueryOnly);
+
+	// Strands still collide with the body but are skipped by traces
+	UPROPERTY(EditAnywhere, Category = "Classification")
+	FBetterPABodyClassResponse ChainBodyResponse = FBetterPABodyClassResponse(PhysType_Default, ECollisionEnabled::PhysicsOnly);
+};
+
+struct FBetterPABodyResult
+{
+	FName BoneName;
+	int32 BoneIndex = INDEX_NONE;
+
+	// Body of the nearest selected ancestor, INDEX_NONE for roots
+	int32 ParentBody = INDEX_NONE;
+
+	FKAggregateGeom AggGeom;
+
+	// Mass properties, only applied when Mass is set. Read back from an asset, damping and sleep hold its values either way.
+	float Mass = 0.0f;
+	float LinearDamping = 0.0f;
+	float AngularDamping = 0.0f;
+	float SleepThresholdMultiplier = 1.0f;
+
+	// Set by classification, everything is simulated with full collision otherwise
+	EBetterPABodyClass Class = EBetterPABodyClass::Full;
+	TEnumAsByte<EPhysicsType> PhysicsType = PhysType_Default;
+	TEnumAsByte<ECollisionEnabled::Type> CollisionEnabled = ECollisionEnabled::QueryAndPhysics;
+};
+
+// Limits and drive of one named profile on a constraint
+struct FBetterPAConstraintProfile
+{
+	FName Name;
+
+	float Swing1Limit = 45.0f;
+	float Swing2Limit = 45.0f;
+	float TwistLimit = 45.0f;
+
+	// Hard limits when zero
+	float LimitStiffness = 0.0f;
+	float LimitDamping = 0.0f;
+
+	// Drive off when zero
+	float DriveStiffness = 0.0f;
+	float DriveDamping = 0.0f;
+};
+
+struct FBetterPAConstraintResult
+{
+	int32 ChildBody = INDEX_NONE;
+	int32 ParentBody = INDEX_NONE;
+
+	// Frame relative to the child bone (Bone1)
+	FVector Pos1 = FVector::ZeroVector;
+	FVector PriAxis1 = FVector(1, 0, 0);
+	FVector SecAxis1 = FVector(0, 1, 0);
+
+	// Frame relative to the parent bone (Bone2)
+	FVector Pos2 = FVector::ZeroVector;
+	FVector PriAxis2 = FVector(1, 0, 0);
+	FVector SecAxis2 = FVector(0, 1, 0);
+
+	// Only meaningful on limited axes
+	float Swing1Limit = 45.0f;
+	float Swing2Limit = 45.0f;
+	float TwistLimit = 45.0f;
+
+	// Generated joints are limited angularly and locked linearly, constraints read from an asset keep what it has
+	TEnumAsByte<EAngularConstraintMotion> Swing1Motion = EAngularConstraintMotion::ACM_Limited;
+	TEnumAsByte<EAngularConstraintMotion> Swing2Motion = EAngularConstraintMotion::ACM_Limited;
+	TEnumAsByte<EAngularConstraintMotion> TwistMotion = EAngularConstraintMotion::ACM_Limited;
+	TEnumAsByte<ELinearConstraintMotion> LinearXMotion = ELinearConstraintMotion::LCM_Locked;
+	TEnumAsByte<ELinearConstraintMotion> LinearYMotion = ELinearConstraintMotion::LCM_Locked;
+	TEnumAsByte<ELinearConstraintMotion> LinearZMotion = ELinearConstraintMotion::LCM_Locked;
+
+	// Shared by the limited linear axes (cm)
+	float LinearLimit = 0.0f;
+
+	// Drives of the default profile, off unless read from an asset
+	FAngularDriveConstraint AngularDrive;
+	FLinearDriveConstraint LinearDrive;
+
+	// One entry per FBetterPAGenerationSettings::ConstraintProfiles rule
+	TArray<FBetterPAConstraintProfile> Profiles;
+
+	bool HasLimitedLinearAxis() const
+	{
+		return LinearXMotion == ELinearConstraintMotion::LCM_Limited || LinearYMotion == ELinearConstraintMotion::LCM_Limited || LinearZMotion == ELinearConstraintMotion::LCM_Limited;
+	}
+};
+
+// Shape change made to separate a body from one it started out penetrating
+struct FBetterPAPenetrationFix
+{
+	int32 Body = INDEX_NONE;
+
+	// Deepest body it was overlapping, and by how much
+	int32 OtherBody = INDEX_NONE;
+	float Depth = 0.0f;
+
+	// Negative when the shape was shrunk
+	float RadiusChange = 0.0f;
+	float LengthChange = 0.0f;
+
+	// Deepest overlap left when the resolver stopped, zero when the body was fully separated
+	float ResidualDepth = 0.0f;
+};
+
+// In-memory generation output, nothing is written to an asset until ApplyResult
+struct FBetterPAGenerationResult
+{
+	// Bodies in breadth-first skeleton order, parents always precede their children
+	TArray<FBetterPABodyResult> Bodies;
+	TArray<FBetterPAConstraintResult> Constraints;
+
+	// Body pairs that never collide, on top of the pairs joined by a constraint
+	TArray<TPair<int32, int32>> DisabledCollisions;
+
+	// What the penetration pass adjusted
+	TArray<FBetterPAPenetrationFix> PenetrationFixes;
+
+	// Constraint profiles every constraint carries, registered on the asset by ApplyResult
+	TArray<FName> ConstraintProfileNames;
+
+	void Reset()
+	{
+		Bodies.Reset();
+		Constraints.Reset();
+		DisabledCollisions.Reset();
+		PenetrationFixes.Reset();
+		ConstraintProfileNames.Reset();
+	}
+};
+
+namespace BetterPA
+{
+	// Smallest radius any pass gives a capsule, leaf bones sitting on their parent would otherwise get a zero radius
+	constexpr float MinCapsuleRadius = 0.5f;
+
+	// Object name derived from BaseName, made valid and unique in Outer without global counters, so the same input always gives the same name
+	BETTERPA_API FName MakeStableObjectName(UObject* Outer, const FString& BaseName);
+
+	// Undo buffer size of the most recent transaction if its title matches, 0 outside the editor or when it was not recorded
+	BETTERPA_API SIZE_T GetLastTransactionSize(const FText& Title);
+}
+
+// What ApplyResult did to the asset's bodies and constraints
+struct FBetterPAApplyStats
+{
+	int32 NumAdded = 0;
+	int32 NumChanged = 0;
+	int32 NumRemoved = 0;
+	int32 NumUnchanged = 0;
+
+	// Filled by ApplyResultTransacted
+	SIZE_T TransactionBytes = 0;
+};
 
 class BETTERPA_API FBetterPAGenerator
 {
 public:
-	static void GeneratePhysicsAsset(USkeletalMesh* SkeletalMesh, UPhysicsAsset* PhysicsAsset, const TSet<FName>& SelectedBones);
+	static void GeneratePhysicsAsset(USkeletalMesh* SkeletalMesh, UPhysicsAsset* PhysicsAsset, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings = FBetterPAGenerationSettings());
+
+	// Computes bodies and constraints for the selected bones without touching any asset. Returns false, with an empty result, once Cancelled is set.
+	static bool Generate(const USkeletalMesh* SkeletalMesh, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings, FBetterPAGenerationResult& OutResult, const FThreadSafeBool* Cancelled = nullptr);
+
+	/**
+	 * Like Generate, but only refits the bodies affected by toggling DirtyBones: each toggled bone, its nearest selected ancestor and its descendants.
+	 * All other bodies reuse their shapes from Previous: the last result for the same settings, or the asset those settings
+	 * generated read back with FBetterPAInterchange::ResultFromAsset, in which case hand edits to the shapes are kept.
+	 */
+	static bool GenerateIncremental(const USkeletalMesh* SkeletalMesh, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings, const TSet<FName>& DirtyBones, const FBetterPAGenerationResult& Previous, FBetterPAGenerationResult& OutResult, const FThreadSafeBool* Cancelled = nullptr);
+
+	/**
+	 * Settings for a quick first pass of a progressive preview: vertices from the mesh's lowest LOD, few optimizer points and
+	 * iterations, reference pose only. False when the settings read no vertices, so a single pass is already fast.
+	 */
+	static bool MakeCoarseSettings(const USkeletalMesh* SkeletalMesh, const FBetterPAGenerationSettings& Settings, FBetterPAGenerationSettings& OutCoarseSettings);
+
+	/**
+	 * Replaces the bodies and constraints of the physics asset with the result. Objects are named after their bones, so equal results serialize identically.
+	 * Existing bodies and constraints are matched by bone and only modified when their data differs, so an enclosing transaction records the asset's arrays and the changed objects only.
+	 */
+	static FBetterPAApplyStats ApplyResult(UPhysicsAsset* PhysicsAsset, const FBetterPAGenerationResult& Result);
+
+	// ApplyResult as one undoable transaction, logs what changed and how much undo memory it took
+	static FBetterPAApplyStats ApplyResultTransacted(UPhysicsAsset* PhysicsAsset, const FBetterPAGenerationResult& Result, const FText& Description);
+
+private:
+	static bool GenerateInternal(const USkeletalMesh* SkeletalMesh, const TSet<FName>& SelectedBones, const FBetterPAGenerationSettings& Settings, const TSet<FName>* DirtyBones, const FBetterPAGenerationResult* Previous, FBetterPAGenerationResult& OutResult, const FThreadSafeBool* Cancelled);
 };
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPhysicsAsset;
+struct FReferenceSkeleton;
+struct FBetterPAGenerationResult;
+struct FBetterPAGenerationSettings;
+
+/**
+ * Binary interchange for generation results, for DCC tools and for moving results between branches without .uasset files.
+ *
+ * Layout: an FHeader at offset 0, then one section per record type. Every section starts at an 8-byte aligned offset from the
+ * start of the file and holds Count tightly packed records, so a reader maps the file and casts instead of parsing.
+ * All values are little-endian; floats are IEEE-754 single precision, vectors are X, Y, Z and rotators Pitch, Yaw, Roll in degrees.
+ * Names are stored once in NameData as UTF-8 and referenced by index; NameOffsets has one entry per name plus a final end offset.
+ * Body, constraint and shape references are indices into their sections. Version changes whenever a record changes.
+ */
+namespace BetterPA::Interchange
+{
+	constexpr uint32 Magic = 0x58415042; // "BPAX"
+	constexpr uint32 Version = 2;
+
+	struct FSection
+	{
+		uint64 Offset;
+		uint64 Count;
+	};
+
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 HeaderSize;
+		uint32 Reserved;
+
+		FSection Bodies;
+		FSection Shapes;
+		FSection Hulls;
+		FSection HullVertices;
+		FSection Constraints;
+		FSection Profiles;
+		FSection ProfileNames;
+		FSection DisabledPairs;
+		FSection NameOffsets;
+		FSection NameData;
+		// Generation settings as UE property text, empty when exported from an asset
+		FSection Settings;
+	};
+
+	enum class EShapeType : uint8
+	{
+		Sphyl,
+		Sphere,
+		Box
+	};
+
+	struct FBodyRecord
+	{
+		uint32 Name;
+		int32 ParentBody;
+		uint32 FirstShape;
+		uint32 NumShapes;
+		uint32 FirstHull;
+		uint32 NumHulls;
+		// Mass override in kg, 0 when the engine default is used
+		float Mass;
+		float LinearDamping;
+		float AngularDamping;
+		float SleepThresholdMultiplier;
+		// EPhysicsType, ECollisionEnabled::Type and EBetterPABodyClass
+		uint8 PhysicsType;
+		uint8 CollisionEnabled;
+		uint8 Class;
+		uint8 Padding;
+	};
+
+	// Bone space; Radius and Length for capsules and spheres, Extent (full size) for boxes
+	struct FShapeRecord
+	{
+		uint8 Type;
+		uint8 Padding[3];
+		float Center[3];
+		float Rotation[3];
+		float Radius;
+		float Length;
+		float Extent[3];
+	};
+
+	// Convex hull, vertices in the space given by the hull's transform relative to the bone
+	struct FHullRecord
+	{
+		uint32 FirstVertex;
+		uint32 NumVertices;
+		float Translation[3];
+		float Rotation[4];
+	};
+
+	struct FVertexRecord
+	{
+		float Position[3];
+	};
+
+	// One constraint drive; the enable flags are 0 or 1
+	struct FDriveRecord
+	{
+		float Stiffness;
+		float Damping;
+		float MaxForce;
+		uint8 bPositionDrive;
+		uint8 bVelocityDrive;
+		uint8 Padding[2];
+	};
+
+	// Frame 1 is relative to the child bone, frame 2 to the parent bone
+	struct FConstraintRecord
+	{
+		int32 ChildBody;
+		int32 ParentBody;
+		float Pos1[3];
+		float PriAxis1[3];
+		float SecAxis1[3];
+		float Pos2[3];
+		float PriAxis2[3];
+		float SecAxis2[3];
+		// Only meaningful on limited axes
+		float Swing1Limit;
+		float Swing2Limit;
+		float TwistLimit;
+		uint32 FirstProfile;
+		uint32 NumProfiles;
+		// EAngularConstraintMotion for swing 1, swing 2 and twist, ELinearConstraintMotion for X, Y and Z, then EAngularDriveMode
+		uint8 AngularMotion[3];
+		uint8 LinearMotion[3];
+		uint8 AngularDriveMode;
+		uint8 Padding;
+		// Shared by the limited linear axes
+		float LinearLimit;
+		// Slerp, twist and swing drives, then the X, Y and Z drives
+		FDriveRecord AngularDrives[3];
+		FDriveRecord LinearDrives[3];
+		// Rotator, then revolutions per second about X, Y and Z
+		float OrientationTarget[3];
+		float AngularVelocityTarget[3];
+		float PositionTarget[3];
+		float VelocityTarget[3];
+	};
+
+	struct FProfileRecord
+	{
+		uint32 Name;
+		float Swing1Limit;
+		float Swing2Limit;
+		float TwistLimit;
+		float LimitStiffness;
+		float LimitDamping;
+		float DriveStiffness;
+		float DriveDamping;
+	};
+
+	struct FPairRecord
+	{
+		int32 BodyA;
+		int32 BodyB;
+	};
+}
+
+class BETTERPA_API FBetterPAInterchange
+{
+public:
+	// Serializes the result, and the settings that produced it if given
+	static void Write(const FBetterPAGenerationResult& Result, const FBetterPAGenerationSettings* Settings, TArray<uint8>& OutData);
+
+	/**
+	 * Rebuilds a result for the skeleton straight from the records, matching bodies to bones by name with one hash lookup each.
+	 * Bodies whose bone the skeleton lacks are dropped along with their constraints and pairs; their children attach to the nearest kept ancestor.
+	 * Data only needs to outlive the call and be 8-byte aligned, as a mapped file or a loaded array is.
+	 * OutSettings is set when the file carries the settings the result was generated with.
+	 */
+	static bool Read(TConstArrayView<uint8> Data, const FReferenceSkeleton& RefSkeleton, FBetterPAGenerationResult& OutResult, TOptional<FBetterPAGenerationSettings>* OutSettings, FString& OutError);
+
+	// Line per record with exact float values, for diffs
+	static bool ToText(TConstArrayView<uint8> Data, FString& OutText, FString& OutError);
+
+	// Reads the asset's current bodies, constraints with their motion and drives, profiles and disabled pairs back into a result
+	static void ResultFromAsset(const UPhysicsAsset* PhysicsAsset, FBetterPAGenerationResult& OutResult);
+
+	// Writes FilePath and a .txt dump next to it
+	static bool SaveToFile(const FString& FilePath, const FBetterPAGenerationResult& Result, const FBetterPAGenerationSettings* Settings);
+
+	// Maps the file when the platform supports it
+	static bool LoadFromFile(const FString& FilePath, const FReferenceSkeleton& RefSkeleton, FBetterPAGenerationResult& OutResult, TOptional<FBetterPAGenerationSettings>* OutSettings, FString& OutError);
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FBetterPAGenerationResult;
+
+struct FBetterPAJointLimitSettings
+{
+	// Range a swept limit is clamped to (degrees)
+	float MinLimit = 5.0f;
+	float MaxSwingLimit = 120.0f;
+	float MaxTwistLimit = 90.0f;
+
+	// Extra overlap (cm) the child may build up with a neighbour beyond what it has in the reference pose
+	float Tolerance = 0.5f;
+
+	// Even steps towards the maximum until the first contact, then bisection steps between the last free and the first blocked angle
+	int32 CoarseSteps = 8;
+	int32 BisectionSteps = 6;
+};
+
+class BETTERPA_API FBetterPAJointLimitSweep
+{
+public:
+	/**
+	 * Replaces the swing and twist limits of the given constraints with the angles at which the child's shapes start
+	 * penetrating the parent's or a colliding sibling's. The child is rotated about the joint around each frame axis in
+	 * both directions and the smaller angle becomes the symmetric limit. Neighbours out of the child's reach are culled
+	 * up front, so a direction with nothing to hit ends at the maximum without stepping.
+	 * Joints run in parallel. BoneTransforms are component space and indexed by bone; only capsules and spheres are swept.
+	 * Returns how many constraints had a limit tightened below its maximum.
+	 */
+	static int32 Sweep(FBetterPAGenerationResult& Result, const TArray<FTransform>& BoneTransforms, TConstArrayView<int32> ConstraintIndices, const FBetterPAJointLimitSettings& Settings);
+};
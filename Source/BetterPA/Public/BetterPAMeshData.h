@@ -0,0 +1,167 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GPUSkinPublicDefs.h"
+
+class USkeletalMesh;
+struct FReferenceSkeleton;
+struct FSkelMeshSection;
+struct FSoftSkinVertex;
+
+// Skin weight a vertex gives each body, several bones can fold into the same body
+typedef TArray<TPair<int32, float>, TInlineAllocator<MAX_TOTAL_INFLUENCES>> FBetterPABodyWeights;
+
+// Struct-of-arrays point set, laid out for the vectorized shape kernels
+struct FBetterPAPointBucket
+{
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Z;
+
+	int32 Num() const { return X.Num(); }
+
+	void Add(const FVector3f& Point)
+	{
+		X.Add(Point.X);
+		Y.Add(Point.Y);
+		Z.Add(Point.Z);
+	}
+
+	FVector3f Get(int32 Index) const
+	{
+		return FVector3f(X[Index], Y[Index], Z[Index]);
+	}
+
+	void Reserve(int32 Count)
+	{
+		X.Reserve(Count);
+		Y.Reserve(Count);
+		Z.Reserve(Count);
+	}
+
+	void Reset()
+	{
+		X.Reset();
+		Y.Reset();
+		Z.Reset();
+	}
+};
+
+// A run of consecutive vertices of one section, viewed in place in the LOD model
+struct FBetterPAVertexChunk
+{
+	const FSkelMeshSection* Section = nullptr;
+	int32 SectionIndex = INDEX_NONE;
+
+	// Index of the first vertex within the section
+	int32 FirstVertex = 0;
+	TConstArrayView<FSoftSkinVertex> Vertices;
+};
+
+struct FBetterPAVertexStreamSettings
+{
+	int32 LODIndex = 0;
+
+	// Vertices per chunk
+	int32 ChunkSize = 16384;
+
+	// Chunks processed in parallel between merges. Fixed rather than derived from the worker count, so results do not depend on it.
+	int32 ChunksPerWave = 16;
+};
+
+struct FBetterPAVertexStreamStats
+{
+	int64 NumVertices = 0;
+	int32 NumChunks = 0;
+
+	// Most memory the stream and its consumer's per-slot state held at once
+	SIZE_T PeakBytes = 0;
+
+	// What copying the vertices out of the LOD model would have taken, for comparison
+	SIZE_T CopyBytes = 0;
+};
+
+class BETTERPA_API FBetterPAVertexStream
+{
+public:
+	/**
+	 * Walks the enabled sections of the imported LOD model in fixed-size chunks without copying any vertex.
+	 * Each wave hands up to ChunksPerWave chunks to ProcessChunk in parallel, each with its own slot in [0, ChunksPerWave),
+	 * then calls MergeSlot for every used slot in chunk order, so consumers only keep one partial result per slot.
+	 * SlotBytes is the consumer's memory per slot, only used for the peak memory report.
+	 */
+	static bool Run(const USkeletalMesh* SkeletalMesh, const FBetterPAVertexStreamSettings& Settings, SIZE_T SlotBytes,
+		TFunctionRef<void(int32 Slot, const FBetterPAVertexChunk& Chunk)> ProcessChunk, TFunctionRef<void(int32 Slot)> MergeSlot, FBetterPAVertexStreamStats& OutStats);
+};
+
+// Running totals of the vertices weighted to one body, positions in the space of the body's bone
+struct BETTERPA_API FBetterPABodyVertexStats
+{
+	int32 NumVertices = 0;
+	double WeightSum = 0.0;
+	FVector PositionSum = FVector::ZeroVector;
+	FBox3f Bounds = FBox3f(ForceInit);
+
+	void Add(const FVector3f& LocalPosition, float Weight)
+	{
+		++NumVertices;
+		WeightSum += Weight;
+		PositionSum += FVector(LocalPosition);
+		Bounds += LocalPosition;
+	}
+
+	void Merge(const FBetterPABodyVertexStats& Other)
+	{
+		NumVertices += Other.NumVertices;
+		WeightSum += Other.WeightSum;
+		PositionSum += Other.PositionSum;
+		Bounds += Other.Bounds;
+	}
+
+	FVector GetCentroid() const
+	{
+		return NumVertices > 0 ? PositionSum / NumVertices : FVector::ZeroVector;
+	}
+};
+
+// Skinned vertices of a mesh LOD, bucketed per body and expressed in the space of the body's bone
+struct BETTERPA_API FBetterPAVertexBuckets
+{
+	// One bucket per body
+	TArray<FBetterPAPointBucket> Buckets;
+
+	// Number of mesh vertices read, including ones that landed in no bucket
+	int32 NumSourceVertices = 0;
+
+	// Per body, the vertices weighted to it before the point cap
+	TArray<int32> NumBodyVertices;
+
+	/**
+	 * Streams the imported LOD model and adds every vertex to the bucket of each body it is weighted to by at least MinWeight.
+	 * BoneToBody maps each reference skeleton bone to its owning body (or INDEX_NONE).
+	 * BodyBoneTransforms holds the component space reference pose of each body's bone.
+	 * With MaxPointsPerBody set, each bucket is a uniform reservoir sample of that size, filled in chunk order with a stream
+	 * seeded by body index, so memory depends on the budget rather than the mesh and the sample does not depend on scheduling.
+	 */
+	bool Build(const USkeletalMesh* SkeletalMesh, int32 LODIndex, const TArray<int32>& BoneToBody, const TArray<FTransform>& BodyBoneTransforms, float MinWeight, int32 MaxPointsPerBody = 0);
+
+	// Peak memory of the last Build, streamed chunk buckets included
+	FBetterPAVertexStreamStats StreamStats;
+};
+
+namespace BetterPA
+{
+	// Maps every bone to the nearest body at or above it in the hierarchy.
+	// Relies on the reference skeleton storing parents before their children.
+	BETTERPA_API void MapBonesToBodies(const FReferenceSkeleton& RefSkeleton, TFunctionRef<int32(FName)> FindBodyIndex, TArray<int32>& OutBoneToBody);
+
+	/**
+	 * Per-body vertex counts, weights, centroids and bounds over a LOD, streamed so only one set of totals per slot is held.
+	 * Arguments as for FBetterPAVertexBuckets::Build; OutBodyStats gets one entry per body transform.
+	 */
+	BETTERPA_API bool GatherBodyVertexStats(const USkeletalMesh* SkeletalMesh, const FBetterPAVertexStreamSettings& Settings, const TArray<int32>& BoneToBody, const TArray<FTransform>& BodyBoneTransforms, float MinWeight,
+		TArray<FBetterPABodyVertexStats>& OutBodyStats, FBetterPAVertexStreamStats& OutStreamStats);
+
+	// Sums the vertex's influence weights per body and returns the total weight over all bones, bodies or not
+	BETTERPA_API float AccumulateBodyWeights(const FSkelMeshSection& Section, const FSoftSkinVertex& Vertex, const TArray<int32>& BoneToBody, FBetterPABodyWeights& OutBodyWeights);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace BetterPA
+{
+	/**
+	 * Parallel loop used by every generation stage. Each index must only write its own outputs,
+	 * so results never depend on how many workers run it or in which order.
+	 */
+	BETTERPA_API void ParallelFor(int32 Num, TFunctionRef<void(int32)> Body);
+
+	// Worker cap for ParallelFor, 0 for no cap
+	BETTERPA_API int32 GetMaxWorkers();
+
+	// Caps the workers of every generation loop for the scope's lifetime, used to check that output does not depend on thread count
+	struct BETTERPA_API FScopedMaxWorkers
+	{
+		explicit FScopedMaxWorkers(int32 MaxWorkers);
+		~FScopedMaxWorkers();
+
+	private:
+		int32 PreviousMaxWorkers;
+	};
+}
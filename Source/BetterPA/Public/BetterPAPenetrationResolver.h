@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FBetterPAGenerationResult;
+struct FBetterPAPenetrationFix;
+
+class BETTERPA_API FBetterPAPenetrationResolver
+{
+public:
+	/**
+	 * Separates capsules and spheres that start out interpenetrating a body they still collide with.
+	 * Candidate pairs come from a uniform grid over the shape bounds, so the pass stays close to linear in the number of bodies.
+	 * Each pair is fixed with the smaller relative change: shortening a capsule whose end cap causes the overlap, or shrinking both radii in proportion.
+	 * Every capsule and sphere element of a body takes part, and the contacts are swept again until a pass changes nothing, up to a fixed number of passes.
+	 * BoneTransforms are component space and indexed by bone. Convex bodies and bodies without physics collision are left alone.
+	 * Radii never drop below BetterPA::MinCapsuleRadius; overlaps still left when the passes stop are reported in the fixes' ResidualDepth.
+	 */
+	static void Resolve(FBetterPAGenerationResult& Result, const TArray<FTransform>& BoneTransforms, float Margin, TArray<FBetterPAPenetrationFix>& OutFixes);
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USkeletalMesh;
+class UAnimSequence;
+struct FBetterPAVertexBuckets;
+
+struct FBetterPAPoseSamplingSettings
+{
+	// Frames sampled evenly over each animation, the reference pose is always included
+	int32 SamplesPerAnimation = 8;
+
+	int32 LODIndex = 0;
+	float MinSkinWeight = 0.5f;
+
+	// Points kept per body over all samples, the rest are dropped by reservoir sampling
+	int32 MaxPointsPerBody = 4096;
+};
+
+class BETTERPA_API FBetterPAPoseSampler
+{
+public:
+	/**
+	 * Skins the mesh on the CPU for every sampled frame and fills each body's bucket with the union of its vertices,
+	 * expressed in the space of the body's bone in that frame.
+	 * Frames are streamed one at a time and bodies are skinned in parallel, so memory stays bounded by the mesh and the reservoirs.
+	 * Animations must use the mesh's skeleton and stay loaded for the duration of the call.
+	 */
+	static bool BuildBuckets(const USkeletalMesh* SkeletalMesh, TConstArrayView<const UAnimSequence*> Animations, const TArray<int32>& BoneToBody, const TArray<int32>& BodyBoneIndices, const FBetterPAPoseSamplingSettings& Settings, FBetterPAVertexBuckets& OutBuckets);
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FKSphereElem;
+struct FKSphylElem;
+struct FKBoxElem;
+struct FKConvexElem;
+struct FKAggregateGeom;
+
+enum class EBetterPAShapeType : uint8
+{
+	Sphere,
+	Capsule,
+	Box,
+	Convex
+};
+
+// A body element reduced to what the distance kernels need.
+// Points are expected in the space of the owning bone.
+struct BETTERPA_API FBetterPAShapeProxy
+{
+	EBetterPAShapeType Type = EBetterPAShapeType::Sphere;
+
+	// Element origin and unit axes, in bone space
+	FVector3f Center = FVector3f::ZeroVector;
+	FVector3f AxisX = FVector3f(1, 0, 0);
+	FVector3f AxisY = FVector3f(0, 1, 0);
+	FVector3f AxisZ = FVector3f(0, 0, 1);
+
+	// Sphere: (Radius, 0, 0). Capsule: (Radius, HalfLength, 0). Box: half extents.
+	FVector3f Extent = FVector3f::ZeroVector;
+
+	// Convex: outward face planes in element space. The largest plane distance is exact inside and on face regions,
+	// and underestimates by at most the edge rounding outside edges and corners.
+	TArray<FPlane4f> Planes;
+
+	static FBetterPAShapeProxy FromSphere(const FKSphereElem& Elem);
+	static FBetterPAShapeProxy FromCapsule(const FKSphylElem& Elem);
+	static FBetterPAShapeProxy FromBox(const FKBoxElem& Elem);
+
+	// Uses the cooked hull's faces, its bounding box when the hull has not been cooked
+	static FBetterPAShapeProxy FromConvex(const FKConvexElem& Elem);
+
+	// Appends one proxy per element of the aggregate
+	static void GatherFromAggGeom(const FKAggregateGeom& AggGeom, TArray<FBetterPAShapeProxy>& OutProxies);
+};
+
+namespace BetterPA
+{
+	// Signed distance (negative inside) from Num struct-of-arrays points to a single shape.
+	// Four points are processed per vector instruction; the remainder falls back to scalar code.
+	BETTERPA_API void ComputeSignedDistances(const FBetterPAShapeProxy& Shape, const float* X, const float* Y, const float* Z, int32 Num, float* OutDistances);
+
+	// Minimum signed distance from each point to any of the shapes. OutDistances must hold Num floats.
+	BETTERPA_API void ComputeMinSignedDistances(TArrayView<const FBetterPAShapeProxy> Shapes, const float* X, const float* Y, const float* Z, int32 Num, float* OutDistances);
+
+	// Scalar reference used for tails and validation
+	BETTERPA_API float ComputeSignedDistance(const FBetterPAShapeProxy& Shape, const FVector3f& Point);
+}
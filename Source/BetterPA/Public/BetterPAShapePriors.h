@@ -0,0 +1,101 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPhysicsAsset;
+
+// Running sums for one bone name pattern, kept as sums so an asset's share can be taken out again when it changes
+struct FBetterPAShapePriorSums
+{
+	// Capsules normalized by the distance from their bone to the next body down the hierarchy (or up it for leaf bodies)
+	int32 NumShapes = 0;
+	double RadiusRatio = 0.0;
+	double LengthRatio = 0.0;
+	double OffsetRatio = 0.0;
+
+	// Limits of the constraint joining the bone's body to its parent, limited axes only
+	int32 NumLimits = 0;
+	double Swing1Limit = 0.0;
+	double Swing2Limit = 0.0;
+	double TwistLimit = 0.0;
+
+	void Accumulate(const FBetterPAShapePriorSums& Other);
+
+	friend FArchive& operator<<(FArchive& Ar, FBetterPAShapePriorSums& Sums);
+};
+
+// What one physics asset contributed, and the package time stamp it was read at
+struct FBetterPAShapePriorSource
+{
+	FDateTime TimeStamp;
+	TMap<FString, FBetterPAShapePriorSums> Patterns;
+
+	friend FArchive& operator<<(FArchive& Ar, FBetterPAShapePriorSource& Source);
+};
+
+// Per-bone shape and limit priors learned from hand-tuned physics assets, keyed by bone name pattern
+struct BETTERPA_API FBetterPAShapePriorTable
+{
+	// Totals over all sources, derived by RebuildPatterns and not saved
+	TMap<FString, FBetterPAShapePriorSums> Patterns;
+
+	// Keyed by package name
+	TMap<FString, FBetterPAShapePriorSource> Sources;
+
+	// Patterns with fewer samples are ignored
+	int32 MinSamples = 3;
+
+	/**
+	 * Mean capsule proportions for the bone. Ratios are relative to the bone's length as the generator measures it:
+	 * radius and cylinder length over bone length, and the capsule center's distance along the bone over bone length (0.5 is the midpoint).
+	 */
+	bool FindShape(FName BoneName, bool bLeaf, float& OutRadiusRatio, float& OutLengthRatio, float& OutOffsetRatio) const;
+
+	bool FindLimits(FName BoneName, float& OutSwing1Limit, float& OutSwing2Limit, float& OutTwistLimit) const;
+
+	// Sums the sources in package order, so the totals do not depend on the order assets were read in
+	void RebuildPatterns();
+
+	void Serialize(FArchive& Ar);
+	bool Save(const FString& FilePath) const;
+	bool Load(const FString& FilePath);
+
+	// Saved/BetterPA/ShapePriors.bin
+	static FString GetDefaultPath();
+};
+
+struct FBetterPAShapePriorSettings
+{
+	// Content folders to scan recursively, /Game when empty
+	TArray<FName> PackagePaths;
+
+	// Physics assets loaded at once
+	int32 BatchSize = 32;
+
+	// Rescan every asset instead of only the ones whose package changed
+	bool bFullRebuild = false;
+};
+
+class BETTERPA_API FBetterPAShapePriors
+{
+public:
+	/**
+	 * Bone name with side markers, digits and rig prefixes stripped, so left and right bones and numbered segments share a prior.
+	 * E.g. "upperarm_l", "Bip01 R UpperArm" and "mixamorig:LeftArm" become "upperarm", "upperarm" and "arm".
+	 */
+	static FString MakeBonePattern(FName BoneName);
+
+	// Reads the asset's capsules and limits normalized by its preview mesh's reference pose. Read only, so assets can be scanned in parallel.
+	static bool ExtractAsset(const UPhysicsAsset* PhysicsAsset, FBetterPAShapePriorSource& OutSource);
+
+	/**
+	 * Brings the table up to date with the physics assets under the settings' paths.
+	 * Only assets whose package changed on disk since they were last read are loaded, in batches, and scanned in parallel; deleted assets are taken out.
+	 * Assets with a generation record are skipped and taken out, so the priors never learn from the generator's own output.
+	 * Returns the number of assets read.
+	 */
+	static int32 Update(FBetterPAShapePriorTable& Table, const FBetterPAShapePriorSettings& Settings);
+
+	// The table at the default path, or null if none was built yet
+	static TSharedPtr<const FBetterPAShapePriorTable> LoadDefault();
+};
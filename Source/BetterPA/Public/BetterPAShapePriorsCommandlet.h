@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BetterPAShapePriorsCommandlet.generated.h"
+
+/**
+ * Updates the shape prior table from the physics assets under the given content paths.
+ * Usage: -run=BetterPAShapePriors [-Paths=/Game/A+/Game/B] [-BatchSize=32] [-MinSamples=3] [-Full]
+ * Only assets changed since the last run are read unless -Full is given.
+ */
+UCLASS()
+class UBetterPAShapePriorsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBetterPAShapePriorsCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	// End of UCommandlet interface
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SCompoundWidget.h"
+#include "Widgets/Views/SListView.h"
+#include "Widgets/Views/SHeaderRow.h"
+#include "BetterPAAudit.h"
+
+class BETTERPA_API SBetterPAAuditReport : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SBetterPAAuditReport) {}
+		SLATE_ARGUMENT(TArray<FBetterPAAuditFinding>, Findings)
+		SLATE_ARGUMENT(FString, ReportPath)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs);
+
+private:
+	TSharedRef<ITableRow> OnGenerateRow(TSharedPtr<FBetterPAAuditFinding> Item, const TSharedRef<STableViewBase>& OwnerTable);
+	void OnSortModeChanged(EColumnSortPriority::Type Priority, const FName& ColumnId, EColumnSortMode::Type NewSortMode);
+	EColumnSortMode::Type GetColumnSortMode(FName ColumnId) const;
+	void SortItems();
+
+	FReply OnFix(TSharedPtr<FBetterPAAuditFinding> Item);
+	FText GetSummaryText() const;
+
+	TArray<TSharedPtr<FBetterPAAuditFinding>> Items;
+	TSharedPtr<SListView<TSharedPtr<FBetterPAAuditFinding>>> ListView;
+
+	FName SortColumn;
+	EColumnSortMode::Type SortMode;
+	FString ReportPath;
+};
@@ -20,11 +20,15 @@ struct FBetterPABoneItem
 	{}
 };
 
+// Fired with every bone whose check state changed and the resulting selection
+DECLARE_DELEGATE_TwoParams(FOnBetterPABonesToggled, const TArray<FName>& /*ToggledBones*/, const TSet<FName>& /*SelectedBones*/);
+
 class BETTERPA_API SBetterPABonePicker : public SCompoundWidget
 {
 public:
 	SLATE_BEGIN_ARGS(SBetterPABonePicker) {}
 		SLATE_ARGUMENT(USkeletalMesh*, SkeletalMesh)
+		SLATE_EVENT(FOnBetterPABonesToggled, OnBonesToggled)
 	SLATE_END_ARGS()
 
 	void Construct(const FArguments& InArgs);
@@ -38,10 +42,11 @@ private:
 	void OnCheckStateChanged(ECheckBoxState NewState, TSharedPtr<FBetterPABoneItem> Item);
 	ECheckBoxState GetCheckState(TSharedPtr<FBetterPABoneItem> Item) const;
 	
-	void RecursivelySetSelection(TSharedPtr<FBetterPABoneItem> Item, bool bSelected);
+	void RecursivelySetSelection(TSharedPtr<FBetterPABoneItem> Item, bool bSelected, TArray<FName>& OutToggledBones);
 	void CollectSelectedBones(TSharedPtr<FBetterPABoneItem> Item, TSet<FName>& OutSelectedBones) const;
 
 	USkeletalMesh* SkeletalMesh;
 	TArray<TSharedPtr<FBetterPABoneItem>> RootItems;
 	TSharedPtr<STreeView<TSharedPtr<FBetterPABoneItem>>> TreeView;
+	FOnBetterPABonesToggled OnBonesToggled;
 };
@@ -2,43 +2,84 @@
 
 #include "CoreMinimal.h"
 #include "Widgets/SCompoundWidget.h"
+#include "Widgets/Views/SListView.h"
 #include "PhysicsEngine/PhysicsAsset.h"
+#include "EditorUndoClient.h"
+#include "BetterPAConstraintBuilder.h"
 
 class UPhysicsAsset;
+class UPhysicsConstraintTemplate;
 class SGraphPanel;
-class UEdGraph;
+class UBetterPAConstraintEdGraph;
+struct FPropertyChangedEvent;
 
-enum class EConstraintGenerationMode
+struct FBetterPABodyListItem
 {
-	Standard,
-	Mesh
+	FName BoneName;
+	int32 BodyIndex = INDEX_NONE;
+
+	// Lower case bone name, computed once and used for both sorting and filtering
+	FString SearchKey;
 };
 
-class BETTERPA_API SBetterPAConstraintGraph : public SCompoundWidget
+class BETTERPA_API SBetterPAConstraintGraph : public SCompoundWidget, public FEditorUndoClient
 {
 public:
 	SLATE_BEGIN_ARGS(SBetterPAConstraintGraph) {}
 		SLATE_ARGUMENT(UPhysicsAsset*, PhysicsAsset)
 	SLATE_END_ARGS()
 
+	virtual ~SBetterPAConstraintGraph() override;
+
 	void Construct(const FArguments& InArgs);
 
+	// FEditorUndoClient interface
+	virtual void PostUndo(bool bSuccess) override;
+	virtual void PostRedo(bool bSuccess) override;
+	// End of FEditorUndoClient interface
+
 private:
 	UPhysicsAsset* PhysicsAsset;
 	TSharedPtr<SGraphPanel> GraphPanel;
-	UEdGraph* GraphObj;
+	UBetterPAConstraintEdGraph* GraphObj;
 	
-	// Settings
-	EConstraintGenerationMode CurrentMode;
-	bool bScaleByDistance;
-	float ScalingFactor;
+	// Settings, constraint settings live on the graph so live edits use them too
+	bool bCollapseChains;
+	int32 MinChainLength;
 
 	void CreateGraph();
 	TSharedRef<SWidget> CreateBodyList();
 	TSharedRef<SWidget> CreateSettingsPanel();
-	
-	FReply OnAddBodyNode(FName BoneName, int32 BodyIndex);
+
+	// Body list
+	TSharedRef<ITableRow> OnGenerateBodyRow(TSharedPtr<FBetterPABodyListItem> Item, const TSharedRef<STableViewBase>& OwnerTable);
+	void OnBodyFilterChanged(const FText& NewText);
+	void OnBodyDoubleClicked(TSharedPtr<FBetterPABodyListItem> Item);
+	FReply OnAddSelectedBodies();
+	bool IsBoneInGraph(FName BoneName) const;
+
+	// Adds a node per body not yet in the graph and notifies the graph once
+	void AddBodyNodes(TConstArrayView<TSharedPtr<FBetterPABodyListItem>> Items);
+
+	TArray<TSharedPtr<FBetterPABodyListItem>> BodyItems;
+	TArray<TSharedPtr<FBetterPABodyListItem>> FilteredBodyItems;
+	TSharedPtr<SListView<TSharedPtr<FBetterPABodyListItem>>> BodyListView;
+	FString BodyFilter;
+
 	FReply OnApplyChanges();
+	FReply OnLoadFromAsset();
+
+	// External edits to the asset, synced on the next tick once the edit is complete
+	void OnObjectModified(UObject* Object);
+	void OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent);
+	void QueueAssetSync(UObject* Object);
+	EActiveTimerReturnType OnDeferredAssetSync(double InCurrentTime, float InDeltaTime);
+
+	FDelegateHandle ObjectModifiedHandle;
+	FDelegateHandle ObjectPropertyChangedHandle;
+	TSet<TWeakObjectPtr<UPhysicsConstraintTemplate>> PendingConstraintSyncs;
+	bool bPendingAssetSync;
+	bool bAssetSyncScheduled;
 
 	// UI Callbacks
 	void OnModeChanged(ECheckBoxState NewState, EConstraintGenerationMode Mode);
@@ -51,4 +92,17 @@ private:
 	float GetScalingFactor() const;
 	
 	bool IsMeshSettingsEnabled() const;
+
+	void OnRagdollProfilesChanged(ECheckBoxState NewState);
+	ECheckBoxState GetRagdollProfilesCheckState() const;
+	FReply OnWriteProfiles();
+
+	void OnLiveSyncChanged(ECheckBoxState NewState);
+	ECheckBoxState GetLiveSyncCheckState() const;
+
+	void OnCollapseChainsChanged(ECheckBoxState NewState);
+	ECheckBoxState GetCollapseChainsCheckState() const;
+
+	void OnMinChainLengthChanged(int32 NewValue);
+	int32 GetMinChainLength() const;
 };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SCompoundWidget.h"
+#include "Widgets/Views/SListView.h"
+#include "Widgets/Views/SHeaderRow.h"
+#include "BetterPAFitAnalysis.h"
+
+class BETTERPA_API SBetterPAFitReport : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SBetterPAFitReport) {}
+		SLATE_ARGUMENT(TArray<FBetterPABodyFitStats>, Stats)
+		SLATE_ARGUMENT(FString, ReportPath)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs);
+
+private:
+	TSharedRef<ITableRow> OnGenerateRow(TSharedPtr<FBetterPABodyFitStats> Item, const TSharedRef<STableViewBase>& OwnerTable);
+	void OnSortModeChanged(EColumnSortPriority::Type Priority, const FName& ColumnId, EColumnSortMode::Type NewSortMode);
+	EColumnSortMode::Type GetColumnSortMode(FName ColumnId) const;
+	void SortItems();
+
+	TArray<TSharedPtr<FBetterPABodyFitStats>> Items;
+	TSharedPtr<SListView<TSharedPtr<FBetterPABodyFitStats>>> ListView;
+
+	FName SortColumn;
+	EColumnSortMode::Type SortMode;
+	int32 NumOutliers;
+	FString ReportPath;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SEditorViewport.h"
+#include "PreviewScene.h"
+#include "Async/Future.h"
+#include "HAL/ThreadSafeBool.h"
+#include "BetterPAGenerator.h"
+
+class USkeletalMesh;
+class USkeletalMeshComponent;
+class FBetterPAPreviewViewportClient;
+class FActiveTimerHandle;
+
+// Draws an in-memory generation result over the mesh and keeps it up to date as the bone selection changes
+class BETTERPA_API SBetterPAPreviewViewport : public SEditorViewport
+{
+public:
+	SLATE_BEGIN_ARGS(SBetterPAPreviewViewport) {}
+		SLATE_ARGUMENT(USkeletalMesh*, SkeletalMesh)
+	SLATE_END_ARGS()
+
+	SBetterPAPreviewViewport();
+	virtual ~SBetterPAPreviewViewport() override;
+
+	void Construct(const FArguments& InArgs);
+
+	/**
+	 * Schedules a debounced regeneration off the UI thread.
+	 * Only bodies affected by DirtyBones are refitted; pass bFullRebuild when the settings changed.
+	 * A full rebuild cancels the one in flight and first shows a coarse fit from the lowest LOD while the full fit runs.
+	 */
+	void RequestUpdate(const TSet<FName>& SelectedBones, const TArray<FName>& DirtyBones, const FBetterPAGenerationSettings& Settings, bool bFullRebuild);
+
+	// Refined result matching the latest request, or null while an update is still pending or only the coarse fit is shown
+	TSharedPtr<const FBetterPAGenerationResult> GetUpToDateResult() const;
+
+	// True while the viewport shows the coarse fit and the refined one is being computed
+	bool IsRefining() const { return bShowingCoarse; }
+	int32 GetCoarseLODIndex() const { return CoarseLODIndex; }
+
+	TSharedPtr<const FBetterPAGenerationResult> GetCurrentResult() const { return CurrentResult; }
+
+protected:
+	// SEditorViewport interface
+	virtual TSharedRef<FEditorViewportClient> MakeEditorViewportClient() override;
+	// End of SEditorViewport interface
+
+private:
+	EActiveTimerReturnType OnDebounceElapsed(double InCurrentTime, float InDeltaTime);
+	void StartPendingUpdate();
+	void OnCoarseResult(TSharedPtr<const FBetterPAGenerationResult> CoarseResult, int32 LODIndex, int32 Revision);
+	void OnUpdateFinished(TSharedPtr<const FBetterPAGenerationResult> NewResult, int32 Revision);
+
+	USkeletalMesh* SkeletalMesh;
+	FPreviewScene PreviewScene;
+	USkeletalMeshComponent* PreviewComponent;
+	TSharedPtr<FBetterPAPreviewViewportClient> PreviewClient;
+
+	// Last refined result, the coarse fit is only ever handed to the viewport client
+	TSharedPtr<const FBetterPAGenerationResult> CurrentResult;
+	bool bShowingCoarse;
+	int32 CoarseLODIndex;
+
+	// Request accumulated while the debounce timer is running
+	TSet<FName> PendingSelectedBones;
+	TSet<FName> PendingDirtyBones;
+	FBetterPAGenerationSettings PendingSettings;
+	bool bPendingFullRebuild;
+	bool bHasPendingRequest;
+
+	int32 RequestRevision;
+	int32 ResultRevision;
+
+	TWeakPtr<FActiveTimerHandle> DebounceTimer;
+	TFuture<void> UpdateTask;
+	TSharedPtr<FThreadSafeBool> UpdateCancelled;
+	bool bUpdateInFlight;
+};